@@ -0,0 +1,56 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightDirection;
+} frame;
+
+// MaterialParameters of the material system
+struct Material
+{
+    vec4 baseColor;
+    vec4 emissive;
+    float roughness;
+    float metallic;
+    float alphaCutoff;
+    uint flags;
+    uint baseColorTexture;
+    uint normalTexture;
+    uint emissiveTexture;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Materials
+{
+    Material materials[];
+};
+
+layout(set = 0, binding = 4) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) flat in uint inMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+vec4 sampleTexture(uint textureIndex, vec2 uv)
+{
+    return textureIndex == NO_TEXTURE ? vec4(1.0) : texture(textures[nonuniformEXT(textureIndex)], uv);
+}
+
+// Alpha tested, the texture alpha below the cutoff of the material is discarded, diffuse lighting on both faces
+void main()
+{
+    Material material = materials[inMaterialId];
+    vec4 albedo = material.baseColor * sampleTexture(material.baseColorTexture, inUV);
+    if (albedo.a < material.alphaCutoff) discard;
+    vec3 normal = normalize(inNormal) * (gl_FrontFacing ? 1.0 : -1.0);
+    float diffuse = max(dot(normal, -frame.lightDirection.xyz), 0.0);
+    outColor = vec4(albedo.rgb * (0.1 + 0.9 * diffuse), 1.0);
+}
@@ -0,0 +1,61 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightDirection;
+} frame;
+
+// MaterialParameters of the material system
+struct Material
+{
+    vec4 baseColor;
+    vec4 emissive;
+    float roughness;
+    float metallic;
+    float alphaCutoff;
+    uint flags;
+    uint baseColorTexture;
+    uint normalTexture;
+    uint emissiveTexture;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Materials
+{
+    Material materials[];
+};
+
+layout(set = 0, binding = 4) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) flat in uint inMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+vec4 sampleTexture(uint textureIndex, vec2 uv)
+{
+    return textureIndex == NO_TEXTURE ? vec4(1.0) : texture(textures[nonuniformEXT(textureIndex)], uv);
+}
+
+// Blinn-Phong with the roughness of the material mapped to the specular exponent
+void main()
+{
+    Material material = materials[inMaterialId];
+    vec3 albedo = material.baseColor.rgb * sampleTexture(material.baseColorTexture, inUV).rgb;
+    vec3 normal = normalize(inNormal);
+    vec3 lightDirection = -frame.lightDirection.xyz;
+    vec3 viewDirection = normalize(frame.cameraPosition.xyz - inPosition);
+    float diffuse = max(dot(normal, lightDirection), 0.0);
+    float exponent = exp2(10.0 * (1.0 - material.roughness) + 1.0);
+    float specular = pow(max(dot(normal, normalize(lightDirection + viewDirection)), 0.0), exponent) * (diffuse > 0.0 ? 1.0 : 0.0);
+    vec3 specularColor = mix(vec3(0.04), albedo, material.metallic);
+    vec3 color = albedo * (1.0 - material.metallic) * (0.1 + 0.9 * diffuse) + specularColor * specular;
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,45 @@
+#version 450
+
+// One draw per object, firstInstance is the object index into the instance streams
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightDirection;
+} frame;
+
+struct Transform
+{
+    vec4 rows[3];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Transforms
+{
+    Transform transforms[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer MaterialIds
+{
+    uint materialIds[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+
+layout(location = 0) out vec3 outPosition;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV;
+layout(location = 3) flat out uint outMaterialId;
+
+void main()
+{
+    Transform transform = transforms[gl_InstanceIndex];
+    mat4x3 model = transpose(mat3x4(transform.rows[0], transform.rows[1], transform.rows[2]));
+    outPosition = model * vec4(inPosition, 1.0);
+    outNormal = normalize(mat3(model) * inNormal);
+    outUV = inUV;
+    outMaterialId = materialIds[gl_InstanceIndex];
+    gl_Position = frame.viewProjection * vec4(outPosition, 1.0);
+}
@@ -0,0 +1,78 @@
+#version 450
+
+// Clustered forward shading: the fragment finds its cluster from its pixel and view depth and loops over the compacted
+// light list of the cluster. Naive shading loops over every light instead, for comparison
+
+struct Light
+{
+    vec4 positionRadius;
+    vec4 colorIntensity;
+};
+
+struct Cluster
+{
+    uint offset;
+    uint count;
+};
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    mat4 view;
+    vec4 cameraPosition;
+    vec4 projection;        // Tangents of the half field of view in x and y, near and far plane distances
+    uvec4 clusterGrid;      // Cluster counts in x, y and z, tile size in pixels
+    vec4 screen;            // Width, height, depth slice scale and bias
+    uint lightCount;
+    uint lightIndexCapacity;
+    uint naiveShading;
+} frame;
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights { Light lights[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Clusters { Cluster clusters[]; };
+layout(std430, set = 0, binding = 3) readonly buffer LightIndices { uint lightIndices[]; };
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in float inViewDepth;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 shadeLight(Light light, vec3 normal, vec3 viewDirection)
+{
+    vec3 toLight = light.positionRadius.xyz - inPosition;
+    float distanceSquared = dot(toLight, toLight);
+    float radius = light.positionRadius.w;
+    if (distanceSquared >= radius * radius) return vec3(0.0);
+
+    // Inverse square falloff windowed to reach zero at the radius
+    float window = 1.0 - distanceSquared * distanceSquared / (radius * radius * radius * radius);
+    float attenuation = window * window / (distanceSquared + 1.0);
+    vec3 direction = toLight * inversesqrt(distanceSquared);
+    float diffuse = max(dot(normal, direction), 0.0);
+    float specular = pow(max(dot(normal, normalize(direction + viewDirection)), 0.0), 32.0);
+    return light.colorIntensity.rgb * light.colorIntensity.w * attenuation * (diffuse + 0.5 * specular);
+}
+
+void main()
+{
+    vec3 normal = normalize(inNormal);
+    vec3 viewDirection = normalize(frame.cameraPosition.xyz - inPosition);
+    vec3 albedo = vec3(0.7);
+    vec3 lighting = vec3(0.02);
+
+    if (frame.naiveShading != 0)
+    {
+        for (uint light = 0; light < frame.lightCount; light++) lighting += shadeLight(lights[light], normal, viewDirection);
+    }
+    else
+    {
+        uvec2 tile = uvec2(gl_FragCoord.xy) / frame.clusterGrid.w;
+        uint slice = uint(clamp(log(inViewDepth) * frame.screen.z - frame.screen.w, 0.0, float(frame.clusterGrid.z - 1)));
+        Cluster cluster = clusters[(slice * frame.clusterGrid.y + tile.y) * frame.clusterGrid.x + tile.x];
+        // Lists cut off by a full light index list hold fewer entries than counted
+        uint count = cluster.offset >= frame.lightIndexCapacity ? 0 : min(cluster.count, frame.lightIndexCapacity - cluster.offset);
+        for (uint entry = 0; entry < count; entry++) lighting += shadeLight(lights[lightIndices[cluster.offset + entry]], normal, viewDirection);
+    }
+    outColor = vec4(albedo * lighting, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 450
+
+// Shared by the depth prepass and the shading pass, invariant keeps their depths equal for the equal depth test
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    mat4 view;
+    vec4 cameraPosition;
+    vec4 projection;
+    uvec4 clusterGrid;
+    vec4 screen;
+    uint lightCount;
+    uint lightIndexCapacity;
+    uint naiveShading;
+} frame;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outPosition;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out float outViewDepth;
+
+invariant gl_Position;
+
+void main()
+{
+    outPosition = inPosition;
+    outNormal = inNormal;
+    outViewDepth = -(frame.view * vec4(inPosition, 1.0)).z;
+    gl_Position = frame.viewProjection * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    mat4 previousViewProjection;
+    vec4 frustumPlanes[6];
+    vec4 lightDirection;
+    uint instanceCount;
+    uint occlusionCulling;
+    uint pyramidWidth;
+    uint pyramidHeight;
+    uint pyramidLevelCount;
+} frame;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    float diffuse = max(dot(normalize(inNormal), -frame.lightDirection.xyz), 0.0);
+    outColor = vec4(inColor * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,40 @@
+#version 450
+
+// Instances are drawn by the indirect commands the culling pass wrote, firstInstance holds the scene instance index
+
+struct Instance
+{
+    mat4 model;
+    vec4 boundingSphere;
+    vec4 color;
+    uint mesh;
+};
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    mat4 previousViewProjection;
+    vec4 frustumPlanes[6];
+    vec4 lightDirection;
+    uint instanceCount;
+    uint occlusionCulling;
+    uint pyramidWidth;
+    uint pyramidHeight;
+    uint pyramidLevelCount;
+} frame;
+
+layout(std430, set = 0, binding = 1) readonly buffer Instances { Instance instances[]; };
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec3 outColor;
+
+void main()
+{
+    Instance instance = instances[gl_InstanceIndex];
+    outNormal = mat3(instance.model) * inNormal;
+    outColor = instance.color.rgb;
+    gl_Position = frame.viewProjection * instance.model * vec4(inPosition, 1.0);
+}
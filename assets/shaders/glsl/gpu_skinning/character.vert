@@ -0,0 +1,22 @@
+#version 450
+
+// Blended vertices are in world space, the draw's first instance is the index of the character
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 lightDirection;
+} frame;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outCharacter;
+
+void main()
+{
+    outNormal = inNormal;
+    outCharacter = gl_InstanceIndex;
+    gl_Position = frame.viewProjection * vec4(inPosition, 1.0);
+}
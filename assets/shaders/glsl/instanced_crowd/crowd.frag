@@ -0,0 +1,27 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 lightDirection;
+} frame;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) flat in uint inMaterialId;
+layout(location = 2) flat in uint inFlags;
+
+layout(location = 0) out vec4 outColor;
+
+const uint FLAG_HIGHLIGHTED = 2u;
+
+const vec3 palette[8] = vec3[](
+    vec3(0.80, 0.25, 0.20), vec3(0.25, 0.60, 0.85), vec3(0.90, 0.75, 0.25), vec3(0.35, 0.75, 0.35),
+    vec3(0.65, 0.40, 0.80), vec3(0.90, 0.55, 0.30), vec3(0.60, 0.60, 0.60), vec3(0.30, 0.35, 0.45));
+
+void main()
+{
+    vec3 albedo = palette[inMaterialId % 8u];
+    if ((inFlags & FLAG_HIGHLIGHTED) != 0u) albedo = mix(albedo, vec3(1.0), 0.6);
+    float diffuse = max(dot(normalize(inNormal), -frame.lightDirection.xyz), 0.0);
+    outColor = vec4(albedo * (0.15 + 0.85 * diffuse), 1.0);
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// Per vertex data in binding 0, the instance streams are separate instance rate bindings: transform rows, material ID, flags
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 lightDirection;
+} frame;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inTransformRow0;
+layout(location = 3) in vec4 inTransformRow1;
+layout(location = 4) in vec4 inTransformRow2;
+layout(location = 5) in uint inMaterialId;
+layout(location = 6) in uint inFlags;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outMaterialId;
+layout(location = 2) flat out uint outFlags;
+
+const uint FLAG_VISIBLE = 1u;
+
+void main()
+{
+    // Hidden instances and instances not uploaded yet, whose flags read zero, collapse to a degenerate point
+    if ((inFlags & FLAG_VISIBLE) == 0u)
+    {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        outNormal = vec3(0.0, 1.0, 0.0);
+        outMaterialId = 0u;
+        outFlags = 0u;
+        return;
+    }
+
+    mat4x3 model = transpose(mat3x4(inTransformRow0, inTransformRow1, inTransformRow2));
+    vec3 position = model * vec4(inPosition, 1.0);
+    outNormal = normalize(mat3(model) * inNormal);
+    outMaterialId = inMaterialId;
+    outFlags = inFlags;
+    gl_Position = frame.viewProjection * vec4(position, 1.0);
+}
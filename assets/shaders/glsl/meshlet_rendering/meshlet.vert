@@ -0,0 +1,64 @@
+#version 450
+
+// Draws the meshlet clusters the culling pass kept without vertex or index buffers: gl_InstanceIndex is the slot of the
+// cluster, every three vertices are a triangle of the meshlet read from the same buffers as the mesh shader
+
+struct Instance
+{
+    mat4 model;
+    vec4 color;
+    float scale;
+};
+
+struct Meshlet
+{
+    uint vertexOffset;
+    uint triangleOffset;    // Byte offset into the packed triangle indices
+    uint vertexCount;
+    uint triangleCount;
+};
+
+layout(set = 0, binding = 0) uniform FrameData
+{
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    vec4 lightDirection;
+    uint meshletCount;
+    uint instanceCount;
+    uint coneCulling;
+    uint frustumCulling;
+} frame;
+
+layout(std430, set = 0, binding = 1) readonly buffer Instances { Instance instances[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Meshlets { Meshlet meshlets[]; };
+layout(std430, set = 0, binding = 4) readonly buffer VertexIndices { uint vertexIndices[]; };
+layout(std430, set = 0, binding = 5) readonly buffer TriangleIndices { uint triangleIndices[]; };    // Four byte indices per word
+layout(std430, set = 0, binding = 6) readonly buffer Vertices { float vertices[]; };                // Position and normal, six floats per vertex
+layout(std430, set = 0, binding = 9) readonly buffer VisibleClusters { uvec2 visibleClusters[]; };
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec3 outColor;
+
+vec3 meshletColor(uint meshlet)
+{
+    uint hash = meshlet * 2654435761u;
+    return vec3(hash & 255u, (hash >> 8) & 255u, (hash >> 16) & 255u) / 255.0;
+}
+
+void main()
+{
+    uvec2 cluster = visibleClusters[gl_InstanceIndex];
+    Meshlet meshlet = meshlets[cluster.y];
+    Instance instance = instances[cluster.x];
+
+    uint byteAddress = meshlet.triangleOffset + gl_VertexIndex;
+    uint localIndex = (triangleIndices[byteAddress / 4] >> (8 * (byteAddress % 4))) & 255u;
+    uint index = vertexIndices[meshlet.vertexOffset + localIndex] * 6;
+    vec3 position = vec3(vertices[index], vertices[index + 1], vertices[index + 2]);
+    vec3 normal = vec3(vertices[index + 3], vertices[index + 4], vertices[index + 5]);
+
+    outNormal = mat3(instance.model) * normal;
+    outColor = mix(instance.color.rgb, meshletColor(cluster.y), 0.35);
+    gl_Position = frame.viewProjection * instance.model * vec4(position, 1.0);
+}
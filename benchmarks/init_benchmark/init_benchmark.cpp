@@ -0,0 +1,204 @@
+#include "vulkan_example_base.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+/*
+* Startup latency benchmark: times every step of ExampleBase::init, and cleanup, over several headless iterations.
+* Run it against a software driver for stable numbers, for example lavapipe through
+* VK_ICD_FILENAMES=<path>/lvp_icd.x86_64.json, or with --mock on the in-process mock driver to time core alone.
+*
+*   init_benchmark [--iterations <n>] [--warmup <n>] [--output <result.json>]
+*                  [--baseline <baseline.json>] [--threshold <fraction>] [--min-delta-ms <ms>] [--validation] [--mock]
+*
+* The median and 95th percentile of every step are written as JSON. Given a baseline produced by a previous run,
+* the process exits with 1 when the median of a step exceeds the baseline median by more than the threshold
+* fraction and by more than the minimum delta. Errors exit with 2.
+*/
+namespace PVulkanExamples
+{
+	struct StepTiming
+	{
+		std::string         name{};
+		std::vector<double> samples{};  // Milliseconds
+		double              median{ 0.0 };
+		double              p95{ 0.0 };
+	};
+
+	struct BenchmarkSettings
+	{
+		uint32_t    iterations{ 20 };
+		uint32_t    warmup{ 2 };
+		std::string outputPath{};
+		std::string baselinePath{};
+		double      threshold{ 0.10 };
+		double      minDeltaMs{ 0.05 };
+		bool        validation{ false };
+		bool        mock{ false };
+	};
+
+	class InitBenchmark : public ExampleBase
+	{
+	public:
+		explicit InitBenchmark(const BenchmarkSettings& settings) : m_settings(settings)
+		{
+			m_headless = true;
+			m_requestValidation = settings.validation;
+			m_useMockDriver = settings.mock;
+		}
+
+		std::vector<StepTiming> measure()
+		{
+			const std::vector<InitStep>& steps = getInitSteps();
+			std::vector<StepTiming> timings(steps.size() + 1);
+			for (size_t i = 0; i < steps.size(); i++) timings[i].name = steps[i].name;
+			timings.back().name = "cleanup";
+
+			for (uint32_t iteration = 0; iteration < m_settings.warmup + m_settings.iterations; iteration++)
+			{
+				bool record = iteration >= m_settings.warmup;
+				for (size_t i = 0; i < steps.size(); i++)
+				{
+					auto begin = std::chrono::steady_clock::now();
+					(this->*steps[i].function)();
+					auto end = std::chrono::steady_clock::now();
+					if (record) timings[i].samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+				}
+				auto begin = std::chrono::steady_clock::now();
+				cleanup();
+				auto end = std::chrono::steady_clock::now();
+				if (record) timings.back().samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+			}
+
+			for (StepTiming& timing : timings)
+			{
+				std::sort(timing.samples.begin(), timing.samples.end());
+				timing.median = percentile(timing.samples, 0.5);
+				timing.p95 = percentile(timing.samples, 0.95);
+			}
+			return timings;
+		}
+
+	private:
+		static double percentile(const std::vector<double>& sorted, double fraction)
+		{
+			if (sorted.empty()) return 0.0;
+			size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+			return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+		}
+
+	private:
+		BenchmarkSettings m_settings;
+	};
+
+	std::string toJson(const std::vector<StepTiming>& timings, uint32_t iterations)
+	{
+		double totalMedian = 0.0;
+		std::ostringstream json;
+		json << std::fixed << std::setprecision(4);
+		json << "{\n  \"benchmark\": \"init\",\n  \"iterations\": " << iterations << ",\n  \"steps\": [\n";
+		for (size_t i = 0; i < timings.size(); i++)
+		{
+			json << "    { \"name\": \"" << timings[i].name << "\", \"median_ms\": " << timings[i].median << ", \"p95_ms\": " << timings[i].p95 << " }"
+				<< (i + 1 < timings.size() ? ",\n" : "\n");
+			totalMedian += timings[i].median;
+		}
+		json << "  ],\n  \"total_median_ms\": " << totalMedian << "\n}\n";
+		return json.str();
+	}
+
+	/*
+	* Read the step medians of a result file written by toJson
+	*/
+	std::map<std::string, double> readBaseline(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("failed to open baseline " + path);
+		}
+		std::stringstream content;
+		content << file.rdbuf();
+		std::string text = content.str();
+
+		std::map<std::string, double> medians;
+		std::regex stepPattern("\"name\"\\s*:\\s*\"([^\"]+)\"\\s*,\\s*\"median_ms\"\\s*:\\s*([-+0-9.eE]+)");
+		for (auto it = std::sregex_iterator(text.begin(), text.end(), stepPattern); it != std::sregex_iterator(); ++it)
+		{
+			medians[(*it)[1].str()] = std::stod((*it)[2].str());
+		}
+		return medians;
+	}
+
+	/*
+	* Print the steps exceeding the baseline and return whether any did
+	*/
+	bool checkRegressions(const std::vector<StepTiming>& timings, const std::map<std::string, double>& baseline, const BenchmarkSettings& settings)
+	{
+		bool regressed = false;
+		for (const StepTiming& timing : timings)
+		{
+			auto it = baseline.find(timing.name);
+			if (it == baseline.end()) continue;
+			double delta = timing.median - it->second;
+			if (delta > settings.minDeltaMs && timing.median > it->second * (1.0 + settings.threshold))
+			{
+				std::cerr << "regression: " << timing.name << " median " << timing.median << " ms, baseline " << it->second << " ms ("
+					<< std::showpos << (it->second > 0.0 ? delta / it->second * 100.0 : 100.0) << std::noshowpos << "%)\n";
+				regressed = true;
+			}
+		}
+		return regressed;
+	}
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	BenchmarkSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--iterations" && i + 1 < argc) settings.iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (argument == "--warmup" && i + 1 < argc) settings.warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (argument == "--output" && i + 1 < argc) settings.outputPath = argv[++i];
+		else if (argument == "--baseline" && i + 1 < argc) settings.baselinePath = argv[++i];
+		else if (argument == "--threshold" && i + 1 < argc) settings.threshold = std::stod(argv[++i]);
+		else if (argument == "--min-delta-ms" && i + 1 < argc) settings.minDeltaMs = std::stod(argv[++i]);
+		else if (argument == "--validation") settings.validation = true;
+		else if (argument == "--mock") settings.mock = true;
+	}
+
+	try
+	{
+		InitBenchmark benchmark(settings);
+		std::vector<StepTiming> timings = benchmark.measure();
+
+		std::string json = toJson(timings, settings.iterations);
+		std::cout << json;
+		if (!settings.outputPath.empty())
+		{
+			std::ofstream file(settings.outputPath);
+			file << json;
+		}
+
+		if (!settings.baselinePath.empty() && checkRegressions(timings, readBaseline(settings.baselinePath), settings))
+		{
+			return 1;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 2;
+	}
+	return 0;
+}
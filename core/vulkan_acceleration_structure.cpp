@@ -0,0 +1,607 @@
+#include "vulkan_acceleration_structure.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr VkBufferUsageFlags STRUCTURE_BUFFER_USAGE = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		/*
+		* Orders every acceleration structure build and its scratch accesses before the ones recorded after it
+		*/
+		void buildBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+			barrier.dstAccessMask = dstAccess;
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, dstStages, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+	}
+
+	void AccelerationStructureBuilder::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkQueue queue,
+		uint32_t maxFrameInFlight, const VkAllocationCallbacks* pAllocator, bool rayTracingPipelines)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		m_queue = queue;
+		m_allocator = pAllocator;
+		// Ray queries are available in compute and fragment shaders
+		m_traceStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+			(rayTracingPipelines ? VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR : 0);
+		m_instanceBuffers.resize(maxFrameInFlight);
+		m_retired.resize(maxFrameInFlight);
+
+		VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+		accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &accelerationStructureProperties;
+		vkd.vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+		m_scratchAlignment = std::max<VkDeviceSize>(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = queueFamily;
+		if (vkd.vkCreateCommandPool(device, &poolInfo, pAllocator, &m_commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create acceleration structure command pool!");
+		}
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkd.vkCreateFence(device, &fenceInfo, pAllocator, &m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create acceleration structure fence!");
+		}
+	}
+
+	void AccelerationStructureBuilder::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		for (Blas& blas : m_blases)
+		{
+			destroyStructure(blas.structure);
+		}
+		m_blases.clear();
+		m_pendingBlases.clear();
+		destroyStructure(m_tlas);
+		for (InstanceBuffer& instances : m_instanceBuffers)
+		{
+			vkd.vkDestroyBuffer(m_device, instances.buffer, m_allocator);
+			vkd.vkFreeMemory(m_device, instances.memory, m_allocator);
+		}
+		m_instanceBuffers.clear();
+		destroyRetired();
+		m_retired.clear();
+		vkd.vkDestroyBuffer(m_device, m_scratchBuffer, m_allocator);
+		vkd.vkFreeMemory(m_device, m_scratchMemory, m_allocator);
+		vkd.vkDestroyQueryPool(m_device, m_compactedSizeQueries, m_allocator);
+		vkd.vkDestroyFence(m_device, m_fence, m_allocator);
+		vkd.vkDestroyCommandPool(m_device, m_commandPool, m_allocator);
+		m_scratchBuffer = VK_NULL_HANDLE;
+		m_scratchMemory = VK_NULL_HANDLE;
+		m_scratchCapacity = 0;
+		m_compactedSizeQueries = VK_NULL_HANDLE;
+		m_queryCapacity = 0;
+		m_statistics = {};
+		m_device = VK_NULL_HANDLE;
+	}
+
+	void AccelerationStructureBuilder::beginFrame(uint32_t frameIndex)
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		m_currentFrame = frameIndex;
+		for (Structure& structure : m_retired[frameIndex])
+		{
+			destroyStructure(structure);
+		}
+		m_retired[frameIndex].clear();
+	}
+
+	BlasHandle AccelerationStructureBuilder::addBlas(const BlasDesc& desc)
+	{
+		Blas blas{};
+		blas.desc = desc;
+		blas.desc.allowCompaction = desc.allowCompaction && !desc.allowUpdate;
+		blas.flags = desc.allowUpdate
+			? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR
+			: VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		if (blas.desc.allowCompaction) blas.flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+
+		std::vector<uint32_t> maxPrimitiveCounts;
+		for (const BlasTriangleGeometry& triangles : desc.geometries)
+		{
+			VkAccelerationStructureGeometryKHR geometry{};
+			geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+			geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+			geometry.flags = triangles.opaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
+			geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+			geometry.geometry.triangles.vertexFormat = triangles.vertexFormat;
+			geometry.geometry.triangles.vertexData.deviceAddress = triangles.vertexAddress;
+			geometry.geometry.triangles.vertexStride = triangles.vertexStride;
+			geometry.geometry.triangles.maxVertex = triangles.maxVertex;
+			geometry.geometry.triangles.indexType = triangles.indexType;
+			geometry.geometry.triangles.indexData.deviceAddress = triangles.indexAddress;
+			geometry.geometry.triangles.transformData.deviceAddress = triangles.transformAddress;
+			blas.geometries.push_back(geometry);
+
+			VkAccelerationStructureBuildRangeInfoKHR range{};
+			range.primitiveCount = triangles.triangleCount;
+			blas.ranges.push_back(range);
+			maxPrimitiveCounts.push_back(triangles.triangleCount);
+		}
+
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+		buildInfo.flags = blas.flags;
+		buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+		buildInfo.geometryCount = static_cast<uint32_t>(blas.geometries.size());
+		buildInfo.pGeometries = blas.geometries.data();
+		VkAccelerationStructureBuildSizesInfoKHR sizes{};
+		sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		vkd.vkGetAccelerationStructureBuildSizesKHR(m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo,
+			maxPrimitiveCounts.data(), &sizes);
+		// Refits of deforming BLASes reuse the shared scratch buffer, reserve the larger of both
+		blas.scratchSize = alignScratch(std::max(sizes.buildScratchSize, desc.allowUpdate ? sizes.updateScratchSize : 0));
+		blas.structure = createStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, sizes.accelerationStructureSize);
+
+		m_blases.push_back(blas);
+		m_pendingBlases.push_back(static_cast<BlasHandle>(m_blases.size() - 1));
+		m_statistics.blasCount++;
+		return m_pendingBlases.back();
+	}
+
+	/*
+	* The scratch buffer holds the budget or the largest single build, largest scratch first a batch takes BLASes until
+	* the next one would not fit in it
+	*/
+	void AccelerationStructureBuilder::buildPendingBlas()
+	{
+		if (m_pendingBlases.empty()) return;
+		std::vector<BlasHandle> pending = m_pendingBlases;
+		m_pendingBlases.clear();
+		std::stable_sort(pending.begin(), pending.end(), [this](BlasHandle a, BlasHandle b)
+		{
+			return m_blases[a].scratchSize > m_blases[b].scratchSize;
+		});
+		VkDeviceSize totalScratch = 0;
+		for (BlasHandle blas : pending) totalScratch += m_blases[blas].scratchSize;
+		ensureScratch(std::max(m_blases[pending.front()].scratchSize, std::min(m_scratchBudget, totalScratch)));
+
+		std::vector<BlasHandle> batch;
+		VkDeviceSize batchScratch = 0;
+		for (BlasHandle blas : pending)
+		{
+			if (!batch.empty() && batchScratch + m_blases[blas].scratchSize > m_scratchCapacity)
+			{
+				buildBatch(batch);
+				batch.clear();
+				batchScratch = 0;
+			}
+			batch.push_back(blas);
+			batchScratch += m_blases[blas].scratchSize;
+		}
+		buildBatch(batch);
+		// Waiting for the last batch waited for every earlier use of the replaced scratch buffer
+		destroyRetired();
+	}
+
+	void AccelerationStructureBuilder::buildBatch(const std::vector<BlasHandle>& batch)
+	{
+		std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
+		std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> ranges;
+		std::vector<VkAccelerationStructureKHR> compactable;
+		VkDeviceSize scratchOffset = 0;
+		for (BlasHandle handle : batch)
+		{
+			Blas& blas = m_blases[handle];
+			VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+			buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+			buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+			buildInfo.flags = blas.flags;
+			buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+			buildInfo.dstAccelerationStructure = blas.structure.handle;
+			buildInfo.geometryCount = static_cast<uint32_t>(blas.geometries.size());
+			buildInfo.pGeometries = blas.geometries.data();
+			buildInfo.scratchData.deviceAddress = getScratchAddress(scratchOffset);
+			scratchOffset += blas.scratchSize;
+			buildInfos.push_back(buildInfo);
+			ranges.push_back(blas.ranges.data());
+			if (blas.desc.allowCompaction) compactable.push_back(blas.structure.handle);
+			m_statistics.builtSize += blas.structure.size;
+		}
+
+		if (compactable.size() > m_queryCapacity)
+		{
+			vkd.vkDestroyQueryPool(m_device, m_compactedSizeQueries, m_allocator);
+			VkQueryPoolCreateInfo queryPoolInfo{};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+			queryPoolInfo.queryCount = static_cast<uint32_t>(compactable.size());
+			if (vkd.vkCreateQueryPool(m_device, &queryPoolInfo, m_allocator, &m_compactedSizeQueries) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create acceleration structure compacted size query pool!");
+			}
+			m_queryCapacity = queryPoolInfo.queryCount;
+		}
+
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		// Frame TLAS builds on the same queue may still use the scratch buffer
+		buildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+		vkd.vkCmdBuildAccelerationStructuresKHR(commandBuffer, static_cast<uint32_t>(buildInfos.size()), buildInfos.data(), ranges.data());
+		if (!compactable.empty())
+		{
+			buildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+			vkd.vkCmdResetQueryPool(commandBuffer, m_compactedSizeQueries, 0, static_cast<uint32_t>(compactable.size()));
+			vkd.vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, static_cast<uint32_t>(compactable.size()), compactable.data(),
+				VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, m_compactedSizeQueries, 0);
+		}
+		endSingleTimeCommands(commandBuffer);
+		m_statistics.buildBatchCount++;
+
+		compactBatch(batch);
+	}
+
+	/*
+	* Copy the compactable BLASes of a built batch into structures of their compacted size, the queries were written by the batch
+	*/
+	void AccelerationStructureBuilder::compactBatch(const std::vector<BlasHandle>& batch)
+	{
+		std::vector<BlasHandle> compactable;
+		for (BlasHandle handle : batch)
+		{
+			if (m_blases[handle].desc.allowCompaction) compactable.push_back(handle);
+		}
+		if (compactable.empty())
+		{
+			for (BlasHandle handle : batch) m_statistics.compactedSize += m_blases[handle].structure.size;
+			return;
+		}
+
+		std::vector<VkDeviceSize> compactedSizes(compactable.size());
+		if (vkd.vkGetQueryPoolResults(m_device, m_compactedSizeQueries, 0, static_cast<uint32_t>(compactable.size()),
+			compactedSizes.size() * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to read acceleration structure compacted sizes!");
+		}
+
+		std::vector<Structure> originals;
+		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		buildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+		for (size_t i = 0; i < compactable.size(); i++)
+		{
+			Blas& blas = m_blases[compactable[i]];
+			if (compactedSizes[i] == 0 || compactedSizes[i] >= blas.structure.size) continue;
+			Structure compacted = createStructure(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, compactedSizes[i]);
+			VkCopyAccelerationStructureInfoKHR copyInfo{};
+			copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+			copyInfo.src = blas.structure.handle;
+			copyInfo.dst = compacted.handle;
+			copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+			vkd.vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+			originals.push_back(blas.structure);
+			blas.structure = compacted;
+			m_statistics.compactedCount++;
+		}
+		endSingleTimeCommands(commandBuffer);
+
+		for (Structure& original : originals)
+		{
+			destroyStructure(original);
+		}
+		for (BlasHandle handle : batch) m_statistics.compactedSize += m_blases[handle].structure.size;
+	}
+
+	/*
+	* BLASes are refitted with as many build infos per command as fit in the scratch budget, consecutive commands share
+	* the scratch buffer and are separated by barriers
+	*/
+	void AccelerationStructureBuilder::refitBlas(VkCommandBuffer commandBuffer, const std::vector<BlasHandle>& blases)
+	{
+		if (blases.empty()) return;
+		VkDeviceSize largestScratch = 0;
+		VkDeviceSize totalScratch = 0;
+		for (BlasHandle handle : blases)
+		{
+			const Blas& blas = m_blases[handle];
+			if (!blas.desc.allowUpdate)
+			{
+				throw std::runtime_error("failed to refit BLAS, it was not added with allowUpdate!");
+			}
+			largestScratch = std::max(largestScratch, blas.scratchSize);
+			totalScratch += blas.scratchSize;
+		}
+		ensureScratch(std::max(largestScratch, std::min(m_scratchBudget, totalScratch)));
+
+		// Shaders of the previous frame trace the BLASes refitted in place, builds on the same queue use the scratch buffer
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | m_traceStages,
+			VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
+		std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> ranges;
+		VkDeviceSize scratchOffset = 0;
+		auto flush = [&]()
+		{
+			vkd.vkCmdBuildAccelerationStructuresKHR(commandBuffer, static_cast<uint32_t>(buildInfos.size()), buildInfos.data(), ranges.data());
+			buildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+				VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+			buildInfos.clear();
+			ranges.clear();
+			scratchOffset = 0;
+		};
+		for (BlasHandle handle : blases)
+		{
+			Blas& blas = m_blases[handle];
+			if (!buildInfos.empty() && scratchOffset + blas.scratchSize > m_scratchCapacity) flush();
+
+			auto pending = std::find(m_pendingBlases.begin(), m_pendingBlases.end(), handle);
+			bool update = pending == m_pendingBlases.end() && blas.updatesSinceBuild < m_blasRebuildInterval;
+			if (pending != m_pendingBlases.end())
+			{
+				m_pendingBlases.erase(pending);
+				m_statistics.builtSize += blas.structure.size;
+				m_statistics.compactedSize += blas.structure.size;
+			}
+			VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+			buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+			buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+			buildInfo.flags = blas.flags;
+			buildInfo.mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+			buildInfo.srcAccelerationStructure = update ? blas.structure.handle : VK_NULL_HANDLE;
+			buildInfo.dstAccelerationStructure = blas.structure.handle;
+			buildInfo.geometryCount = static_cast<uint32_t>(blas.geometries.size());
+			buildInfo.pGeometries = blas.geometries.data();
+			buildInfo.scratchData.deviceAddress = getScratchAddress(scratchOffset);
+			scratchOffset += blas.scratchSize;
+			buildInfos.push_back(buildInfo);
+			ranges.push_back(blas.ranges.data());
+
+			blas.updatesSinceBuild = update ? blas.updatesSinceBuild + 1 : 0;
+			if (update) m_statistics.blasRefitCount++;
+			else m_statistics.blasRebuildCount++;
+		}
+		flush();
+		buildBarrier(commandBuffer, m_traceStages, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+	}
+
+	void AccelerationStructureBuilder::buildTlas(VkCommandBuffer commandBuffer, const std::vector<TlasInstance>& instances)
+	{
+		uint32_t instanceCount = static_cast<uint32_t>(instances.size());
+		InstanceBuffer& instanceBuffer = m_instanceBuffers[m_currentFrame];
+		if (instanceBuffer.capacity < std::max(instanceCount, 1u))
+		{
+			// The fence of this frame slot was waited for, nothing reads its previous instances anymore
+			vkd.vkDestroyBuffer(m_device, instanceBuffer.buffer, m_allocator);
+			vkd.vkFreeMemory(m_device, instanceBuffer.memory, m_allocator);
+			instanceBuffer.capacity = std::max(std::max(instanceCount, 1u), instanceBuffer.capacity * 2);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, instanceBuffer.capacity * sizeof(VkAccelerationStructureInstanceKHR),
+				VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				instanceBuffer.buffer, instanceBuffer.memory, m_allocator);
+			vkd.vkMapMemory(m_device, instanceBuffer.memory, 0, VK_WHOLE_SIZE, 0, &instanceBuffer.mapped);
+		}
+		auto* instanceData = static_cast<VkAccelerationStructureInstanceKHR*>(instanceBuffer.mapped);
+		for (uint32_t i = 0; i < instanceCount; i++)
+		{
+			const TlasInstance& instance = instances[i];
+			VkAccelerationStructureInstanceKHR& data = instanceData[i];
+			data.transform = instance.transform;
+			data.instanceCustomIndex = instance.customIndex & 0xFFFFFF;
+			data.mask = instance.mask;
+			data.instanceShaderBindingTableRecordOffset = instance.hitGroupOffset & 0xFFFFFF;
+			data.flags = instance.flags & 0xFF;
+			data.accelerationStructureReference = m_blases[instance.blas].structure.address;
+		}
+
+		VkAccelerationStructureGeometryKHR geometry{};
+		geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+		geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+		geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+		geometry.geometry.instances.data.deviceAddress = getBufferAddress(instanceBuffer.buffer);
+
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+		buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+		buildInfo.geometryCount = 1;
+		buildInfo.pGeometries = &geometry;
+
+		bool update = m_tlas.handle != VK_NULL_HANDLE && instanceCount == m_tlasInstanceCount &&
+			m_tlasUpdatesSinceBuild < m_tlasRebuildInterval;
+		VkAccelerationStructureBuildSizesInfoKHR sizes{};
+		sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		vkd.vkGetAccelerationStructureBuildSizesKHR(m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &instanceCount, &sizes);
+		if (sizes.accelerationStructureSize > m_tlas.size)
+		{
+			// Earlier frames may still trace the old TLAS
+			retireStructure(m_tlas);
+			m_tlas = createStructure(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, sizes.accelerationStructureSize);
+			update = false;
+		}
+		ensureScratch(alignScratch(std::max(sizes.buildScratchSize, sizes.updateScratchSize)));
+
+		buildInfo.mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+		buildInfo.srcAccelerationStructure = update ? m_tlas.handle : VK_NULL_HANDLE;
+		buildInfo.dstAccelerationStructure = m_tlas.handle;
+		buildInfo.scratchData.deviceAddress = getScratchAddress(0);
+		VkAccelerationStructureBuildRangeInfoKHR range{};
+		range.primitiveCount = instanceCount;
+		const VkAccelerationStructureBuildRangeInfoKHR* pRange = &range;
+
+		// Shaders of the previous frame trace the TLAS, builds on the same queue use the scratch buffer
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | m_traceStages,
+			VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+		vkd.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &pRange);
+		buildBarrier(commandBuffer, m_traceStages, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+
+		m_tlasInstanceCount = instanceCount;
+		m_tlasUpdatesSinceBuild = update ? m_tlasUpdatesSinceBuild + 1 : 0;
+		if (update) m_statistics.tlasUpdateCount++;
+		else m_statistics.tlasBuildCount++;
+	}
+
+	void AccelerationStructureBuilder::printStatistics() const
+	{
+		std::cout << "\n=====Acceleration Structures=====";
+		std::cout << "\n" << std::setw(24) << std::left << "BLAS count" << m_statistics.blasCount;
+		std::cout << "\n" << std::setw(24) << std::left << "Build batches" << m_statistics.buildBatchCount;
+		std::cout << "\n" << std::setw(24) << std::left << "Compacted BLAS" << m_statistics.compactedCount;
+		std::cout << "\n" << std::setw(24) << std::left << "BLAS size (KiB)" << m_statistics.builtSize / 1024 << " -> " << m_statistics.compactedSize / 1024;
+		std::cout << "\n" << std::setw(24) << std::left << "Scratch size (KiB)" << m_statistics.scratchSize / 1024;
+		std::cout << "\n" << std::setw(24) << std::left << "TLAS builds / updates" << m_statistics.tlasBuildCount << " / " << m_statistics.tlasUpdateCount;
+		std::cout << "\n" << std::setw(24) << std::left << "BLAS refits / rebuilds" << m_statistics.blasRefitCount << " / " << m_statistics.blasRebuildCount;
+		std::cout << std::endl;
+	}
+
+	AccelerationStructureBuilder::Structure AccelerationStructureBuilder::createStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size)
+	{
+		Structure structure{};
+		structure.size = size;
+		VulkanUtil::createBuffer(m_physicalDevice, m_device, size, STRUCTURE_BUFFER_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			structure.buffer, structure.memory, m_allocator);
+
+		VkAccelerationStructureCreateInfoKHR createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+		createInfo.buffer = structure.buffer;
+		createInfo.size = size;
+		createInfo.type = type;
+		if (vkd.vkCreateAccelerationStructureKHR(m_device, &createInfo, m_allocator, &structure.handle) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create acceleration structure!");
+		}
+		VkAccelerationStructureDeviceAddressInfoKHR addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+		addressInfo.accelerationStructure = structure.handle;
+		structure.address = vkd.vkGetAccelerationStructureDeviceAddressKHR(m_device, &addressInfo);
+		return structure;
+	}
+
+	void AccelerationStructureBuilder::destroyStructure(Structure& structure)
+	{
+		vkd.vkDestroyAccelerationStructureKHR(m_device, structure.handle, m_allocator);
+		vkd.vkDestroyBuffer(m_device, structure.buffer, m_allocator);
+		vkd.vkFreeMemory(m_device, structure.memory, m_allocator);
+		structure = {};
+	}
+
+	/*
+	* Keep a structure or scratch buffer until the current frame slot comes round again
+	*/
+	void AccelerationStructureBuilder::retireStructure(Structure& structure)
+	{
+		if (structure.buffer != VK_NULL_HANDLE) m_retired[m_currentFrame].push_back(structure);
+		structure = {};
+	}
+
+	void AccelerationStructureBuilder::destroyRetired()
+	{
+		for (std::vector<Structure>& retired : m_retired)
+		{
+			for (Structure& structure : retired)
+			{
+				destroyStructure(structure);
+			}
+			retired.clear();
+		}
+	}
+
+	/*
+	* Grow the shared scratch buffer, builds already submitted or recorded may still use the old one
+	*/
+	void AccelerationStructureBuilder::ensureScratch(VkDeviceSize size)
+	{
+		if (size <= m_scratchCapacity) return;
+		Structure scratch{};
+		scratch.buffer = m_scratchBuffer;
+		scratch.memory = m_scratchMemory;
+		retireStructure(scratch);
+		// Room to align the base address
+		VulkanUtil::createBuffer(m_physicalDevice, m_device, size + m_scratchAlignment,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_scratchBuffer, m_scratchMemory, m_allocator);
+		m_scratchCapacity = size;
+		m_scratchAddress = alignUp(getBufferAddress(m_scratchBuffer), m_scratchAlignment);
+		m_statistics.scratchSize = size;
+	}
+
+	VkDeviceAddress AccelerationStructureBuilder::getBufferAddress(VkBuffer buffer) const
+	{
+		VkBufferDeviceAddressInfo addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressInfo.buffer = buffer;
+		return vkd.vkGetBufferDeviceAddress(m_device, &addressInfo);
+	}
+
+	VkDeviceAddress AccelerationStructureBuilder::getScratchAddress(VkDeviceSize offset) const
+	{
+		return m_scratchAddress + offset;
+	}
+
+	VkDeviceSize AccelerationStructureBuilder::alignScratch(VkDeviceSize size) const
+	{
+		return alignUp(size, m_scratchAlignment);
+	}
+
+	VkCommandBuffer AccelerationStructureBuilder::beginSingleTimeCommands()
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = m_commandPool;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer commandBuffer;
+		if (vkd.vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate acceleration structure command buffer!");
+		}
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		return commandBuffer;
+	}
+
+	void AccelerationStructureBuilder::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+	{
+		vkd.vkEndCommandBuffer(commandBuffer);
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		if (vkd.vkQueueSubmit(m_queue, 1, &submitInfo, m_fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit acceleration structure builds!");
+		}
+		vkd.vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+		vkd.vkResetFences(m_device, 1, &m_fence);
+		vkd.vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+	}
+} // namespace PVulkanExamples
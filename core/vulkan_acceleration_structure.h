@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// Index of a bottom level acceleration structure owned by the builder
+	using BlasHandle = uint32_t;
+	constexpr BlasHandle INVALID_BLAS = UINT32_MAX;
+
+	/*
+	* Indexed triangles read from device addresses, buffers need VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR
+	* and VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+	*/
+	struct BlasTriangleGeometry
+	{
+		VkDeviceAddress     vertexAddress{ 0 };
+		VkFormat            vertexFormat{ VK_FORMAT_R32G32B32_SFLOAT };
+		VkDeviceSize        vertexStride{ 3 * sizeof(float) };
+		uint32_t            maxVertex{ 0 };
+		VkDeviceAddress     indexAddress{ 0 };
+		VkIndexType         indexType{ VK_INDEX_TYPE_UINT32 };
+		uint32_t            triangleCount{ 0 };
+		VkDeviceAddress     transformAddress{ 0 };  // Optional VkTransformMatrixKHR
+		bool                opaque{ true };
+	};
+
+	struct BlasDesc
+	{
+		std::string                         name{};
+		std::vector<BlasTriangleGeometry>   geometries{};
+		bool                                allowCompaction{ true };    // Static geometry, copied into a smaller structure after the build
+		bool                                allowUpdate{ false };       // Deforming geometry refitted in place, never compacted
+	};
+
+	struct TlasInstance
+	{
+		VkTransformMatrixKHR        transform{ { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } } };
+		BlasHandle                  blas{ INVALID_BLAS };
+		uint32_t                    customIndex{ 0 };   // 24 bits, gl_InstanceCustomIndexEXT
+		uint8_t                     mask{ 0xFF };
+		uint32_t                    hitGroupOffset{ 0 };
+		VkGeometryInstanceFlagsKHR  flags{ 0 };
+	};
+
+	struct AccelerationStructureStatistics
+	{
+		uint32_t        blasCount{ 0 };
+		uint32_t        buildBatchCount{ 0 };
+		uint32_t        compactedCount{ 0 };
+		VkDeviceSize    builtSize{ 0 };         // Sum of the BLAS sizes reported before compaction
+		VkDeviceSize    compactedSize{ 0 };     // The same BLASes after compaction
+		VkDeviceSize    scratchSize{ 0 };       // Shared scratch buffer
+		uint32_t        tlasBuildCount{ 0 };
+		uint32_t        tlasUpdateCount{ 0 };
+		uint32_t        blasRefitCount{ 0 };    // Deforming BLASes refitted inside frames
+		uint32_t        blasRebuildCount{ 0 };  // And built or rebuilt inside frames
+	};
+
+	/*
+	* Bottom and top level acceleration structures.
+	* BLASes are queued with addBlas and built by buildPendingBlas on the graphics queue, as many per submission as fit in
+	* the scratch budget. Every build takes its scratch memory from one shared buffer, compactable BLASes have their compacted
+	* sizes queried after each batch and are copied into structures of that size, the originals are destroyed right away.
+	* Deforming BLASes are refitted in place inside the frame command buffer by refitBlas, as many per build command as fit
+	* in the scratch buffer.
+	* The TLAS is built inside the frame command buffer. When the instance count did not change it is refitted in place
+	* from the new transforms, with a full rebuild every m_tlasRebuildInterval updates since refits degrade the tree.
+	* Refitted BLASes are rebuilt every m_blasRebuildInterval refits for the same reason.
+	* Instance buffers are per frame in flight, the TLAS and the scratch buffer are shared and guarded by barriers. A scratch
+	* buffer or TLAS replaced inside a frame is kept until beginFrame reaches the same frame slot again, commands recorded
+	* earlier in the frame and frames still in flight may use it.
+	*/
+	class AccelerationStructureBuilder
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkQueue queue,
+			uint32_t maxFrameInFlight, const VkAllocationCallbacks* pAllocator, bool rayTracingPipelines);
+		void cleanup();
+
+		// Destroys what the previous use of the frame slot replaced, its fence must have been waited for
+		void beginFrame(uint32_t frameIndex);
+
+		BlasHandle addBlas(const BlasDesc& desc);
+		// Build every queued BLAS and wait for the builds, call outside frames
+		void buildPendingBlas();
+
+		/*
+		* Refit BLASes added with allowUpdate from the current contents of their geometry buffers. Those still pending are
+		* built instead, geometry written on the GPU only exists once the frame has written it. The caller makes the writes
+		* of the geometry visible to acceleration structure builds, TLAS builds and ray tracing shaders recorded afterwards
+		* see the refitted BLASes.
+		*/
+		void refitBlas(VkCommandBuffer commandBuffer, const std::vector<BlasHandle>& blases);
+
+		/*
+		* Build or refit the TLAS from the instances. Reads of the previous TLAS in earlier commands are waited for,
+		* ray tracing, compute and fragment shaders recorded afterwards see the new one.
+		*/
+		void buildTlas(VkCommandBuffer commandBuffer, const std::vector<TlasInstance>& instances);
+
+		VkAccelerationStructureKHR getBlas(BlasHandle blas) const { return m_blases[blas].structure.handle; }
+		VkDeviceAddress getBlasAddress(BlasHandle blas) const { return m_blases[blas].structure.address; }
+		VkAccelerationStructureKHR getTlas() const { return m_tlas.handle; }
+		const AccelerationStructureStatistics& getStatistics() const { return m_statistics; }
+		void printStatistics() const;
+
+	public:
+		VkDeviceSize    m_scratchBudget{ 64ull << 20 };     // Scratch memory a BLAS batch may use, a larger single build gets its size
+		uint32_t        m_tlasRebuildInterval{ 64 };
+		uint32_t        m_blasRebuildInterval{ 64 };
+
+	private:
+		struct Structure
+		{
+			VkAccelerationStructureKHR  handle{ VK_NULL_HANDLE };
+			VkBuffer                    buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory              memory{ VK_NULL_HANDLE };
+			VkDeviceAddress             address{ 0 };
+			VkDeviceSize                size{ 0 };
+		};
+
+		struct Blas
+		{
+			BlasDesc                                    desc{};
+			Structure                                   structure{};
+			std::vector<VkAccelerationStructureGeometryKHR> geometries{};
+			std::vector<VkAccelerationStructureBuildRangeInfoKHR> ranges{};
+			VkBuildAccelerationStructureFlagsKHR        flags{ 0 };
+			VkDeviceSize                                scratchSize{ 0 };
+			uint32_t                                    updatesSinceBuild{ 0 };
+		};
+
+		struct InstanceBuffer
+		{
+			VkBuffer        buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory  memory{ VK_NULL_HANDLE };
+			void*           mapped{ nullptr };
+			uint32_t        capacity{ 0 };
+		};
+
+		Structure createStructure(VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+		void destroyStructure(Structure& structure);
+		void retireStructure(Structure& structure);
+		void destroyRetired();
+		void ensureScratch(VkDeviceSize size);
+		VkDeviceAddress getBufferAddress(VkBuffer buffer) const;
+		VkDeviceAddress getScratchAddress(VkDeviceSize offset) const;
+		VkDeviceSize alignScratch(VkDeviceSize size) const;
+		void buildBatch(const std::vector<BlasHandle>& batch);
+		void compactBatch(const std::vector<BlasHandle>& batch);
+		VkCommandBuffer beginSingleTimeCommands();
+		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+	private:
+		VkPhysicalDevice                m_physicalDevice{ VK_NULL_HANDLE };
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		VkQueue                         m_queue{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		VkDeviceSize                    m_scratchAlignment{ 256 };
+		VkPipelineStageFlags            m_traceStages{ 0 };     // Shader stages reading the TLAS
+
+		VkCommandPool                   m_commandPool{ VK_NULL_HANDLE };
+		VkFence                         m_fence{ VK_NULL_HANDLE };
+		VkQueryPool                     m_compactedSizeQueries{ VK_NULL_HANDLE };
+		uint32_t                        m_queryCapacity{ 0 };
+
+		VkBuffer                        m_scratchBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory                  m_scratchMemory{ VK_NULL_HANDLE };
+		VkDeviceSize                    m_scratchCapacity{ 0 };
+		VkDeviceAddress                 m_scratchAddress{ 0 };
+
+		uint32_t                        m_currentFrame{ 0 };
+		std::vector<std::vector<Structure>> m_retired{};      // Per frame slot, replaced scratch buffers and TLASes
+
+		std::vector<Blas>               m_blases{};
+		std::vector<BlasHandle>         m_pendingBlases{};
+
+		Structure                       m_tlas{};
+		uint32_t                        m_tlasInstanceCount{ 0 };
+		uint32_t                        m_tlasUpdatesSinceBuild{ 0 };
+		std::vector<InstanceBuffer>     m_instanceBuffers{};
+
+		AccelerationStructureStatistics m_statistics{};
+	};
+} // namespace PVulkanExamples
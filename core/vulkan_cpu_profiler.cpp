@@ -0,0 +1,170 @@
+#include "vulkan_cpu_profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		const uint32_t GPU_TRACK_THREAD_ID = 0;
+
+		std::string escapeJson(const char* text)
+		{
+			std::string escaped;
+			for (const char* c = text; *c != '\0'; c++)
+			{
+				if (*c == '"' || *c == '\\') escaped += '\\';
+				if (static_cast<unsigned char>(*c) >= 0x20) escaped += *c;
+			}
+			return escaped;
+		}
+	}
+
+	CpuProfiler& CpuProfiler::instance()
+	{
+		static CpuProfiler profiler;
+		return profiler;
+	}
+
+	CpuProfiler::CpuProfiler()
+	{
+		m_epoch = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+		m_gpuBuffer = std::make_unique<ThreadBuffer>();
+		m_gpuBuffer->name = "GPU";
+		m_gpuBuffer->threadId = GPU_TRACK_THREAD_ID;
+	}
+
+	uint64_t CpuProfiler::now() const
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count()) - m_epoch;
+	}
+
+	/*
+	* Buffer of the calling thread, registered on first use and kept until exit so cached pointers stay valid
+	*/
+	CpuProfiler::ThreadBuffer& CpuProfiler::threadBuffer()
+	{
+		thread_local ThreadBuffer* pBuffer = nullptr;
+		if (pBuffer == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(m_registrationMutex);
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->threadId = static_cast<uint32_t>(m_threadBuffers.size()) + 1;
+			buffer->name = "Thread " + std::to_string(buffer->threadId);
+			pBuffer = buffer.get();
+			m_threadBuffers.push_back(std::move(buffer));
+		}
+		return *pBuffer;
+	}
+
+	/*
+	* Events are only stored while the profiler is enabled, the buffer is allocated by the first of them
+	*/
+	void CpuProfiler::record(ThreadBuffer& buffer, const Event& event)
+	{
+		if (buffer.events.empty()) buffer.events.resize(m_eventsPerThread);
+		uint32_t index = buffer.count.load(std::memory_order_relaxed);
+		if (index >= buffer.events.size())
+		{
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		buffer.events[index] = event;
+		buffer.count.store(index + 1, std::memory_order_release);
+	}
+
+	void CpuProfiler::setThreadName(const char* name)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(m_registrationMutex);
+		buffer.name = name;
+	}
+
+	void CpuProfiler::zone(const char* name, uint64_t beginNs, uint64_t endNs)
+	{
+		if (!isEnabled()) return;
+		record(threadBuffer(), { name, beginNs, endNs, 0.0, EventType::Zone });
+	}
+
+	void CpuProfiler::counter(const char* name, double value)
+	{
+		if (!isEnabled()) return;
+		uint64_t timestamp = now();
+		record(threadBuffer(), { name, timestamp, timestamp, value, EventType::Counter });
+	}
+
+	/*
+	* Record a zone measured on the GPU clock, must be called from a single thread (the one collecting GPU queries)
+	*/
+	void CpuProfiler::gpuZone(const char* name, uint64_t beginGpuNs, uint64_t endGpuNs)
+	{
+		if (!isEnabled()) return;
+		record(*m_gpuBuffer, { name, beginGpuNs, endGpuNs, 0.0, EventType::Zone });
+	}
+
+	/*
+	* Write every recorded event as Chrome trace event JSON, timestamps in microseconds
+	*/
+	bool CpuProfiler::exportChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) return false;
+
+		std::lock_guard<std::mutex> lock(m_registrationMutex);
+		std::vector<ThreadBuffer*> buffers{ m_gpuBuffer.get() };
+		for (auto& buffer : m_threadBuffers) buffers.push_back(buffer.get());
+
+		int64_t gpuOffset = m_gpuToCpuOffsetNs.load(std::memory_order_relaxed);
+		uint64_t dropped = 0;
+		bool first = true;
+		auto separator = [&]() -> std::ofstream& { file << (first ? "\n" : ",\n"); first = false; return file; };
+
+		file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+		for (ThreadBuffer* buffer : buffers)
+		{
+			uint32_t count = buffer->count.load(std::memory_order_acquire);
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+			if (count == 0 && buffer != m_gpuBuffer.get()) continue;
+
+			separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"" << escapeJson(buffer->name.c_str()) << "\"}}";
+			int64_t offset = buffer == m_gpuBuffer.get() ? gpuOffset : 0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Event& event = buffer->events[i];
+				double begin = (static_cast<int64_t>(event.begin) + offset) * 1e-3;
+				if (event.type == EventType::Zone)
+				{
+					separator() << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+						<< ",\"ts\":" << begin << ",\"dur\":" << (event.end - event.begin) * 1e-3 << "}";
+				}
+				else
+				{
+					separator() << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << buffer->threadId
+						<< ",\"ts\":" << begin << ",\"args\":{\"value\":" << event.value << "}}";
+				}
+			}
+		}
+		file << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+		return file.good();
+	}
+
+	/*
+	* Discard recorded events, only safe while no other thread is recording
+	*/
+	void CpuProfiler::clear()
+	{
+		std::lock_guard<std::mutex> lock(m_registrationMutex);
+		for (auto& buffer : m_threadBuffers)
+		{
+			buffer->count.store(0, std::memory_order_relaxed);
+			buffer->dropped.store(0, std::memory_order_relaxed);
+		}
+		m_gpuBuffer->count.store(0, std::memory_order_relaxed);
+		m_gpuBuffer->dropped.store(0, std::memory_order_relaxed);
+	}
+} // namespace PVulkanExamples
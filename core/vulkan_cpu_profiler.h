@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	/*
+	* Lightweight CPU instrumentation: scoped zones, counters and thread names.
+	* Every thread records into its own fixed size buffer, recording takes no lock,
+	* only the first event of a thread registers and allocates its buffer. GPU zones reported by the
+	* GpuProfiler are stored on a separate track and shifted onto the CPU clock at export.
+	* Traces are written in the Chrome trace event JSON format, readable by chrome://tracing and Perfetto.
+	*/
+	class CpuProfiler
+	{
+	public:
+		static CpuProfiler& instance();
+
+		void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+		bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+		uint64_t now() const;   // Nanoseconds since the profiler was created
+
+		void setThreadName(const char* name);
+		void zone(const char* name, uint64_t beginNs, uint64_t endNs);
+		void counter(const char* name, double value);
+		void gpuZone(const char* name, uint64_t beginGpuNs, uint64_t endGpuNs);
+		void setGpuClockOffset(int64_t gpuToCpuNs) { m_gpuToCpuOffsetNs.store(gpuToCpuNs, std::memory_order_relaxed); }
+
+		bool exportChromeTrace(const std::string& path);
+		void clear();
+
+	public:
+		uint32_t m_eventsPerThread{ 1 << 16 };  // Events beyond the capacity of a thread buffer are dropped and counted
+
+	private:
+		enum class EventType : uint8_t
+		{
+			Zone,
+			Counter,
+		};
+
+		struct Event
+		{
+			const char* name{ nullptr };    // Expected to outlive the trace, typically a string literal
+			uint64_t    begin{ 0 };
+			uint64_t    end{ 0 };
+			double      value{ 0.0 };
+			EventType   type{ EventType::Zone };
+		};
+
+		// Written by its owning thread only, published to the exporter through count
+		struct ThreadBuffer
+		{
+			std::vector<Event>      events{};
+			std::atomic<uint32_t>   count{ 0 };
+			std::atomic<uint32_t>   dropped{ 0 };
+			std::string             name{};
+			uint32_t                threadId{ 0 };
+		};
+
+		CpuProfiler();
+		ThreadBuffer& threadBuffer();
+		void record(ThreadBuffer& buffer, const Event& event);
+
+	private:
+		std::atomic<bool>                           m_enabled{ false };
+		std::atomic<int64_t>                        m_gpuToCpuOffsetNs{ 0 };
+		uint64_t                                    m_epoch{ 0 };
+		std::mutex                                  m_registrationMutex{};  // Guards m_threadBuffers, taken once per thread and by export
+		std::vector<std::unique_ptr<ThreadBuffer>>  m_threadBuffers{};
+		std::unique_ptr<ThreadBuffer>               m_gpuBuffer{};
+	};
+
+	/*
+	* RAII helper recording a CPU zone over a scope
+	*/
+	class CpuProfileScope
+	{
+	public:
+		explicit CpuProfileScope(const char* name)
+			: m_name(CpuProfiler::instance().isEnabled() ? name : nullptr), m_begin(m_name ? CpuProfiler::instance().now() : 0) {}
+		~CpuProfileScope()
+		{
+			if (m_name) CpuProfiler::instance().zone(m_name, m_begin, CpuProfiler::instance().now());
+		}
+
+	private:
+		const char* m_name;
+		uint64_t    m_begin;
+	};
+} // namespace PVulkanExamples
+
+#define PVE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PVE_PROFILE_CONCAT(a, b) PVE_PROFILE_CONCAT_IMPL(a, b)
+#define PVE_PROFILE_ZONE(name) ::PVulkanExamples::CpuProfileScope PVE_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#define PVE_PROFILE_FUNCTION() PVE_PROFILE_ZONE(__func__)
+#define PVE_PROFILE_COUNTER(name, value) ::PVulkanExamples::CpuProfiler::instance().counter(name, static_cast<double>(value))
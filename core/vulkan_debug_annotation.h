@@ -0,0 +1,202 @@
+#pragma once
+
+#include "vulkan_dispatch.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+
+namespace PVulkanExamples
+{
+	/*
+	* Annotation policies, the disabled policy turns every annotation call into an empty inline function
+	*/
+	struct DebugAnnotationEnabled { static constexpr bool enabled = true; };
+	struct DebugAnnotationDisabled { static constexpr bool enabled = false; };
+
+#ifdef NDEBUG
+	using DefaultDebugAnnotationPolicy = DebugAnnotationDisabled;
+#else
+	using DefaultDebugAnnotationPolicy = DebugAnnotationEnabled;
+#endif
+
+	/*
+	* Object type of a Vulkan handle type, used to name objects without spelling out VkObjectType
+	*/
+	template <typename T> struct VulkanObjectType;
+	template <> struct VulkanObjectType<VkBuffer> { static constexpr VkObjectType value = VK_OBJECT_TYPE_BUFFER; };
+	template <> struct VulkanObjectType<VkBufferView> { static constexpr VkObjectType value = VK_OBJECT_TYPE_BUFFER_VIEW; };
+	template <> struct VulkanObjectType<VkCommandBuffer> { static constexpr VkObjectType value = VK_OBJECT_TYPE_COMMAND_BUFFER; };
+	template <> struct VulkanObjectType<VkCommandPool> { static constexpr VkObjectType value = VK_OBJECT_TYPE_COMMAND_POOL; };
+	template <> struct VulkanObjectType<VkDescriptorPool> { static constexpr VkObjectType value = VK_OBJECT_TYPE_DESCRIPTOR_POOL; };
+	template <> struct VulkanObjectType<VkDescriptorSet> { static constexpr VkObjectType value = VK_OBJECT_TYPE_DESCRIPTOR_SET; };
+	template <> struct VulkanObjectType<VkDescriptorSetLayout> { static constexpr VkObjectType value = VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT; };
+	template <> struct VulkanObjectType<VkDevice> { static constexpr VkObjectType value = VK_OBJECT_TYPE_DEVICE; };
+	template <> struct VulkanObjectType<VkDeviceMemory> { static constexpr VkObjectType value = VK_OBJECT_TYPE_DEVICE_MEMORY; };
+	template <> struct VulkanObjectType<VkFramebuffer> { static constexpr VkObjectType value = VK_OBJECT_TYPE_FRAMEBUFFER; };
+	template <> struct VulkanObjectType<VkFence> { static constexpr VkObjectType value = VK_OBJECT_TYPE_FENCE; };
+	template <> struct VulkanObjectType<VkImage> { static constexpr VkObjectType value = VK_OBJECT_TYPE_IMAGE; };
+	template <> struct VulkanObjectType<VkImageView> { static constexpr VkObjectType value = VK_OBJECT_TYPE_IMAGE_VIEW; };
+	template <> struct VulkanObjectType<VkPipeline> { static constexpr VkObjectType value = VK_OBJECT_TYPE_PIPELINE; };
+	template <> struct VulkanObjectType<VkPipelineCache> { static constexpr VkObjectType value = VK_OBJECT_TYPE_PIPELINE_CACHE; };
+	template <> struct VulkanObjectType<VkPipelineLayout> { static constexpr VkObjectType value = VK_OBJECT_TYPE_PIPELINE_LAYOUT; };
+	template <> struct VulkanObjectType<VkQueryPool> { static constexpr VkObjectType value = VK_OBJECT_TYPE_QUERY_POOL; };
+	template <> struct VulkanObjectType<VkQueue> { static constexpr VkObjectType value = VK_OBJECT_TYPE_QUEUE; };
+	template <> struct VulkanObjectType<VkRenderPass> { static constexpr VkObjectType value = VK_OBJECT_TYPE_RENDER_PASS; };
+	template <> struct VulkanObjectType<VkSampler> { static constexpr VkObjectType value = VK_OBJECT_TYPE_SAMPLER; };
+	template <> struct VulkanObjectType<VkSemaphore> { static constexpr VkObjectType value = VK_OBJECT_TYPE_SEMAPHORE; };
+	template <> struct VulkanObjectType<VkShaderModule> { static constexpr VkObjectType value = VK_OBJECT_TYPE_SHADER_MODULE; };
+	template <> struct VulkanObjectType<VkSwapchainKHR> { static constexpr VkObjectType value = VK_OBJECT_TYPE_SWAPCHAIN_KHR; };
+	template <> struct VulkanObjectType<VkAccelerationStructureKHR> { static constexpr VkObjectType value = VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR; };
+
+	/*
+	* Object names, command buffer labels and queue labels through VK_EXT_debug_utils.
+	* Names are null terminated C strings passed straight to the driver, nothing is allocated.
+	* Entry points come from vkGetDeviceProcAddr, calls are ignored when the extension is not enabled on the instance.
+	*/
+	template <typename Policy>
+	class DebugAnnotatorT
+	{
+	public:
+		void init(VkDevice device)
+		{
+			if constexpr (Policy::enabled)
+			{
+				m_device = device;
+				m_pfnSetObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkd.vkGetDeviceProcAddr(device, "vkSetDebugUtilsObjectNameEXT");
+				m_pfnCmdBeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkCmdBeginDebugUtilsLabelEXT");
+				m_pfnCmdEndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkCmdEndDebugUtilsLabelEXT");
+				m_pfnCmdInsertLabel = (PFN_vkCmdInsertDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkCmdInsertDebugUtilsLabelEXT");
+				m_pfnQueueBeginLabel = (PFN_vkQueueBeginDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkQueueBeginDebugUtilsLabelEXT");
+				m_pfnQueueEndLabel = (PFN_vkQueueEndDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkQueueEndDebugUtilsLabelEXT");
+				m_pfnQueueInsertLabel = (PFN_vkQueueInsertDebugUtilsLabelEXT)vkd.vkGetDeviceProcAddr(device, "vkQueueInsertDebugUtilsLabelEXT");
+			}
+		}
+
+		bool isAvailable() const
+		{
+			if constexpr (Policy::enabled) return m_pfnSetObjectName != nullptr;
+			else return false;
+		}
+
+		void setObjectName(uint64_t object, VkObjectType objectType, const char* name) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnSetObjectName == nullptr || object == 0) return;
+				VkDebugUtilsObjectNameInfoEXT nameInfo{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, objectType, object, name };
+				m_pfnSetObjectName(m_device, &nameInfo);
+			}
+		}
+
+		template <typename T>
+		void setObjectName(T object, const char* name) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				setObjectName((uint64_t)object, VulkanObjectType<T>::value, name);
+			}
+		}
+
+		void beginLabel(VkCommandBuffer commandBuffer, const char* name, const float* pColor = nullptr) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnCmdBeginLabel == nullptr) return;
+				VkDebugUtilsLabelEXT label = makeLabel(name, pColor);
+				m_pfnCmdBeginLabel(commandBuffer, &label);
+			}
+		}
+
+		void endLabel(VkCommandBuffer commandBuffer) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnCmdEndLabel != nullptr) m_pfnCmdEndLabel(commandBuffer);
+			}
+		}
+
+		void insertLabel(VkCommandBuffer commandBuffer, const char* name, const float* pColor = nullptr) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnCmdInsertLabel == nullptr) return;
+				VkDebugUtilsLabelEXT label = makeLabel(name, pColor);
+				m_pfnCmdInsertLabel(commandBuffer, &label);
+			}
+		}
+
+		void beginQueueLabel(VkQueue queue, const char* name, const float* pColor = nullptr) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnQueueBeginLabel == nullptr) return;
+				VkDebugUtilsLabelEXT label = makeLabel(name, pColor);
+				m_pfnQueueBeginLabel(queue, &label);
+			}
+		}
+
+		void endQueueLabel(VkQueue queue) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnQueueEndLabel != nullptr) m_pfnQueueEndLabel(queue);
+			}
+		}
+
+		void insertQueueLabel(VkQueue queue, const char* name, const float* pColor = nullptr) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (m_pfnQueueInsertLabel == nullptr) return;
+				VkDebugUtilsLabelEXT label = makeLabel(name, pColor);
+				m_pfnQueueInsertLabel(queue, &label);
+			}
+		}
+
+	private:
+		static VkDebugUtilsLabelEXT makeLabel(const char* name, const float* pColor)
+		{
+			VkDebugUtilsLabelEXT label{};
+			label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+			label.pLabelName = name;
+			if (pColor != nullptr)
+			{
+				for (int i = 0; i < 4; i++) label.color[i] = pColor[i];
+			}
+			return label;
+		}
+
+	private:
+		VkDevice                            m_device{ VK_NULL_HANDLE };
+		PFN_vkSetDebugUtilsObjectNameEXT    m_pfnSetObjectName{ nullptr };
+		PFN_vkCmdBeginDebugUtilsLabelEXT    m_pfnCmdBeginLabel{ nullptr };
+		PFN_vkCmdEndDebugUtilsLabelEXT      m_pfnCmdEndLabel{ nullptr };
+		PFN_vkCmdInsertDebugUtilsLabelEXT   m_pfnCmdInsertLabel{ nullptr };
+		PFN_vkQueueBeginDebugUtilsLabelEXT  m_pfnQueueBeginLabel{ nullptr };
+		PFN_vkQueueEndDebugUtilsLabelEXT    m_pfnQueueEndLabel{ nullptr };
+		PFN_vkQueueInsertDebugUtilsLabelEXT m_pfnQueueInsertLabel{ nullptr };
+	};
+
+	/*
+	* RAII command buffer label scope
+	*/
+	template <typename Policy>
+	class DebugLabelScopeT
+	{
+	public:
+		DebugLabelScopeT(const DebugAnnotatorT<Policy>& annotator, VkCommandBuffer commandBuffer, const char* name, const float* pColor = nullptr)
+			: m_annotator(annotator), m_commandBuffer(commandBuffer)
+		{
+			m_annotator.beginLabel(m_commandBuffer, name, pColor);
+		}
+		~DebugLabelScopeT() { m_annotator.endLabel(m_commandBuffer); }
+
+	private:
+		const DebugAnnotatorT<Policy>&  m_annotator;
+		VkCommandBuffer                 m_commandBuffer;
+	};
+
+	using DebugAnnotator = DebugAnnotatorT<DefaultDebugAnnotationPolicy>;
+	using DebugLabelScope = DebugLabelScopeT<DefaultDebugAnnotationPolicy>;
+} // namespace PVulkanExamples
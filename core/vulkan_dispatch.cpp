@@ -0,0 +1,44 @@
+#include "vulkan_dispatch.h"
+
+namespace PVulkanExamples
+{
+	VulkanDispatch vkd{};
+
+	/*
+	* Select the entry point provider and load the global functions, called before the instance is created
+	*/
+	void VulkanDispatch::init(PFN_vkGetInstanceProcAddr getInstanceProcAddr)
+	{
+		reset();
+		vkGetInstanceProcAddr = getInstanceProcAddr;
+#define PVE_LOAD_GLOBAL_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(VK_NULL_HANDLE, #name));
+		PVE_VULKAN_GLOBAL_FUNCTIONS(PVE_LOAD_GLOBAL_FUNCTION)
+#undef PVE_LOAD_GLOBAL_FUNCTION
+	}
+
+	/*
+	* Load the instance and device level functions, device level ones resolve to the loader trampolines
+	*/
+	void VulkanDispatch::loadInstance(VkInstance instance)
+	{
+#define PVE_LOAD_INSTANCE_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+		PVE_VULKAN_INSTANCE_FUNCTIONS(PVE_LOAD_INSTANCE_FUNCTION)
+		PVE_VULKAN_DEVICE_FUNCTIONS(PVE_LOAD_INSTANCE_FUNCTION)
+#undef PVE_LOAD_INSTANCE_FUNCTION
+	}
+
+	/*
+	* Load the device level functions straight from the driver of the device, skipping the loader trampolines
+	*/
+	void VulkanDispatch::loadDevice(VkDevice device)
+	{
+#define PVE_LOAD_DEVICE_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));
+		PVE_VULKAN_DEVICE_FUNCTIONS(PVE_LOAD_DEVICE_FUNCTION)
+#undef PVE_LOAD_DEVICE_FUNCTION
+	}
+
+	void VulkanDispatch::reset()
+	{
+		*this = VulkanDispatch{};
+	}
+} // namespace PVulkanExamples
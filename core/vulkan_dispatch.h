@@ -0,0 +1,173 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+/*
+* Entry points called by core, listed once and expanded into the dispatch table members, their loading and the mock driver.
+* Add a function to the list matching the level of its first parameter before calling it through vkd.
+*/
+
+// Resolved with a null instance
+#define PVE_VULKAN_GLOBAL_FUNCTIONS(X) \
+	X(vkCreateInstance) \
+	X(vkEnumerateInstanceExtensionProperties) \
+	X(vkEnumerateInstanceLayerProperties) \
+	X(vkEnumerateInstanceVersion)
+
+// First parameter is the instance or a physical device
+#define PVE_VULKAN_INSTANCE_FUNCTIONS(X) \
+	X(vkDestroyInstance) \
+	X(vkEnumeratePhysicalDevices) \
+	X(vkEnumeratePhysicalDeviceGroups) \
+	X(vkGetPhysicalDeviceProperties) \
+	X(vkGetPhysicalDeviceProperties2) \
+	X(vkGetPhysicalDeviceFeatures) \
+	X(vkGetPhysicalDeviceFeatures2) \
+	X(vkGetPhysicalDeviceQueueFamilyProperties) \
+	X(vkGetPhysicalDeviceMemoryProperties) \
+	X(vkGetPhysicalDeviceFormatProperties) \
+	X(vkEnumerateDeviceExtensionProperties) \
+	X(vkCreateDevice) \
+	X(vkGetDeviceProcAddr) \
+	X(vkDestroySurfaceKHR) \
+	X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+	X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+	X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+	X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkDestroyDebugUtilsMessengerEXT)
+
+// First parameter is the device, a queue or a command buffer
+#define PVE_VULKAN_DEVICE_FUNCTIONS(X) \
+	X(vkDestroyDevice) \
+	X(vkGetDeviceQueue) \
+	X(vkDeviceWaitIdle) \
+	X(vkQueueSubmit) \
+	X(vkQueueWaitIdle) \
+	X(vkAllocateMemory) \
+	X(vkFreeMemory) \
+	X(vkMapMemory) \
+	X(vkUnmapMemory) \
+	X(vkCreateBuffer) \
+	X(vkDestroyBuffer) \
+	X(vkGetBufferMemoryRequirements) \
+	X(vkBindBufferMemory) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkGetImageMemoryRequirements) \
+	X(vkBindImageMemory) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	X(vkCreateSampler) \
+	X(vkDestroySampler) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyShaderModule) \
+	X(vkCreatePipelineCache) \
+	X(vkDestroyPipelineCache) \
+	X(vkCreatePipelineLayout) \
+	X(vkDestroyPipelineLayout) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkCreateComputePipelines) \
+	X(vkCreateRayTracingPipelinesKHR) \
+	X(vkGetRayTracingShaderGroupHandlesKHR) \
+	X(vkDestroyPipeline) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkCreateDescriptorPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkResetDescriptorPool) \
+	X(vkAllocateDescriptorSets) \
+	X(vkFreeDescriptorSets) \
+	X(vkUpdateDescriptorSets) \
+	X(vkCreateFramebuffer) \
+	X(vkDestroyFramebuffer) \
+	X(vkCreateRenderPass) \
+	X(vkDestroyRenderPass) \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkFreeCommandBuffers) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	X(vkResetCommandBuffer) \
+	X(vkCreateFence) \
+	X(vkDestroyFence) \
+	X(vkResetFences) \
+	X(vkGetFenceStatus) \
+	X(vkWaitForFences) \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkCreateQueryPool) \
+	X(vkDestroyQueryPool) \
+	X(vkGetQueryPoolResults) \
+	X(vkGetBufferDeviceAddress) \
+	X(vkCreateAccelerationStructureKHR) \
+	X(vkDestroyAccelerationStructureKHR) \
+	X(vkGetAccelerationStructureBuildSizesKHR) \
+	X(vkGetAccelerationStructureDeviceAddressKHR) \
+	X(vkCmdPipelineBarrier) \
+	X(vkCmdPipelineBarrier2KHR) \
+	X(vkCmdClearColorImage) \
+	X(vkCmdCopyBuffer) \
+	X(vkCmdUpdateBuffer) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdCopyImageToBuffer) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdBindVertexBuffers) \
+	X(vkCmdBindIndexBuffer) \
+	X(vkCmdPushConstants) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdBeginRenderPass) \
+	X(vkCmdEndRenderPass) \
+	X(vkCmdDraw) \
+	X(vkCmdDrawIndexed) \
+	X(vkCmdDrawIndirectCount) \
+	X(vkCmdDrawIndexedIndirectCount) \
+	X(vkCmdDrawMeshTasksNV) \
+	X(vkCmdDispatch) \
+	X(vkCmdTraceRaysKHR) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdWriteTimestamp) \
+	X(vkCmdBeginQuery) \
+	X(vkCmdEndQuery) \
+	X(vkCmdBuildAccelerationStructuresKHR) \
+	X(vkCmdWriteAccelerationStructuresPropertiesKHR) \
+	X(vkCmdCopyAccelerationStructureKHR) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR)
+
+namespace PVulkanExamples
+{
+	/*
+	* Function pointer table standing between core and the Vulkan loader.
+	* Every entry point is resolved through the vkGetInstanceProcAddr handed to init, the loader's export or the one of
+	* an in-process driver such as MockDriver, so core runs unchanged on either.
+	* Once the device exists, loadDevice replaces the device level entries, loader trampolines dispatching on the handle,
+	* with the driver functions of that device, which makes the table specific to one device.
+	* Extension entry points stay null when the extension is not available.
+	*/
+	struct VulkanDispatch
+	{
+		void init(PFN_vkGetInstanceProcAddr getInstanceProcAddr);
+		void loadInstance(VkInstance instance);
+		void loadDevice(VkDevice device);
+		void reset();
+
+		PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr{ nullptr };
+
+#define PVE_DECLARE_VULKAN_FUNCTION(name) PFN_##name name{ nullptr };
+		PVE_VULKAN_GLOBAL_FUNCTIONS(PVE_DECLARE_VULKAN_FUNCTION)
+		PVE_VULKAN_INSTANCE_FUNCTIONS(PVE_DECLARE_VULKAN_FUNCTION)
+		PVE_VULKAN_DEVICE_FUNCTIONS(PVE_DECLARE_VULKAN_FUNCTION)
+#undef PVE_DECLARE_VULKAN_FUNCTION
+	};
+
+	// Table every Vulkan call in core goes through
+	extern VulkanDispatch vkd;
+} // namespace PVulkanExamples
@@ -2,69 +2,298 @@
 #include "templates.h"
 #include "vulkan_reflection_util.h"
 #include "vulkan_util.h"
+#include "vulkan_cpu_profiler.h"
+#include "vulkan_validation_sink.h"
+#include "vulkan_host_allocator.h"
+#include "configFile.h"
 
 #include <set>
 #include <algorithm>
 #include <stdexcept>
 #include <memory>
+#include <fstream>
+#include <cstring>
 
 namespace PVulkanExamples
 {
+    namespace
+    {
+        // Cleared and read back with transfers around the example's rendering
+        constexpr VkImageUsageFlags OFFSCREEN_TARGET_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
+    /*
+    * Common command line options of the examples
+    *   --headless          render offscreen without window or surface
+    *   --frames <n>        number of frames rendered in headless mode
+    *   --dump <file.ppm>   write the last headless frame to disk
+    *   --hot-reload        watch and recompile the example shaders
+    *   --no-validation     do not enable the Khronos validation layer
+    *   --present <mode>    mailbox (default), fifo or immediate
+    *   --gpu-profile       print per zone GPU timings on exit
+    *   --trace <file.json> record CPU and GPU zones and write a Chrome trace on exit
+    *   --pipeline-stats    print the pipeline statistics of the last collected frame on exit
+    *   --host-stats        print driver host allocations per scope on exit
+    *   --host-budget <MiB> cap driver host allocations, 0 for unlimited
+    *   --mock              run headless on the in-process mock driver instead of the Vulkan loader
+    */
+    void ExampleBase::parseArguments(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (argument == "--headless") m_headless = true;
+            else if (argument == "--frames" && i + 1 < argc) m_headlessFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            else if (argument == "--dump" && i + 1 < argc) m_dumpFramePath = argv[++i];
+            else if (argument == "--hot-reload") m_enableShaderHotReload = true;
+            else if (argument == "--no-validation") m_requestValidation = false;
+            else if (argument == "--gpu-profile") m_printGpuProfile = true;
+            else if (argument == "--trace" && i + 1 < argc) m_traceFilePath = argv[++i];
+            else if (argument == "--pipeline-stats") m_printPipelineStatistics = true;
+            else if (argument == "--host-stats") m_printHostAllocations = true;
+            else if (argument == "--host-budget" && i + 1 < argc) m_hostAllocationBudget = std::stoull(argv[++i]) << 20;
+            else if (argument == "--mock") m_useMockDriver = true;
+            else if (argument == "--present" && i + 1 < argc)
+            {
+                std::string policy = argv[++i];
+                m_presentPolicy = policy == "fifo" ? PresentPolicy::PowerSaving : policy == "immediate" ? PresentPolicy::Uncapped : PresentPolicy::LowLatency;
+            }
+        }
+    }
+
+    /*
+    * Initialization steps in execution order, shared by init and the init benchmark
+    */
+    const std::vector<ExampleBase::InitStep>& ExampleBase::getInitSteps()
+    {
+        static const std::vector<InitStep> steps = {
+            { "setup",                      &ExampleBase::setup },
+            { "createInstance",             &ExampleBase::createInstance },
+            { "createDebugMessenger",       &ExampleBase::createDebugMessenger },
+            { "createSurface",              &ExampleBase::createSurface },
+            { "createPhysicalDevice",       &ExampleBase::createPhysicalDevice },
+            { "createLogicalDevice",        &ExampleBase::createLogicalDevice },
+            { "createSwapchain",            &ExampleBase::createSwapchain },
+            { "initializeCommandPools",     &ExampleBase::initializeCommandPools },
+            { "initializeCommandBuffers",   &ExampleBase::initializeCommandBuffers },
+            { "createDescriptorPools",      &ExampleBase::createDescriptorPools },
+            { "createSyncObjects",          &ExampleBase::createSyncObjects },
+            { "createOffscreenTargets",     &ExampleBase::createOffscreenTargets },
+            { "initializeSubsystems",       &ExampleBase::initializeSubsystems },
+        };
+        return steps;
+    }
+
 	void ExampleBase::init()
 	{
-        
-        setup();
-		createInstance();
-		createDebugMessenger();
-		createSurface();
-		createPhysicalDevice();
-		createLogicalDevice();
-		initializeCommandPools();
-		initializeCommandBuffers();
-		createDescriptorPools();
-		createSyncObjects();
+        CpuProfiler::instance().setEnabled(!m_traceFilePath.empty());
+        CpuProfiler::instance().setThreadName("Main");
+        PVE_PROFILE_ZONE("ExampleBase::init");
+
+        for (const InitStep& step : getInitSteps())
+        {
+            (this->*step.function)();
+        }
+        createResources();
 	}
 
+    /*
+    * Profilers, query collectors and pipeline managers built on the device and pipeline cache
+    */
+    void ExampleBase::initializeSubsystems()
+    {
+        PVE_PROFILE_FUNCTION();
+
+        m_gpuProfiler.init(m_physicalDevice, m_device, m_queueFamilyIndices.graphicsFamily.value(), m_maxFrameInFlight, m_defaultAllocator);
+        m_pipelineStatistics.init(m_device, m_physicalFeaturesStructChain.features, m_maxFrameInFlight, m_defaultAllocator);
+        m_shaderPermutations.init(m_device, m_pipelineCache, m_defaultAllocator, m_maxFrameInFlight);
+        m_shaderHotReloader.init(m_device, m_pipelineCache, m_defaultAllocator, m_maxFrameInFlight);
+        m_uploadRing.init(m_physicalDevice, m_device, m_uploadRingFrameSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_maxFrameInFlight, m_defaultAllocator);
+        m_materialSystem.init(m_physicalDevice, m_device, m_maxMaterialCount, m_pipelineLayoutCache.m_runtimeArrayDescriptorCount,
+            m_maxFrameInFlight, m_defaultAllocator);
+        m_renderGraph.init(m_physicalDevice, m_device, m_queueFamilyIndices.graphicsFamily.value(), m_queueFamilyIndices.computeFamily.value(),
+            m_computeQueue, m_maxFrameInFlight, m_defaultAllocator, m_synchronization2Feature.synchronization2 == VK_TRUE,
+            isFeatureSetEnabled("MeshShader"), &m_debugAnnotator);
+        if (m_accelFeature.accelerationStructure == VK_TRUE)
+        {
+            m_accelerationStructures.init(m_physicalDevice, m_device, m_queueFamilyIndices.graphicsFamily.value(), m_graphicsQueue,
+                m_maxFrameInFlight, m_defaultAllocator, m_rtPipelineFeature.rayTracingPipeline == VK_TRUE);
+        }
+#ifdef GLSLANGVALIDATOR
+        m_shaderHotReloader.m_compilerPath = GLSLANGVALIDATOR;
+#endif
+        if (m_enableShaderHotReload && !m_shaderDirectory.empty())
+        {
+            m_shaderHotReloader.watchDirectory(m_shaderDirectory);
+            m_shaderHotReloader.watchDirectory(getShaderDirectory("core"));
+        }
+	}
+
+    void ExampleBase::run()
+    {
+        if (m_headless)
+        {
+            for (uint32_t frame = 0; frame < m_headlessFrameCount; frame++)
+            {
+                drawFrame();
+            }
+            if (!m_dumpFramePath.empty() && !dumpFrame(m_dumpFramePath))
+            {
+                throw std::runtime_error("failed to write frame to " + m_dumpFramePath);
+            }
+        }
+        else
+        {
+            while (!glfwWindowShouldClose(m_window))
+            {
+                glfwPollEvents();
+                drawFrame();
+            }
+        }
+        vkd.vkDeviceWaitIdle(m_device);
+        if (m_printGpuProfile)
+        {
+            m_gpuProfiler.printStatistics();
+        }
+        if (m_printPipelineStatistics)
+        {
+            m_pipelineStatistics.printStatistics({ m_windowWidth, m_windowHeight });
+        }
+        if (!m_traceFilePath.empty() && !CpuProfiler::instance().exportChromeTrace(m_traceFilePath))
+        {
+            throw std::runtime_error("failed to write trace to " + m_traceFilePath);
+        }
+    }
+
     void ExampleBase::cleanup()
     {
-        vkDestroyDevice(m_device, m_defaultAllocator);
-        vkDestroySurfaceKHR(m_instance, m_surface, m_defaultAllocator);
+        if (m_device != VK_NULL_HANDLE)
+        {
+            vkd.vkDeviceWaitIdle(m_device);
+            destroyResources();
+        }
+        for (RetiredSceneTargets& retired : m_retiredSceneTargets)
+        {
+            destroyRetiredSceneTargets(retired);
+        }
+        m_retiredSceneTargets.clear();
+        for (OffscreenTarget& target : m_offscreenTargets)
+        {
+            vkd.vkDestroyImageView(m_device, target.view, m_defaultAllocator);
+            vkd.vkDestroyImage(m_device, target.image, m_defaultAllocator);
+            vkd.vkFreeMemory(m_device, target.memory, m_defaultAllocator);
+            vkd.vkDestroyBuffer(m_device, target.readbackBuffer, m_defaultAllocator);
+            vkd.vkFreeMemory(m_device, target.readbackMemory, m_defaultAllocator);
+        }
+        m_offscreenTargets.clear();
+        for (uint32_t i = 0; i < m_imageInFlightFences.size(); i++)
+        {
+            vkd.vkDestroySemaphore(m_device, m_imageAvaliableForRenderSemaphore[i], m_defaultAllocator);
+            vkd.vkDestroySemaphore(m_device, m_imageRenderFinishedForPresentSemaphores[i], m_defaultAllocator);
+            vkd.vkDestroyFence(m_device, m_imageInFlightFences[i], m_defaultAllocator);
+        }
+        m_imageAvaliableForRenderSemaphore.clear();
+        m_imageRenderFinishedForPresentSemaphores.clear();
+        m_imageInFlightFences.clear();
+        vkd.vkDestroyCommandPool(m_device, m_commandPool, m_defaultAllocator);
+        m_commandBuffers.clear();
+        m_swapchain.cleanup();
+
+        m_accelerationStructures.cleanup();
+        m_renderGraph.cleanup();
+        m_gpuProfiler.cleanup();
+        m_pipelineStatistics.cleanup();
+        m_shaderHotReloader.cleanup();
+        m_shaderPermutations.cleanup();
+        m_materialSystem.cleanup();
+        m_uploadRing.cleanup();
+        m_pipelineLayoutCache.cleanup();
+        vkd.vkDestroyPipelineCache(m_device, m_pipelineCache, m_defaultAllocator);
+        vkd.vkDestroyDevice(m_device, m_defaultAllocator);
+        if (m_surface != VK_NULL_HANDLE) vkd.vkDestroySurfaceKHR(m_instance, m_surface, m_defaultAllocator);
         VulkanUtil::destroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, m_defaultAllocator);
-        vkDestroyInstance(m_instance, m_defaultAllocator);
+        vkd.vkDestroyInstance(m_instance, m_defaultAllocator);
+        m_commandPool = VK_NULL_HANDLE;
+        m_pipelineCache = VK_NULL_HANDLE;
+        m_device = VK_NULL_HANDLE;
+        m_physicalDevice = VK_NULL_HANDLE;
+        m_surface = VK_NULL_HANDLE;
+        m_debugMessenger = VK_NULL_HANDLE;
+        m_instance = VK_NULL_HANDLE;
+        m_validationSink.stop();
+        if (m_printHostAllocations)
+        {
+            m_hostAllocator.printStatistics();
+        }
+        m_hostAllocator.cleanup();
+        m_defaultAllocator = nullptr;
+        if (m_window != nullptr)
+        {
+            glfwDestroyWindow(m_window);
+            glfwTerminate();
+            m_window = nullptr;
+        }
     }
 
     void ExampleBase::setup()
     {
+        PVE_PROFILE_FUNCTION();
+
         m_debugMode = false;
 
-        //Window settings
+        // Start from a clean state so init can run again after cleanup
+        m_deviceExtensions.clear();
+        m_deviceFeatureSets.clear();
+        m_EXTPhysicalDeviceFeatureStructs.clear();
+        m_physicalDeviceFeatureRequirements.clear();
+        m_physicalFeaturesStructChain.pNext = nullptr;
+        m_frameCounter = 0;
+        m_framebufferResized = false;
+
+        // The mock driver has no window system integration and no layers
+        if (m_useMockDriver)
+        {
+            m_headless = true;
+            m_requestValidation = false;
+        }
+
+        //Window settings, in headless mode the size is used for the offscreen targets
         m_windowWidth = 800;
         m_windowHeight = 600;
-        if (!glfwInit())
+        if (!m_headless)
         {
-            throw std::runtime_error("failed to initialize GLFW");
+            if (!glfwInit())
+            {
+                throw std::runtime_error("failed to initialize GLFW");
+            }
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+            m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, m_title, nullptr, nullptr);
+            glfwSetWindowUserPointer(m_window, this);
+            glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int width, int height)
+            {
+                reinterpret_cast<ExampleBase*>(glfwGetWindowUserPointer(window))->m_framebufferResized = true;
+            });
         }
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, m_title, nullptr, nullptr);
 
         //Specify vulkan api settings
         m_apiMajor = 1;
         m_apiMinor = 2;
         m_apiVersion = VK_MAKE_API_VERSION(0, m_apiMajor, m_apiMinor, 0);
-        m_instanceLayers = { "VK_LAYER_KHRONOS_validation" };
+        m_instanceLayers = m_requestValidation ? std::vector<const char*>{ "VK_LAYER_KHRONOS_validation" } : std::vector<const char*>{};
         m_enableValidationLayers = !m_instanceLayers.empty();
 
-        //Memory allocator
-        m_defaultAllocator = nullptr;
-
         // Instance extensions
         m_instanceExtensions = {};
         // GLFW extensions
-        uint32_t count{ 0 };
-        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&count);
-        for (int extId = 0; extId < count; ++extId)
+        if (!m_headless)
         {
-            m_instanceExtensions.push_back(glfwExtensions[extId]);
+            uint32_t count{ 0 };
+            const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&count);
+            for (int extId = 0; extId < count; ++extId)
+            {
+                m_instanceExtensions.push_back(glfwExtensions[extId]);
+            }
         }
         // Debug extension
         if (m_enableValidationLayers)
@@ -73,29 +302,45 @@ namespace PVulkanExamples
         }
 
         // Device extensions and physical device features
-        addDeviceExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-
-        // Raytracing extensions and features
-        
-        //auto accelFeature = std::make_shared<VkPhysicalDeviceAccelerationStructureFeaturesKHR>();
-        addDeviceExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &m_accelFeature, {"accelerationStructure"});
-        addDeviceExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &m_rtPipelineFeature, { "rayTracingPipeline" });
-        addDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);  // Required by ray tracing pipeline
+        if (!m_headless)
+        {
+            addDeviceExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
         addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "samplerAnisotropy");
         addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "fragmentStoresAndAtomics");  // support inefficient readback storage buffer
         addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "independentBlend");          // support independent blending
-        addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "geometryShader");            // support geometry shader
-        addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES, "multiviewGeometryShader"); // Test struct chain
         addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "imagelessFramebuffer");    // Test struct chain
+
+        // Raytracing extensions and features, devices with them are picked first and examples fall back to rasterization without them
+        addDeviceFeatureSet("RayTracing", FeatureSetPriority::Preferred);
+        addDeviceExtension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, &m_accelFeature, { "accelerationStructure" }, "RayTracing");
+        addDeviceExtension(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME, &m_rtPipelineFeature, { "rayTracingPipeline" }, "RayTracing");
+        addDeviceExtension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME, nullptr, {}, "RayTracing");  // Required by ray tracing pipeline
+        addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "bufferDeviceAddress", "RayTracing");   // Acceleration structure build inputs and scratch
+
+        // Geometry shaders, enabled when the picked device supports them for examples checking isFeatureSetEnabled("GeometryShader")
+        addDeviceFeatureSet("GeometryShader", FeatureSetPriority::Optional);
+        addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "geometryShader", "GeometryShader");
+        addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES, "multiviewGeometryShader", "GeometryShader");
+
+        // Render graph barriers with per barrier stage masks, the legacy barrier path is used otherwise
+        addDeviceFeatureSet("Synchronization2", FeatureSetPriority::Optional);
+        addDeviceExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, &m_synchronization2Feature, { "synchronization2" }, "Synchronization2");
+
+        // Task and mesh shader geometry, examples draw through the vertex pipeline without them
+        addDeviceFeatureSet("MeshShader", FeatureSetPriority::Optional);
+        addDeviceExtension(VK_NV_MESH_SHADER_EXTENSION_NAME, &m_meshShaderFeature, { "taskShader", "meshShader" }, "MeshShader");
+        configureDeviceRequirements();
         constructStructChain(); // Construct the struct chain for physical device features  
 
         // Command buffer setting
         m_maxFrameInFlight = 3;
         m_currentFrameIndex = 0;
 
-        // Descriptor pool settings
-        m_maxVertexBlendingMeshCount = 256;
-        m_maxMaterialCount = 256;
+        //Memory allocator, tracks driver host allocations and serves them from arenas and pools
+        m_hostAllocator.init(m_maxFrameInFlight, 1 << 20, m_hostAllocationBudget);
+        m_defaultAllocator = m_hostAllocator.getCallbacks();
 
         if (m_debugMode)
         {
@@ -105,6 +350,11 @@ namespace PVulkanExamples
 
 	void ExampleBase::createInstance()
 	{
+        PVE_PROFILE_FUNCTION();
+
+        // Every Vulkan call goes through the dispatch table, filled from the loader or from the mock driver
+        vkd.init(m_useMockDriver ? m_mockDriver.getInstanceProcAddr() : vkGetInstanceProcAddr);
+
         // Check the availability for required validation layers
         if (m_enableValidationLayers && !checkValidationLayerSupport())
         {
@@ -129,9 +379,12 @@ namespace PVulkanExamples
         VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
         if (m_enableValidationLayers)
         {
+            // Validation output goes through the sink thread, repeated message ids are muted after a few occurrences
+            m_validationSink.m_severityThreshold = m_debugMode ? VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT : VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            m_validationSink.start();
             instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(m_instanceLayers.size());
             instanceCreateInfo.ppEnabledLayerNames = m_instanceLayers.data();
-            VulkanUtil::populateDebugMessengerCreateInfo(debugCreateInfo, VulkanUtil::plainDebugCallback, m_debugMode);
+            VulkanUtil::populateDebugMessengerCreateInfo(debugCreateInfo, ValidationMessageSink::debugCallback, m_debugMode, &m_validationSink);
             instanceCreateInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
         }
         else
@@ -141,18 +394,21 @@ namespace PVulkanExamples
         }
 
         // Create instance
-        if (vkCreateInstance(&instanceCreateInfo, m_defaultAllocator, &m_instance) != VK_SUCCESS)
+        if (vkd.vkCreateInstance(&instanceCreateInfo, m_defaultAllocator, &m_instance) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create instance!");
         }
+        vkd.loadInstance(m_instance);
 	}
 
 	void ExampleBase::createDebugMessenger()
 	{
+        PVE_PROFILE_FUNCTION();
+
         if (m_enableValidationLayers)
         {
             VkDebugUtilsMessengerCreateInfoEXT createInfo;
-            VulkanUtil::populateDebugMessengerCreateInfo(createInfo, VulkanUtil::plainDebugCallback, m_debugMode);
+            VulkanUtil::populateDebugMessengerCreateInfo(createInfo, ValidationMessageSink::debugCallback, m_debugMode, &m_validationSink);
             if (VK_SUCCESS != VulkanUtil::createDebugUtilsMessengerEXT(m_instance, &createInfo, m_defaultAllocator, &m_debugMessenger))
             {
                 throw std::runtime_error("failed to set up debug messenger!");
@@ -162,6 +418,9 @@ namespace PVulkanExamples
 
 	void ExampleBase::createSurface()
 	{
+        PVE_PROFILE_FUNCTION();
+
+        if (m_headless) return;
         if (glfwCreateWindowSurface(m_instance, m_window, m_defaultAllocator, &m_surface) != VK_SUCCESS)
         {
             throw std::runtime_error("glfwCreateWindowSurface");
@@ -170,9 +429,11 @@ namespace PVulkanExamples
 
 	void ExampleBase::createPhysicalDevice()
 	{
+        PVE_PROFILE_FUNCTION();
+
         //Check if there are any physical device available
         uint32_t availableDeviceCount = 0;
-        vkEnumeratePhysicalDevices(m_instance, &availableDeviceCount, nullptr);
+        vkd.vkEnumeratePhysicalDevices(m_instance, &availableDeviceCount, nullptr);
         if (availableDeviceCount == 0)
         {
             throw std::runtime_error("Failed to find physical device with Vulkan support!");
@@ -180,38 +441,54 @@ namespace PVulkanExamples
 
         std::vector<VkPhysicalDevice> compatibleDevices{};
         std::vector<VkPhysicalDevice> availableDevices(availableDeviceCount);
-        vkEnumeratePhysicalDevices(m_instance, &availableDeviceCount, availableDevices.data());
+        vkd.vkEnumeratePhysicalDevices(m_instance, &availableDeviceCount, availableDevices.data());
 
-        //Find all suitable devices	
+        //Find all suitable devices, pick the one supporting the best preferred feature sets
+        std::vector<bool> pickedFeatureSets{};
+        int64_t pickedScore = -1;
         for (const VkPhysicalDevice device : availableDevices)
         {
-            if (isDeviceSuitable(device))
+            if (!isDeviceSuitable(device)) continue;
+            compatibleDevices.push_back(device);
+
+            std::vector<bool> featureSetsSupported = checkFeatureSetSupport(device);
+            int64_t score = 0;
+            for (size_t i = 0; i < m_deviceFeatureSets.size(); i++)
             {
-                compatibleDevices.push_back(device);
-                break;
+                if (m_deviceFeatureSets[i].priority != FeatureSetPriority::Preferred) continue;
+                score = score * 2 + (featureSetsSupported[i] ? 1 : 0);
+            }
+            if (score > pickedScore)
+            {
+                m_physicalDevice = device;
+                pickedFeatureSets = featureSetsSupported;
+                pickedScore = score;
             }
         }
 
-        if (compatibleDevices.size() > 0)
-        {
-            m_physicalDevice = compatibleDevices[0];
-        }
-        else
+        if (compatibleDevices.empty())
         {
             throw std::runtime_error("Cannot find any compatible physical device");
         }
 
+        enableFeatureSets(pickedFeatureSets);
         m_queueFamilyIndices = findQueueFamilies(m_physicalDevice);
 	}
 
 	void ExampleBase::createLogicalDevice()
 	{
+        PVE_PROFILE_FUNCTION();
+
         // Initialize queue create infos
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {
             m_queueFamilyIndices.graphicsFamily.value(), m_queueFamilyIndices.computeFamily.value(),
-            m_queueFamilyIndices.transferFamily.value(), m_queueFamilyIndices.presentFamily.value()
+            m_queueFamilyIndices.transferFamily.value()
         };
+        if (m_queueFamilyIndices.presentFamily.has_value())
+        {
+            uniqueQueueFamilies.insert(m_queueFamilyIndices.presentFamily.value());
+        }
 
         float queuePriority = 1.0f; // TODO compute queue priority
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -236,24 +513,39 @@ namespace PVulkanExamples
         createInfo.enabledLayerCount = 0;
 
         // Create logical device
-        VkResult res = vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device);
+        VkResult res = vkd.vkCreateDevice(m_physicalDevice, &createInfo, m_defaultAllocator, &m_device);
         if (res != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create logical device!");
         }
 
-        // Create efficient function pointers
-        m_pfn_vkSetDebugUtilsObjectNameEXT = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr(m_instance, "vkSetDebugUtilsObjectNameEXT");
+        // Device level calls skip the loader trampolines from here on
+        vkd.loadDevice(m_device);
+
+        // Debug utils entry points, left null when the extension is not enabled
+        m_debugAnnotator.init(m_device);
 
         // Create queues
-        vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
+        vkd.vkGetDeviceQueue(m_device, m_queueFamilyIndices.graphicsFamily.value(), 0, &m_graphicsQueue);
         setObjectName(m_graphicsQueue, "Graphics Queue");
-        vkGetDeviceQueue(m_device, m_queueFamilyIndices.computeFamily.value(), 0, &m_computeQueue);
+        vkd.vkGetDeviceQueue(m_device, m_queueFamilyIndices.computeFamily.value(), 0, &m_computeQueue);
         setObjectName(m_computeQueue, "Compute Queue");
-        vkGetDeviceQueue(m_device, m_queueFamilyIndices.transferFamily.value(), 0, &m_transferQueue);
+        vkd.vkGetDeviceQueue(m_device, m_queueFamilyIndices.transferFamily.value(), 0, &m_transferQueue);
         setObjectName(m_transferQueue, "Transfer Queue");
-        vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily.value(), 0, &m_presentQueue);
-        setObjectName(m_presentQueue, "Present Queue");
+        if (m_queueFamilyIndices.presentFamily.has_value())
+        {
+            vkd.vkGetDeviceQueue(m_device, m_queueFamilyIndices.presentFamily.value(), 0, &m_presentQueue);
+            setObjectName(m_presentQueue, "Present Queue");
+        }
+
+        // Pipeline cache shared by every pipeline creation, hot reloaded pipelines included
+        VkPipelineCacheCreateInfo pipelineCacheInfo{};
+        pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        if (vkd.vkCreatePipelineCache(m_device, &pipelineCacheInfo, m_defaultAllocator, &m_pipelineCache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+        setObjectName(m_pipelineCache, "Pipeline Cache");
 
         if (m_debugMode)
         {
@@ -261,56 +553,602 @@ namespace PVulkanExamples
         }
 	}
 
+    void ExampleBase::createSwapchain()
+    {
+        PVE_PROFILE_FUNCTION();
+
+        if (m_headless) return;
+
+        m_swapchain.init(m_device, m_surface, m_defaultAllocator, m_maxFrameInFlight);
+        recreateSwapchain();
+    }
+
+    /*
+    * (Re)create the swapchain for the current surface size, the previous swapchain is retired without idling the device
+    */
+    void ExampleBase::recreateSwapchain()
+    {
+        PVE_PROFILE_FUNCTION();
+
+        // Nothing to present to while minimized
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        while (width == 0 || height == 0)
+        {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(m_window, &width, &height);
+        }
+
+        SwapChainSupportDetails support = querySwapChainSupport(m_physicalDevice, m_surface);
+        VkSurfaceFormatKHR surfaceFormat = chooseSwapchainSurfaceFormat(support.formats);
+        VkPresentModeKHR presentMode = chooseSwapchainPresentMode(support.presentModes);
+        VkExtent2D extent = chooseSwapchainExtent(support.capabilities);
+        uint32_t imageCount = SwapchainManager::chooseImageCount(presentMode, support.capabilities, m_swapchainImageCount);
+
+        std::vector<uint32_t> queueFamilies{ m_queueFamilyIndices.graphicsFamily.value() };
+        if (m_queueFamilyIndices.presentFamily.value() != m_queueFamilyIndices.graphicsFamily.value())
+        {
+            queueFamilies.push_back(m_queueFamilyIndices.presentFamily.value());
+        }
+
+        m_swapchain.m_frameCounter = m_frameCounter;
+        m_swapchain.create(support, surfaceFormat, presentMode, extent, imageCount, queueFamilies);
+        setObjectName(m_swapchain.getSwapchain(), "Swapchain");
+        m_framebufferResized = false;
+    }
+
 	void ExampleBase::initializeCommandPools()
 	{
+        PVE_PROFILE_FUNCTION();
 
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily.value();
+        if (vkd.vkCreateCommandPool(m_device, &poolInfo, m_defaultAllocator, &m_commandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create command pool!");
+        }
+        setObjectName(m_commandPool, "Graphics Command Pool");
 	}
 
 	void ExampleBase::initializeCommandBuffers()
 	{
-
+        PVE_PROFILE_FUNCTION();
+
+        m_commandBuffers.resize(m_maxFrameInFlight);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
+        if (vkd.vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
 	}
 
 	void ExampleBase::createDescriptorPools()
 	{
+        PVE_PROFILE_FUNCTION();
 
+        // Layouts are created on demand from shader reflection and shared between pipelines, runtime sized arrays
+        // are only accepted when the example declared and got the DescriptorIndexing feature set
+        m_pipelineLayoutCache.init(m_device, m_defaultAllocator, isFeatureSetEnabled("DescriptorIndexing"));
 	}
 
 	void ExampleBase::createSyncObjects()
 	{
-
+        PVE_PROFILE_FUNCTION();
+
+        m_imageAvaliableForRenderSemaphore.resize(m_maxFrameInFlight);
+        m_imageRenderFinishedForPresentSemaphores.resize(m_maxFrameInFlight);
+        m_imageInFlightFences.resize(m_maxFrameInFlight);
+        m_retiredSceneTargets.resize(m_maxFrameInFlight);
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        for (uint32_t i = 0; i < m_maxFrameInFlight; i++)
+        {
+            if (vkd.vkCreateSemaphore(m_device, &semaphoreInfo, m_defaultAllocator, &m_imageAvaliableForRenderSemaphore[i]) != VK_SUCCESS ||
+                vkd.vkCreateSemaphore(m_device, &semaphoreInfo, m_defaultAllocator, &m_imageRenderFinishedForPresentSemaphores[i]) != VK_SUCCESS ||
+                vkd.vkCreateFence(m_device, &fenceInfo, m_defaultAllocator, &m_imageInFlightFences[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create synchronization objects for a frame!");
+            }
+        }
 	}
 
+    /*
+    * Create the offscreen color targets and their host visible readback buffers used in headless mode
+    */
+    void ExampleBase::createOffscreenTargets()
+    {
+        PVE_PROFILE_FUNCTION();
+
+        if (!m_headless) return;
+
+        VkExtent2D extent{ m_windowWidth, m_windowHeight };
+        VkDeviceSize readbackSize = VkDeviceSize(extent.width) * extent.height * 4;
+        m_offscreenTargets.resize(m_maxFrameInFlight);
+        for (OffscreenTarget& target : m_offscreenTargets)
+        {
+            VulkanUtil::createImage2D(m_physicalDevice, m_device, extent, m_offscreenFormat, OFFSCREEN_TARGET_USAGE,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.image, target.memory, m_defaultAllocator);
+            target.view = VulkanUtil::createImageView2D(m_device, target.image, m_offscreenFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_defaultAllocator);
+            setObjectName(target.image, "Offscreen Target");
+
+            VulkanUtil::createBuffer(m_physicalDevice, m_device, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                target.readbackBuffer, target.readbackMemory, m_defaultAllocator);
+            vkd.vkMapMemory(m_device, target.readbackMemory, 0, VK_WHOLE_SIZE, 0, &target.readbackData);
+            setObjectName(target.readbackBuffer, "Offscreen Readback Buffer");
+        }
+    }
+
+    void ExampleBase::drawFrame()
+    {
+        PVE_PROFILE_FUNCTION();
+
+        // Frame boundary: once this frame slot's fence has signaled, recompiled pipelines can be swapped in
+        // and resources retired m_maxFrameInFlight frames ago are no longer in use
+        {
+            PVE_PROFILE_ZONE("Wait frame fence");
+            vkd.vkWaitForFences(m_device, 1, &m_imageInFlightFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+        }
+        m_hostAllocator.beginFrame(m_currentFrameIndex);
+        destroyRetiredSceneTargets(m_retiredSceneTargets[m_currentFrameIndex]);
+        m_shaderHotReloader.applyPendingReloads();
+        m_shaderPermutations.nextFrame();
+        if (m_maxIdlePermutationFrames != 0) m_shaderPermutations.evictUnused(m_maxIdlePermutationFrames);
+        m_renderGraph.beginFrame(m_currentFrameIndex);
+        m_accelerationStructures.beginFrame(m_currentFrameIndex);
+        m_uploadRing.beginFrame(m_currentFrameIndex);
+
+        FrameTarget target{};
+        uint32_t imageIndex = 0;
+        if (m_headless)
+        {
+            OffscreenTarget& offscreen = m_offscreenTargets[m_currentFrameIndex];
+            target = { offscreen.image, offscreen.view, m_offscreenFormat, { m_windowWidth, m_windowHeight }, OFFSCREEN_TARGET_USAGE };
+        }
+        else
+        {
+            m_swapchain.destroyRetired(m_frameCounter);
+            PVE_PROFILE_ZONE("Acquire swapchain image");
+            VkResult result = m_swapchain.acquireNextImage(m_imageAvaliableForRenderSemaphore[m_currentFrameIndex], imageIndex);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                recreateSwapchain();
+                return;
+            }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                throw std::runtime_error("failed to acquire swap chain image!");
+            }
+            target = { m_swapchain.getImage(imageIndex), m_swapchain.getImageView(imageIndex), m_swapchain.getFormat(), m_swapchain.getExtent(),
+                m_swapchain.getImageUsage() };
+        }
+
+        updateUniformBuffers();
+
+        VkCommandBuffer commandBuffer = m_commandBuffers[m_currentFrameIndex];
+        vkd.vkResetFences(m_device, 1, &m_imageInFlightFences[m_currentFrameIndex]);
+        vkd.vkResetCommandBuffer(commandBuffer, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        // Timestamps of this slot were written m_maxFrameInFlight frames ago, its fence guarantees they are available
+        m_gpuProfiler.beginFrame(commandBuffer, m_currentFrameIndex);
+        m_pipelineStatistics.beginFrame(commandBuffer, m_currentFrameIndex);
+        {
+            DebugLabelScope frameLabel(m_debugAnnotator, commandBuffer, "Frame");
+            GpuProfileScope frameZone(m_gpuProfiler, commandBuffer, "Frame");
+            recordFrame(commandBuffer, target, m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+
+        if (m_headless)
+        {
+            // Copy the frame into the readback buffer of this frame slot
+            VkBufferImageCopy region{};
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            region.imageExtent = { target.extent.width, target.extent.height, 1 };
+            vkd.vkCmdCopyImageToBuffer(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_offscreenTargets[m_currentFrameIndex].readbackBuffer, 1, &region);
+            VkMemoryBarrier hostBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+            vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+        }
+
+        if (vkd.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+
+        // The first access to the frame target is the clear in the transfer stage,
+        // render graph async compute work is waited for at the stages first consuming its results
+        VkSemaphore waitSemaphores[2];
+        VkPipelineStageFlags waitStages[2];
+        uint32_t waitSemaphoreCount = 0;
+        if (!m_headless)
+        {
+            waitSemaphores[waitSemaphoreCount] = m_imageAvaliableForRenderSemaphore[m_currentFrameIndex];
+            waitStages[waitSemaphoreCount++] = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+        if (m_renderGraph.getAsyncComputeWait(waitSemaphores[waitSemaphoreCount], waitStages[waitSemaphoreCount]))
+        {
+            waitSemaphoreCount++;
+        }
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.waitSemaphoreCount = waitSemaphoreCount;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
+        if (!m_headless)
+        {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &m_imageRenderFinishedForPresentSemaphores[m_currentFrameIndex];
+        }
+        m_gpuProfiler.markSubmit();
+        m_debugAnnotator.beginQueueLabel(m_graphicsQueue, "Frame");
+        VkResult submitResult = vkd.vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_imageInFlightFences[m_currentFrameIndex]);
+        m_debugAnnotator.endQueueLabel(m_graphicsQueue);
+        if (submitResult != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+
+        if (!m_headless)
+        {
+            PVE_PROFILE_ZONE("Present");
+            VkResult result = m_swapchain.present(m_presentQueue, m_imageRenderFinishedForPresentSemaphores[m_currentFrameIndex], imageIndex);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_framebufferResized)
+            {
+                m_frameCounter++;
+                m_currentFrameIndex = (m_currentFrameIndex + 1) % m_maxFrameInFlight;
+                recreateSwapchain();
+                return;
+            }
+            else if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to present swap chain image!");
+            }
+        }
+
+        m_frameCounter++;
+        m_currentFrameIndex = (m_currentFrameIndex + 1) % m_maxFrameInFlight;
+    }
+
+    /*
+    * Update the per frame data of the current frame slot, its previous use has completed once the frame fence signaled
+    */
+    void ExampleBase::updateUniformBuffers()
+    {
+        PVE_PROFILE_FUNCTION();
+        updateFrameData(m_currentFrameIndex);
+    }
+
+    /*
+    * Clear the frame target, let the example record into it and transition it for presentation or readback
+    */
+    void ExampleBase::recordFrame(VkCommandBuffer commandBuffer, const FrameTarget& target, VkImageLayout finalLayout)
+    {
+        // Source stage matches the acquire semaphore wait stage so the transition happens after the image is available
+        VulkanUtil::transitionImageLayout(commandBuffer, target.image, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkd.vkCmdClearColorImage(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &m_clearColor, 1, &range);
+        VulkanUtil::transitionImageLayout(commandBuffer, target.image, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+        {
+            PVE_PROFILE_ZONE("Record command buffer");
+            recordCommandBuffer(commandBuffer, target);
+        }
+
+        bool toTransfer = finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        VulkanUtil::transitionImageLayout(commandBuffer, target.image, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            toTransfer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, toTransfer ? VK_ACCESS_TRANSFER_READ_BIT : 0);
+    }
+
+    RenderGraphResource ExampleBase::importFrameTarget(const FrameTarget& target)
+    {
+        RenderGraphResourceState attachmentState{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+        return m_renderGraph.importImage("Frame Target", target.image, target.view, target.format, target.extent, attachmentState, attachmentState);
+    }
+
+    /*
+    * Depth buffer of the frame size, recreated when the size changes.
+    * The old one is retired to the current frame slot, the frames still in flight may be using it.
+    */
+    bool ExampleBase::ensureDepthTarget(SceneTargets& targets, VkExtent2D extent)
+    {
+        if (targets.depthImage != VK_NULL_HANDLE && extent.width == targets.extent.width && extent.height == targets.extent.height) return false;
+        if (targets.depthImage != VK_NULL_HANDLE)
+        {
+            RetiredSceneTargets& retired = m_retiredSceneTargets[m_currentFrameIndex];
+            retired.views.push_back(targets.depthView);
+            retired.images.push_back(targets.depthImage);
+            retired.memories.push_back(targets.depthMemory);
+        }
+        targets.extent = extent;
+
+        VulkanUtil::createImage2D(m_physicalDevice, m_device, extent, targets.depthFormat, targets.depthUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            targets.depthImage, targets.depthMemory, m_defaultAllocator);
+        targets.depthView = VulkanUtil::createImageView2D(m_device, targets.depthImage, targets.depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, m_defaultAllocator);
+        return true;
+    }
+
+    /*
+    * Imageless framebuffer, the attachments are given when the render pass begins, recreated when the frame size changes.
+    * The old one is retired like the depth target.
+    */
+    void ExampleBase::ensureSceneFramebuffer(SceneTargets& targets, VkRenderPass renderPass, const FrameTarget& target)
+    {
+        if (targets.framebuffer != VK_NULL_HANDLE && target.extent.width == targets.framebufferExtent.width &&
+            target.extent.height == targets.framebufferExtent.height && target.usage == targets.framebufferColorUsage) return;
+        if (targets.framebuffer != VK_NULL_HANDLE)
+        {
+            m_retiredSceneTargets[m_currentFrameIndex].framebuffers.push_back(targets.framebuffer);
+        }
+
+        VkFormat colorFormat = target.format;
+        VkFormat depthFormat = targets.depthFormat;
+        VkFramebufferAttachmentImageInfo attachmentInfos[2]{};
+        for (VkFramebufferAttachmentImageInfo& info : attachmentInfos)
+        {
+            info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO;
+            info.width = target.extent.width;
+            info.height = target.extent.height;
+            info.layerCount = 1;
+            info.viewFormatCount = 1;
+        }
+        attachmentInfos[0].usage = target.usage;
+        attachmentInfos[0].pViewFormats = &colorFormat;
+        attachmentInfos[1].usage = targets.depthUsage;
+        attachmentInfos[1].pViewFormats = &depthFormat;
+        VkFramebufferAttachmentsCreateInfo attachmentsInfo{};
+        attachmentsInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO;
+        attachmentsInfo.attachmentImageInfoCount = 2;
+        attachmentsInfo.pAttachmentImageInfos = attachmentInfos;
+
+        VkFramebufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        createInfo.pNext = &attachmentsInfo;
+        createInfo.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT;
+        createInfo.renderPass = renderPass;
+        createInfo.attachmentCount = 2;
+        createInfo.width = target.extent.width;
+        createInfo.height = target.extent.height;
+        createInfo.layers = 1;
+        if (vkd.vkCreateFramebuffer(m_device, &createInfo, m_defaultAllocator, &targets.framebuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
+        targets.framebufferExtent = target.extent;
+        targets.framebufferColorUsage = target.usage;
+    }
+
+    void ExampleBase::destroyRetiredSceneTargets(RetiredSceneTargets& retired)
+    {
+        for (VkFramebuffer framebuffer : retired.framebuffers) vkd.vkDestroyFramebuffer(m_device, framebuffer, m_defaultAllocator);
+        for (VkImageView view : retired.views) vkd.vkDestroyImageView(m_device, view, m_defaultAllocator);
+        for (VkImage image : retired.images) vkd.vkDestroyImage(m_device, image, m_defaultAllocator);
+        for (VkDeviceMemory memory : retired.memories) vkd.vkFreeMemory(m_device, memory, m_defaultAllocator);
+        retired = {};
+    }
+
+    void ExampleBase::destroySceneTargets(SceneTargets& targets)
+    {
+        vkd.vkDestroyImageView(m_device, targets.depthView, m_defaultAllocator);
+        vkd.vkDestroyImage(m_device, targets.depthImage, m_defaultAllocator);
+        vkd.vkFreeMemory(m_device, targets.depthMemory, m_defaultAllocator);
+        vkd.vkDestroyFramebuffer(m_device, targets.framebuffer, m_defaultAllocator);
+        targets.depthView = VK_NULL_HANDLE;
+        targets.depthImage = VK_NULL_HANDLE;
+        targets.depthMemory = VK_NULL_HANDLE;
+        targets.framebuffer = VK_NULL_HANDLE;
+    }
+
+    VkCommandBuffer ExampleBase::beginSingleTimeCommands()
+    {
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = m_commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        if (vkd.vkAllocateCommandBuffers(m_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    void ExampleBase::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    {
+        vkd.vkEndCommandBuffer(commandBuffer);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        if (vkd.vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+        vkd.vkQueueWaitIdle(m_graphicsQueue);
+        vkd.vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+    }
+
+    void ExampleBase::destroyBuffer(VkBuffer& buffer, VkDeviceMemory& memory)
+    {
+        vkd.vkDestroyBuffer(m_device, buffer, m_defaultAllocator);
+        vkd.vkFreeMemory(m_device, memory, m_defaultAllocator);
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+    }
+
+    VkWriteDescriptorSet ExampleBase::bufferWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo* pInfo)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pBufferInfo = pInfo;
+        return write;
+    }
+
+    VkWriteDescriptorSet ExampleBase::imageWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo* pInfo)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pImageInfo = pInfo;
+        return write;
+    }
+
+    /*
+    * Copy the pixels of the most recently submitted headless frame, tightly packed RGBA8
+    */
+    bool ExampleBase::readbackFrame(std::vector<uint8_t>& pixels)
+    {
+        if (!m_headless || m_frameCounter == 0) return false;
+
+        uint32_t frameIndex = (m_currentFrameIndex + m_maxFrameInFlight - 1) % m_maxFrameInFlight;
+        vkd.vkWaitForFences(m_device, 1, &m_imageInFlightFences[frameIndex], VK_TRUE, UINT64_MAX);
+        size_t size = size_t(m_windowWidth) * m_windowHeight * 4;
+        pixels.resize(size);
+        std::memcpy(pixels.data(), m_offscreenTargets[frameIndex].readbackData, size);
+        return true;
+    }
+
+    /*
+    * Write the most recently submitted headless frame as a binary PPM image
+    */
+    bool ExampleBase::dumpFrame(const std::string& path)
+    {
+        std::vector<uint8_t> pixels;
+        if (!readbackFrame(pixels)) return false;
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        file << "P6\n" << m_windowWidth << " " << m_windowHeight << "\n255\n";
+        bool bgr = m_offscreenFormat == VK_FORMAT_B8G8R8A8_UNORM || m_offscreenFormat == VK_FORMAT_B8G8R8A8_SRGB;
+        std::vector<uint8_t> row(size_t(m_windowWidth) * 3);
+        for (uint32_t y = 0; y < m_windowHeight; y++)
+        {
+            const uint8_t* src = pixels.data() + size_t(y) * m_windowWidth * 4;
+            for (uint32_t x = 0; x < m_windowWidth; x++)
+            {
+                row[x * 3 + 0] = src[x * 4 + (bgr ? 2 : 0)];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + (bgr ? 0 : 2)];
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        return file.good();
+    }
+
+    /*
+    * Directory of the GLSL sources of an example, compiled SPIR-V is written next to them
+    */
+    std::string ExampleBase::getShaderDirectory(const std::string& exampleName)
+    {
+        return std::string(SOURCE_DIR) + "assets/shaders/glsl/" + exampleName;
+    }
+
 
 
     /*
     * Add device extension requirement and corresponding physical device feature requirements
     */
-    void ExampleBase::addDeviceExtension(const char* extension, void* pPhysicalDeviceFeatureStruct, std::vector<const char*> featureRequirements) {
-        add_unique(m_deviceExtensions, extension);
+    void ExampleBase::addDeviceExtension(const char* extension, void* pPhysicalDeviceFeatureStruct, std::vector<const char*> featureRequirements,
+        const char* featureSet) {
+        std::vector<const char*>& extensions = featureSet != nullptr ? getFeatureSet(featureSet).extensions : m_deviceExtensions;
+        std::vector<void*>& featureStructs = featureSet != nullptr ? getFeatureSet(featureSet).featureStructs : m_EXTPhysicalDeviceFeatureStructs;
+        auto& requirements = featureSet != nullptr ? getFeatureSet(featureSet).featureRequirements : m_physicalDeviceFeatureRequirements;
+        add_unique(extensions, extension);
         if (pPhysicalDeviceFeatureStruct != nullptr)
         {
-            m_EXTPhysicalDeviceFeatureStructs.push_back(pPhysicalDeviceFeatureStruct);
+            featureStructs.push_back(pPhysicalDeviceFeatureStruct);
             VkStructureType sType = reinterpret_cast<VulkanExtensionHeader*>(pPhysicalDeviceFeatureStruct)->sType;
-            if (m_physicalDeviceFeatureRequirements.find(sType) != m_physicalDeviceFeatureRequirements.end())
+            if (requirements.find(sType) != requirements.end())
             {
-                m_physicalDeviceFeatureRequirements[sType].insert(m_physicalDeviceFeatureRequirements[sType].end(),
+                requirements[sType].insert(requirements[sType].end(),
                     featureRequirements.begin(),
                     featureRequirements.end());
             }
             else if (featureRequirements.size() > 0)
             {
-                m_physicalDeviceFeatureRequirements[sType] = featureRequirements;
+                requirements[sType] = featureRequirements;
             }
 
         }
     }
 
-    void ExampleBase::addPhysicalDeviceFeatureRequirement(VkStructureType featureStructType, const char* feature) {
-        if (m_physicalDeviceFeatureRequirements.find(featureStructType) != m_physicalDeviceFeatureRequirements.end())
-            add_unique(m_physicalDeviceFeatureRequirements[featureStructType], feature);
+    void ExampleBase::addPhysicalDeviceFeatureRequirement(VkStructureType featureStructType, const char* feature, const char* featureSet) {
+        auto& requirements = featureSet != nullptr ? getFeatureSet(featureSet).featureRequirements : m_physicalDeviceFeatureRequirements;
+        if (requirements.find(featureStructType) != requirements.end())
+            add_unique(requirements[featureStructType], feature);
         else
-            m_physicalDeviceFeatureRequirements[featureStructType] = std::vector<const char*>{ feature };
+            requirements[featureStructType] = std::vector<const char*>{ feature };
+    }
+
+    /*
+    * Declare a feature set, its extensions and features are added by passing its name to addDeviceExtension and addPhysicalDeviceFeatureRequirement
+    */
+    void ExampleBase::addDeviceFeatureSet(const char* name, FeatureSetPriority priority)
+    {
+        for (const DeviceFeatureSet& featureSet : m_deviceFeatureSets)
+        {
+            if (featureSet.name == name)
+            {
+                throw std::runtime_error(std::string("device feature set ") + name + " declared twice!");
+            }
+        }
+        DeviceFeatureSet featureSet{};
+        featureSet.name = name;
+        featureSet.priority = priority;
+        featureSet.enabled = true;
+        m_deviceFeatureSets.push_back(featureSet);
+    }
+
+    bool ExampleBase::isFeatureSetEnabled(const char* name) const
+    {
+        for (const DeviceFeatureSet& featureSet : m_deviceFeatureSets)
+        {
+            if (featureSet.name == name) return featureSet.enabled;
+        }
+        return false;
+    }
+
+    DeviceFeatureSet& ExampleBase::getFeatureSet(const char* name)
+    {
+        for (DeviceFeatureSet& featureSet : m_deviceFeatureSets)
+        {
+            if (featureSet.name == name) return featureSet;
+        }
+        throw std::runtime_error(std::string("device feature set ") + name + " was not declared!");
     }
 
     /*
@@ -318,10 +1156,10 @@ namespace PVulkanExamples
     */
     bool ExampleBase::checkValidationLayerSupport() {
         uint32_t layerCount;
-        vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+        vkd.vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
         std::vector<VkLayerProperties> availableLayers(layerCount);
-        vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+        vkd.vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
 
         for (const char* layerName : m_instanceLayers)
         {
@@ -349,6 +1187,14 @@ namespace PVulkanExamples
     void ExampleBase::constructStructChain() {
         m_physicalFeaturesStructChain.features = m_features10;
 
+        // Structs of the required extensions and of the feature sets still enabled
+        std::vector<void*> featureStructs = m_EXTPhysicalDeviceFeatureStructs;
+        for (const DeviceFeatureSet& featureSet : m_deviceFeatureSets)
+        {
+            if (!featureSet.enabled) continue;
+            for (void* featureStruct : featureSet.featureStructs) add_unique(featureStructs, featureStruct);
+        }
+
         // Only support Vulkan 1.2 for now
         if (m_apiMajor == 1 && m_apiMinor >= 2)
         {
@@ -357,13 +1203,13 @@ namespace PVulkanExamples
             m_features12.pNext = nullptr;
         }
         // use the physicalFeaturesStructChain to append extensions
-        if (!m_EXTPhysicalDeviceFeatureStructs.empty())
+        if (!featureStructs.empty())
         {
             // build up chain of all used extension features
-            for (size_t i = 0; i < m_EXTPhysicalDeviceFeatureStructs.size(); i++)
+            for (size_t i = 0; i < featureStructs.size(); i++)
             {
-                auto* header = reinterpret_cast<VulkanExtensionHeader*>(m_EXTPhysicalDeviceFeatureStructs[i]);
-                header->pNext = i < m_EXTPhysicalDeviceFeatureStructs.size() - 1 ? m_EXTPhysicalDeviceFeatureStructs[i + 1] : nullptr;
+                auto* header = reinterpret_cast<VulkanExtensionHeader*>(featureStructs[i]);
+                header->pNext = i < featureStructs.size() - 1 ? featureStructs[i + 1] : nullptr;
             }
 
             // append to the end of current feature2 struct
@@ -372,21 +1218,10 @@ namespace PVulkanExamples
             {
                 lastCoreFeature = (VulkanExtensionHeader*)lastCoreFeature->pNext;
             }
-            lastCoreFeature->pNext = m_EXTPhysicalDeviceFeatureStructs[0];
+            lastCoreFeature->pNext = featureStructs[0];
         }
     }
 
-    /*
-    * Set debug name of given object
-    */
-    void ExampleBase::setObjectName(const uint64_t object, const std::string& name, VkObjectType t)
-    {
-        VkDebugUtilsObjectNameInfoEXT s{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT, nullptr, t, object, name.c_str() };
-        m_pfn_vkSetDebugUtilsObjectNameEXT(m_device, &s);
-    }
-
-
-
     /*
     * Check whether the physical device has required features and support required extensions and queue families
     */
@@ -395,15 +1230,24 @@ namespace PVulkanExamples
         m_queueFamilyIndices = findQueueFamilies(device); //Initialize queue family indices and check queue family support
         bool extensionsSupported = checkDeviceExtensionSupport(device, m_deviceExtensions); //Check device extension support
         bool requiredFeaturesSupported = checkDeviceFeaturesSupport(device); //Check physical device features support
+        std::vector<bool> featureSetsSupported = checkFeatureSetSupport(device);
+        for (size_t i = 0; i < m_deviceFeatureSets.size(); i++)
+        {
+            if (m_deviceFeatureSets[i].priority == FeatureSetPriority::Required && !featureSetsSupported[i]) requiredFeaturesSupported = false;
+        }
 
         //Check presentation support if surface is assigned
-        uint32_t formatCount;
-        uint32_t presentModeCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
-        bool presentSupported = formatCount > 0 && presentModeCount > 0;
+        bool presentSupported = true;
+        if (m_surface != VK_NULL_HANDLE)
+        {
+            uint32_t formatCount;
+            uint32_t presentModeCount;
+            vkd.vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
+            vkd.vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
+            presentSupported = formatCount > 0 && presentModeCount > 0;
+        }
 
-        return extensionsSupported && requiredFeaturesSupported && m_queueFamilyIndices.isComplete() && presentSupported;
+        return extensionsSupported && requiredFeaturesSupported && m_queueFamilyIndices.isComplete(!m_headless) && presentSupported;
     }
 
     /*
@@ -411,10 +1255,12 @@ namespace PVulkanExamples
     */
     QueueFamilyIndices  ExampleBase::findQueueFamilies(VkPhysicalDevice device) {
         uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        vkd.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+        vkd.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+        m_queueFamilyIndices = {}; // Do not carry indices over from previously inspected devices
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
@@ -430,25 +1276,38 @@ namespace PVulkanExamples
                 m_queueFamilyIndices.transferFamily = i;
             }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
-            if (presentSupport) {
-                m_queueFamilyIndices.presentFamily = i;
+            if (m_surface != VK_NULL_HANDLE) {
+                VkBool32 presentSupport = false;
+                vkd.vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+                if (presentSupport) {
+                    m_queueFamilyIndices.presentFamily = i;
+                }
             }
 
-            if (m_queueFamilyIndices.isComplete()) break;
+            if (m_queueFamilyIndices.isComplete(!m_headless)) break;
             i++;
         }
 
+        // Prefer a compute family without graphics so render graph async compute passes overlap with graphics work
+        for (uint32_t family = 0; family < queueFamilyCount; family++)
+        {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                m_queueFamilyIndices.computeFamily = family;
+                break;
+            }
+        }
+
         return m_queueFamilyIndices;
     }
 
     bool ExampleBase::checkDeviceExtensionSupport(VkPhysicalDevice device, std::vector<const char*> deviceExtensions) {
         uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        vkd.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+        vkd.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
         std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
@@ -463,15 +1322,22 @@ namespace PVulkanExamples
     * Iterate over the physical device feature struct chain and check whether every required feature can be enabled
     */
     bool ExampleBase::checkDeviceFeaturesSupport(VkPhysicalDevice device) {
-        vkGetPhysicalDeviceFeatures2(device, &m_physicalFeaturesStructChain);
+        vkd.vkGetPhysicalDeviceFeatures2(device, &m_physicalFeaturesStructChain);
+        return checkFeatureRequirements(m_physicalDeviceFeatureRequirements);
+    }
+
+    /*
+    * Check the requirements against the features last queried into the struct chain
+    */
+    bool ExampleBase::checkFeatureRequirements(const std::map<VkStructureType, std::vector<const char*>>& requirements) {
         bool res = true;
         VulkanExtensionHeader* pStructChainIterator = reinterpret_cast<VulkanExtensionHeader*>(&m_physicalFeaturesStructChain);
         while (pStructChainIterator != nullptr && res)
         {
             VkStructureType sType = pStructChainIterator->sType;
-            if (m_physicalDeviceFeatureRequirements.find(sType) != m_physicalDeviceFeatureRequirements.end())
+            if (requirements.find(sType) != requirements.end())
             {
-                for (const char* featureName : m_physicalDeviceFeatureRequirements[sType])
+                for (const char* featureName : requirements.at(sType))
                 {
                     res = res && VulkanReflectionUtil::getVkBool32StructValue(pStructChainIterator, featureName);
                     if (!res) break;
@@ -482,27 +1348,65 @@ namespace PVulkanExamples
         return res;
     }
 
+    /*
+    * Whether the device has the extensions and features of every feature set, the struct chain holds the features of the device
+    */
+    std::vector<bool> ExampleBase::checkFeatureSetSupport(VkPhysicalDevice device) {
+        std::vector<bool> supported(m_deviceFeatureSets.size());
+        for (size_t i = 0; i < m_deviceFeatureSets.size(); i++)
+        {
+            const DeviceFeatureSet& featureSet = m_deviceFeatureSets[i];
+            supported[i] = checkDeviceExtensionSupport(device, featureSet.extensions) && checkFeatureRequirements(featureSet.featureRequirements);
+        }
+        return supported;
+    }
+
+    /*
+    * Keep the supported feature sets of the picked device, the struct chain and extension list lose the others
+    */
+    void ExampleBase::enableFeatureSets(const std::vector<bool>& supported) {
+        for (size_t i = 0; i < m_deviceFeatureSets.size(); i++)
+        {
+            DeviceFeatureSet& featureSet = m_deviceFeatureSets[i];
+            featureSet.enabled = supported[i];
+            if (featureSet.enabled)
+            {
+                for (const char* extension : featureSet.extensions) add_unique(m_deviceExtensions, extension);
+                continue;
+            }
+            // Feature values of a struct left out of the chain would otherwise keep what the device reported
+            for (void* featureStruct : featureSet.featureStructs)
+            {
+                size_t featureCount = VulkanReflectionUtil::getVkBool32StructVector(featureStruct).size();
+                auto* values = reinterpret_cast<VkBool32*>(reinterpret_cast<uint8_t*>(featureStruct) + sizeof(VulkanExtensionHeader));
+                std::fill(values, values + featureCount, VK_FALSE);
+            }
+        }
+        constructStructChain();
+        vkd.vkGetPhysicalDeviceFeatures2(m_physicalDevice, &m_physicalFeaturesStructChain);
+    }
+
     SwapChainSupportDetails ExampleBase::querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
         SwapChainSupportDetails details;
 
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+        vkd.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
 
         //formats
         uint32_t formatCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+        vkd.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
         if (formatCount != 0)
         {
             details.formats.resize(formatCount);
-            vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+            vkd.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
         }
 
         //present modes
         uint32_t presentModeCount;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+        vkd.vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
         if (presentModeCount != 0)
         {
             details.presentModes.resize(presentModeCount);
-            vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+            vkd.vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
         }
 
         return details;
@@ -520,17 +1424,10 @@ namespace PVulkanExamples
     }
 
     /*
-    * Specify the present mode format for the currrent Swapchain, prefer VK_PRESENT_MODE_MAILBOX_KHR
+    * Specify the present mode format for the currrent Swapchain according to m_presentPolicy
     */
     VkPresentModeKHR ExampleBase::chooseSwapchainPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-        for (const auto& availablePresentMode : availablePresentModes)
-        {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-            {
-                return availablePresentMode;
-            }
-        }
-        return VK_PRESENT_MODE_FIFO_KHR;
+        return SwapchainManager::choosePresentMode(m_presentPolicy, availablePresentModes);
     }
 
     VkExtent2D ExampleBase::chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
@@ -563,7 +1460,7 @@ namespace PVulkanExamples
     VkFormat ExampleBase::findSupportedFormat(VkPhysicalDevice physicalDevice, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
         for (VkFormat format : candidates) {
             VkFormatProperties props;
-            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+            vkd.vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
 
             if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
                 return format;
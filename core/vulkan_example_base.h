@@ -1,5 +1,21 @@
 #pragma once
 
+#include "vulkan_shader_reflection.h"
+#include "vulkan_shader_hot_reload.h"
+#include "vulkan_shader_permutations.h"
+#include "vulkan_swapchain.h"
+#include "vulkan_gpu_profiler.h"
+#include "vulkan_pipeline_statistics.h"
+#include "vulkan_debug_annotation.h"
+#include "vulkan_validation_sink.h"
+#include "vulkan_host_allocator.h"
+#include "vulkan_render_graph.h"
+#include "vulkan_acceleration_structure.h"
+#include "vulkan_material_system.h"
+#include "vulkan_ring_buffer.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_mock_driver.h"
+
 #include <vulkan/vulkan_core.h>
 #include <GLFW/glfw3.h>
 
@@ -17,24 +33,79 @@ namespace PVulkanExamples
 		std::optional<uint32_t> computeFamily;
 		std::optional<uint32_t> presentFamily;
 
-		bool isComplete() {
-			return graphicsFamily.has_value() && transferFamily.has_value() && computeFamily.has_value() && presentFamily.has_value();
+		bool isComplete(bool requirePresent = true) {
+			return graphicsFamily.has_value() && transferFamily.has_value() && computeFamily.has_value() && (presentFamily.has_value() || !requirePresent);
 		}
 	};
 
-	struct SwapChainSupportDetails
+	enum class FeatureSetPriority
+	{
+		Required,	// Devices without the set are not suitable
+		Preferred,	// Devices supporting the set are picked over devices that do not, sets declared earlier weigh more
+		Optional,	// Enabled when the picked device supports it, does not influence the pick
+	};
+
+	/*
+	* Device extensions and features enabled together or not at all, examples check isFeatureSetEnabled to choose
+	* between a render path using them and a fallback
+	*/
+	struct DeviceFeatureSet
+	{
+		std::string											name{};
+		FeatureSetPriority									priority{ FeatureSetPriority::Optional };
+		std::vector<const char*>							extensions{};
+		std::vector<void*>									featureStructs{};
+		std::map<VkStructureType, std::vector<const char*>>	featureRequirements{};
+		bool												enabled{ false };	// Candidate until the physical device is picked
+	};
+
+	/*
+	* Image a frame renders into, a swapchain image or an offscreen image in headless mode
+	*/
+	struct FrameTarget
+	{
+		VkImage				image{ VK_NULL_HANDLE };
+		VkImageView			view{ VK_NULL_HANDLE };
+		VkFormat			format{ VK_FORMAT_UNDEFINED };
+		VkExtent2D			extent{};
+		VkImageUsageFlags	usage{ 0 };	// Creation usage, imageless framebuffers have to match it
+	};
+
+	struct OffscreenTarget
+	{
+		VkImage			image{ VK_NULL_HANDLE };
+		VkDeviceMemory	memory{ VK_NULL_HANDLE };
+		VkImageView		view{ VK_NULL_HANDLE };
+		VkBuffer		readbackBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory	readbackMemory{ VK_NULL_HANDLE };
+		void*			readbackData{ nullptr };
+	};
+
+	/*
+	* Depth attachment and imageless framebuffer of a scene render pass with one color and one depth attachment.
+	* The example sets the depth format and usage, ensureDepthTarget and ensureSceneFramebuffer recreate the rest
+	* when the frame size or the target usage changes.
+	*/
+	struct SceneTargets
 	{
-		VkSurfaceCapabilitiesKHR        capabilities{};
-		std::vector<VkSurfaceFormatKHR> formats;
-		std::vector<VkPresentModeKHR>   presentModes;
+		VkFormat			depthFormat{ VK_FORMAT_D32_SFLOAT };
+		VkImageUsageFlags	depthUsage{ VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		VkExtent2D			extent{};
+		VkImage				depthImage{ VK_NULL_HANDLE };
+		VkDeviceMemory		depthMemory{ VK_NULL_HANDLE };
+		VkImageView			depthView{ VK_NULL_HANDLE };
+		VkFramebuffer		framebuffer{ VK_NULL_HANDLE };
+		VkExtent2D			framebufferExtent{};
+		VkImageUsageFlags	framebufferColorUsage{ 0 };
 	};
 
 	class ExampleBase
 	{
 	public:
 		ExampleBase() {};
-		~ExampleBase() {};
+		virtual ~ExampleBase() {};
 
+		void parseArguments(int argc, char** argv);
 		void init();
 		void run();
 		void cleanup();
@@ -45,26 +116,86 @@ namespace PVulkanExamples
 		void createSurface();
 		void createPhysicalDevice();
 		void createLogicalDevice();
+		void createSwapchain();
+		void recreateSwapchain();
 		void initializeCommandPools();
 		void initializeCommandBuffers();
 		void createDescriptorPools();
 		void createSyncObjects();
+		void createOffscreenTargets();
+		void initializeSubsystems();
+
+		struct InitStep
+		{
+			const char* name;
+			void (ExampleBase::*function)();
+		};
+		static const std::vector<InitStep>& getInitSteps();
 
 		void drawFrame();
 		void updateUniformBuffers();
 
+		bool readbackFrame(std::vector<uint8_t>& pixels);
+		bool dumpFrame(const std::string& path);
+
+
+		static std::string getShaderDirectory(const std::string& exampleName);
 
-		void addDeviceExtension(const char* extension, void* pPhysicalDeviceFeatureStruct = VK_NULL_HANDLE, std::vector<const char*> featureRequirements = {});
-		void addPhysicalDeviceFeatureRequirement(VkStructureType featureStructType, const char* feature);
+		// Without a feature set name extensions and features are required
+		void addDeviceExtension(const char* extension, void* pPhysicalDeviceFeatureStruct = VK_NULL_HANDLE, std::vector<const char*> featureRequirements = {},
+			const char* featureSet = nullptr);
+		void addPhysicalDeviceFeatureRequirement(VkStructureType featureStructType, const char* feature, const char* featureSet = nullptr);
+		void addDeviceFeatureSet(const char* name, FeatureSetPriority priority);
+		bool isFeatureSetEnabled(const char* name) const;
+
+	protected:
+		// Record the example's rendering, the target arrives cleared in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL and must be left in that layout
+		virtual void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) {}
+		// Update uniform and storage buffers of a frame slot before its commands are recorded
+		virtual void updateFrameData(uint32_t frameIndex) {}
+		// Add the device extensions and feature requirements of the example, called by setup on every init
+		virtual void configureDeviceRequirements() {}
+		// Create the example's pipelines and resources once core is initialized
+		virtual void createResources() {}
+		// Destroy them again, called by cleanup while the device is idle and before core is torn down
+		virtual void destroyResources() {}
+		// Declare the frame target in m_renderGraph in the state recordCommandBuffer receives and must leave it in
+		RenderGraphResource importFrameTarget(const FrameTarget& target);
+
+		// Shared helpers of the examples
+		bool ensureDepthTarget(SceneTargets& targets, VkExtent2D extent);	// True when the depth image was recreated
+		void ensureSceneFramebuffer(SceneTargets& targets, VkRenderPass renderPass, const FrameTarget& target);
+		void destroySceneTargets(SceneTargets& targets);
+		// Command buffer for uploads outside frames, endSingleTimeCommands submits it and waits for the graphics queue
+		VkCommandBuffer beginSingleTimeCommands();
+		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+		void destroyBuffer(VkBuffer& buffer, VkDeviceMemory& memory);
+		static VkWriteDescriptorSet bufferWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo* pInfo);
+		static VkWriteDescriptorSet imageWrite(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo* pInfo);
 
 	private:
+		// Depth targets and framebuffers replaced when the frame size changed, the frames in flight may still use them
+		struct RetiredSceneTargets
+		{
+			std::vector<VkImageView>	views{};
+			std::vector<VkImage>		images{};
+			std::vector<VkDeviceMemory>	memories{};
+			std::vector<VkFramebuffer>	framebuffers{};
+		};
+
 		// Private helpers
+		void destroyRetiredSceneTargets(RetiredSceneTargets& retired);
+		void recordFrame(VkCommandBuffer commandBuffer, const FrameTarget& target, VkImageLayout finalLayout);
 		bool checkValidationLayerSupport();
 		void constructStructChain();
 		bool isDeviceSuitable(VkPhysicalDevice device);
 		QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device, std::vector<const char*> deviceExtensions);
 		bool checkDeviceFeaturesSupport(VkPhysicalDevice device);
+		bool checkFeatureRequirements(const std::map<VkStructureType, std::vector<const char*>>& requirements);
+		std::vector<bool> checkFeatureSetSupport(VkPhysicalDevice device);
+		void enableFeatureSets(const std::vector<bool>& supported);
+		DeviceFeatureSet& getFeatureSet(const char* name);
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 		VkSurfaceFormatKHR chooseSwapchainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 		VkPresentModeKHR chooseSwapchainPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
@@ -74,29 +205,8 @@ namespace PVulkanExamples
 
 	private:
 		// Debug object name setters
-		void setObjectName(const uint64_t object, const std::string& name, VkObjectType t);
-		inline void setObjectName(VkBuffer object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_BUFFER); }
-		inline void setObjectName(VkBufferView object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_BUFFER_VIEW); }
-		inline void setObjectName(VkCommandBuffer object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_COMMAND_BUFFER); }
-		inline void setObjectName(VkCommandPool object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_COMMAND_POOL); }
-		inline void setObjectName(VkDescriptorPool object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_DESCRIPTOR_POOL); }
-		inline void setObjectName(VkDescriptorSet object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_DESCRIPTOR_SET); }
-		inline void setObjectName(VkDescriptorSetLayout object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT); }
-		inline void setObjectName(VkDevice object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_DEVICE); }
-		inline void setObjectName(VkDeviceMemory object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_DEVICE_MEMORY); }
-		inline void setObjectName(VkFramebuffer object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_FRAMEBUFFER); }
-		inline void setObjectName(VkFence object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_FENCE); }
-		inline void setObjectName(VkImage object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_IMAGE); }
-		inline void setObjectName(VkImageView object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_IMAGE_VIEW); }
-		inline void setObjectName(VkPipeline object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_PIPELINE); }
-		inline void setObjectName(VkPipelineLayout object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_PIPELINE_LAYOUT); }
-		inline void setObjectName(VkQueryPool object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_QUERY_POOL); }
-		inline void setObjectName(VkQueue object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_QUEUE); }
-		inline void setObjectName(VkRenderPass object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_RENDER_PASS); }
-		inline void setObjectName(VkSampler object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_SAMPLER); }
-		inline void setObjectName(VkSemaphore object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_SEMAPHORE); }
-		inline void setObjectName(VkShaderModule object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_SHADER_MODULE); }
-		inline void setObjectName(VkSwapchainKHR object, const std::string& name) { setObjectName((uint64_t)object, name, VK_OBJECT_TYPE_SWAPCHAIN_KHR); }
+		template <typename T>
+		inline void setObjectName(T object, const char* name) { m_debugAnnotator.setObjectName(object, name); }
 
 	public:
 		//Windwo and basic components
@@ -108,8 +218,15 @@ namespace PVulkanExamples
 
 		// Additional components
 		VkAllocationCallbacks*		m_defaultAllocator{ nullptr };
+		HostAllocator				m_hostAllocator{};
+		uint64_t					m_hostAllocationBudget{ 0 };	// Bytes, 0 for unlimited
+		bool						m_printHostAllocations{ false };
 		VkDebugUtilsMessengerEXT	m_debugMessenger{ VK_NULL_HANDLE };
 
+		// In-process driver replacing the Vulkan loader, configure its devices and latencies before init
+		MockDriver					m_mockDriver{};
+		bool						m_useMockDriver{ false };
+
 		// Queue families and queues
 		QueueFamilyIndices	m_queueFamilyIndices{};
 		VkQueue				m_graphicsQueue;
@@ -117,8 +234,14 @@ namespace PVulkanExamples
 		VkQueue				m_transferQueue;
 		VkQueue				m_presentQueue;
 
-		// Efficient function pointers
-		PFN_vkSetDebugUtilsObjectNameEXT m_pfn_vkSetDebugUtilsObjectNameEXT;
+		// Swapchain, created when not running headless
+		SwapchainManager	m_swapchain{};
+		PresentPolicy		m_presentPolicy{ PresentPolicy::LowLatency };
+		uint32_t			m_swapchainImageCount{ 0 };	// 0 lets the present policy choose
+		bool				m_framebufferResized{ false };
+
+		// Object names and command buffer / queue labels, compiled out in release builds
+		DebugAnnotator		m_debugAnnotator{};
 
 		// Command pools, command buffers and sychronization objects
 		VkCommandPool					m_commandPool{ VK_NULL_HANDLE };
@@ -128,10 +251,20 @@ namespace PVulkanExamples
 		std::vector<VkFence>			m_imageInFlightFences{};
 		uint8_t							m_maxFrameInFlight{ 3 };
 		uint8_t							m_currentFrameIndex{ 0 };
+		uint64_t						m_frameCounter{ 0 };
+		std::vector<RetiredSceneTargets>	m_retiredSceneTargets{};	// Per frame slot, destroyed once its fence has signaled again
+
+		// Offscreen rendering without window or surface, one target per frame in flight
+		std::vector<OffscreenTarget>	m_offscreenTargets{};
+		VkFormat						m_offscreenFormat{ VK_FORMAT_R8G8B8A8_UNORM };
+		VkClearColorValue				m_clearColor{ { 0.0f, 0.0f, 0.0f, 1.0f } };
 
 
 	public:
 		bool m_debugMode{ false };
+		bool m_headless{ false };				// No GLFW window, surface or present queue, frames render to offscreen images
+		uint32_t m_headlessFrameCount{ 1 };		// Frames rendered by run() in headless mode
+		std::string m_dumpFramePath{};			// Last headless frame is written here by run() when set
 
 		// Window settings
 		uint32_t m_windowWidth{ 800 };
@@ -146,10 +279,13 @@ namespace PVulkanExamples
 		// Extensions and features
 		std::vector<const char*>							m_instanceLayers{ "VK_LAYER_KHRONOS_validation" };
 		bool												m_enableValidationLayers{ false };
+		bool												m_requestValidation{ true };
+		ValidationMessageSink								m_validationSink{};
 		std::vector<const char*>							m_instanceExtensions{};
 		std::vector<void* >									m_EXTPhysicalDeviceFeatureStructs{};
 		std::map<VkStructureType, std::vector<const char*>> m_physicalDeviceFeatureRequirements{};
 		std::vector<const char*>							m_deviceExtensions{};
+		std::vector<DeviceFeatureSet>						m_deviceFeatureSets{};	// Ray tracing, geometry shader, synchronization2 and mesh shader tiers plus the ones examples add
 
 		// Physical Device Features
 		VkPhysicalDeviceFeatures2							m_physicalFeaturesStructChain{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
@@ -158,9 +294,46 @@ namespace PVulkanExamples
 		VkPhysicalDeviceVulkan12Features					m_features12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
 		VkPhysicalDeviceAccelerationStructureFeaturesKHR	m_accelFeature{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR };
 		VkPhysicalDeviceRayTracingPipelineFeaturesKHR		m_rtPipelineFeature{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR };
+		VkPhysicalDeviceSynchronization2FeaturesKHR			m_synchronization2Feature{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+		VkPhysicalDeviceMeshShaderFeaturesNV				m_meshShaderFeature{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV };
 
-		// Descriptor pool settings
+		// Descriptor pool and material system capacities, set before init
 		uint32_t m_maxVertexBlendingMeshCount{ 256 };
 		uint32_t m_maxMaterialCount{ 256 };
+
+		// Material parameters indexed by material ID and bindless textures, m_maxMaterialCount materials
+		MaterialSystem		m_materialSystem{};
+
+		// Descriptor set layouts and pipeline layouts generated from shader reflection
+		PipelineLayoutCache m_pipelineLayoutCache{};
+
+		// Pipeline creation and shader hot reload
+		VkPipelineCache		m_pipelineCache{ VK_NULL_HANDLE };
+		ShaderHotReloader	m_shaderHotReloader{};
+		bool				m_enableShaderHotReload{ false };
+		std::string			m_shaderDirectory{};	// GLSL sources watched when hot reload is enabled
+		ShaderPermutationManager m_shaderPermutations{};
+		uint32_t			m_maxIdlePermutationFrames{ 600 };	// Compiled permutations unused this many frames are evicted, 0 keeps them
+
+		// GPU timing, examples add zones with GpuProfileScope inside recordCommandBuffer
+		GpuProfiler			m_gpuProfiler{};
+		bool				m_printGpuProfile{ false };
+
+		// Per pass pipeline statistics and occlusion queries, read back one frame late
+		PipelineStatisticsCollector m_pipelineStatistics{};
+		bool				m_printPipelineStatistics{ false };
+
+		// Frame graph, examples declare and execute their passes in recordCommandBuffer, async compute work is waited for by the frame submission
+		RenderGraph			m_renderGraph{};
+
+		// Per frame uniform, storage and staging data, the region of a frame slot is released when its fence has signaled
+		RingBuffer			m_uploadRing{};
+		VkDeviceSize		m_uploadRingFrameSize{ 4ull << 20 };	// Bytes per frame in flight, set before init
+
+		// BLAS batches built at load time and the TLAS built in the frame command buffer, initialized when acceleration structures are enabled
+		AccelerationStructureBuilder m_accelerationStructures{};
+
+		// CPU and GPU zones are recorded when a trace file is given
+		std::string			m_traceFilePath{};
 	};
 } // namespace PVulkanExamples
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "vulkan_gpu_profiler.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_cpu_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t maxFrameInFlight,
+		const VkAllocationCallbacks* pAllocator, uint32_t maxZonesPerFrame, uint32_t historySize)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+		m_historySize = historySize;
+		m_maxQueriesPerFrame = maxZonesPerFrame * 2;
+
+		VkPhysicalDeviceProperties properties;
+		vkd.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		uint32_t queueFamilyCount = 0;
+		vkd.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkd.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+		m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+		if (!m_supported) return;
+
+		m_timestampPeriodNs = properties.limits.timestampPeriod;
+		m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = m_maxQueriesPerFrame;
+		m_frames.resize(maxFrameInFlight);
+		for (FrameQueries& frame : m_frames)
+		{
+			if (vkd.vkCreateQueryPool(m_device, &queryPoolInfo, m_allocator, &frame.queryPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create timestamp query pool!");
+			}
+			frame.zones.reserve(maxZonesPerFrame);
+		}
+		m_results.resize(size_t(m_maxQueriesPerFrame) * 2); // Value and availability per query
+	}
+
+	void GpuProfiler::cleanup()
+	{
+		for (FrameQueries& frame : m_frames)
+		{
+			vkd.vkDestroyQueryPool(m_device, frame.queryPool, m_allocator);
+		}
+		m_frames.clear();
+		m_history.clear();
+		m_zoneOrder.clear();
+		m_supported = false;
+	}
+
+	/*
+	* Collect the results of the frame previously recorded in this slot and reset its queries.
+	* Call after waiting on the slot's fence, at the start of command buffer recording.
+	*/
+	void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (!m_supported) return;
+
+		m_currentFrame = frameIndex;
+		FrameQueries& frame = m_frames[frameIndex];
+		collect(frame);
+		frame.zones.clear();
+		frame.queryCount = 0;
+		frame.cpuSubmitNs = 0;
+		vkd.vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, m_maxQueriesPerFrame);
+	}
+
+	uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage)
+	{
+		if (!m_supported) return UINT32_MAX;
+
+		FrameQueries& frame = m_frames[m_currentFrame];
+		if (frame.queryCount + 2 > m_maxQueriesPerFrame) return UINT32_MAX; // Out of queries, drop the zone
+		Zone zone{ name, frame.queryCount++, UINT32_MAX };
+		frame.queryCount++; // Reserve the end query so nested zones stay paired
+		vkd.vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, zone.beginQuery);
+		frame.zones.push_back(zone);
+		return static_cast<uint32_t>(frame.zones.size() - 1);
+	}
+
+	void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage)
+	{
+		if (!m_supported || zone == UINT32_MAX) return;
+
+		FrameQueries& frame = m_frames[m_currentFrame];
+		Zone& frameZone = frame.zones[zone];
+		frameZone.endQuery = frameZone.beginQuery + 1;
+		vkd.vkCmdWriteTimestamp(commandBuffer, stage, frame.queryPool, frameZone.endQuery);
+	}
+
+	/*
+	* Record the CPU time at which the current frame is submitted, GPU work of the frame cannot start earlier
+	*/
+	void GpuProfiler::markSubmit()
+	{
+		if (!m_supported) return;
+		m_frames[m_currentFrame].cpuSubmitNs = CpuProfiler::instance().now();
+	}
+
+	/*
+	* Read back available results without waiting, unavailable zones are skipped
+	*/
+	void GpuProfiler::collect(FrameQueries& frame)
+	{
+		if (frame.queryCount == 0) return;
+
+		VkResult result = vkd.vkGetQueryPoolResults(m_device, frame.queryPool, 0, frame.queryCount,
+			sizeof(uint64_t) * 2 * frame.queryCount, m_results.data(), sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_SUCCESS && result != VK_NOT_READY) return;
+
+		// Every frame gives a lower bound of the GPU to CPU clock offset since the GPU starts after the submit,
+		// the largest bound seen so far is the tightest estimate
+		CpuProfiler& cpuProfiler = CpuProfiler::instance();
+		bool forward = cpuProfiler.isEnabled();
+		if (forward && frame.cpuSubmitNs != 0 && !frame.zones.empty() && m_results[frame.zones[0].beginQuery * 2 + 1] != 0)
+		{
+			uint64_t frameBeginNs = static_cast<uint64_t>((m_results[frame.zones[0].beginQuery * 2] & m_timestampMask) * m_timestampPeriodNs);
+			m_gpuToCpuOffsetNs = std::max(m_gpuToCpuOffsetNs, static_cast<int64_t>(frame.cpuSubmitNs) - static_cast<int64_t>(frameBeginNs));
+			cpuProfiler.setGpuClockOffset(m_gpuToCpuOffsetNs);
+		}
+
+		for (const Zone& zone : frame.zones)
+		{
+			if (zone.endQuery == UINT32_MAX) continue;
+			if (m_results[zone.beginQuery * 2 + 1] == 0 || m_results[zone.endQuery * 2 + 1] == 0) continue;
+
+			uint64_t beginTicks = m_results[zone.beginQuery * 2] & m_timestampMask;
+			uint64_t ticks = (m_results[zone.endQuery * 2] - m_results[zone.beginQuery * 2]) & m_timestampMask;
+			double milliseconds = double(ticks) * m_timestampPeriodNs * 1e-6;
+			if (forward)
+			{
+				uint64_t beginNs = static_cast<uint64_t>(beginTicks * m_timestampPeriodNs);
+				cpuProfiler.gpuZone(zone.name, beginNs, beginNs + static_cast<uint64_t>(ticks * m_timestampPeriodNs));
+			}
+
+			auto it = m_history.find(zone.name);
+			if (it == m_history.end())
+			{
+				it = m_history.emplace(zone.name, ZoneHistory{}).first;
+				it->second.samples.reserve(m_historySize);
+				m_zoneOrder.push_back(zone.name);
+			}
+			ZoneHistory& history = it->second;
+			if (history.samples.size() < m_historySize) history.samples.push_back(milliseconds);
+			else history.samples[history.next] = milliseconds;
+			history.next = (history.next + 1) % m_historySize;
+			history.last = milliseconds;
+		}
+	}
+
+	/*
+	* Rolling statistics over the last historySize samples of every zone
+	*/
+	std::vector<GpuZoneStatistics> GpuProfiler::getStatistics() const
+	{
+		std::vector<GpuZoneStatistics> statistics;
+		std::vector<double> sorted;
+		for (const std::string& name : m_zoneOrder)
+		{
+			const ZoneHistory& history = m_history.at(name);
+			if (history.samples.empty()) continue;
+
+			sorted = history.samples;
+			std::sort(sorted.begin(), sorted.end());
+			GpuZoneStatistics zone{};
+			zone.name = name;
+			zone.lastMs = history.last;
+			zone.minMs = sorted.front();
+			zone.avgMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+			zone.p99Ms = sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))];
+			zone.sampleCount = static_cast<uint32_t>(sorted.size());
+			statistics.push_back(zone);
+		}
+		return statistics;
+	}
+
+	void GpuProfiler::printStatistics() const
+	{
+		std::cout << "\n=============================GPU zones (ms)=============================";
+		std::cout << "\n" << std::setw(32) << std::left << "zone" << std::right
+			<< std::setw(10) << "last" << std::setw(10) << "min" << std::setw(10) << "avg" << std::setw(10) << "p99" << std::setw(10) << "samples";
+		for (const GpuZoneStatistics& zone : getStatistics())
+		{
+			std::cout << "\n" << std::setw(32) << std::left << zone.name << std::right << std::fixed << std::setprecision(3)
+				<< std::setw(10) << zone.lastMs << std::setw(10) << zone.minMs << std::setw(10) << zone.avgMs << std::setw(10) << zone.p99Ms
+				<< std::setw(10) << zone.sampleCount;
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace PVulkanExamples
+{
+	struct GpuZoneStatistics
+	{
+		std::string name;
+		double      lastMs{ 0.0 };
+		double      minMs{ 0.0 };
+		double      avgMs{ 0.0 };
+		double      p99Ms{ 0.0 };
+		uint32_t    sampleCount{ 0 };
+	};
+
+	/*
+	* Per pass GPU timing with timestamp queries.
+	* Every frame in flight owns a query pool. Results of a frame slot are read back when the slot is reused,
+	* after its fence has signaled, so reading never stalls. Rolling min/avg/p99 are kept per zone name.
+	* Resolved zones are also forwarded to the CpuProfiler when it is enabled, aligned to the CPU clock
+	* with the submit times passed to markSubmit.
+	*/
+	class GpuProfiler
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t maxFrameInFlight,
+			const VkAllocationCallbacks* pAllocator, uint32_t maxZonesPerFrame = 64, uint32_t historySize = 256);
+		void cleanup();
+		bool isSupported() const { return m_supported; }
+
+		void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+		uint32_t beginZone(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		void endZone(VkCommandBuffer commandBuffer, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		void markSubmit();
+
+		std::vector<GpuZoneStatistics> getStatistics() const;
+		void printStatistics() const;
+
+	private:
+		struct Zone
+		{
+			const char* name{ nullptr };    // Expected to outlive the frame, typically a string literal
+			uint32_t    beginQuery{ 0 };
+			uint32_t    endQuery{ UINT32_MAX };
+		};
+
+		struct FrameQueries
+		{
+			VkQueryPool         queryPool{ VK_NULL_HANDLE };
+			std::vector<Zone>   zones{};
+			uint32_t            queryCount{ 0 };
+			uint64_t            cpuSubmitNs{ 0 };
+		};
+
+		struct ZoneHistory
+		{
+			std::vector<double> samples{};  // Ring buffer of durations in milliseconds
+			uint32_t            next{ 0 };
+			double              last{ 0.0 };
+		};
+
+		void collect(FrameQueries& frame);
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		bool                            m_supported{ false };
+		double                          m_timestampPeriodNs{ 1.0 };
+		uint64_t                        m_timestampMask{ ~0ull };
+		uint32_t                        m_maxQueriesPerFrame{ 0 };
+		uint32_t                        m_historySize{ 256 };
+		uint32_t                        m_currentFrame{ 0 };
+		int64_t                         m_gpuToCpuOffsetNs{ INT64_MIN };
+
+		std::vector<FrameQueries>                       m_frames{};
+		std::vector<uint64_t>                           m_results{};
+		std::unordered_map<std::string, ZoneHistory>    m_history{};
+		std::vector<std::string>                        m_zoneOrder{};  // First seen order, for stable reports
+	};
+
+	/*
+	* RAII helper recording a GPU zone around a scope of command recording
+	*/
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+			: m_profiler(profiler), m_commandBuffer(commandBuffer), m_zone(profiler.beginZone(commandBuffer, name)) {}
+		~GpuProfileScope() { m_profiler.endZone(m_commandBuffer, m_zone); }
+
+	private:
+		GpuProfiler&    m_profiler;
+		VkCommandBuffer m_commandBuffer;
+		uint32_t        m_zone;
+	};
+} // namespace PVulkanExamples
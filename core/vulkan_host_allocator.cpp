@@ -0,0 +1,307 @@
+#include "vulkan_host_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		const uint64_t ARENA_LIVE_ONE = 1ull << 32;
+		const uint64_t ARENA_OFFSET_MASK = ARENA_LIVE_ONE - 1;
+
+		uintptr_t alignUp(uintptr_t value, size_t alignment)
+		{
+			return (value + alignment - 1) & ~(uintptr_t(alignment) - 1);
+		}
+
+		const char* scopeName(uint32_t scope)
+		{
+			switch (scope)
+			{
+			case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:  return "command";
+			case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:   return "object";
+			case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:    return "cache";
+			case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:   return "device";
+			case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+			default:                                  return "unknown";
+			}
+		}
+	}
+
+	/*
+	* Set up the callbacks, one arena of arenaSize bytes per frame in flight and an optional budget in bytes (0 for unlimited)
+	*/
+	void HostAllocator::init(uint32_t maxFrameInFlight, size_t arenaSize, uint64_t budget)
+	{
+		cleanup();
+
+		m_callbacks = {};
+		m_callbacks.pUserData = this;
+		m_callbacks.pfnAllocation = allocationCallback;
+		m_callbacks.pfnReallocation = reallocationCallback;
+		m_callbacks.pfnFree = freeCallback;
+		m_callbacks.pfnInternalAllocation = internalAllocationCallback;
+		m_callbacks.pfnInternalFree = internalFreeCallback;
+		m_budget = budget;
+
+		m_arenaSize = std::min<size_t>(arenaSize, ARENA_OFFSET_MASK);
+		m_arenaCount = maxFrameInFlight;
+		m_arenas = std::make_unique<Arena[]>(m_arenaCount);
+		for (uint32_t i = 0; i < m_arenaCount; i++)
+		{
+			m_arenas[i].memory = static_cast<uint8_t*>(std::malloc(m_arenaSize));
+		}
+		m_currentArena.store(m_arenaCount > 0 ? &m_arenas[0] : nullptr);
+	}
+
+	/*
+	* Release arenas and pools, only valid once every object created with the callbacks has been destroyed
+	*/
+	void HostAllocator::cleanup()
+	{
+		m_currentArena.store(nullptr);
+		for (uint32_t i = 0; i < m_arenaCount; i++)
+		{
+			std::free(m_arenas[i].memory);
+		}
+		m_arenas.reset();
+		m_arenaCount = 0;
+		for (SizeClassPool& pool : m_pools)
+		{
+			for (void* chunk : pool.chunks) std::free(chunk);
+			pool.chunks.clear();
+			pool.freeBlocks.clear();
+		}
+	}
+
+	/*
+	* Switch command scope allocations to the arena of this frame slot, it is rewound if none of its allocations is alive
+	*/
+	void HostAllocator::beginFrame(uint32_t frameIndex)
+	{
+		if (frameIndex >= m_arenaCount) return;
+		Arena& arena = m_arenas[frameIndex];
+		uint64_t state = arena.state.load(std::memory_order_relaxed);
+		if ((state >> 32) == 0)
+		{
+			arena.state.compare_exchange_strong(state, 0, std::memory_order_acq_rel);
+		}
+		m_currentArena.store(&arena, std::memory_order_release);
+	}
+
+	HostAllocationScopeStatistics HostAllocator::getStatistics(VkSystemAllocationScope scope) const
+	{
+		const ScopeCounters& counters = m_scopes[scope];
+		HostAllocationScopeStatistics statistics{};
+		statistics.allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+		statistics.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+		statistics.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+		statistics.internalBytes = counters.internalBytes.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+	void HostAllocator::printStatistics() const
+	{
+		std::cout << "\n=============================Host allocations=============================";
+		std::cout << "\n" << std::setw(12) << std::left << "scope" << std::right
+			<< std::setw(16) << "allocated" << std::setw(16) << "peak" << std::setw(16) << "allocations" << std::setw(16) << "internal";
+		for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++)
+		{
+			HostAllocationScopeStatistics statistics = getStatistics(static_cast<VkSystemAllocationScope>(scope));
+			std::cout << "\n" << std::setw(12) << std::left << scopeName(scope) << std::right
+				<< std::setw(16) << statistics.allocatedBytes << std::setw(16) << statistics.peakBytes
+				<< std::setw(16) << statistics.allocationCount << std::setw(16) << statistics.internalBytes;
+		}
+		std::cout << "\nfailed allocations: " << getFailedAllocationCount() << "  arena overflows: " << getArenaOverflowCount() << std::endl;
+	}
+
+	VKAPI_ATTR void* VKAPI_CALL HostAllocator::allocationCallback(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		return static_cast<HostAllocator*>(pUserData)->allocate(size, alignment, scope);
+	}
+
+	VKAPI_ATTR void* VKAPI_CALL HostAllocator::reallocationCallback(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		return static_cast<HostAllocator*>(pUserData)->reallocate(pOriginal, size, alignment, scope);
+	}
+
+	VKAPI_ATTR void VKAPI_CALL HostAllocator::freeCallback(void* pUserData, void* pMemory)
+	{
+		static_cast<HostAllocator*>(pUserData)->release(pMemory);
+	}
+
+	VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocationCallback(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator*>(pUserData)->m_scopes[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFreeCallback(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator*>(pUserData)->m_scopes[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+	void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		if (size == 0 || size > UINT32_MAX || scope >= SCOPE_COUNT) return nullptr;
+		if (!reserveBudget(size, scope))
+		{
+			m_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		alignment = std::max(alignment, HEADER_SIZE);
+		void* pMemory = nullptr;
+		if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+		{
+			pMemory = allocateFromArena(size, alignment, scope);
+			if (pMemory == nullptr) m_arenaOverflows.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if (alignment == HEADER_SIZE && size + HEADER_SIZE <= (MIN_SIZE_CLASS << (SIZE_CLASS_COUNT - 1)))
+		{
+			pMemory = allocateFromPool(size, scope);
+		}
+		if (pMemory == nullptr)
+		{
+			pMemory = allocateFromSystem(size, alignment, scope);
+		}
+		if (pMemory == nullptr)
+		{
+			releaseBudget(size, scope);
+			m_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		return pMemory;
+	}
+
+	void* HostAllocator::reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		if (pOriginal == nullptr) return allocate(size, alignment, scope);
+		if (size == 0)
+		{
+			release(pOriginal);
+			return nullptr;
+		}
+
+		const Header* header = reinterpret_cast<const Header*>(static_cast<uint8_t*>(pOriginal) - HEADER_SIZE);
+		void* pMemory = allocate(size, alignment, scope);
+		if (pMemory == nullptr) return nullptr; // The original allocation stays valid
+		std::memcpy(pMemory, pOriginal, std::min<size_t>(size, header->size));
+		release(pOriginal);
+		return pMemory;
+	}
+
+	void HostAllocator::release(void* pMemory)
+	{
+		if (pMemory == nullptr) return;
+
+		Header* header = reinterpret_cast<Header*>(static_cast<uint8_t*>(pMemory) - HEADER_SIZE);
+		releaseBudget(header->size, static_cast<VkSystemAllocationScope>(header->scope));
+		switch (static_cast<Source>(header->source))
+		{
+		case Source::Arena:
+			static_cast<Arena*>(header->base)->state.fetch_sub(ARENA_LIVE_ONE, std::memory_order_acq_rel);
+			break;
+		case Source::Pool:
+		{
+			SizeClassPool& pool = m_pools[header->sizeClass];
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			pool.freeBlocks.push_back(header->base);
+			break;
+		}
+		case Source::System:
+			std::free(header->base);
+			break;
+		}
+	}
+
+	/*
+	* Lock-free bump allocation, the live count and offset are advanced with a single compare exchange
+	*/
+	void* HostAllocator::allocateFromArena(size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		Arena* arena = m_currentArena.load(std::memory_order_acquire);
+		if (arena == nullptr || arena->memory == nullptr) return nullptr;
+
+		uintptr_t base = reinterpret_cast<uintptr_t>(arena->memory);
+		uint64_t state = arena->state.load(std::memory_order_relaxed);
+		uintptr_t user = 0;
+		while (true)
+		{
+			uint64_t offset = state & ARENA_OFFSET_MASK;
+			user = alignUp(base + offset + HEADER_SIZE, alignment);
+			uint64_t end = user + size - base;
+			if (end > m_arenaSize) return nullptr;
+			uint64_t newState = ((state & ~ARENA_OFFSET_MASK) + ARENA_LIVE_ONE) | end;
+			if (arena->state.compare_exchange_weak(state, newState, std::memory_order_acq_rel)) break;
+		}
+
+		Header* header = reinterpret_cast<Header*>(user - HEADER_SIZE);
+		*header = { arena, static_cast<uint32_t>(size), static_cast<uint16_t>(Source::Arena), static_cast<uint8_t>(scope), 0 };
+		return reinterpret_cast<void*>(user);
+	}
+
+	void* HostAllocator::allocateFromPool(size_t size, VkSystemAllocationScope scope)
+	{
+		uint32_t sizeClass = 0;
+		while ((MIN_SIZE_CLASS << sizeClass) < size + HEADER_SIZE) sizeClass++;
+		size_t blockSize = MIN_SIZE_CLASS << sizeClass;
+
+		SizeClassPool& pool = m_pools[sizeClass];
+		void* block = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			if (pool.freeBlocks.empty())
+			{
+				uint8_t* chunk = static_cast<uint8_t*>(std::malloc(POOL_CHUNK_SIZE));
+				if (chunk == nullptr) return nullptr;
+				pool.chunks.push_back(chunk);
+				for (size_t offset = 0; offset + blockSize <= POOL_CHUNK_SIZE; offset += blockSize)
+				{
+					pool.freeBlocks.push_back(chunk + offset);
+				}
+			}
+			block = pool.freeBlocks.back();
+			pool.freeBlocks.pop_back();
+		}
+
+		Header* header = static_cast<Header*>(block);
+		*header = { block, static_cast<uint32_t>(size), static_cast<uint16_t>(Source::Pool), static_cast<uint8_t>(scope), static_cast<uint8_t>(sizeClass) };
+		return static_cast<uint8_t*>(block) + HEADER_SIZE;
+	}
+
+	void* HostAllocator::allocateFromSystem(size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		void* base = std::malloc(size + alignment + HEADER_SIZE);
+		if (base == nullptr) return nullptr;
+		uintptr_t user = alignUp(reinterpret_cast<uintptr_t>(base) + HEADER_SIZE, alignment);
+		Header* header = reinterpret_cast<Header*>(user - HEADER_SIZE);
+		*header = { base, static_cast<uint32_t>(size), static_cast<uint16_t>(Source::System), static_cast<uint8_t>(scope), 0 };
+		return reinterpret_cast<void*>(user);
+	}
+
+	bool HostAllocator::reserveBudget(size_t size, VkSystemAllocationScope scope)
+	{
+		uint64_t total = m_totalBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		if (m_budget != 0 && total > m_budget)
+		{
+			m_totalBytes.fetch_sub(size, std::memory_order_relaxed);
+			return false;
+		}
+
+		ScopeCounters& counters = m_scopes[scope];
+		uint64_t allocated = counters.allocatedBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+		uint64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+		while (allocated > peak && !counters.peakBytes.compare_exchange_weak(peak, allocated, std::memory_order_relaxed)) {}
+		return true;
+	}
+
+	void HostAllocator::releaseBudget(size_t size, VkSystemAllocationScope scope)
+	{
+		m_totalBytes.fetch_sub(size, std::memory_order_relaxed);
+		m_scopes[scope].allocatedBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+} // namespace PVulkanExamples
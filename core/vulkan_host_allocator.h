@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	struct HostAllocationScopeStatistics
+	{
+		uint64_t allocatedBytes{ 0 };       // Currently allocated through the callbacks
+		uint64_t peakBytes{ 0 };
+		uint64_t allocationCount{ 0 };      // Total number of allocations, reallocations included
+		uint64_t internalBytes{ 0 };        // Reported by the driver through the internal allocation notifications
+	};
+
+	/*
+	* VkAllocationCallbacks tracking driver host memory per VkSystemAllocationScope.
+	*   COMMAND scope allocations only live for the duration of a Vulkan command and come from a per frame linear arena
+	*   OBJECT, CACHE, DEVICE and INSTANCE scope allocations come from size class pools when small enough
+	*   everything else, over aligned or oversized, goes to the system heap
+	* Allocations fail, and the driver returns VK_ERROR_OUT_OF_HOST_MEMORY, once the optional budget is exceeded.
+	* Must outlive every Vulkan object created with its callbacks.
+	*/
+	class HostAllocator
+	{
+	public:
+		HostAllocator() = default;
+		HostAllocator(const HostAllocator&) = delete;
+		HostAllocator& operator=(const HostAllocator&) = delete;
+		~HostAllocator() { cleanup(); }
+
+		void init(uint32_t maxFrameInFlight, size_t arenaSize = 1 << 20, uint64_t budget = 0);
+		void cleanup();
+		VkAllocationCallbacks* getCallbacks() { return &m_callbacks; }
+
+		void beginFrame(uint32_t frameIndex);
+
+		HostAllocationScopeStatistics getStatistics(VkSystemAllocationScope scope) const;
+		uint64_t getFailedAllocationCount() const { return m_failedAllocations.load(std::memory_order_relaxed); }
+		uint64_t getArenaOverflowCount() const { return m_arenaOverflows.load(std::memory_order_relaxed); }
+		void printStatistics() const;
+
+	private:
+		static constexpr uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+		static constexpr uint32_t SIZE_CLASS_COUNT = 8;         // 64 bytes to 8 KiB blocks
+		static constexpr size_t   MIN_SIZE_CLASS = 64;
+		static constexpr size_t   POOL_CHUNK_SIZE = 64 * 1024;
+		static constexpr size_t   HEADER_SIZE = 16;             // Natural alignment of pooled allocations
+
+		enum class Source : uint32_t
+		{
+			System,
+			Arena,
+			Pool,
+		};
+
+		// Stored right before every returned pointer
+		struct Header
+		{
+			void*       base;       // System: malloc result, Pool: block start, Arena: owning arena
+			uint32_t    size;
+			uint16_t    source;
+			uint8_t     scope;
+			uint8_t     sizeClass;
+		};
+		static_assert(sizeof(Header) <= HEADER_SIZE, "allocation header must fit in HEADER_SIZE");
+
+		// Live allocation count in the high 32 bits and bump offset in the low 32 bits, updated together so a reset
+		// can only succeed while no allocation of the arena is alive
+		struct Arena
+		{
+			uint8_t*                memory{ nullptr };
+			std::atomic<uint64_t>   state{ 0 };
+		};
+
+		struct SizeClassPool
+		{
+			std::mutex          mutex{};
+			std::vector<void*>  freeBlocks{};
+			std::vector<void*>  chunks{};
+		};
+
+		struct ScopeCounters
+		{
+			std::atomic<uint64_t> allocatedBytes{ 0 };
+			std::atomic<uint64_t> peakBytes{ 0 };
+			std::atomic<uint64_t> allocationCount{ 0 };
+			std::atomic<uint64_t> internalBytes{ 0 };
+		};
+
+		static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL freeCallback(void* pUserData, void* pMemory);
+		static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+		void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void* reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void release(void* pMemory);
+		void* allocateFromArena(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void* allocateFromPool(size_t size, VkSystemAllocationScope scope);
+		void* allocateFromSystem(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		bool reserveBudget(size_t size, VkSystemAllocationScope scope);
+		void releaseBudget(size_t size, VkSystemAllocationScope scope);
+
+	private:
+		VkAllocationCallbacks                           m_callbacks{};
+		uint64_t                                        m_budget{ 0 };      // 0 for unlimited
+		std::atomic<uint64_t>                           m_totalBytes{ 0 };
+		std::atomic<uint64_t>                           m_failedAllocations{ 0 };
+		std::atomic<uint64_t>                           m_arenaOverflows{ 0 };
+		std::array<ScopeCounters, SCOPE_COUNT>          m_scopes{};
+		std::unique_ptr<Arena[]>                        m_arenas{};
+		uint32_t                                        m_arenaCount{ 0 };
+		size_t                                          m_arenaSize{ 0 };
+		std::atomic<Arena*>                             m_currentArena{ nullptr };
+		std::array<SizeClassPool, SIZE_CLASS_COUNT>     m_pools{};
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,218 @@
+#include "vulkan_instance_store.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void InstanceStore::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, const VkAllocationCallbacks* pAllocator)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+		m_capacity = capacity;
+		m_count = 0;
+		m_cleared = false;
+		m_statistics = {};
+
+		const uint32_t elementSizes[] = { sizeof(InstanceTransform), sizeof(uint32_t), sizeof(uint32_t) };
+		uint32_t pageCount = (capacity + PAGE_SIZE - 1) / PAGE_SIZE;
+		for (uint32_t index = 0; index < static_cast<uint32_t>(InstanceStream::Count); index++)
+		{
+			Stream& stream = m_streams[index];
+			stream.elementSize = elementSizes[index];
+			stream.hostData.assign(VkDeviceSize(capacity) * stream.elementSize, 0);
+			stream.dirtyPages.assign((pageCount + 63) / 64, 0);
+			stream.dirtyPageCount = 0;
+			VulkanUtil::createBuffer(physicalDevice, device, std::max<VkDeviceSize>(stream.hostData.size(), 4),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, stream.buffer, stream.memory, pAllocator);
+		}
+	}
+
+	void InstanceStore::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		for (Stream& stream : m_streams)
+		{
+			vkd.vkDestroyBuffer(m_device, stream.buffer, m_allocator);
+			vkd.vkFreeMemory(m_device, stream.memory, m_allocator);
+			stream = Stream{};
+		}
+		m_copyRegions.clear();
+		m_device = VK_NULL_HANDLE;
+	}
+
+	uint32_t InstanceStore::add(const InstanceTransform& transform, uint32_t materialId, uint32_t flags)
+	{
+		if (m_count == m_capacity)
+		{
+			throw std::runtime_error("failed to add instance, instance store is full!");
+		}
+		uint32_t index = m_count++;
+		setTransform(index, transform);
+		setMaterial(index, materialId);
+		setFlags(index, flags);
+		return index;
+	}
+
+	void InstanceStore::setTransform(uint32_t index, const InstanceTransform& transform)
+	{
+		Stream& stream = m_streams[static_cast<uint32_t>(InstanceStream::Transform)];
+		std::memcpy(stream.hostData.data() + VkDeviceSize(index) * stream.elementSize, &transform, sizeof(transform));
+		markDirty(stream, index);
+	}
+
+	void InstanceStore::setMaterial(uint32_t index, uint32_t materialId)
+	{
+		Stream& stream = m_streams[static_cast<uint32_t>(InstanceStream::Material)];
+		reinterpret_cast<uint32_t*>(stream.hostData.data())[index] = materialId;
+		markDirty(stream, index);
+	}
+
+	void InstanceStore::setFlags(uint32_t index, uint32_t flags)
+	{
+		Stream& stream = m_streams[static_cast<uint32_t>(InstanceStream::Flags)];
+		reinterpret_cast<uint32_t*>(stream.hostData.data())[index] = flags;
+		markDirty(stream, index);
+	}
+
+	void InstanceStore::invalidate(InstanceStream stream)
+	{
+		Stream& target = m_streams[static_cast<uint32_t>(stream)];
+		for (uint32_t index = 0; index < m_count; index += PAGE_SIZE) markDirty(target, index);
+	}
+
+	const InstanceTransform& InstanceStore::getTransform(uint32_t index) const
+	{
+		return reinterpret_cast<const InstanceTransform*>(m_streams[static_cast<uint32_t>(InstanceStream::Transform)].hostData.data())[index];
+	}
+
+	uint32_t InstanceStore::getMaterial(uint32_t index) const
+	{
+		return reinterpret_cast<const uint32_t*>(m_streams[static_cast<uint32_t>(InstanceStream::Material)].hostData.data())[index];
+	}
+
+	uint32_t InstanceStore::getFlags(uint32_t index) const
+	{
+		return reinterpret_cast<const uint32_t*>(m_streams[static_cast<uint32_t>(InstanceStream::Flags)].hostData.data())[index];
+	}
+
+	VkDeviceSize InstanceStore::getStreamSize(InstanceStream stream) const
+	{
+		return VkDeviceSize(m_count) * m_streams[static_cast<uint32_t>(stream)].elementSize;
+	}
+
+	bool InstanceStore::hasDirtyPages() const
+	{
+		for (const Stream& stream : m_streams)
+		{
+			if (stream.dirtyPageCount > 0) return true;
+		}
+		return false;
+	}
+
+	void InstanceStore::markDirty(Stream& stream, uint32_t index)
+	{
+		uint32_t page = index / PAGE_SIZE;
+		uint64_t bit = 1ull << (page % 64);
+		uint64_t& word = stream.dirtyPages[page / 64];
+		if ((word & bit) == 0)
+		{
+			word |= bit;
+			stream.dirtyPageCount++;
+		}
+	}
+
+	VkDeviceSize InstanceStore::upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing, VkDeviceSize maxBytes)
+	{
+		if (!hasDirtyPages()) return 0;
+
+		if (!m_cleared)
+		{
+			for (const Stream& stream : m_streams) vkd.vkCmdFillBuffer(commandBuffer, stream.buffer, 0, VK_WHOLE_SIZE, 0);
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			m_cleared = true;
+		}
+
+		VkDeviceSize uploaded = 0;
+		for (Stream& stream : m_streams)
+		{
+			if (stream.dirtyPageCount == 0) continue;
+			uploaded += uploadStream(commandBuffer, stagingRing, stream, maxBytes == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : maxBytes - uploaded);
+		}
+		if (uploaded > 0)
+		{
+			m_statistics.uploads++;
+			m_statistics.uploadedBytes += uploaded;
+		}
+		return uploaded;
+	}
+
+	/*
+	* Runs of consecutive dirty pages become one copy region each, all regions of the stream are staged in one ring
+	* allocation and copied with one command. The last page is cut at the instance count.
+	*/
+	VkDeviceSize InstanceStore::uploadStream(VkCommandBuffer commandBuffer, RingBuffer& stagingRing, Stream& stream, VkDeviceSize maxBytes)
+	{
+		VkDeviceSize available = stagingRing.getFrameAvailable();
+		available = available > stagingRing.getMinAlignment() ? available - stagingRing.getMinAlignment() : 0;
+		VkDeviceSize budget = std::min(maxBytes, available);
+		VkDeviceSize pageBytes = VkDeviceSize(PAGE_SIZE) * stream.elementSize;
+		VkDeviceSize streamEnd = VkDeviceSize(m_count) * stream.elementSize;
+
+		m_copyRegions.clear();
+		VkDeviceSize stagedSize = 0;
+		uint32_t pageCount = (m_count + PAGE_SIZE - 1) / PAGE_SIZE;
+		uint32_t page = 0;
+		while (page < pageCount)
+		{
+			uint64_t word = stream.dirtyPages[page / 64] >> (page % 64);
+			if (word == 0)
+			{
+				page = (page / 64 + 1) * 64;
+				continue;
+			}
+			if ((word & 1) == 0)
+			{
+				page++;
+				continue;
+			}
+
+			// Extend the run while pages are dirty and fit the budget
+			VkDeviceSize begin = VkDeviceSize(page) * pageBytes;
+			VkDeviceSize end = begin;
+			uint32_t runBegin = page;
+			while (page < pageCount && (stream.dirtyPages[page / 64] & (1ull << (page % 64))) != 0)
+			{
+				VkDeviceSize pageEnd = std::min(end + pageBytes, streamEnd);
+				if (stagedSize + (pageEnd - begin) > budget) break;
+				end = pageEnd;
+				page++;
+			}
+			if (end == begin) break;
+
+			m_copyRegions.push_back({ stagedSize, begin, end - begin });
+			stagedSize += end - begin;
+			for (uint32_t cleared = runBegin; cleared < page; cleared++) stream.dirtyPages[cleared / 64] &= ~(1ull << (cleared % 64));
+			stream.dirtyPageCount -= page - runBegin;
+			m_statistics.uploadedPages += page - runBegin;
+			if (page < pageCount && (stream.dirtyPages[page / 64] & (1ull << (page % 64))) != 0) break;   // Budget exhausted
+		}
+		if (m_copyRegions.empty()) return 0;
+
+		RingBufferAllocation staging = stagingRing.allocate(stagedSize);
+		uint8_t* destination = static_cast<uint8_t*>(staging.pData);
+		for (VkBufferCopy& region : m_copyRegions)
+		{
+			std::memcpy(destination + region.srcOffset, stream.hostData.data() + region.dstOffset, region.size);
+			region.srcOffset += staging.offset;
+		}
+		vkd.vkCmdCopyBuffer(commandBuffer, staging.buffer, stream.buffer, static_cast<uint32_t>(m_copyRegions.size()), m_copyRegions.data());
+		m_statistics.copyRegions += m_copyRegions.size();
+		return stagedSize;
+	}
+} // namespace PVulkanExamples
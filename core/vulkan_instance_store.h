@@ -0,0 +1,100 @@
+#pragma once
+
+#include "vulkan_ring_buffer.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// Row major 3x4 affine transform, the rows can be bound as three vec4 instance attributes
+	struct InstanceTransform
+	{
+		float rows[3][4]{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } };
+	};
+
+	enum class InstanceStream : uint32_t
+	{
+		Transform,      // InstanceTransform
+		Material,       // uint32_t material ID
+		Flags,          // uint32_t, meaning defined by the example
+		Count,
+	};
+
+	struct InstanceUploadStatistics
+	{
+		uint64_t    uploads{ 0 };           // upload() calls that recorded copies
+		uint64_t    uploadedBytes{ 0 };
+		uint64_t    uploadedPages{ 0 };
+		uint64_t    copyRegions{ 0 };
+	};
+
+	/*
+	* Structure of arrays instance data: transforms, material IDs and flags each live in a host copy and a device local
+	* buffer of their own, usable as instance rate vertex buffers or storage buffers. Every stream tracks which pages of
+	* PAGE_SIZE instances were changed since the last upload, upload() copies only the dirty pages of each stream through
+	* the staging ring, coalescing neighbouring pages into one copy region, so moving a few instances does not re-upload
+	* their materials and flags, nor the instances that did not move.
+	*/
+	class InstanceStore
+	{
+	public:
+		static constexpr uint32_t PAGE_SIZE = 256;  // Instances per dirty page
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t capacity, const VkAllocationCallbacks* pAllocator = nullptr);
+		void cleanup();
+
+		// Returns the index of the new instance, throws when the store is full
+		uint32_t add(const InstanceTransform& transform, uint32_t materialId, uint32_t flags);
+		void setTransform(uint32_t index, const InstanceTransform& transform);
+		void setMaterial(uint32_t index, uint32_t materialId);
+		void setFlags(uint32_t index, uint32_t flags);
+		// Marks every instance of the stream dirty, as if all of them had been written
+		void invalidate(InstanceStream stream);
+
+		/*
+		* Record the copies of the dirty pages of all streams, staged in the current frame region of the ring. At most
+		* maxBytes are uploaded, pages that do not fit stay dirty for the next call. The first call also clears the
+		* buffers so instances not uploaded yet read zeros. Returns the bytes uploaded, the caller synchronizes the transfer
+		* writes with the reads of the buffers.
+		*/
+		VkDeviceSize upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing, VkDeviceSize maxBytes = VK_WHOLE_SIZE);
+
+		bool hasDirtyPages() const;
+		VkBuffer getBuffer(InstanceStream stream) const { return m_streams[static_cast<uint32_t>(stream)].buffer; }
+		VkDeviceSize getStreamSize(InstanceStream stream) const;
+		uint32_t getElementSize(InstanceStream stream) const { return m_streams[static_cast<uint32_t>(stream)].elementSize; }
+		const InstanceTransform& getTransform(uint32_t index) const;
+		uint32_t getMaterial(uint32_t index) const;
+		uint32_t getFlags(uint32_t index) const;
+		uint32_t getCount() const { return m_count; }
+		uint32_t getCapacity() const { return m_capacity; }
+		const InstanceUploadStatistics& getStatistics() const { return m_statistics; }
+		void resetStatistics() { m_statistics = {}; }
+
+	private:
+		struct Stream
+		{
+			VkBuffer                buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory          memory{ VK_NULL_HANDLE };
+			uint32_t                elementSize{ 0 };
+			std::vector<uint8_t>    hostData{};
+			std::vector<uint64_t>   dirtyPages{};   // One bit per page
+			uint32_t                dirtyPageCount{ 0 };
+		};
+
+		void markDirty(Stream& stream, uint32_t index);
+		VkDeviceSize uploadStream(VkCommandBuffer commandBuffer, RingBuffer& stagingRing, Stream& stream, VkDeviceSize maxBytes);
+
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		Stream                          m_streams[static_cast<uint32_t>(InstanceStream::Count)]{};
+		uint32_t                        m_capacity{ 0 };
+		uint32_t                        m_count{ 0 };
+		bool                            m_cleared{ false };    // Device buffers zero filled by the first upload
+		InstanceUploadStatistics        m_statistics{};
+		std::vector<VkBufferCopy>       m_copyRegions{};        // Reused by every upload
+	};
+} // namespace PVulkanExamples
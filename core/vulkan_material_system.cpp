@@ -0,0 +1,190 @@
+#include "vulkan_material_system.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void MaterialSystem::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxMaterialCount, uint32_t maxTextureCount, uint32_t frameCount,
+		const VkAllocationCallbacks* pAllocator)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+		m_maxTextureCount = maxTextureCount;
+		m_parameters.assign(maxMaterialCount, MaterialParameters{});
+		m_pipelines.assign(maxMaterialCount, 0);
+		m_dirty.assign(maxMaterialCount, 0);
+		m_dirtyMaterials.clear();
+		m_freeMaterials.resize(maxMaterialCount);
+		for (uint32_t index = 0; index < maxMaterialCount; index++) m_freeMaterials[index] = maxMaterialCount - 1 - index;
+		m_textures.clear();
+		m_frameStates.assign(frameCount, FrameDescriptorState{});
+		m_statistics = {};
+
+		VulkanUtil::createBuffer(physicalDevice, device, std::max<VkDeviceSize>(maxMaterialCount, 1) * sizeof(MaterialParameters),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_buffer, m_memory, pAllocator);
+	}
+
+	void MaterialSystem::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		vkd.vkDestroyBuffer(m_device, m_buffer, m_allocator);
+		vkd.vkFreeMemory(m_device, m_memory, m_allocator);
+		m_buffer = VK_NULL_HANDLE;
+		m_memory = VK_NULL_HANDLE;
+		m_parameters.clear();
+		m_pipelines.clear();
+		m_freeMaterials.clear();
+		m_dirty.clear();
+		m_dirtyMaterials.clear();
+		m_textures.clear();
+		m_frameStates.clear();
+		m_device = VK_NULL_HANDLE;
+	}
+
+	uint32_t MaterialSystem::addTexture(VkImageView view, VkSampler sampler)
+	{
+		if (m_textures.size() == m_maxTextureCount)
+		{
+			throw std::runtime_error("failed to add texture, bindless texture array is full!");
+		}
+		m_textures.push_back({ sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		return static_cast<uint32_t>(m_textures.size() - 1);
+	}
+
+	uint32_t MaterialSystem::createMaterial(const MaterialParameters& parameters, uint32_t pipeline)
+	{
+		if (m_freeMaterials.empty())
+		{
+			throw std::runtime_error("failed to create material, material count exceeds maxMaterialCount!");
+		}
+		uint32_t materialId = m_freeMaterials.back();
+		m_freeMaterials.pop_back();
+		m_parameters[materialId] = parameters;
+		m_pipelines[materialId] = pipeline;
+		markDirty(materialId);
+		return materialId;
+	}
+
+	void MaterialSystem::updateMaterial(uint32_t materialId, const MaterialParameters& parameters)
+	{
+		m_parameters[materialId] = parameters;
+		markDirty(materialId);
+	}
+
+	void MaterialSystem::setMaterialPipeline(uint32_t materialId, uint32_t pipeline)
+	{
+		m_pipelines[materialId] = pipeline;
+	}
+
+	// The parameters stay in the buffer until the ID is reused, draws still in flight may read them
+	void MaterialSystem::destroyMaterial(uint32_t materialId)
+	{
+		m_freeMaterials.push_back(materialId);
+	}
+
+	void MaterialSystem::markDirty(uint32_t materialId)
+	{
+		if (m_dirty[materialId]) return;
+		m_dirty[materialId] = 1;
+		m_dirtyMaterials.push_back(materialId);
+	}
+
+	/*
+	* Consecutive material IDs become one copy region, all regions are staged in one ring allocation and copied with one
+	* command
+	*/
+	VkDeviceSize MaterialSystem::upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing)
+	{
+		if (m_dirtyMaterials.empty()) return 0;
+
+		std::sort(m_dirtyMaterials.begin(), m_dirtyMaterials.end());
+		m_copyRegions.clear();
+		for (uint32_t materialId : m_dirtyMaterials)
+		{
+			VkDeviceSize offset = VkDeviceSize(materialId) * sizeof(MaterialParameters);
+			if (!m_copyRegions.empty() && m_copyRegions.back().dstOffset + m_copyRegions.back().size == offset)
+			{
+				m_copyRegions.back().size += sizeof(MaterialParameters);
+			}
+			else
+			{
+				VkDeviceSize staged = m_copyRegions.empty() ? 0 : m_copyRegions.back().srcOffset + m_copyRegions.back().size;
+				m_copyRegions.push_back({ staged, offset, sizeof(MaterialParameters) });
+			}
+			m_dirty[materialId] = 0;
+		}
+
+		VkDeviceSize stagedSize = m_copyRegions.back().srcOffset + m_copyRegions.back().size;
+		RingBufferAllocation staging = stagingRing.allocate(stagedSize);
+		uint8_t* destination = static_cast<uint8_t*>(staging.pData);
+		for (VkBufferCopy& region : m_copyRegions)
+		{
+			std::memcpy(destination + region.srcOffset, reinterpret_cast<const uint8_t*>(m_parameters.data()) + region.dstOffset, region.size);
+			region.srcOffset += staging.offset;
+		}
+		vkd.vkCmdCopyBuffer(commandBuffer, staging.buffer, m_buffer, static_cast<uint32_t>(m_copyRegions.size()), m_copyRegions.data());
+
+		m_statistics.uploads++;
+		m_statistics.uploadedMaterials += m_dirtyMaterials.size();
+		m_statistics.copyRegions += m_copyRegions.size();
+		m_dirtyMaterials.clear();
+		return stagedSize;
+	}
+
+	void MaterialSystem::updateDescriptorSet(uint32_t frameIndex, VkDescriptorSet set, uint32_t materialBinding, uint32_t textureBinding)
+	{
+		FrameDescriptorState& state = m_frameStates[frameIndex];
+		VkDescriptorBufferInfo bufferInfo{ m_buffer, 0, VK_WHOLE_SIZE };
+		VkWriteDescriptorSet writes[2]{};
+		uint32_t writeCount = 0;
+		if (state.set != set)
+		{
+			writes[writeCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[writeCount].dstSet = set;
+			writes[writeCount].dstBinding = materialBinding;
+			writes[writeCount].descriptorCount = 1;
+			writes[writeCount].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[writeCount].pBufferInfo = &bufferInfo;
+			writeCount++;
+			state.set = set;
+			state.writtenTextureCount = 0;
+		}
+		uint32_t textureCount = static_cast<uint32_t>(m_textures.size());
+		if (state.writtenTextureCount < textureCount)
+		{
+			writes[writeCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[writeCount].dstSet = set;
+			writes[writeCount].dstBinding = textureBinding;
+			writes[writeCount].dstArrayElement = state.writtenTextureCount;
+			writes[writeCount].descriptorCount = textureCount - state.writtenTextureCount;
+			writes[writeCount].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[writeCount].pImageInfo = m_textures.data() + state.writtenTextureCount;
+			writeCount++;
+			state.writtenTextureCount = textureCount;
+		}
+		if (writeCount > 0) vkd.vkUpdateDescriptorSets(m_device, writeCount, writes, 0, nullptr);
+	}
+
+	uint32_t MaterialSystem::sortDraws(std::vector<MaterialDraw>& draws)
+	{
+		m_sortKeys.resize(draws.size());
+		for (size_t index = 0; index < draws.size(); index++)
+		{
+			const MaterialDraw& draw = draws[index];
+			m_sortKeys[index] = { (uint64_t(m_pipelines[draw.materialId]) << 32) | draw.materialId, draw.drawIndex };
+		}
+		std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+		uint32_t pipelineChanges = 0;
+		for (size_t index = 0; index < draws.size(); index++)
+		{
+			draws[index] = { static_cast<uint32_t>(m_sortKeys[index].first), m_sortKeys[index].second };
+			if (index == 0 || (m_sortKeys[index].first >> 32) != (m_sortKeys[index - 1].first >> 32)) pipelineChanges++;
+		}
+		return pipelineChanges;
+	}
+} // namespace PVulkanExamples
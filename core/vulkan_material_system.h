@@ -0,0 +1,121 @@
+#pragma once
+
+#include "vulkan_ring_buffer.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// std430 layout of one material in the material buffer, 64 bytes
+	struct MaterialParameters
+	{
+		static constexpr uint32_t NO_TEXTURE = UINT32_MAX;
+
+		float       baseColor[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+		float       emissive[4]{ 0.0f, 0.0f, 0.0f, 0.0f };     // Color and intensity
+		float       roughness{ 0.5f };
+		float       metallic{ 0.0f };
+		float       alphaCutoff{ 0.5f };
+		uint32_t    flags{ 0 };                                 // Meaning defined by the shaders
+		uint32_t    baseColorTexture{ NO_TEXTURE };             // Bindless texture indices
+		uint32_t    normalTexture{ NO_TEXTURE };
+		uint32_t    emissiveTexture{ NO_TEXTURE };
+		uint32_t    padding{ 0 };
+	};
+
+	// A draw of the caller, referenced by drawIndex, using the material
+	struct MaterialDraw
+	{
+		uint32_t    materialId{ 0 };
+		uint32_t    drawIndex{ 0 };
+	};
+
+	struct MaterialUploadStatistics
+	{
+		uint64_t    uploads{ 0 };           // upload() calls that recorded copies
+		uint64_t    uploadedMaterials{ 0 };
+		uint64_t    copyRegions{ 0 };
+	};
+
+	/*
+	* Materials indexed by material ID: the parameters of all materials live in one device local storage buffer, textures
+	* are referenced by their index in a bindless sampled image array. Shaders fetch the parameters of a draw from its
+	* material ID, so switching materials needs no descriptor or buffer binding, only draws of materials with different
+	* pipelines need a pipeline bind, and sortDraws orders draws by pipeline then material to keep those to a minimum.
+	* Changed materials are uploaded as deltas through the staging ring, textures added since a frame slot's descriptor set
+	* was last written are written to that set when the slot is reused, so sets are never updated while in use.
+	*/
+	class MaterialSystem
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxMaterialCount, uint32_t maxTextureCount, uint32_t frameCount,
+			const VkAllocationCallbacks* pAllocator = nullptr);
+		void cleanup();
+
+		// Returns the bindless index of the texture, the view and sampler must outlive the material system
+		uint32_t addTexture(VkImageView view, VkSampler sampler);
+
+		// The pipeline is an opaque key of the caller, draws are grouped by it. Throws when all material IDs are in use.
+		uint32_t createMaterial(const MaterialParameters& parameters, uint32_t pipeline);
+		void updateMaterial(uint32_t materialId, const MaterialParameters& parameters);
+		void setMaterialPipeline(uint32_t materialId, uint32_t pipeline);
+		void destroyMaterial(uint32_t materialId);
+
+		/*
+		* Record the copies of the materials changed since the last upload, staged in the current frame region of the ring.
+		* Returns the bytes uploaded, the caller synchronizes the transfer writes with the shader reads of the buffer.
+		*/
+		VkDeviceSize upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing);
+
+		/*
+		* Point the set of a frame slot at the material buffer and the textures, only the writes missing from the set are
+		* done. Call once the frame slot's fence has signaled.
+		*/
+		void updateDescriptorSet(uint32_t frameIndex, VkDescriptorSet set, uint32_t materialBinding, uint32_t textureBinding);
+
+		// Orders the draws by pipeline then material ID, returns the number of pipeline changes along the sorted draws
+		uint32_t sortDraws(std::vector<MaterialDraw>& draws);
+
+		bool hasPendingUploads() const { return !m_dirtyMaterials.empty(); }
+		VkBuffer getBuffer() const { return m_buffer; }
+		const MaterialParameters& getParameters(uint32_t materialId) const { return m_parameters[materialId]; }
+		uint32_t getPipeline(uint32_t materialId) const { return m_pipelines[materialId]; }
+		uint32_t getMaterialCapacity() const { return static_cast<uint32_t>(m_parameters.size()); }
+		uint32_t getMaterialCount() const { return getMaterialCapacity() - static_cast<uint32_t>(m_freeMaterials.size()); }
+		uint32_t getTextureCapacity() const { return m_maxTextureCount; }
+		uint32_t getTextureCount() const { return static_cast<uint32_t>(m_textures.size()); }
+		const MaterialUploadStatistics& getStatistics() const { return m_statistics; }
+		void resetStatistics() { m_statistics = {}; }
+
+	private:
+		void markDirty(uint32_t materialId);
+
+		struct FrameDescriptorState
+		{
+			VkDescriptorSet set{ VK_NULL_HANDLE };
+			uint32_t        writtenTextureCount{ 0 };
+		};
+
+		VkDevice                            m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*        m_allocator{ nullptr };
+		VkBuffer                            m_buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory                      m_memory{ VK_NULL_HANDLE };
+		uint32_t                            m_maxTextureCount{ 0 };
+
+		std::vector<MaterialParameters>     m_parameters{};         // Host copy of the material buffer
+		std::vector<uint32_t>               m_pipelines{};
+		std::vector<uint32_t>               m_freeMaterials{};      // Popped from the back, lowest IDs first
+		std::vector<uint8_t>                m_dirty{};              // Per material, set while listed in m_dirtyMaterials
+		std::vector<uint32_t>               m_dirtyMaterials{};
+		std::vector<VkDescriptorImageInfo>  m_textures{};           // Append only, indices stay valid
+		std::vector<FrameDescriptorState>   m_frameStates{};
+
+		MaterialUploadStatistics            m_statistics{};
+		std::vector<VkBufferCopy>           m_copyRegions{};        // Reused by every upload
+		std::vector<std::pair<uint64_t, uint32_t>> m_sortKeys{};    // Reused by every sort
+	};
+} // namespace PVulkanExamples
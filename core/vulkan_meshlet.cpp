@@ -0,0 +1,309 @@
+#include "vulkan_meshlet.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t MESHLET_FILE_MAGIC = 0x4C4D5650;     // "PVML"
+		constexpr uint32_t MESHLET_FILE_VERSION = 1;
+		constexpr float MIN_CONE_SPREAD = 0.1f;     // Cosine of the widest normal deviation a cone still bounds
+
+		struct MeshletFileHeader
+		{
+			uint32_t    magic{ MESHLET_FILE_MAGIC };
+			uint32_t    version{ MESHLET_FILE_VERSION };
+			uint64_t    sourceHash{ 0 };
+			uint32_t    meshletCount{ 0 };
+			uint32_t    vertexIndexCount{ 0 };
+			uint32_t    triangleIndexSize{ 0 };
+			uint32_t    padding{ 0 };
+		};
+
+		struct Float3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Float3 operator-(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Float3 cross(const Float3& a, const Float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+		uint64_t hashBytes(uint64_t hash, const void* pData, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(pData);
+			for (size_t i = 0; i < size; i++)
+			{
+				hash = (hash ^ bytes[i]) * 0x100000001B3ull;    // FNV-1a
+			}
+			return hash;
+		}
+
+		/*
+		* Sphere around the bounding box of the meshlet vertices, cone around the normals of its triangles.
+		* The apex is moved back along the axis until every triangle plane is behind it, the cone of directions from which
+		* all triangles are back facing then starts at the apex.
+		*/
+		MeshletBounds computeBounds(const MeshletMesh& mesh, const Meshlet& meshlet, const float* pPositions, size_t vertexStride)
+		{
+			auto position = [&](uint32_t localVertex)
+			{
+				uint32_t vertex = mesh.vertexIndices[meshlet.vertexOffset + localVertex];
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * vertexStride);
+				return Float3{ p[0], p[1], p[2] };
+			};
+
+			Float3 minimum = position(0);
+			Float3 maximum = minimum;
+			for (uint32_t i = 1; i < meshlet.vertexCount; i++)
+			{
+				Float3 p = position(i);
+				minimum = { std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z) };
+				maximum = { std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z) };
+			}
+			Float3 center{ 0.5f * (minimum.x + maximum.x), 0.5f * (minimum.y + maximum.y), 0.5f * (minimum.z + maximum.z) };
+			float radius = 0.0f;
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				Float3 offset = position(i) - center;
+				radius = std::max(radius, std::sqrt(dot(offset, offset)));
+			}
+
+			MeshletBounds bounds{};
+			std::memcpy(bounds.center, &center, sizeof(bounds.center));
+			bounds.radius = radius;
+			std::memcpy(bounds.coneApex, &center, sizeof(bounds.coneApex));
+
+			std::vector<std::pair<Float3, Float3>> planes;     // Corner and unit normal of every triangle
+			planes.reserve(meshlet.triangleCount);
+			Float3 normalSum{};
+			const uint8_t* triangles = mesh.triangleIndices.data() + meshlet.triangleOffset;
+			for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				Float3 p0 = position(triangles[triangle * 3]);
+				Float3 normal = cross(position(triangles[triangle * 3 + 1]) - p0, position(triangles[triangle * 3 + 2]) - p0);
+				float length = std::sqrt(dot(normal, normal));
+				if (length == 0.0f) continue;
+				normal = { normal.x / length, normal.y / length, normal.z / length };
+				planes.emplace_back(p0, normal);
+				normalSum = { normalSum.x + normal.x, normalSum.y + normal.y, normalSum.z + normal.z };
+			}
+			float sumLength = std::sqrt(dot(normalSum, normalSum));
+			if (sumLength == 0.0f) return bounds;
+			Float3 axis{ normalSum.x / sumLength, normalSum.y / sumLength, normalSum.z / sumLength };
+
+			float minDot = 1.0f;
+			for (const auto& plane : planes) minDot = std::min(minDot, dot(plane.second, axis));
+			if (minDot <= MIN_CONE_SPREAD) return bounds;
+
+			float maxDistance = 0.0f;
+			for (const auto& plane : planes)
+			{
+				maxDistance = std::max(maxDistance, dot(center - plane.first, plane.second) / dot(axis, plane.second));
+			}
+			Float3 apex{ center.x - axis.x * maxDistance, center.y - axis.y * maxDistance, center.z - axis.z * maxDistance };
+			std::memcpy(bounds.coneApex, &apex, sizeof(bounds.coneApex));
+			std::memcpy(bounds.coneAxis, &axis, sizeof(bounds.coneAxis));
+			bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+			return bounds;
+		}
+	}
+
+	/*
+	* Connectivity uses vertices welded by position, meshes split vertices along hard edges and UV seams, which would
+	* otherwise cut them into many small meshlets.
+	*/
+	MeshletMesh MeshletBuilder::build(const float* pPositions, size_t vertexStride, size_t vertexCount, const uint32_t* pIndices, size_t indexCount,
+		const MeshletBuildSettings& settings)
+	{
+		if (settings.maxVertices < 3 || settings.maxVertices > 256 || settings.maxTriangles == 0 || settings.maxTriangles % 4 != 0)
+		{
+			throw std::runtime_error("meshlets need 3 to 256 vertices and a multiple of 4 triangles!");
+		}
+		auto position = [&](uint32_t vertex)
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + vertex * vertexStride);
+		};
+
+		// Weld vertices sharing a position, hashing the bits of the three floats
+		struct PositionHash
+		{
+			size_t operator()(const std::array<uint32_t, 3>& key) const { return key[0] * 73856093u ^ key[1] * 19349663u ^ key[2] * 83492791u; }
+		};
+		std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> welded;
+		std::vector<uint32_t> weldedVertex(vertexCount);
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			std::array<uint32_t, 3> key;
+			std::memcpy(key.data(), position(vertex), sizeof(key));
+			weldedVertex[vertex] = welded.emplace(key, static_cast<uint32_t>(welded.size())).first->second;
+		}
+
+		// Triangles around every welded vertex
+		size_t triangleCount = indexCount / 3;
+		std::vector<uint32_t> adjacencyOffsets(welded.size() + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			if (pIndices[i] >= vertexCount)
+			{
+				throw std::runtime_error("mesh index out of range of the vertices!");
+			}
+			adjacencyOffsets[weldedVertex[pIndices[i]] + 1]++;
+		}
+		for (size_t i = 1; i < adjacencyOffsets.size(); i++) adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> liveTriangles(welded.size(), 0);  // Triangles around the vertex not in a meshlet yet
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			uint32_t vertex = weldedVertex[pIndices[i]];
+			adjacency[adjacencyOffsets[vertex] + liveTriangles[vertex]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		MeshletMesh mesh{};
+		mesh.sourceHash = hashSource(pPositions, vertexStride, vertexCount, pIndices, indexCount, settings);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> localVertex(vertexCount, UINT32_MAX);
+		std::vector<uint32_t> candidates;   // Triangles sharing a vertex with the current meshlet, emitted ones are dropped lazily
+		Meshlet meshlet{};
+
+		auto newVertexCount = [&](uint32_t triangle)
+		{
+			uint32_t count = 0;
+			for (uint32_t corner = 0; corner < 3; corner++) count += localVertex[pIndices[triangle * 3 + corner]] == UINT32_MAX ? 1 : 0;
+			return count;
+		};
+		auto finish = [&]()
+		{
+			if (meshlet.triangleCount == 0) return;
+			mesh.bounds.push_back(computeBounds(mesh, meshlet, pPositions, vertexStride));
+			mesh.meshlets.push_back(meshlet);
+			mesh.triangleIndices.resize((mesh.triangleIndices.size() + 3) / 4 * 4, 0);
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++) localVertex[mesh.vertexIndices[meshlet.vertexOffset + i]] = UINT32_MAX;
+			meshlet = { static_cast<uint32_t>(mesh.vertexIndices.size()), static_cast<uint32_t>(mesh.triangleIndices.size()), 0, 0 };
+			candidates.clear();
+		};
+		auto append = [&](uint32_t triangle)
+		{
+			if (meshlet.vertexCount + newVertexCount(triangle) > settings.maxVertices || meshlet.triangleCount == settings.maxTriangles) finish();
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = pIndices[triangle * 3 + corner];
+				if (localVertex[vertex] == UINT32_MAX)
+				{
+					localVertex[vertex] = meshlet.vertexCount++;
+					mesh.vertexIndices.push_back(vertex);
+				}
+				mesh.triangleIndices.push_back(static_cast<uint8_t>(localVertex[vertex]));
+				uint32_t weldedCorner = weldedVertex[vertex];
+				liveTriangles[weldedCorner]--;
+				for (uint32_t i = adjacencyOffsets[weldedCorner]; i < adjacencyOffsets[weldedCorner + 1]; i++)
+				{
+					if (!emitted[adjacency[i]] && adjacency[i] != triangle) candidates.push_back(adjacency[i]);
+				}
+			}
+			emitted[triangle] = true;
+			meshlet.triangleCount++;
+		};
+
+		size_t seed = 0;
+		while (true)
+		{
+			// Fewest new vertices first, then the triangle whose vertices have the fewest triangles left, which closes holes
+			uint32_t best = UINT32_MAX;
+			uint32_t bestNewVertices = UINT32_MAX;
+			uint32_t bestLiveTriangles = UINT32_MAX;
+			size_t kept = 0;
+			for (uint32_t candidate : candidates)
+			{
+				if (emitted[candidate]) continue;
+				candidates[kept++] = candidate;
+				uint32_t newVertices = newVertexCount(candidate);
+				uint32_t live = 0;
+				for (uint32_t corner = 0; corner < 3; corner++) live += liveTriangles[weldedVertex[pIndices[candidate * 3 + corner]]];
+				if (newVertices < bestNewVertices || (newVertices == bestNewVertices && live < bestLiveTriangles))
+				{
+					best = candidate;
+					bestNewVertices = newVertices;
+					bestLiveTriangles = live;
+				}
+			}
+			candidates.resize(kept);
+
+			if (best == UINT32_MAX)
+			{
+				while (seed < triangleCount && emitted[seed]) seed++;
+				if (seed == triangleCount) break;
+				finish();
+				best = static_cast<uint32_t>(seed);
+			}
+			append(best);
+		}
+		finish();
+		return mesh;
+	}
+
+	uint64_t MeshletBuilder::hashSource(const float* pPositions, size_t vertexStride, size_t vertexCount, const uint32_t* pIndices, size_t indexCount,
+		const MeshletBuildSettings& settings)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			hash = hashBytes(hash, reinterpret_cast<const uint8_t*>(pPositions) + vertex * vertexStride, 3 * sizeof(float));
+		}
+		hash = hashBytes(hash, pIndices, indexCount * sizeof(uint32_t));
+		hash = hashBytes(hash, &settings.maxVertices, sizeof(settings.maxVertices));
+		return hashBytes(hash, &settings.maxTriangles, sizeof(settings.maxTriangles));
+	}
+
+	void MeshletBuilder::save(const std::string& path, const MeshletMesh& mesh)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("failed to write meshlet file " + path);
+		}
+		MeshletFileHeader header{};
+		header.sourceHash = mesh.sourceHash;
+		header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+		header.vertexIndexCount = static_cast<uint32_t>(mesh.vertexIndices.size());
+		header.triangleIndexSize = static_cast<uint32_t>(mesh.triangleIndices.size());
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+		file.write(reinterpret_cast<const char*>(mesh.bounds.data()), mesh.bounds.size() * sizeof(MeshletBounds));
+		file.write(reinterpret_cast<const char*>(mesh.vertexIndices.data()), mesh.vertexIndices.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(mesh.triangleIndices.data()), mesh.triangleIndices.size());
+	}
+
+	bool MeshletBuilder::load(const std::string& path, uint64_t sourceHash, MeshletMesh& mesh)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) return false;
+		MeshletFileHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != MESHLET_FILE_MAGIC || header.version != MESHLET_FILE_VERSION || header.sourceHash != sourceHash) return false;
+
+		mesh.sourceHash = header.sourceHash;
+		mesh.meshlets.resize(header.meshletCount);
+		mesh.bounds.resize(header.meshletCount);
+		mesh.vertexIndices.resize(header.vertexIndexCount);
+		mesh.triangleIndices.resize(header.triangleIndexSize);
+		file.read(reinterpret_cast<char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+		file.read(reinterpret_cast<char*>(mesh.bounds.data()), mesh.bounds.size() * sizeof(MeshletBounds));
+		file.read(reinterpret_cast<char*>(mesh.vertexIndices.data()), mesh.vertexIndices.size() * sizeof(uint32_t));
+		file.read(reinterpret_cast<char*>(mesh.triangleIndices.data()), mesh.triangleIndices.size());
+		if (!file)
+		{
+			throw std::runtime_error("truncated meshlet file " + path);
+		}
+		return true;
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// Matches the std430 layout shaders read meshlets with
+	struct Meshlet
+	{
+		uint32_t    vertexOffset{ 0 };      // First entry of the meshlet in MeshletMesh::vertexIndices
+		uint32_t    triangleOffset{ 0 };    // First byte of the meshlet in MeshletMesh::triangleIndices, a multiple of 4
+		uint32_t    vertexCount{ 0 };
+		uint32_t    triangleCount{ 0 };
+	};
+
+	/*
+	* Culling bounds in mesh space. The meshlet is outside the view when its sphere is, and facing away when
+	* dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff. Meshlets whose triangles face too many
+	* directions have a zero axis, which never passes the cone test.
+	*/
+	struct MeshletBounds
+	{
+		float   center[3]{};
+		float   radius{ 0.0f };
+		float   coneApex[3]{};
+		float   coneCutoff{ 1.0f };     // Sine of the cone half angle
+		float   coneAxis[3]{};
+		float   padding{ 0.0f };
+	};
+
+	struct MeshletBuildSettings
+	{
+		uint32_t    maxVertices{ 64 };
+		uint32_t    maxTriangles{ 124 };    // Multiple of 4 keeps a full meshlet's triangles word aligned
+	};
+
+	// Meshlets of an indexed triangle mesh, the vertex buffer of the mesh is used unchanged
+	struct MeshletMesh
+	{
+		std::vector<Meshlet>        meshlets{};
+		std::vector<MeshletBounds>  bounds{};
+		std::vector<uint32_t>       vertexIndices{};    // Mesh vertex of every meshlet vertex
+		std::vector<uint8_t>        triangleIndices{};  // Three meshlet vertices per triangle, each meshlet padded to 4 bytes
+		uint64_t                    sourceHash{ 0 };    // Positions, indices and settings the meshlets were built from
+	};
+
+	/*
+	* Offline meshlet preprocessing.
+	* build grows every meshlet from a seed triangle over shared edges, taking the adjacent triangle that adds the fewest
+	* vertices until the vertex or triangle limit is reached or no adjacent triangle is left, so meshlets stay compact
+	* and their bounds tight. Disconnected parts start new meshlets. Built meshlets are written to a file by save and
+	* read back by load, which rejects files built from other source data, so assets are split once and not on every run.
+	*/
+	class MeshletBuilder
+	{
+	public:
+		// Positions are three floats at the start of every vertexStride bytes
+		static MeshletMesh build(const float* pPositions, size_t vertexStride, size_t vertexCount, const uint32_t* pIndices, size_t indexCount,
+			const MeshletBuildSettings& settings = {});
+		static uint64_t hashSource(const float* pPositions, size_t vertexStride, size_t vertexCount, const uint32_t* pIndices, size_t indexCount,
+			const MeshletBuildSettings& settings = {});
+
+		static void save(const std::string& path, const MeshletMesh& mesh);
+		// False when the file does not exist or was built from other source data
+		static bool load(const std::string& path, uint64_t sourceHash, MeshletMesh& mesh);
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,1540 @@
+#include "vulkan_mock_driver.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_reflection_util.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Entry points the mock driver implements, every other entry point of the dispatch lists is a no-op returning VK_SUCCESS
+#define PVE_MOCK_IMPLEMENTED_FUNCTIONS(X) \
+	X(vkCreateInstance) \
+	X(vkEnumerateInstanceExtensionProperties) \
+	X(vkEnumerateInstanceLayerProperties) \
+	X(vkEnumerateInstanceVersion) \
+	X(vkDestroyInstance) \
+	X(vkEnumeratePhysicalDevices) \
+	X(vkEnumeratePhysicalDeviceGroups) \
+	X(vkGetPhysicalDeviceProperties) \
+	X(vkGetPhysicalDeviceProperties2) \
+	X(vkGetPhysicalDeviceFeatures) \
+	X(vkGetPhysicalDeviceFeatures2) \
+	X(vkGetPhysicalDeviceQueueFamilyProperties) \
+	X(vkGetPhysicalDeviceMemoryProperties) \
+	X(vkGetPhysicalDeviceFormatProperties) \
+	X(vkEnumerateDeviceExtensionProperties) \
+	X(vkCreateDevice) \
+	X(vkGetDeviceProcAddr) \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkDestroyDebugUtilsMessengerEXT) \
+	X(vkDestroyDevice) \
+	X(vkGetDeviceQueue) \
+	X(vkQueueSubmit) \
+	X(vkAllocateMemory) \
+	X(vkFreeMemory) \
+	X(vkMapMemory) \
+	X(vkCreateBuffer) \
+	X(vkDestroyBuffer) \
+	X(vkGetBufferMemoryRequirements) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkGetImageMemoryRequirements) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	X(vkCreateSampler) \
+	X(vkDestroySampler) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyShaderModule) \
+	X(vkCreatePipelineCache) \
+	X(vkDestroyPipelineCache) \
+	X(vkCreatePipelineLayout) \
+	X(vkDestroyPipelineLayout) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkCreateComputePipelines) \
+	X(vkCreateRayTracingPipelinesKHR) \
+	X(vkGetRayTracingShaderGroupHandlesKHR) \
+	X(vkDestroyPipeline) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkCreateDescriptorPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkResetDescriptorPool) \
+	X(vkAllocateDescriptorSets) \
+	X(vkFreeDescriptorSets) \
+	X(vkCreateFramebuffer) \
+	X(vkDestroyFramebuffer) \
+	X(vkCreateRenderPass) \
+	X(vkDestroyRenderPass) \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkFreeCommandBuffers) \
+	X(vkCreateFence) \
+	X(vkDestroyFence) \
+	X(vkResetFences) \
+	X(vkGetFenceStatus) \
+	X(vkWaitForFences) \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkCreateQueryPool) \
+	X(vkDestroyQueryPool) \
+	X(vkGetQueryPoolResults) \
+	X(vkGetBufferDeviceAddress) \
+	X(vkCreateAccelerationStructureKHR) \
+	X(vkDestroyAccelerationStructureKHR) \
+	X(vkGetAccelerationStructureBuildSizesKHR) \
+	X(vkGetAccelerationStructureDeviceAddressKHR) \
+	X(vkCmdWriteAccelerationStructuresPropertiesKHR)
+
+// No window system integration, these resolve to null like on a driver without the surface extensions
+#define PVE_MOCK_UNAVAILABLE_FUNCTIONS(X) \
+	X(vkDestroySurfaceKHR) \
+	X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+	X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+	X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+	X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR)
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		MockDriver* s_activeDriver{ nullptr };
+
+		struct MockInstance;
+		struct MockDevice;
+
+		struct MockPhysicalDevice
+		{
+			MockInstance*           instance;
+			MockPhysicalDeviceDesc  desc;
+		};
+
+		struct MockInstance
+		{
+			MockDriver*                                         driver;
+			std::vector<std::unique_ptr<MockPhysicalDevice>>    physicalDevices{};
+		};
+
+		struct MockQueue
+		{
+			MockDevice* device;
+			uint32_t    familyIndex;
+		};
+
+		struct MockDevice
+		{
+			MockDriver*                                                 driver;
+			MockPhysicalDevice*                                         physicalDevice;
+			std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<MockQueue>> queues{};
+			std::array<std::atomic<VkDeviceSize>, VK_MAX_MEMORY_HEAPS>  heapUsage{};
+			std::atomic<uint32_t>                                       allocationCount{ 0 };
+			std::atomic<VkDeviceAddress>                                nextAddress{ 0 };    // Buffers get disjoint device address ranges
+		};
+
+		struct MockMemory
+		{
+			VkDeviceSize            size;
+			uint32_t                heapIndex;
+			bool                    committed;  // Lazily allocated memory does not count against its heap
+			std::vector<uint8_t>    data{};       // Host visible memory only
+		};
+
+		struct MockBuffer
+		{
+			VkDeviceSize        size;
+			VkBufferUsageFlags  usage;
+			VkDeviceAddress     address;
+		};
+
+		struct MockImage
+		{
+			VkDeviceSize        size;
+			VkImageUsageFlags   usage;
+		};
+
+		// Objects without state
+		struct MockHandle
+		{
+			VkObjectType type;
+		};
+
+		struct MockDescriptorSetLayout
+		{
+			std::map<VkDescriptorType, uint32_t> descriptorCounts;
+		};
+
+		struct MockDescriptorPool;
+
+		struct MockDescriptorSet
+		{
+			MockDescriptorPool*                     pool;
+			std::map<VkDescriptorType, uint32_t>    descriptorCounts;
+		};
+
+		struct MockDescriptorPool
+		{
+			const VkAllocationCallbacks*            allocator;
+			VkDescriptorPoolCreateFlags             flags;
+			uint32_t                                maxSets;
+			std::map<VkDescriptorType, uint32_t>    capacity{};
+			std::map<VkDescriptorType, uint32_t>    used{};
+			std::set<MockDescriptorSet*>            sets{};
+		};
+
+		struct MockCommandPool;
+
+		struct MockCommandBuffer
+		{
+			MockCommandPool* pool;
+		};
+
+		struct MockCommandPool
+		{
+			const VkAllocationCallbacks*    allocator;
+			std::set<MockCommandBuffer*>    commandBuffers{};
+		};
+
+		struct MockFence
+		{
+			std::atomic<bool> signaled;
+		};
+
+		struct MockQueryPool
+		{
+			VkQueryType             type;
+			uint32_t                queryCount;
+			uint32_t                valueCount;     // Values per query, one unless pipeline statistics are queried
+			std::atomic<uint64_t>   readCount{ 0 };
+			std::vector<uint64_t>   properties{};     // Acceleration structure properties written when the command is recorded
+		};
+
+		struct MockAccelerationStructure
+		{
+			VkAccelerationStructureTypeKHR  type;
+			VkDeviceSize                    size;
+			VkDeviceAddress                 address;
+		};
+
+		template <typename T, typename Handle>
+		T* fromHandle(Handle handle)
+		{
+			return reinterpret_cast<T*>(handle);
+		}
+
+		template <typename Handle, typename T>
+		Handle toHandle(T* object)
+		{
+			return reinterpret_cast<Handle>(object);
+		}
+
+		/*
+		* Driver objects live in host memory from the application allocation callbacks, like on a real driver
+		*/
+		template <typename T, typename... Args>
+		T* createObject(const VkAllocationCallbacks* pAllocator, VkSystemAllocationScope scope, Args&&... args)
+		{
+			void* memory = pAllocator != nullptr
+				? pAllocator->pfnAllocation(pAllocator->pUserData, sizeof(T), alignof(T), scope)
+				: std::malloc(sizeof(T));
+			if (memory == nullptr) return nullptr;
+			return new (memory) T{ std::forward<Args>(args)... };
+		}
+
+		template <typename T>
+		void destroyObject(const VkAllocationCallbacks* pAllocator, T* object)
+		{
+			if (object == nullptr) return;
+			object->~T();
+			if (pAllocator != nullptr) pAllocator->pfnFree(pAllocator->pUserData, object);
+			else std::free(object);
+		}
+
+		/*
+		* Two call enumeration: report the count or copy up to the provided count
+		*/
+		template <typename T>
+		VkResult enumerate(const std::vector<T>& values, uint32_t* pCount, T* pValues)
+		{
+			if (pValues == nullptr)
+			{
+				*pCount = static_cast<uint32_t>(values.size());
+				return VK_SUCCESS;
+			}
+			uint32_t count = std::min(*pCount, static_cast<uint32_t>(values.size()));
+			std::copy(values.begin(), values.begin() + count, pValues);
+			*pCount = count;
+			return count < values.size() ? VK_INCOMPLETE : VK_SUCCESS;
+		}
+
+		std::vector<VkExtensionProperties> toExtensionProperties(const std::vector<std::string>& names)
+		{
+			std::vector<VkExtensionProperties> properties(names.size());
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				std::strncpy(properties[i].extensionName, names[i].c_str(), VK_MAX_EXTENSION_NAME_SIZE - 1);
+				properties[i].specVersion = 1;
+			}
+			return properties;
+		}
+
+		bool contains(const std::vector<std::string>& names, const char* name)
+		{
+			return std::find(names.begin(), names.end(), name) != names.end();
+		}
+
+		VkBool32* featureValues(VulkanStructCommon* featureStruct)
+		{
+			return reinterpret_cast<VkBool32*>(reinterpret_cast<uint8_t*>(featureStruct) + sizeof(VulkanStructCommon));
+		}
+
+		/*
+		* Report every feature of the known feature structs in the chain as supported unless the device disables it
+		*/
+		void fillFeatures(const MockPhysicalDeviceDesc& desc, void* pFeatures)
+		{
+			for (VulkanStructCommon* featureStruct = static_cast<VulkanStructCommon*>(pFeatures); featureStruct != nullptr;
+				featureStruct = static_cast<VulkanStructCommon*>(featureStruct->pNext))
+			{
+				std::vector<const char*> names = VulkanReflectionUtil::getVkBool32StructVector(featureStruct);
+				auto unsupported = desc.unsupportedFeatures.find(featureStruct->sType);
+				VkBool32* values = featureValues(featureStruct);
+				for (size_t i = 0; i < names.size(); i++)
+				{
+					values[i] = unsupported != desc.unsupportedFeatures.end() && unsupported->second.count(names[i]) > 0 ? VK_FALSE : VK_TRUE;
+				}
+			}
+		}
+
+		/*
+		* Whether every feature enabled in the chain is supported, like the driver check of vkCreateDevice
+		*/
+		bool featuresSupported(const MockPhysicalDeviceDesc& desc, const void* pFeatures)
+		{
+			for (const VulkanStructCommon* featureStruct = static_cast<const VulkanStructCommon*>(pFeatures); featureStruct != nullptr;
+				featureStruct = static_cast<const VulkanStructCommon*>(featureStruct->pNext))
+			{
+				auto unsupported = desc.unsupportedFeatures.find(featureStruct->sType);
+				if (unsupported == desc.unsupportedFeatures.end()) continue;
+				std::vector<const char*> names = VulkanReflectionUtil::getVkBool32StructVector(const_cast<VulkanStructCommon*>(featureStruct));
+				const VkBool32* values = featureValues(const_cast<VulkanStructCommon*>(featureStruct));
+				for (size_t i = 0; i < names.size(); i++)
+				{
+					if (values[i] == VK_TRUE && unsupported->second.count(names[i]) > 0) return false;
+				}
+			}
+			return true;
+		}
+
+		VkDeviceSize texelSize(VkFormat format)
+		{
+			switch (format)
+			{
+			case VK_FORMAT_R8_UNORM: case VK_FORMAT_R8_SNORM: case VK_FORMAT_R8_UINT: case VK_FORMAT_R8_SINT: case VK_FORMAT_R8_SRGB:
+			case VK_FORMAT_S8_UINT:
+				return 1;
+			case VK_FORMAT_R8G8_UNORM: case VK_FORMAT_R8G8_SNORM: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8_SINT:
+			case VK_FORMAT_R16_UNORM: case VK_FORMAT_R16_SNORM: case VK_FORMAT_R16_UINT: case VK_FORMAT_R16_SINT: case VK_FORMAT_R16_SFLOAT:
+			case VK_FORMAT_D16_UNORM: case VK_FORMAT_R5G6B5_UNORM_PACK16:
+				return 2;
+			case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SNORM: case VK_FORMAT_R16G16B16A16_UINT:
+			case VK_FORMAT_R16G16B16A16_SINT: case VK_FORMAT_R16G16B16A16_SFLOAT:
+			case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_SFLOAT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT: case VK_FORMAT_R64_UINT: case VK_FORMAT_R64_SINT: case VK_FORMAT_R64_SFLOAT:
+				return 8;
+			case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_SFLOAT:
+				return 12;
+			case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R32G32B32A32_SINT: case VK_FORMAT_R32G32B32A32_SFLOAT:
+				return 16;
+			default:
+				return 4;
+			}
+		}
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		/*
+		* Memory types a resource can be bound to, lazily allocated memory only backs transient attachments
+		*/
+		uint32_t memoryTypeBits(const MockPhysicalDeviceDesc& desc, bool transientAttachment)
+		{
+			uint32_t bits = 0;
+			for (uint32_t i = 0; i < desc.memoryProperties.memoryTypeCount; i++)
+			{
+				bool lazy = (desc.memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+				if (!lazy || transientAttachment) bits |= 1u << i;
+			}
+			return bits;
+		}
+
+		/*
+		* Entry point of the dispatch lists without a mock implementation, does nothing and succeeds
+		*/
+		template <typename T>
+		struct DefaultEntryPoint;
+
+		template <typename R, typename... Args>
+		struct DefaultEntryPoint<R (VKAPI_PTR*)(Args...)>
+		{
+			static VKAPI_ATTR R VKAPI_CALL call(Args...)
+			{
+				if constexpr (std::is_same_v<R, VkResult>) return VK_SUCCESS;
+				else if constexpr (!std::is_void_v<R>) return R{};
+			}
+		};
+
+		enum class EntryPointLevel
+		{
+			Global,
+			Instance,
+			Device,
+		};
+
+		struct EntryPoint
+		{
+			PFN_vkVoidFunction  function;
+			EntryPointLevel     level;
+		};
+
+		const std::unordered_map<std::string, EntryPoint>& getEntryPoints();
+	}
+
+	/*
+	* Mock implementations, named after the entry points they stand for
+	*/
+	struct MockEntryPoints
+	{
+		static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char* pName)
+		{
+			if (std::strcmp(pName, "vkGetInstanceProcAddr") == 0) return reinterpret_cast<PFN_vkVoidFunction>(&MockEntryPoints::vkGetInstanceProcAddr);
+			auto entryPoint = getEntryPoints().find(pName);
+			if (entryPoint == getEntryPoints().end()) return nullptr;
+			if (instance == VK_NULL_HANDLE && entryPoint->second.level != EntryPointLevel::Global) return nullptr;
+			return entryPoint->second.function;
+		}
+
+		static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice, const char* pName)
+		{
+			auto entryPoint = getEntryPoints().find(pName);
+			if (entryPoint == getEntryPoints().end() || entryPoint->second.level != EntryPointLevel::Device) return nullptr;
+			return entryPoint->second.function;
+		}
+
+		// Global
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance)
+		{
+			MockDriver* driver = s_activeDriver;
+			driver->simulateLatency("vkCreateInstance");
+			if (pCreateInfo->enabledLayerCount > 0) return VK_ERROR_LAYER_NOT_PRESENT;
+			for (uint32_t i = 0; i < pCreateInfo->enabledExtensionCount; i++)
+			{
+				if (!contains(driver->m_instanceExtensions, pCreateInfo->ppEnabledExtensionNames[i])) return VK_ERROR_EXTENSION_NOT_PRESENT;
+			}
+
+			MockInstance* instance = createObject<MockInstance>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE, driver);
+			if (instance == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			std::vector<MockPhysicalDeviceDesc> descs = driver->m_physicalDevices;
+			if (descs.empty()) descs.push_back(MockDriver::discreteGpu());
+			for (MockPhysicalDeviceDesc& desc : descs)
+			{
+				instance->physicalDevices.push_back(std::make_unique<MockPhysicalDevice>(MockPhysicalDevice{ instance, std::move(desc) }));
+			}
+			driver->trackObject(VK_OBJECT_TYPE_INSTANCE, 1);
+			*pInstance = toHandle<VkInstance>(instance);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+		{
+			if (pLayerName != nullptr) return VK_ERROR_LAYER_NOT_PRESENT;
+			return enumerate(toExtensionProperties(s_activeDriver->m_instanceExtensions), pPropertyCount, pProperties);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(uint32_t* pPropertyCount, VkLayerProperties*)
+		{
+			*pPropertyCount = 0;
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceVersion(uint32_t* pApiVersion)
+		{
+			*pApiVersion = s_activeDriver->m_apiVersion;
+			return VK_SUCCESS;
+		}
+
+		// Instance
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks* pAllocator)
+		{
+			if (instance == VK_NULL_HANDLE) return;
+			MockInstance* mockInstance = fromHandle<MockInstance>(instance);
+			mockInstance->driver->trackObject(VK_OBJECT_TYPE_INSTANCE, -1);
+			destroyObject(pAllocator, mockInstance);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices)
+		{
+			MockInstance* mockInstance = fromHandle<MockInstance>(instance);
+			mockInstance->driver->simulateLatency("vkEnumeratePhysicalDevices");
+			std::vector<VkPhysicalDevice> physicalDevices{};
+			for (const auto& physicalDevice : mockInstance->physicalDevices)
+			{
+				physicalDevices.push_back(toHandle<VkPhysicalDevice>(physicalDevice.get()));
+			}
+			return enumerate(physicalDevices, pPhysicalDeviceCount, pPhysicalDevices);
+		}
+
+		// Every physical device is its own group, linked adapters are not emulated
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instance, uint32_t* pPhysicalDeviceGroupCount,
+			VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties)
+		{
+			MockInstance* mockInstance = fromHandle<MockInstance>(instance);
+			uint32_t groupCount = static_cast<uint32_t>(mockInstance->physicalDevices.size());
+			if (pPhysicalDeviceGroupProperties == nullptr)
+			{
+				*pPhysicalDeviceGroupCount = groupCount;
+				return VK_SUCCESS;
+			}
+			uint32_t count = std::min(*pPhysicalDeviceGroupCount, groupCount);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				pPhysicalDeviceGroupProperties[i].physicalDeviceCount = 1;
+				pPhysicalDeviceGroupProperties[i].physicalDevices[0] = toHandle<VkPhysicalDevice>(mockInstance->physicalDevices[i].get());
+				pPhysicalDeviceGroupProperties[i].subsetAllocation = VK_FALSE;
+			}
+			*pPhysicalDeviceGroupCount = count;
+			return count < groupCount ? VK_INCOMPLETE : VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties* pProperties)
+		{
+			*pProperties = fromHandle<MockPhysicalDevice>(physicalDevice)->desc.properties;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2* pProperties)
+		{
+			pProperties->properties = fromHandle<MockPhysicalDevice>(physicalDevice)->desc.properties;
+			for (VulkanStructCommon* properties = static_cast<VulkanStructCommon*>(pProperties->pNext); properties != nullptr;
+				properties = static_cast<VulkanStructCommon*>(properties->pNext))
+			{
+				if (properties->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR)
+				{
+					auto* rayTracing = reinterpret_cast<VkPhysicalDeviceRayTracingPipelinePropertiesKHR*>(properties);
+					rayTracing->shaderGroupHandleSize = 32;
+					rayTracing->maxRayRecursionDepth = 31;
+					rayTracing->maxShaderGroupStride = 4096;
+					rayTracing->shaderGroupBaseAlignment = 64;
+					rayTracing->shaderGroupHandleCaptureReplaySize = 32;
+					rayTracing->maxRayDispatchInvocationCount = 1 << 30;
+					rayTracing->shaderGroupHandleAlignment = 32;
+					rayTracing->maxRayHitAttributeSize = 32;
+				}
+				else if (properties->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR)
+				{
+					auto* accelerationStructure = reinterpret_cast<VkPhysicalDeviceAccelerationStructurePropertiesKHR*>(properties);
+					accelerationStructure->maxGeometryCount = 1 << 24;
+					accelerationStructure->maxInstanceCount = 1 << 24;
+					accelerationStructure->maxPrimitiveCount = 1 << 29;
+					accelerationStructure->maxPerStageDescriptorAccelerationStructures = 16;
+					accelerationStructure->maxDescriptorSetAccelerationStructures = 16;
+					accelerationStructure->minAccelerationStructureScratchOffsetAlignment = 128;
+				}
+				else if (properties->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_NV)
+				{
+					auto* meshShader = reinterpret_cast<VkPhysicalDeviceMeshShaderPropertiesNV*>(properties);
+					meshShader->maxDrawMeshTasksCount = 65535;
+					meshShader->maxTaskWorkGroupInvocations = 32;
+					meshShader->maxTaskWorkGroupSize[0] = 32;
+					meshShader->maxTaskWorkGroupSize[1] = 1;
+					meshShader->maxTaskWorkGroupSize[2] = 1;
+					meshShader->maxTaskTotalMemorySize = 16384;
+					meshShader->maxTaskOutputCount = 65535;
+					meshShader->maxMeshWorkGroupInvocations = 32;
+					meshShader->maxMeshWorkGroupSize[0] = 32;
+					meshShader->maxMeshWorkGroupSize[1] = 1;
+					meshShader->maxMeshWorkGroupSize[2] = 1;
+					meshShader->maxMeshTotalMemorySize = 16384;
+					meshShader->maxMeshOutputVertices = 256;
+					meshShader->maxMeshOutputPrimitives = 512;
+					meshShader->maxMeshMultiviewViewCount = 4;
+					meshShader->meshOutputPerVertexGranularity = 32;
+					meshShader->meshOutputPerPrimitiveGranularity = 32;
+				}
+			}
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures* pFeatures)
+		{
+			VkPhysicalDeviceFeatures2 features{};
+			features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			fillFeatures(fromHandle<MockPhysicalDevice>(physicalDevice)->desc, &features);
+			*pFeatures = features.features;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* pFeatures)
+		{
+			fillFeatures(fromHandle<MockPhysicalDevice>(physicalDevice)->desc, pFeatures);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice, uint32_t* pQueueFamilyPropertyCount,
+			VkQueueFamilyProperties* pQueueFamilyProperties)
+		{
+			enumerate(fromHandle<MockPhysicalDevice>(physicalDevice)->desc.queueFamilies, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+		{
+			*pMemoryProperties = fromHandle<MockPhysicalDevice>(physicalDevice)->desc.memoryProperties;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFormatProperties(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatProperties* pFormatProperties)
+		{
+			const MockPhysicalDeviceDesc& desc = fromHandle<MockPhysicalDevice>(physicalDevice)->desc;
+			VkFormatFeatureFlags features = desc.unsupportedFormats.count(format) > 0 ? 0 : ~0u;
+			*pFormatProperties = { features, features, features };
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice, const char* pLayerName,
+			uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+		{
+			if (pLayerName != nullptr) return VK_ERROR_LAYER_NOT_PRESENT;
+			return enumerate(toExtensionProperties(fromHandle<MockPhysicalDevice>(physicalDevice)->desc.extensions), pPropertyCount, pProperties);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkDevice* pDevice)
+		{
+			MockPhysicalDevice* mockPhysicalDevice = fromHandle<MockPhysicalDevice>(physicalDevice);
+			const MockPhysicalDeviceDesc& desc = mockPhysicalDevice->desc;
+			MockDriver* driver = mockPhysicalDevice->instance->driver;
+			driver->simulateLatency("vkCreateDevice");
+
+			for (uint32_t i = 0; i < pCreateInfo->enabledExtensionCount; i++)
+			{
+				if (!contains(desc.extensions, pCreateInfo->ppEnabledExtensionNames[i])) return VK_ERROR_EXTENSION_NOT_PRESENT;
+			}
+			if (!featuresSupported(desc, pCreateInfo->pNext)) return VK_ERROR_FEATURE_NOT_PRESENT;
+			if (pCreateInfo->pEnabledFeatures != nullptr)
+			{
+				VkPhysicalDeviceFeatures2 features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, nullptr, *pCreateInfo->pEnabledFeatures };
+				if (!featuresSupported(desc, &features)) return VK_ERROR_FEATURE_NOT_PRESENT;
+			}
+			for (uint32_t i = 0; i < pCreateInfo->queueCreateInfoCount; i++)
+			{
+				const VkDeviceQueueCreateInfo& queueInfo = pCreateInfo->pQueueCreateInfos[i];
+				if (queueInfo.queueFamilyIndex >= desc.queueFamilies.size() ||
+					queueInfo.queueCount > desc.queueFamilies[queueInfo.queueFamilyIndex].queueCount)
+				{
+					return VK_ERROR_INITIALIZATION_FAILED;
+				}
+			}
+
+			MockDevice* device = createObject<MockDevice>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_DEVICE, driver, mockPhysicalDevice);
+			if (device == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			for (uint32_t i = 0; i < pCreateInfo->queueCreateInfoCount; i++)
+			{
+				const VkDeviceQueueCreateInfo& queueInfo = pCreateInfo->pQueueCreateInfos[i];
+				for (uint32_t queueIndex = 0; queueIndex < queueInfo.queueCount; queueIndex++)
+				{
+					device->queues[{ queueInfo.queueFamilyIndex, queueIndex }] = std::make_unique<MockQueue>(MockQueue{ device, queueInfo.queueFamilyIndex });
+				}
+			}
+			driver->trackObject(VK_OBJECT_TYPE_DEVICE, 1);
+			*pDevice = toHandle<VkDevice>(device);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT*,
+			const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pMessenger)
+		{
+			MockHandle* messenger = createObject<MockHandle>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT);
+			if (messenger == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			fromHandle<MockInstance>(instance)->driver->trackObject(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, 1);
+			*pMessenger = toHandle<VkDebugUtilsMessengerEXT>(messenger);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT messenger, const VkAllocationCallbacks* pAllocator)
+		{
+			if (messenger == VK_NULL_HANDLE) return;
+			fromHandle<MockInstance>(instance)->driver->trackObject(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT, -1);
+			destroyObject(pAllocator, fromHandle<MockHandle>(messenger));
+		}
+
+		// Device
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device, const VkAllocationCallbacks* pAllocator)
+		{
+			if (device == VK_NULL_HANDLE) return;
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_DEVICE, -1);
+			destroyObject(pAllocator, mockDevice);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue* pQueue)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			auto queue = mockDevice->queues.find({ queueFamilyIndex, queueIndex });
+			*pQueue = queue != mockDevice->queues.end() ? toHandle<VkQueue>(queue->second.get()) : VK_NULL_HANDLE;
+		}
+
+		// Work completes on submission
+		static VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t, const VkSubmitInfo*, VkFence fence)
+		{
+			fromHandle<MockQueue>(queue)->device->driver->simulateLatency("vkQueueSubmit");
+			if (fence != VK_NULL_HANDLE) fromHandle<MockFence>(fence)->signaled.store(true);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo,
+			const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkAllocateMemory");
+			const MockPhysicalDeviceDesc& desc = mockDevice->physicalDevice->desc;
+			if (pAllocateInfo->memoryTypeIndex >= desc.memoryProperties.memoryTypeCount) return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+			const VkMemoryType& memoryType = desc.memoryProperties.memoryTypes[pAllocateInfo->memoryTypeIndex];
+
+			if (mockDevice->allocationCount.fetch_add(1) >= desc.properties.limits.maxMemoryAllocationCount)
+			{
+				mockDevice->allocationCount.fetch_sub(1);
+				return VK_ERROR_TOO_MANY_OBJECTS;
+			}
+			bool committed = (memoryType.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) == 0;
+			if (committed)
+			{
+				VkDeviceSize heapSize = desc.memoryProperties.memoryHeaps[memoryType.heapIndex].size;
+				VkDeviceSize previousUsage = mockDevice->heapUsage[memoryType.heapIndex].fetch_add(pAllocateInfo->allocationSize);
+				if (previousUsage + pAllocateInfo->allocationSize > heapSize)
+				{
+					mockDevice->heapUsage[memoryType.heapIndex].fetch_sub(pAllocateInfo->allocationSize);
+					mockDevice->allocationCount.fetch_sub(1);
+					return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+				}
+			}
+
+			MockMemory* memory = createObject<MockMemory>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pAllocateInfo->allocationSize, memoryType.heapIndex, committed);
+			if (memory == nullptr)
+			{
+				if (committed) mockDevice->heapUsage[memoryType.heapIndex].fetch_sub(pAllocateInfo->allocationSize);
+				mockDevice->allocationCount.fetch_sub(1);
+				return VK_ERROR_OUT_OF_HOST_MEMORY;
+			}
+			if (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			{
+				memory->data.resize(static_cast<size_t>(pAllocateInfo->allocationSize));
+			}
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, 1);
+			*pMemory = toHandle<VkDeviceMemory>(memory);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator)
+		{
+			if (memory == VK_NULL_HANDLE) return;
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			MockMemory* mockMemory = fromHandle<MockMemory>(memory);
+			if (mockMemory->committed) mockDevice->heapUsage[mockMemory->heapIndex].fetch_sub(mockMemory->size);
+			mockDevice->allocationCount.fetch_sub(1);
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, -1);
+			destroyObject(pAllocator, mockMemory);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize,
+			VkMemoryMapFlags, void** ppData)
+		{
+			MockMemory* mockMemory = fromHandle<MockMemory>(memory);
+			if (mockMemory->data.empty()) return VK_ERROR_MEMORY_MAP_FAILED;
+			*ppData = mockMemory->data.data() + offset;
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(VkDevice device, const VkBufferCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkBuffer* pBuffer)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkCreateBuffer");
+			// Addresses start past zero, which stands for no address
+			VkDeviceAddress address = mockDevice->nextAddress.fetch_add(alignUp(pCreateInfo->size, 65536)) + 65536;
+			MockBuffer* buffer = createObject<MockBuffer>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pCreateInfo->size, pCreateInfo->usage, address);
+			if (buffer == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_BUFFER, 1);
+			*pBuffer = toHandle<VkBuffer>(buffer);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice device, VkBuffer buffer, const VkAllocationCallbacks* pAllocator)
+		{
+			if (buffer == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_BUFFER, -1);
+			destroyObject(pAllocator, fromHandle<MockBuffer>(buffer));
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice device, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements)
+		{
+			const MockBuffer* mockBuffer = fromHandle<MockBuffer>(buffer);
+			pMemoryRequirements->alignment = 256;
+			pMemoryRequirements->size = alignUp(mockBuffer->size, pMemoryRequirements->alignment);
+			pMemoryRequirements->memoryTypeBits = memoryTypeBits(fromHandle<MockDevice>(device)->physicalDevice->desc, false);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice device, const VkImageCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkImage* pImage)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkCreateImage");
+			VkDeviceSize size = 0;
+			for (uint32_t level = 0; level < pCreateInfo->mipLevels; level++)
+			{
+				size += VkDeviceSize(std::max(1u, pCreateInfo->extent.width >> level)) * std::max(1u, pCreateInfo->extent.height >> level) *
+					std::max(1u, pCreateInfo->extent.depth >> level);
+			}
+			size *= VkDeviceSize(pCreateInfo->arrayLayers) * pCreateInfo->samples * texelSize(pCreateInfo->format);
+
+			MockImage* image = createObject<MockImage>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, size, pCreateInfo->usage);
+			if (image == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_IMAGE, 1);
+			*pImage = toHandle<VkImage>(image);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks* pAllocator)
+		{
+			if (image == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_IMAGE, -1);
+			destroyObject(pAllocator, fromHandle<MockImage>(image));
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice device, VkImage image, VkMemoryRequirements* pMemoryRequirements)
+		{
+			const MockImage* mockImage = fromHandle<MockImage>(image);
+			pMemoryRequirements->alignment = 4096;
+			pMemoryRequirements->size = alignUp(mockImage->size, pMemoryRequirements->alignment);
+			pMemoryRequirements->memoryTypeBits = memoryTypeBits(fromHandle<MockDevice>(device)->physicalDevice->desc,
+				(mockImage->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0);
+		}
+
+		// Objects without state only need a unique handle
+
+		template <typename Handle>
+		static VkResult createHandle(VkDevice device, VkObjectType objectType, const VkAllocationCallbacks* pAllocator, Handle* pHandle)
+		{
+			MockHandle* object = createObject<MockHandle>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, objectType);
+			if (object == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			fromHandle<MockDevice>(device)->driver->trackObject(objectType, 1);
+			*pHandle = toHandle<Handle>(object);
+			return VK_SUCCESS;
+		}
+
+		template <typename Handle>
+		static void destroyHandle(VkDevice device, Handle handle, const VkAllocationCallbacks* pAllocator)
+		{
+			if (handle == VK_NULL_HANDLE) return;
+			MockHandle* object = fromHandle<MockHandle>(handle);
+			fromHandle<MockDevice>(device)->driver->trackObject(object->type, -1);
+			destroyObject(pAllocator, object);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(VkDevice device, const VkImageViewCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkImageView* pView)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_IMAGE_VIEW, pAllocator, pView);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice device, VkImageView imageView, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, imageView, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateSampler(VkDevice device, const VkSamplerCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkSampler* pSampler)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_SAMPLER, pAllocator, pSampler);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroySampler(VkDevice device, VkSampler sampler, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, sampler, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateShaderModule(VkDevice device, const VkShaderModuleCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkShaderModule* pShaderModule)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkCreateShaderModule");
+			return createHandle(device, VK_OBJECT_TYPE_SHADER_MODULE, pAllocator, pShaderModule);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyShaderModule(VkDevice device, VkShaderModule shaderModule, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, shaderModule, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreatePipelineCache(VkDevice device, const VkPipelineCacheCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkPipelineCache* pPipelineCache)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_PIPELINE_CACHE, pAllocator, pPipelineCache);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineCache(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, pipelineCache, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreatePipelineLayout(VkDevice device, const VkPipelineLayoutCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkPipelineLayout* pPipelineLayout)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_PIPELINE_LAYOUT, pAllocator, pPipelineLayout);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineLayout(VkDevice device, VkPipelineLayout pipelineLayout, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, pipelineLayout, pAllocator);
+		}
+
+		static VkResult createPipelines(VkDevice device, uint32_t createInfoCount, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+		{
+			for (uint32_t i = 0; i < createInfoCount; i++)
+			{
+				VkResult result = createHandle(device, VK_OBJECT_TYPE_PIPELINE, pAllocator, &pPipelines[i]);
+				if (result != VK_SUCCESS)
+				{
+					for (uint32_t j = i; j < createInfoCount; j++) pPipelines[j] = VK_NULL_HANDLE;
+					return result;
+				}
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice device, VkPipelineCache, uint32_t createInfoCount,
+			const VkGraphicsPipelineCreateInfo*, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkCreateGraphicsPipelines");
+			return createPipelines(device, createInfoCount, pAllocator, pPipelines);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(VkDevice device, VkPipelineCache, uint32_t createInfoCount,
+			const VkComputePipelineCreateInfo*, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkCreateComputePipelines");
+			return createPipelines(device, createInfoCount, pAllocator, pPipelines);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateRayTracingPipelinesKHR(VkDevice device, VkDeferredOperationKHR,
+			VkPipelineCache, uint32_t createInfoCount, const VkRayTracingPipelineCreateInfoKHR*,
+			const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkCreateRayTracingPipelinesKHR");
+			return createPipelines(device, createInfoCount, pAllocator, pPipelines);
+		}
+
+		/*
+		* Every byte of a group handle is the group index plus one
+		*/
+		static VKAPI_ATTR VkResult VKAPI_CALL vkGetRayTracingShaderGroupHandlesKHR(VkDevice, VkPipeline, uint32_t firstGroup,
+			uint32_t groupCount, size_t dataSize, void* pData)
+		{
+			constexpr size_t handleSize = 32;   // shaderGroupHandleSize reported by vkGetPhysicalDeviceProperties2
+			if (dataSize < groupCount * handleSize) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			for (uint32_t group = 0; group < groupCount; group++)
+			{
+				std::memset(static_cast<uint8_t*>(pData) + group * handleSize, static_cast<int>((firstGroup + group + 1) & 0xFF), handleSize);
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyPipeline(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, pipeline, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateDescriptorSetLayout(VkDevice device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkDescriptorSetLayout* pSetLayout)
+		{
+			MockDescriptorSetLayout* layout = createObject<MockDescriptorSetLayout>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+			if (layout == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			for (uint32_t i = 0; i < pCreateInfo->bindingCount; i++)
+			{
+				layout->descriptorCounts[pCreateInfo->pBindings[i].descriptorType] += pCreateInfo->pBindings[i].descriptorCount;
+			}
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, 1);
+			*pSetLayout = toHandle<VkDescriptorSetLayout>(layout);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout descriptorSetLayout, const VkAllocationCallbacks* pAllocator)
+		{
+			if (descriptorSetLayout == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, -1);
+			destroyObject(pAllocator, fromHandle<MockDescriptorSetLayout>(descriptorSetLayout));
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateDescriptorPool(VkDevice device, const VkDescriptorPoolCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkDescriptorPool* pDescriptorPool)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkCreateDescriptorPool");
+			MockDescriptorPool* pool = createObject<MockDescriptorPool>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pAllocator, pCreateInfo->flags, pCreateInfo->maxSets);
+			if (pool == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			for (uint32_t i = 0; i < pCreateInfo->poolSizeCount; i++)
+			{
+				pool->capacity[pCreateInfo->pPoolSizes[i].type] += pCreateInfo->pPoolSizes[i].descriptorCount;
+			}
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, 1);
+			*pDescriptorPool = toHandle<VkDescriptorPool>(pool);
+			return VK_SUCCESS;
+		}
+
+		static void freeDescriptorSet(MockDriver* driver, MockDescriptorPool* pool, MockDescriptorSet* set)
+		{
+			for (const auto& [type, count] : set->descriptorCounts) pool->used[type] -= count;
+			pool->sets.erase(set);
+			driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, -1);
+			destroyObject(pool->allocator, set);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkResetDescriptorPool(VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorPoolResetFlags)
+		{
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			MockDescriptorPool* pool = fromHandle<MockDescriptorPool>(descriptorPool);
+			while (!pool->sets.empty()) freeDescriptorSet(driver, pool, *pool->sets.begin());
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyDescriptorPool(VkDevice device, VkDescriptorPool descriptorPool, const VkAllocationCallbacks* pAllocator)
+		{
+			if (descriptorPool == VK_NULL_HANDLE) return;
+			vkResetDescriptorPool(device, descriptorPool, 0);
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, -1);
+			destroyObject(pAllocator, fromHandle<MockDescriptorPool>(descriptorPool));
+		}
+
+		// Fails with VK_ERROR_OUT_OF_POOL_MEMORY once the pool runs out of sets or descriptors of a type
+		static VKAPI_ATTR VkResult VKAPI_CALL vkAllocateDescriptorSets(VkDevice device, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets)
+		{
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			driver->simulateLatency("vkAllocateDescriptorSets");
+			MockDescriptorPool* pool = fromHandle<MockDescriptorPool>(pAllocateInfo->descriptorPool);
+
+			std::map<VkDescriptorType, uint32_t> required{};
+			for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; i++)
+			{
+				for (const auto& [type, count] : fromHandle<MockDescriptorSetLayout>(pAllocateInfo->pSetLayouts[i])->descriptorCounts) required[type] += count;
+			}
+			bool fits = pool->sets.size() + pAllocateInfo->descriptorSetCount <= pool->maxSets;
+			for (const auto& [type, count] : required)
+			{
+				fits = fits && pool->used[type] + count <= pool->capacity[type];
+			}
+			if (!fits)
+			{
+				for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; i++) pDescriptorSets[i] = VK_NULL_HANDLE;
+				return VK_ERROR_OUT_OF_POOL_MEMORY;
+			}
+
+			for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; i++)
+			{
+				const MockDescriptorSetLayout* layout = fromHandle<MockDescriptorSetLayout>(pAllocateInfo->pSetLayouts[i]);
+				MockDescriptorSet* set = createObject<MockDescriptorSet>(pool->allocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pool, layout->descriptorCounts);
+				if (set == nullptr)
+				{
+					for (uint32_t j = 0; j < i; j++) freeDescriptorSet(driver, pool, fromHandle<MockDescriptorSet>(pDescriptorSets[j]));
+					for (uint32_t j = 0; j < pAllocateInfo->descriptorSetCount; j++) pDescriptorSets[j] = VK_NULL_HANDLE;
+					return VK_ERROR_OUT_OF_HOST_MEMORY;
+				}
+				for (const auto& [type, count] : layout->descriptorCounts) pool->used[type] += count;
+				pool->sets.insert(set);
+				driver->trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET, 1);
+				pDescriptorSets[i] = toHandle<VkDescriptorSet>(set);
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkFreeDescriptorSets(VkDevice device, VkDescriptorPool descriptorPool, uint32_t descriptorSetCount,
+			const VkDescriptorSet* pDescriptorSets)
+		{
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			MockDescriptorPool* pool = fromHandle<MockDescriptorPool>(descriptorPool);
+			for (uint32_t i = 0; i < descriptorSetCount; i++)
+			{
+				if (pDescriptorSets[i] != VK_NULL_HANDLE) freeDescriptorSet(driver, pool, fromHandle<MockDescriptorSet>(pDescriptorSets[i]));
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateFramebuffer(VkDevice device, const VkFramebufferCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkFramebuffer* pFramebuffer)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_FRAMEBUFFER, pAllocator, pFramebuffer);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, framebuffer, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(VkDevice device, const VkRenderPassCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkRenderPass* pRenderPass)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_RENDER_PASS, pAllocator, pRenderPass);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(VkDevice device, VkRenderPass renderPass, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, renderPass, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(VkDevice device, const VkCommandPoolCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkCommandPool* pCommandPool)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkCreateCommandPool");
+			MockCommandPool* pool = createObject<MockCommandPool>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pAllocator);
+			if (pool == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_COMMAND_POOL, 1);
+			*pCommandPool = toHandle<VkCommandPool>(pool);
+			return VK_SUCCESS;
+		}
+
+		static void freeCommandBuffer(MockDriver* driver, MockCommandPool* pool, MockCommandBuffer* commandBuffer)
+		{
+			pool->commandBuffers.erase(commandBuffer);
+			driver->trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, -1);
+			destroyObject(pool->allocator, commandBuffer);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice device, VkCommandPool commandPool, const VkAllocationCallbacks* pAllocator)
+		{
+			if (commandPool == VK_NULL_HANDLE) return;
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			MockCommandPool* pool = fromHandle<MockCommandPool>(commandPool);
+			while (!pool->commandBuffers.empty()) freeCommandBuffer(driver, pool, *pool->commandBuffers.begin());
+			driver->trackObject(VK_OBJECT_TYPE_COMMAND_POOL, -1);
+			destroyObject(pAllocator, pool);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkAllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers)
+		{
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			driver->simulateLatency("vkAllocateCommandBuffers");
+			MockCommandPool* pool = fromHandle<MockCommandPool>(pAllocateInfo->commandPool);
+			for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++)
+			{
+				MockCommandBuffer* commandBuffer = createObject<MockCommandBuffer>(pool->allocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pool);
+				if (commandBuffer == nullptr)
+				{
+					for (uint32_t j = 0; j < i; j++) freeCommandBuffer(driver, pool, fromHandle<MockCommandBuffer>(pCommandBuffers[j]));
+					for (uint32_t j = 0; j < pAllocateInfo->commandBufferCount; j++) pCommandBuffers[j] = VK_NULL_HANDLE;
+					return VK_ERROR_OUT_OF_HOST_MEMORY;
+				}
+				pool->commandBuffers.insert(commandBuffer);
+				driver->trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, 1);
+				pCommandBuffers[i] = toHandle<VkCommandBuffer>(commandBuffer);
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkFreeCommandBuffers(VkDevice device, VkCommandPool commandPool, uint32_t commandBufferCount,
+			const VkCommandBuffer* pCommandBuffers)
+		{
+			MockDriver* driver = fromHandle<MockDevice>(device)->driver;
+			MockCommandPool* pool = fromHandle<MockCommandPool>(commandPool);
+			for (uint32_t i = 0; i < commandBufferCount; i++)
+			{
+				if (pCommandBuffers[i] != VK_NULL_HANDLE) freeCommandBuffer(driver, pool, fromHandle<MockCommandBuffer>(pCommandBuffers[i]));
+			}
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateFence(VkDevice device, const VkFenceCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkFence* pFence)
+		{
+			MockFence* fence = createObject<MockFence>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, (pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0);
+			if (fence == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_FENCE, 1);
+			*pFence = toHandle<VkFence>(fence);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyFence(VkDevice device, VkFence fence, const VkAllocationCallbacks* pAllocator)
+		{
+			if (fence == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_FENCE, -1);
+			destroyObject(pAllocator, fromHandle<MockFence>(fence));
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkResetFences(VkDevice, uint32_t fenceCount, const VkFence* pFences)
+		{
+			for (uint32_t i = 0; i < fenceCount; i++) fromHandle<MockFence>(pFences[i])->signaled.store(false);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkGetFenceStatus(VkDevice, VkFence fence)
+		{
+			return fromHandle<MockFence>(fence)->signaled.load() ? VK_SUCCESS : VK_NOT_READY;
+		}
+
+		// Nothing signals a fence after its submission, waiting on an unsignaled fence times out right away
+		static VKAPI_ATTR VkResult VKAPI_CALL vkWaitForFences(VkDevice device, uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkWaitForFences");
+			uint32_t signaledCount = 0;
+			for (uint32_t i = 0; i < fenceCount; i++)
+			{
+				if (fromHandle<MockFence>(pFences[i])->signaled.load()) signaledCount++;
+			}
+			bool done = waitAll ? signaledCount == fenceCount : signaledCount > 0;
+			return done ? VK_SUCCESS : VK_TIMEOUT;
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateSemaphore(VkDevice device, const VkSemaphoreCreateInfo*,
+			const VkAllocationCallbacks* pAllocator, VkSemaphore* pSemaphore)
+		{
+			return createHandle(device, VK_OBJECT_TYPE_SEMAPHORE, pAllocator, pSemaphore);
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroySemaphore(VkDevice device, VkSemaphore semaphore, const VkAllocationCallbacks* pAllocator)
+		{
+			destroyHandle(device, semaphore, pAllocator);
+		}
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateQueryPool(VkDevice device, const VkQueryPoolCreateInfo* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkQueryPool* pQueryPool)
+		{
+			uint32_t valueCount = pCreateInfo->queryType == VK_QUERY_TYPE_PIPELINE_STATISTICS
+				? static_cast<uint32_t>(std::bitset<32>(pCreateInfo->pipelineStatistics).count()) : 1;
+			MockQueryPool* pool = createObject<MockQueryPool>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, pCreateInfo->queryType, pCreateInfo->queryCount, valueCount);
+			if (pool == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			pool->properties.resize(pCreateInfo->queryCount);
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_QUERY_POOL, 1);
+			*pQueryPool = toHandle<VkQueryPool>(pool);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyQueryPool(VkDevice device, VkQueryPool queryPool, const VkAllocationCallbacks* pAllocator)
+		{
+			if (queryPool == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_QUERY_POOL, -1);
+			destroyObject(pAllocator, fromHandle<MockQueryPool>(queryPool));
+		}
+
+		/*
+		* Every query is available. Timestamps are 1000 ticks apart per query index and advance with every read,
+		* acceleration structure properties report what was last written, other queries report zero
+		*/
+		static VKAPI_ATTR VkResult VKAPI_CALL vkGetQueryPoolResults(VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount,
+			size_t, void* pData, VkDeviceSize stride, VkQueryResultFlags flags)
+		{
+			fromHandle<MockDevice>(device)->driver->simulateLatency("vkGetQueryPoolResults");
+			MockQueryPool* pool = fromHandle<MockQueryPool>(queryPool);
+			uint64_t base = (pool->readCount.fetch_add(1) + 1) * 1000000000ull;
+			bool wide = (flags & VK_QUERY_RESULT_64_BIT) != 0;
+			uint32_t valueCount = pool->valueCount + ((flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) ? 1 : 0);
+			for (uint32_t query = 0; query < queryCount; query++)
+			{
+				uint8_t* output = static_cast<uint8_t*>(pData) + query * stride;
+				for (uint32_t value = 0; value < valueCount; value++)
+				{
+					uint64_t result = 0;
+					if (value == pool->valueCount) result = 1;
+					else if (pool->type == VK_QUERY_TYPE_TIMESTAMP) result = base + uint64_t(firstQuery + query) * 1000;
+					else if (pool->type == VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR) result = pool->properties[firstQuery + query];
+					if (wide) reinterpret_cast<uint64_t*>(output)[value] = result;
+					else reinterpret_cast<uint32_t*>(output)[value] = static_cast<uint32_t>(result);
+				}
+			}
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR VkDeviceAddress VKAPI_CALL vkGetBufferDeviceAddress(VkDevice, const VkBufferDeviceAddressInfo* pInfo)
+		{
+			return fromHandle<MockBuffer>(pInfo->buffer)->address;
+		}
+
+		// Acceleration structures
+
+		static VKAPI_ATTR VkResult VKAPI_CALL vkCreateAccelerationStructureKHR(VkDevice device, const VkAccelerationStructureCreateInfoKHR* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator, VkAccelerationStructureKHR* pAccelerationStructure)
+		{
+			MockDevice* mockDevice = fromHandle<MockDevice>(device);
+			mockDevice->driver->simulateLatency("vkCreateAccelerationStructureKHR");
+			const MockBuffer* buffer = fromHandle<MockBuffer>(pCreateInfo->buffer);
+			if (pCreateInfo->offset + pCreateInfo->size > buffer->size) return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+			MockAccelerationStructure* structure = createObject<MockAccelerationStructure>(pAllocator, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
+				pCreateInfo->type, pCreateInfo->size, buffer->address + pCreateInfo->offset);
+			if (structure == nullptr) return VK_ERROR_OUT_OF_HOST_MEMORY;
+			mockDevice->driver->trackObject(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, 1);
+			*pAccelerationStructure = toHandle<VkAccelerationStructureKHR>(structure);
+			return VK_SUCCESS;
+		}
+
+		static VKAPI_ATTR void VKAPI_CALL vkDestroyAccelerationStructureKHR(VkDevice device, VkAccelerationStructureKHR accelerationStructure,
+			const VkAllocationCallbacks* pAllocator)
+		{
+			if (accelerationStructure == VK_NULL_HANDLE) return;
+			fromHandle<MockDevice>(device)->driver->trackObject(VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, -1);
+			destroyObject(pAllocator, fromHandle<MockAccelerationStructure>(accelerationStructure));
+		}
+
+		/*
+		* Sizes grow linearly with the primitive count: 64 bytes per triangle and 128 per instance, builds need half of that as scratch
+		* and updates an eighth
+		*/
+		static VKAPI_ATTR void VKAPI_CALL vkGetAccelerationStructureBuildSizesKHR(VkDevice, VkAccelerationStructureBuildTypeKHR,
+			const VkAccelerationStructureBuildGeometryInfoKHR* pBuildInfo, const uint32_t* pMaxPrimitiveCounts,
+			VkAccelerationStructureBuildSizesInfoKHR* pSizeInfo)
+		{
+			VkDeviceSize nodeSize = 0;
+			for (uint32_t i = 0; i < pBuildInfo->geometryCount; i++)
+			{
+				const VkAccelerationStructureGeometryKHR& geometry = pBuildInfo->pGeometries != nullptr ? pBuildInfo->pGeometries[i] : *pBuildInfo->ppGeometries[i];
+				nodeSize += VkDeviceSize(pMaxPrimitiveCounts[i]) * (geometry.geometryType == VK_GEOMETRY_TYPE_INSTANCES_KHR ? 128 : 64);
+			}
+			pSizeInfo->accelerationStructureSize = alignUp(nodeSize + 1024, 256);
+			pSizeInfo->buildScratchSize = alignUp(nodeSize / 2 + 256, 256);
+			pSizeInfo->updateScratchSize = alignUp(nodeSize / 8 + 256, 256);
+		}
+
+		static VKAPI_ATTR VkDeviceAddress VKAPI_CALL vkGetAccelerationStructureDeviceAddressKHR(VkDevice,
+			const VkAccelerationStructureDeviceAddressInfoKHR* pInfo)
+		{
+			return fromHandle<MockAccelerationStructure>(pInfo->accelerationStructure)->address;
+		}
+
+		/*
+		* Compacted BLASes take 5/8 of their size, TLASes do not shrink
+		*/
+		static VKAPI_ATTR void VKAPI_CALL vkCmdWriteAccelerationStructuresPropertiesKHR(VkCommandBuffer, uint32_t accelerationStructureCount,
+			const VkAccelerationStructureKHR* pAccelerationStructures, VkQueryType, VkQueryPool queryPool, uint32_t firstQuery)
+		{
+			MockQueryPool* pool = fromHandle<MockQueryPool>(queryPool);
+			for (uint32_t i = 0; i < accelerationStructureCount; i++)
+			{
+				const MockAccelerationStructure* structure = fromHandle<MockAccelerationStructure>(pAccelerationStructures[i]);
+				pool->properties[firstQuery + i] = structure->type == VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR
+					? alignUp(structure->size * 5 / 8, 256) : structure->size;
+			}
+		}
+	};
+
+	namespace
+	{
+		const std::unordered_map<std::string, EntryPoint>& getEntryPoints()
+		{
+			static const std::unordered_map<std::string, EntryPoint> entryPoints = []()
+			{
+				std::unordered_map<std::string, EntryPoint> table{};
+#define PVE_DEFAULT_ENTRY_POINT(name) table[#name] = { reinterpret_cast<PFN_vkVoidFunction>(&DefaultEntryPoint<PFN_##name>::call), level };
+				EntryPointLevel level = EntryPointLevel::Global;
+				PVE_VULKAN_GLOBAL_FUNCTIONS(PVE_DEFAULT_ENTRY_POINT)
+				level = EntryPointLevel::Instance;
+				PVE_VULKAN_INSTANCE_FUNCTIONS(PVE_DEFAULT_ENTRY_POINT)
+				level = EntryPointLevel::Device;
+				PVE_VULKAN_DEVICE_FUNCTIONS(PVE_DEFAULT_ENTRY_POINT)
+#undef PVE_DEFAULT_ENTRY_POINT
+
+#define PVE_MOCK_ENTRY_POINT(name) { PFN_##name function = &MockEntryPoints::name; table.at(#name).function = reinterpret_cast<PFN_vkVoidFunction>(function); }
+				PVE_MOCK_IMPLEMENTED_FUNCTIONS(PVE_MOCK_ENTRY_POINT)
+#undef PVE_MOCK_ENTRY_POINT
+
+#define PVE_MOCK_UNAVAILABLE_ENTRY_POINT(name) table.erase(#name);
+				PVE_MOCK_UNAVAILABLE_FUNCTIONS(PVE_MOCK_UNAVAILABLE_ENTRY_POINT)
+#undef PVE_MOCK_UNAVAILABLE_ENTRY_POINT
+				return table;
+			}();
+			return entryPoints;
+		}
+	}
+
+	PFN_vkGetInstanceProcAddr MockDriver::getInstanceProcAddr()
+	{
+		s_activeDriver = this;
+		return &MockEntryPoints::vkGetInstanceProcAddr;
+	}
+
+	int64_t MockDriver::getLiveObjectCount(VkObjectType objectType) const
+	{
+		std::lock_guard<std::mutex> lock(m_objectMutex);
+		auto count = m_liveObjects.find(objectType);
+		return count != m_liveObjects.end() ? count->second : 0;
+	}
+
+	int64_t MockDriver::getLiveObjectCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_objectMutex);
+		int64_t total = 0;
+		for (const auto& [type, count] : m_liveObjects) total += count;
+		return total;
+	}
+
+	VkDeviceSize MockDriver::getHeapUsage(VkDevice device, uint32_t heapIndex)
+	{
+		return fromHandle<MockDevice>(device)->heapUsage[heapIndex].load();
+	}
+
+	void MockDriver::simulateLatency(const char* entryPoint) const
+	{
+		if (m_latencies.empty()) return;
+		auto latency = m_latencies.find(entryPoint);
+		if (latency == m_latencies.end()) return;
+		auto end = std::chrono::steady_clock::now() + latency->second;
+		while (std::chrono::steady_clock::now() < end) {}
+	}
+
+	void MockDriver::trackObject(VkObjectType objectType, int64_t delta)
+	{
+		std::lock_guard<std::mutex> lock(m_objectMutex);
+		m_liveObjects[objectType] += delta;
+	}
+
+	namespace
+	{
+		VkPhysicalDeviceProperties defaultProperties(const char* name, VkPhysicalDeviceType type, uint32_t deviceId)
+		{
+			VkPhysicalDeviceProperties properties{};
+			properties.apiVersion = VK_API_VERSION_1_2;
+			properties.driverVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+			properties.vendorID = 0x10005;  // VK_VENDOR_ID_MESA, reserved for software implementations
+			properties.deviceID = deviceId;
+			properties.deviceType = type;
+			std::strncpy(properties.deviceName, name, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+
+			VkPhysicalDeviceLimits& limits = properties.limits;
+			limits.maxImageDimension1D = 16384;
+			limits.maxImageDimension2D = 16384;
+			limits.maxImageDimension3D = 2048;
+			limits.maxImageDimensionCube = 16384;
+			limits.maxImageArrayLayers = 2048;
+			limits.maxTexelBufferElements = 1u << 27;
+			limits.maxUniformBufferRange = 65536;
+			limits.maxStorageBufferRange = 1u << 30;
+			limits.maxPushConstantsSize = 256;
+			limits.maxMemoryAllocationCount = 4096;
+			limits.maxSamplerAllocationCount = 4000;
+			limits.bufferImageGranularity = 1024;
+			limits.maxBoundDescriptorSets = 8;
+			limits.maxPerStageDescriptorSamplers = 1u << 20;
+			limits.maxPerStageDescriptorUniformBuffers = 15;
+			limits.maxPerStageDescriptorStorageBuffers = 1u << 20;
+			limits.maxPerStageDescriptorSampledImages = 1u << 20;
+			limits.maxPerStageDescriptorStorageImages = 1u << 20;
+			limits.maxPerStageResources = 1u << 22;
+			limits.maxDescriptorSetSamplers = 1u << 20;
+			limits.maxDescriptorSetUniformBuffers = 90;
+			limits.maxDescriptorSetStorageBuffers = 1u << 20;
+			limits.maxDescriptorSetSampledImages = 1u << 20;
+			limits.maxDescriptorSetStorageImages = 1u << 20;
+			limits.maxVertexInputAttributes = 32;
+			limits.maxVertexInputBindings = 32;
+			limits.maxVertexOutputComponents = 128;
+			limits.maxFragmentOutputAttachments = 8;
+			limits.maxComputeSharedMemorySize = 49152;
+			limits.maxComputeWorkGroupCount[0] = limits.maxComputeWorkGroupCount[1] = limits.maxComputeWorkGroupCount[2] = 65535;
+			limits.maxComputeWorkGroupInvocations = 1024;
+			limits.maxComputeWorkGroupSize[0] = limits.maxComputeWorkGroupSize[1] = 1024;
+			limits.maxComputeWorkGroupSize[2] = 64;
+			limits.maxDrawIndexedIndexValue = UINT32_MAX;
+			limits.maxDrawIndirectCount = UINT32_MAX;
+			limits.maxSamplerAnisotropy = 16.0f;
+			limits.maxViewports = 16;
+			limits.maxViewportDimensions[0] = limits.maxViewportDimensions[1] = 16384;
+			limits.minMemoryMapAlignment = 64;
+			limits.minTexelBufferOffsetAlignment = 16;
+			limits.minUniformBufferOffsetAlignment = 256;
+			limits.minStorageBufferOffsetAlignment = 64;
+			limits.maxFramebufferWidth = 16384;
+			limits.maxFramebufferHeight = 16384;
+			limits.maxFramebufferLayers = 2048;
+			limits.framebufferColorSampleCounts = VK_SAMPLE_COUNT_1_BIT | VK_SAMPLE_COUNT_4_BIT | VK_SAMPLE_COUNT_8_BIT;
+			limits.framebufferDepthSampleCounts = limits.framebufferColorSampleCounts;
+			limits.maxColorAttachments = 8;
+			limits.timestampComputeAndGraphics = VK_TRUE;
+			limits.timestampPeriod = 1.0f;
+			limits.optimalBufferCopyOffsetAlignment = 1;
+			limits.optimalBufferCopyRowPitchAlignment = 1;
+			limits.nonCoherentAtomSize = 64;
+			return properties;
+		}
+
+		std::vector<std::string> defaultDeviceExtensions()
+		{
+			return {
+				VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+				VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,
+				VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
+				VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+				VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+				VK_NV_MESH_SHADER_EXTENSION_NAME,
+			};
+		}
+
+		void addMemoryType(VkPhysicalDeviceMemoryProperties& memoryProperties, VkMemoryPropertyFlags flags, uint32_t heapIndex)
+		{
+			memoryProperties.memoryTypes[memoryProperties.memoryTypeCount++] = { flags, heapIndex };
+		}
+	}
+
+	/*
+	* Discrete GPU: a graphics queue family, an async compute family and a transfer family,
+	* 8 GiB of device local memory with a 256 MiB host visible window and 16 GiB of host memory
+	*/
+	MockPhysicalDeviceDesc MockDriver::discreteGpu(const char* name)
+	{
+		MockPhysicalDeviceDesc desc{};
+		desc.properties = defaultProperties(name, VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, 1);
+		desc.queueFamilies = {
+			{ VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 16, 64, { 1, 1, 1 } },
+			{ VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 8, 64, { 1, 1, 1 } },
+			{ VK_QUEUE_TRANSFER_BIT, 2, 64, { 1, 1, 1 } },
+		};
+
+		VkPhysicalDeviceMemoryProperties& memory = desc.memoryProperties;
+		memory.memoryHeapCount = 3;
+		memory.memoryHeaps[0] = { 8ull << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		memory.memoryHeaps[1] = { 16ull << 30, 0 };
+		memory.memoryHeaps[2] = { 256ull << 20, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 2);
+
+		desc.extensions = defaultDeviceExtensions();
+		return desc;
+	}
+
+	/*
+	* Integrated GPU: a single queue family, one heap of unified memory with a lazily allocated memory type, no ray tracing
+	*/
+	MockPhysicalDeviceDesc MockDriver::integratedGpu(const char* name)
+	{
+		MockPhysicalDeviceDesc desc{};
+		desc.properties = defaultProperties(name, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, 2);
+		desc.queueFamilies = {
+			{ VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 1, 64, { 1, 1, 1 } },
+		};
+
+		VkPhysicalDeviceMemoryProperties& memory = desc.memoryProperties;
+		memory.memoryHeapCount = 1;
+		memory.memoryHeaps[0] = { 4ull << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 0);
+		addMemoryType(memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, 0);
+
+		// No ray tracing
+		desc.extensions = { VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
+		return desc;
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	/*
+	* Physical device reported by the mock driver
+	*/
+	struct MockPhysicalDeviceDesc
+	{
+		VkPhysicalDeviceProperties                          properties{};
+		std::vector<VkQueueFamilyProperties>                queueFamilies{};
+		VkPhysicalDeviceMemoryProperties                    memoryProperties{};
+		std::vector<std::string>                            extensions{};
+		// Every feature known to VulkanReflectionUtil is reported supported except these, per feature struct type
+		std::map<VkStructureType, std::set<std::string>>    unsupportedFeatures{};
+		// Formats reporting no format features, every other format supports everything
+		std::set<VkFormat>                                  unsupportedFormats{};
+
+		MockPhysicalDeviceDesc& disableFeature(VkStructureType featureStructType, const char* feature)
+		{
+			unsupportedFeatures[featureStructType].insert(feature);
+			return *this;
+		}
+	};
+
+	/*
+	* In-process Vulkan driver for machines without a GPU, reached through VulkanDispatch.
+	* Emulates the configured physical devices, their feature structs, queue families, memory types and extensions,
+	* enforces heap sizes and descriptor pool capacities, and creates objects with the application allocation callbacks.
+	* Nothing is executed: command buffer recording is ignored apart from acceleration structure property writes,
+	* submissions signal their fence immediately and query results are available as soon as they are read.
+	* Latencies configured per entry point are spent busy waiting so timings stay deterministic.
+	*/
+	class MockDriver
+	{
+	public:
+		MockDriver() = default;
+		MockDriver(const MockDriver&) = delete;
+		MockDriver& operator=(const MockDriver&) = delete;
+
+		// Hand the result to VulkanDispatch::init, the driver must outlive every instance created through it
+		PFN_vkGetInstanceProcAddr getInstanceProcAddr();
+
+		void setLatency(const std::string& entryPoint, std::chrono::nanoseconds latency) { m_latencies[entryPoint] = latency; }
+
+		// Objects created through the driver and not destroyed yet, for leak checks
+		int64_t getLiveObjectCount(VkObjectType objectType) const;
+		int64_t getLiveObjectCount() const;
+		static VkDeviceSize getHeapUsage(VkDevice device, uint32_t heapIndex);
+
+		static MockPhysicalDeviceDesc discreteGpu(const char* name = "Mock Discrete GPU");
+		static MockPhysicalDeviceDesc integratedGpu(const char* name = "Mock Integrated GPU");
+
+	public:
+		// Settings, change them before the instance is created
+		std::vector<MockPhysicalDeviceDesc> m_physicalDevices{};       // A discrete GPU is reported when empty
+		std::vector<std::string>            m_instanceExtensions{ VK_EXT_DEBUG_UTILS_EXTENSION_NAME, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
+		uint32_t                            m_apiVersion{ VK_API_VERSION_1_2 };
+
+	private:
+		friend struct MockEntryPoints;
+
+		void simulateLatency(const char* entryPoint) const;
+		void trackObject(VkObjectType objectType, int64_t delta);
+
+	private:
+		std::unordered_map<std::string, std::chrono::nanoseconds>   m_latencies{};
+		mutable std::mutex                                          m_objectMutex{};
+		std::map<VkObjectType, int64_t>                             m_liveObjects{};
+	};
+} // namespace PVulkanExamples
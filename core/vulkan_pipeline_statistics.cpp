@@ -0,0 +1,227 @@
+#include "vulkan_pipeline_statistics.h"
+#include "vulkan_dispatch.h"
+
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		// Results are written in the order of the flag bits
+		const VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+		const uint32_t STATISTIC_COUNT = 7;
+		const uint32_t STATISTIC_STRIDE = STATISTIC_COUNT + 1;  // Availability word after the values
+	}
+
+	void PipelineStatisticsCollector::init(VkDevice device, const VkPhysicalDeviceFeatures& enabledFeatures, uint32_t maxFrameInFlight,
+		const VkAllocationCallbacks* pAllocator, uint32_t maxScopesPerFrame)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+		m_maxScopesPerFrame = maxScopesPerFrame;
+		m_statisticsSupported = enabledFeatures.pipelineStatisticsQuery == VK_TRUE;
+		m_occlusionPrecise = enabledFeatures.occlusionQueryPrecise == VK_TRUE;
+		if (!m_statisticsSupported) return;
+
+		VkQueryPoolCreateInfo statisticsPoolInfo{};
+		statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		statisticsPoolInfo.queryCount = m_maxScopesPerFrame;
+		statisticsPoolInfo.pipelineStatistics = STATISTIC_FLAGS;
+
+		VkQueryPoolCreateInfo occlusionPoolInfo{};
+		occlusionPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		occlusionPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+		occlusionPoolInfo.queryCount = m_maxScopesPerFrame;
+
+		m_frames.resize(maxFrameInFlight);
+		for (FrameQueries& frame : m_frames)
+		{
+			if (vkd.vkCreateQueryPool(m_device, &statisticsPoolInfo, m_allocator, &frame.statisticsPool) != VK_SUCCESS ||
+				vkd.vkCreateQueryPool(m_device, &occlusionPoolInfo, m_allocator, &frame.occlusionPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create pipeline statistics query pool!");
+			}
+			frame.scopes.reserve(m_maxScopesPerFrame);
+		}
+		m_results.resize(size_t(m_maxScopesPerFrame) * STATISTIC_STRIDE);
+	}
+
+	void PipelineStatisticsCollector::cleanup()
+	{
+		for (FrameQueries& frame : m_frames)
+		{
+			vkd.vkDestroyQueryPool(m_device, frame.statisticsPool, m_allocator);
+			vkd.vkDestroyQueryPool(m_device, frame.occlusionPool, m_allocator);
+		}
+		m_frames.clear();
+		m_latestResults.clear();
+		m_statisticsSupported = false;
+	}
+
+	/*
+	* Publish the results of completed frames, oldest first, then reset the queries of the reused slot.
+	* Call after waiting on the slot's fence, at the start of command buffer recording.
+	*/
+	void PipelineStatisticsCollector::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (!m_statisticsSupported) return;
+
+		uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+		for (uint32_t i = 1; i <= frameCount; i++)
+		{
+			// The reused slot is the oldest frame, the others may still be executing and are only read when available
+			FrameQueries& frame = m_frames[(frameIndex + i) % frameCount];
+			if (frame.pending) collect(frame, &frame == &m_frames[frameIndex]);
+		}
+
+		m_currentFrame = frameIndex;
+		FrameQueries& frame = m_frames[frameIndex];
+		frame.scopes.clear();
+		frame.pending = false;
+		frame.frame = m_frameCounter++;
+		m_statisticsScopeOpen = false;
+		m_occlusionScopeOpen = false;
+		vkd.vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, m_maxScopesPerFrame);
+		vkd.vkCmdResetQueryPool(commandBuffer, frame.occlusionPool, 0, m_maxScopesPerFrame);
+	}
+
+	uint32_t PipelineStatisticsCollector::beginScope(VkCommandBuffer commandBuffer, const char* name, bool withOcclusion)
+	{
+		if (!m_statisticsSupported) return UINT32_MAX;
+
+		// Queries of one type cannot nest, an open scope would leave the results of both undefined
+		if (m_statisticsScopeOpen || (withOcclusion && m_occlusionScopeOpen))
+		{
+			throw std::runtime_error(std::string("failed to begin query scope ") + name + ", a scope of the same query type is still open!");
+		}
+		FrameQueries& frame = m_frames[m_currentFrame];
+		if (frame.scopes.size() >= m_maxScopesPerFrame) return UINT32_MAX;
+		uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+		frame.scopes.push_back({ name, withOcclusion });
+		frame.pending = true;
+		m_statisticsScopeOpen = true;
+		m_occlusionScopeOpen = withOcclusion;
+		vkd.vkCmdBeginQuery(commandBuffer, frame.statisticsPool, scope, 0);
+		if (withOcclusion)
+		{
+			vkd.vkCmdBeginQuery(commandBuffer, frame.occlusionPool, scope, m_occlusionPrecise ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+		}
+		return scope;
+	}
+
+	void PipelineStatisticsCollector::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+	{
+		if (!m_statisticsSupported || scope == UINT32_MAX) return;
+
+		FrameQueries& frame = m_frames[m_currentFrame];
+		Scope& frameScope = frame.scopes[scope];
+		if (frameScope.withOcclusion)
+		{
+			vkd.vkCmdEndQuery(commandBuffer, frame.occlusionPool, scope);
+		}
+		vkd.vkCmdEndQuery(commandBuffer, frame.statisticsPool, scope);
+		m_statisticsScopeOpen = false;
+		m_occlusionScopeOpen = false;
+	}
+
+	/*
+	* Read the results of a frame without waiting, nothing is published until every scope of the frame is available.
+	* The reused slot has finished executing, if its results are still unavailable they are dropped.
+	*/
+	bool PipelineStatisticsCollector::collect(FrameQueries& frame, bool complete)
+	{
+		uint32_t scopeCount = static_cast<uint32_t>(frame.scopes.size());
+		std::vector<PassStatistics> results(scopeCount);
+
+		VkResult result = vkd.vkGetQueryPoolResults(m_device, frame.statisticsPool, 0, scopeCount,
+			sizeof(uint64_t) * STATISTIC_STRIDE * scopeCount, m_results.data(), sizeof(uint64_t) * STATISTIC_STRIDE,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		bool available = result == VK_SUCCESS;
+		for (uint32_t i = 0; i < scopeCount && available; i++)
+		{
+			const uint64_t* values = &m_results[size_t(i) * STATISTIC_STRIDE];
+			available = values[STATISTIC_COUNT] != 0;
+			results[i].name = frame.scopes[i].name;
+			results[i].statistics = { values[0], values[1], values[2], values[3], values[4], values[5], values[6] };
+		}
+		for (uint32_t i = 0; i < scopeCount && available; i++)
+		{
+			if (!frame.scopes[i].withOcclusion) continue;
+			uint64_t occlusion[2] = {};
+			result = vkd.vkGetQueryPoolResults(m_device, frame.occlusionPool, i, 1, sizeof(occlusion), occlusion, sizeof(occlusion),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			available = result == VK_SUCCESS && occlusion[1] != 0;
+			results[i].hasSamplesPassed = true;
+			results[i].samplesPassed = occlusion[0];
+		}
+
+		if (!available)
+		{
+			if (complete) frame.pending = false;
+			return false;
+		}
+		frame.pending = false;
+
+		// Scopes never nest, the frame total is the sum of its passes
+		PassStatistics total{};
+		total.name = "Frame";
+		for (const PassStatistics& pass : results)
+		{
+			total.statistics.inputAssemblyVertices += pass.statistics.inputAssemblyVertices;
+			total.statistics.inputAssemblyPrimitives += pass.statistics.inputAssemblyPrimitives;
+			total.statistics.vertexShaderInvocations += pass.statistics.vertexShaderInvocations;
+			total.statistics.clippingInvocations += pass.statistics.clippingInvocations;
+			total.statistics.clippingPrimitives += pass.statistics.clippingPrimitives;
+			total.statistics.fragmentShaderInvocations += pass.statistics.fragmentShaderInvocations;
+			total.statistics.computeShaderInvocations += pass.statistics.computeShaderInvocations;
+		}
+		if (!results.empty()) results.push_back(total);
+
+		if (frame.frame >= m_latestResultsFrame || m_latestResults.empty())
+		{
+			m_latestResults = std::move(results);
+			m_latestResultsFrame = frame.frame;
+		}
+		return true;
+	}
+
+	/*
+	* Fragment shader invocations per pixel of the target, values above one indicate overdraw
+	*/
+	double PipelineStatisticsCollector::fragmentInvocationsPerPixel(const PassStatistics& pass, VkExtent2D extent)
+	{
+		uint64_t pixelCount = uint64_t(extent.width) * extent.height;
+		return pixelCount > 0 ? double(pass.statistics.fragmentShaderInvocations) / pixelCount : 0.0;
+	}
+
+	void PipelineStatisticsCollector::printStatistics(VkExtent2D extent) const
+	{
+		std::cout << "\n=============================Pipeline statistics (frame " << m_latestResultsFrame << ")=============================";
+		std::cout << "\n" << std::setw(24) << std::left << "pass" << std::right
+			<< std::setw(12) << "ia verts" << std::setw(12) << "ia prims" << std::setw(12) << "vs inv"
+			<< std::setw(12) << "clip inv" << std::setw(12) << "clip prims" << std::setw(12) << "fs inv"
+			<< std::setw(12) << "cs inv" << std::setw(12) << "fs/pixel" << std::setw(12) << "samples";
+		for (const PassStatistics& pass : m_latestResults)
+		{
+			const PipelineStatistics& s = pass.statistics;
+			std::cout << "\n" << std::setw(24) << std::left << pass.name << std::right
+				<< std::setw(12) << s.inputAssemblyVertices << std::setw(12) << s.inputAssemblyPrimitives << std::setw(12) << s.vertexShaderInvocations
+				<< std::setw(12) << s.clippingInvocations << std::setw(12) << s.clippingPrimitives << std::setw(12) << s.fragmentShaderInvocations
+				<< std::setw(12) << s.computeShaderInvocations
+				<< std::setw(12) << std::fixed << std::setprecision(2) << fragmentInvocationsPerPixel(pass, extent) << std::defaultfloat
+				<< std::setw(12) << (pass.hasSamplesPassed ? std::to_string(pass.samplesPassed) : "-");
+		}
+		std::cout << std::endl;
+	}
+} // namespace PVulkanExamples
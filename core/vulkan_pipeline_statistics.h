@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <string>
+
+namespace PVulkanExamples
+{
+	struct PipelineStatistics
+	{
+		uint64_t inputAssemblyVertices{ 0 };
+		uint64_t inputAssemblyPrimitives{ 0 };
+		uint64_t vertexShaderInvocations{ 0 };
+		uint64_t clippingInvocations{ 0 };
+		uint64_t clippingPrimitives{ 0 };
+		uint64_t fragmentShaderInvocations{ 0 };
+		uint64_t computeShaderInvocations{ 0 };
+	};
+
+	struct PassStatistics
+	{
+		std::string         name{};
+		PipelineStatistics  statistics{};
+		bool                hasSamplesPassed{ false };
+		uint64_t            samplesPassed{ 0 };     // Occlusion query result, exact when occlusionQueryPrecise is enabled
+	};
+
+	/*
+	* Pipeline statistics and occlusion queries per render pass.
+	* Every frame in flight owns its query pools. At the start of each frame the results of earlier frames are
+	* read back without waiting, usually one frame late, and the slot being reused is guaranteed complete by its fence.
+	* Scopes must be recorded on a graphics queue command buffer and cannot span render pass boundaries. Scopes cannot
+	* nest, beginScope throws while another scope is open. The results end with a "Frame" entry summing all scopes.
+	*/
+	class PipelineStatisticsCollector
+	{
+	public:
+		void init(VkDevice device, const VkPhysicalDeviceFeatures& enabledFeatures, uint32_t maxFrameInFlight,
+			const VkAllocationCallbacks* pAllocator, uint32_t maxScopesPerFrame = 32);
+		void cleanup();
+		bool isSupported() const { return m_statisticsSupported; }
+
+		void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+		uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name, bool withOcclusion = false);
+		void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+		const std::vector<PassStatistics>& getLatestResults() const { return m_latestResults; }
+		uint64_t getLatestResultsFrame() const { return m_latestResultsFrame; }
+		void printStatistics(VkExtent2D extent) const;
+
+		static double fragmentInvocationsPerPixel(const PassStatistics& pass, VkExtent2D extent);
+
+	private:
+		struct Scope
+		{
+			const char* name{ nullptr };    // Expected to outlive the frame, typically a string literal
+			bool        withOcclusion{ false };
+		};
+
+		struct FrameQueries
+		{
+			VkQueryPool         statisticsPool{ VK_NULL_HANDLE };
+			VkQueryPool         occlusionPool{ VK_NULL_HANDLE };
+			std::vector<Scope>  scopes{};
+			uint64_t            frame{ 0 };
+			bool                pending{ false };
+		};
+
+		bool collect(FrameQueries& frame, bool complete);
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		bool                            m_statisticsSupported{ false };
+		bool                            m_occlusionPrecise{ false };
+		uint32_t                        m_maxScopesPerFrame{ 0 };
+		uint32_t                        m_currentFrame{ 0 };
+		uint64_t                        m_frameCounter{ 0 };
+		bool                            m_statisticsScopeOpen{ false };
+		bool                            m_occlusionScopeOpen{ false };
+
+		std::vector<FrameQueries>       m_frames{};
+		std::vector<uint64_t>           m_results{};
+		std::vector<PassStatistics>     m_latestResults{};
+		uint64_t                        m_latestResultsFrame{ 0 };
+	};
+} // namespace PVulkanExamples
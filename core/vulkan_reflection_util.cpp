@@ -1,4 +1,5 @@
 #include "vulkan_reflection_util.h"
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 
@@ -111,6 +112,18 @@ namespace PVulkanExamples {
 		{ "rayTracingPipeline", 0 }, { "rayTracingPipelineShaderGroupHandleCaptureReplay", 1 }, { "rayTracingPipelineShaderGroupHandleCaptureReplayMixed", 2 },
 		{ "rayTracingPipelineTraceRaysIndirect", 3 }, { "rayTraversalPrimitiveCulling", 4 }
 	};
+	const std::vector<const char*> VulkanReflectionUtil::physicalDeviceSynchronization2FeaturesKHRVector{
+		"synchronization2"
+	};
+	const std::map<const char*, int> VulkanReflectionUtil::physicalDeviceSynchronization2FeaturesKHRMap = {
+		{ "synchronization2", 0 }
+	};
+	const std::vector<const char*> VulkanReflectionUtil::physicalDeviceMeshShaderFeaturesNVVector{
+		"taskShader", "meshShader"
+	};
+	const std::map<const char*, int> VulkanReflectionUtil::physicalDeviceMeshShaderFeaturesNVMap = {
+		{ "taskShader", 0 }, { "meshShader", 1 }
+	};
 
 	std::string VulkanReflectionUtil::getVkBool32StructName(void* pStructFeatures) {
 		VulkanStructCommon* features = reinterpret_cast<VulkanStructCommon*>(pStructFeatures);
@@ -131,6 +144,12 @@ namespace PVulkanExamples {
 		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR) {
 			structName = "VkPhysicalDeviceRayTracingPipelineFeaturesKHR";
 		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+			structName = "VkPhysicalDeviceSynchronization2FeaturesKHR";
+		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV) {
+			structName = "VkPhysicalDeviceMeshShaderFeaturesNV";
+		}
 		else
 		{
 			std::cout << "No name" << std::endl;
@@ -157,6 +176,12 @@ namespace PVulkanExamples {
 		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR) {
 			structVector = physicalDeviceRayTracingPipelineFeaturesKHRVector;
 		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+			structVector = physicalDeviceSynchronization2FeaturesKHRVector;
+		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV) {
+			structVector = physicalDeviceMeshShaderFeaturesNVVector;
+		}
 		return structVector;
 	}
 
@@ -179,6 +204,12 @@ namespace PVulkanExamples {
 		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR) {
 			structMap = physicalDeviceRayTracingPipelineFeaturesKHRMap;
 		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+			structMap = physicalDeviceSynchronization2FeaturesKHRMap;
+		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV) {
+			structMap = physicalDeviceMeshShaderFeaturesNVMap;
+		}
 		return structMap;
 	}
 
@@ -201,6 +232,12 @@ namespace PVulkanExamples {
 		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR) {
 			structValue = getVkBool32StructValue(reinterpret_cast<VkPhysicalDeviceRayTracingPipelineFeaturesKHR*>(features), fieldName);
 		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+			structValue = getVkBool32StructValue(reinterpret_cast<VkPhysicalDeviceSynchronization2FeaturesKHR*>(features), fieldName);
+		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV) {
+			structValue = getVkBool32StructValue(reinterpret_cast<VkPhysicalDeviceMeshShaderFeaturesNV*>(features), fieldName);
+		}
 		else throw std::runtime_error("Structure type " + std::to_string(sType) + "not supported");
 		return structValue;
 	}
@@ -224,6 +261,12 @@ namespace PVulkanExamples {
 		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR) {
 			structValues = getVkBool32StructValues(reinterpret_cast<VkPhysicalDeviceRayTracingPipelineFeaturesKHR*>(features));
 		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR) {
+			structValues = getVkBool32StructValues(reinterpret_cast<VkPhysicalDeviceSynchronization2FeaturesKHR*>(features));
+		}
+		else if (sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_NV) {
+			structValues = getVkBool32StructValues(reinterpret_cast<VkPhysicalDeviceMeshShaderFeaturesNV*>(features));
+		}
 		return structValues;
 	}
 
@@ -375,6 +418,17 @@ namespace PVulkanExamples {
 		else throw std::runtime_error("The struct does not have field " + std::string(fieldName));
 	}
 
+	VkBool32 VulkanReflectionUtil::getVkBool32StructValue(VkPhysicalDeviceSynchronization2FeaturesKHR* pVkStruct, const char* fieldName) {
+		if (!strcmp(fieldName, "synchronization2")) return pVkStruct->synchronization2;
+		else throw std::runtime_error("The struct does not have field " + std::string(fieldName));
+	}
+
+	VkBool32 VulkanReflectionUtil::getVkBool32StructValue(VkPhysicalDeviceMeshShaderFeaturesNV* pVkStruct, const char* fieldName) {
+		if (!strcmp(fieldName, "taskShader")) return pVkStruct->taskShader;
+		else if (!strcmp(fieldName, "meshShader")) return pVkStruct->meshShader;
+		else throw std::runtime_error("The struct does not have field " + std::string(fieldName));
+	}
+
 	std::vector<VkBool32> VulkanReflectionUtil::getVkBool32StructValues(VkPhysicalDeviceFeatures2* pVkStruct) {
 		return getVkBool32StructValues(pVkStruct->features);
 	}
@@ -451,4 +505,18 @@ namespace PVulkanExamples {
 		return v;
 	}
 
+	std::vector<VkBool32> VulkanReflectionUtil::getVkBool32StructValues(VkPhysicalDeviceSynchronization2FeaturesKHR* pVkStruct) {
+		std::vector<VkBool32> v{
+			pVkStruct->synchronization2
+		};
+		return v;
+	}
+
+	std::vector<VkBool32> VulkanReflectionUtil::getVkBool32StructValues(VkPhysicalDeviceMeshShaderFeaturesNV* pVkStruct) {
+		std::vector<VkBool32> v{
+			pVkStruct->taskShader, pVkStruct->meshShader
+		};
+		return v;
+	}
+
 } // namespace Polaris
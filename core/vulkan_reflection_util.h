@@ -30,12 +30,16 @@ namespace PVulkanExamples
         static VkBool32 getVkBool32StructValue(VkPhysicalDeviceVulkan12Features* pVkStruct, const char* fieldName);
         static VkBool32 getVkBool32StructValue(VkPhysicalDeviceAccelerationStructureFeaturesKHR* pVkStruct, const char* fieldName);
         static VkBool32 getVkBool32StructValue(VkPhysicalDeviceRayTracingPipelineFeaturesKHR* pVkStruct, const char* fieldName);
+        static VkBool32 getVkBool32StructValue(VkPhysicalDeviceSynchronization2FeaturesKHR* pVkStruct, const char* fieldName);
+        static VkBool32 getVkBool32StructValue(VkPhysicalDeviceMeshShaderFeaturesNV* pVkStruct, const char* fieldName);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceFeatures vkStruct);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceFeatures2* pVkStruct);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceVulkan11Features* pVkStruct);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceVulkan12Features* pVkStruct);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceAccelerationStructureFeaturesKHR* pVkStruct);
         static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceRayTracingPipelineFeaturesKHR* pVkStruct);
+        static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceSynchronization2FeaturesKHR* pVkStruct);
+        static std::vector<VkBool32> getVkBool32StructValues(VkPhysicalDeviceMeshShaderFeaturesNV* pVkStruct);
 
         static const std::vector<const char*> physicalDeviceFeatures2Vector;
         static const std::map<const char*, int> physicalDeviceFeatures2Map;
@@ -47,6 +51,10 @@ namespace PVulkanExamples
         static const std::map<const char*, int> physicalDeviceAccelerationStructureFeaturesKHRMap;
         static const std::vector<const char*> physicalDeviceRayTracingPipelineFeaturesKHRVector;
         static const std::map<const char*, int> physicalDeviceRayTracingPipelineFeaturesKHRMap;
+        static const std::vector<const char*> physicalDeviceSynchronization2FeaturesKHRVector;
+        static const std::map<const char*, int> physicalDeviceSynchronization2FeaturesKHRMap;
+        static const std::vector<const char*> physicalDeviceMeshShaderFeaturesNVVector;
+        static const std::map<const char*, int> physicalDeviceMeshShaderFeaturesNVMap;
 
     };
 } // namespace PVulkanExamples
\ No newline at end of file
@@ -0,0 +1,798 @@
+#include "vulkan_render_graph.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_cpu_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		struct UsageInfo
+		{
+			VkPipelineStageFlags    stages{ 0 };
+			VkAccessFlags           access{ 0 };
+			VkImageLayout           layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkImageUsageFlags       imageUsage{ 0 };    // 0 when images cannot be used this way
+			VkBufferUsageFlags      bufferUsage{ 0 };   // 0 when buffers cannot be used this way
+			bool                    write{ false };
+		};
+
+		UsageInfo getUsageInfo(RenderGraphUsage usage, RenderGraphPassType type, VkPipelineStageFlags rasterShaderStages)
+		{
+			VkPipelineStageFlags shaderStages = type == RenderGraphPassType::Raster ? rasterShaderStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			VkPipelineStageFlags fragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+			switch (usage)
+			{
+			case RenderGraphUsage::ColorAttachment:
+				return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0, true };
+			case RenderGraphUsage::DepthStencilAttachment:
+				return { fragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, true };
+			case RenderGraphUsage::DepthStencilRead:
+				return { fragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, false };
+			case RenderGraphUsage::SampledRead:
+				return { shaderStages, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT, false };
+			case RenderGraphUsage::StorageRead:
+				return { shaderStages, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false };
+			case RenderGraphUsage::StorageWrite:
+				return { shaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true };
+			case RenderGraphUsage::UniformRead:
+				return { shaderStages, VK_ACCESS_UNIFORM_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, false };
+			case RenderGraphUsage::VertexRead:
+				return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, false };
+			case RenderGraphUsage::IndirectRead:
+				return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false };
+			case RenderGraphUsage::TransferRead:
+				return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, false };
+			case RenderGraphUsage::TransferWrite:
+				return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true };
+			case RenderGraphUsage::AccelerationStructureInput:
+				return { VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR, false };
+			}
+			return {};
+		}
+	}
+
+	RenderGraphPassBuilder& RenderGraphPassBuilder::read(RenderGraphResource resource, RenderGraphUsage usage)
+	{
+		m_graph.addAccess(m_pass, resource, usage, false);
+		return *this;
+	}
+
+	RenderGraphPassBuilder& RenderGraphPassBuilder::write(RenderGraphResource resource, RenderGraphUsage usage)
+	{
+		m_graph.addAccess(m_pass, resource, usage, true);
+		return *this;
+	}
+
+	RenderGraphPassBuilder& RenderGraphPassBuilder::setSideEffects()
+	{
+		m_graph.m_passes[m_pass].sideEffects = true;
+		return *this;
+	}
+
+	void RenderGraph::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t graphicsFamily, uint32_t computeFamily,
+		VkQueue computeQueue, uint32_t maxFrameInFlight, const VkAllocationCallbacks* pAllocator,
+		bool useSynchronization2, bool meshShaders, const DebugAnnotator* pAnnotator)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		m_allocator = pAllocator;
+		m_annotator = pAnnotator;
+		m_graphicsFamily = graphicsFamily;
+		m_computeFamily = computeFamily;
+		m_computeQueue = computeQueue;
+		m_useSynchronization2 = useSynchronization2 && vkd.vkCmdPipelineBarrier2KHR != nullptr;
+		m_asyncComputeSupported = computeFamily != graphicsFamily;
+		m_rasterShaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+			(meshShaders ? VK_PIPELINE_STAGE_TASK_SHADER_BIT_NV | VK_PIPELINE_STAGE_MESH_SHADER_BIT_NV : 0);
+
+		m_frames.resize(maxFrameInFlight);
+		for (FrameSlot& frame : m_frames)
+		{
+			frame.transients.pool.init(physicalDevice, device, pAllocator,
+				m_asyncComputeSupported ? std::vector<uint32_t>{ graphicsFamily, computeFamily } : std::vector<uint32_t>{ graphicsFamily });
+		}
+		if (!m_asyncComputeSupported) return;
+
+		for (FrameSlot& frame : m_frames)
+		{
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			poolInfo.queueFamilyIndex = computeFamily;
+			if (vkd.vkCreateCommandPool(m_device, &poolInfo, m_allocator, &frame.computeCommandPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph compute command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.computeCommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+			if (vkd.vkAllocateCommandBuffers(m_device, &allocInfo, &frame.computeCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate render graph compute command buffer!");
+			}
+
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			VkFenceCreateInfo fenceInfo{};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+			if (vkd.vkCreateSemaphore(m_device, &semaphoreInfo, m_allocator, &frame.computeFinishedSemaphore) != VK_SUCCESS ||
+				vkd.vkCreateFence(m_device, &fenceInfo, m_allocator, &frame.computeFence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph synchronization objects!");
+			}
+		}
+	}
+
+	void RenderGraph::cleanup()
+	{
+		for (FrameSlot& frame : m_frames)
+		{
+			frame.transients.pool.cleanup();
+			if (frame.computeCommandPool == VK_NULL_HANDLE) continue;
+			vkd.vkDestroyFence(m_device, frame.computeFence, m_allocator);
+			vkd.vkDestroySemaphore(m_device, frame.computeFinishedSemaphore, m_allocator);
+			vkd.vkDestroyCommandPool(m_device, frame.computeCommandPool, m_allocator);
+		}
+		m_frames.clear();
+		m_resources.clear();
+		m_passes.clear();
+		m_executionOrder.clear();
+		m_finalBarriers.clear();
+		m_compiled = false;
+		m_computeSubmitted = false;
+		m_device = VK_NULL_HANDLE;
+	}
+
+	void RenderGraph::beginFrame(uint32_t frameIndex)
+	{
+		m_currentFrame = frameIndex;
+		FrameSlot& frame = m_frames[m_currentFrame];
+		if (frame.computeFence != VK_NULL_HANDLE)
+		{
+			// Usually signaled already, the graphics fence of the slot was waited for and that submission waited for it
+			vkd.vkWaitForFences(m_device, 1, &frame.computeFence, VK_TRUE, UINT64_MAX);
+		}
+
+		m_resources.clear();
+		m_passes.clear();
+		m_executionOrder.clear();
+		m_finalBarriers.clear();
+		m_computeWaitStages = 0;
+		m_compiled = false;
+		m_computeSubmitted = false;
+		m_statistics = {};
+	}
+
+	RenderGraphResource RenderGraph::importImage(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+		const RenderGraphResourceState& initialState, const RenderGraphResourceState& finalState)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.isImage = true;
+		resource.imported = true;
+		resource.imageDesc = { format, extent, 0 };
+		resource.initialState = initialState;
+		resource.finalState = finalState;
+		resource.image = image;
+		resource.view = view;
+		m_resources.push_back(resource);
+		return static_cast<RenderGraphResource>(m_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::importBuffer(const char* name, VkBuffer buffer, VkDeviceSize size,
+		const RenderGraphResourceState& initialState, const RenderGraphResourceState& finalState)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.imported = true;
+		resource.bufferDesc = { size, 0 };
+		resource.initialState = initialState;
+		resource.finalState = finalState;
+		resource.buffer = buffer;
+		m_resources.push_back(resource);
+		return static_cast<RenderGraphResource>(m_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::createImage(const char* name, const RenderGraphImageDesc& desc)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.isImage = true;
+		resource.imageDesc = desc;
+		m_resources.push_back(resource);
+		return static_cast<RenderGraphResource>(m_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::createBuffer(const char* name, const RenderGraphBufferDesc& desc)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.bufferDesc = desc;
+		m_resources.push_back(resource);
+		return static_cast<RenderGraphResource>(m_resources.size() - 1);
+	}
+
+	RenderGraphPassBuilder RenderGraph::addPass(const char* name, RenderGraphPassType type, ExecuteCallback execute)
+	{
+		Pass pass{};
+		pass.name = name;
+		pass.type = type;
+		pass.execute = std::move(execute);
+		m_passes.push_back(std::move(pass));
+		return RenderGraphPassBuilder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+	}
+
+	/*
+	* Record one access of a pass, several accesses of the same resource are merged and must agree on the image layout
+	*/
+	void RenderGraph::addAccess(uint32_t passIndex, RenderGraphResource resource, RenderGraphUsage usage, bool write)
+	{
+		Pass& pass = m_passes[passIndex];
+		if (resource >= m_resources.size())
+		{
+			throw std::runtime_error("render graph pass " + pass.name + " uses an undeclared resource!");
+		}
+		Resource& declared = m_resources[resource];
+		UsageInfo info = getUsageInfo(usage, pass.type, m_rasterShaderStages);
+		if (info.write != write)
+		{
+			throw std::runtime_error("render graph pass " + pass.name + " declares " + declared.name + (write ? " written" : " read") +
+				" with a usage that " + (write ? "only reads" : "writes") + "!");
+		}
+		if ((declared.isImage && info.imageUsage == 0) || (!declared.isImage && info.bufferUsage == 0))
+		{
+			throw std::runtime_error("render graph pass " + pass.name + " uses " + declared.name + " in a way its resource type does not support!");
+		}
+		declared.imageUsage |= info.imageUsage;
+		declared.bufferUsage |= info.bufferUsage;
+
+		VkImageLayout layout = declared.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		for (Access& access : pass.accesses)
+		{
+			if (access.resource != resource) continue;
+			if (access.layout != layout)
+			{
+				throw std::runtime_error("render graph pass " + pass.name + " uses " + declared.name + " in two image layouts!");
+			}
+			access.stages |= info.stages;
+			access.access |= info.access;
+			access.write = access.write || write;
+			return;
+		}
+		pass.accesses.push_back({ resource, info.stages, info.access, layout, write });
+	}
+
+	void RenderGraph::compile()
+	{
+		PVE_PROFILE_FUNCTION();
+
+		cullPasses();
+		assignQueues();
+		computeLifetimes();
+		realizeTransients();
+		planBarriers();
+		m_compiled = true;
+	}
+
+	/*
+	* Keep the passes writing imported resources or having side effects and, transitively, the last writers of
+	* everything they access. Passes only depend on earlier passes, so one backwards sweep is enough.
+	*/
+	void RenderGraph::cullPasses()
+	{
+		std::vector<uint32_t> lastWriter(m_resources.size(), UINT32_MAX);
+		std::vector<std::vector<uint32_t>> dependencies(m_passes.size());
+		std::vector<bool> alive(m_passes.size(), false);
+		for (uint32_t passIndex = 0; passIndex < m_passes.size(); passIndex++)
+		{
+			Pass& pass = m_passes[passIndex];
+			alive[passIndex] = pass.sideEffects;
+			for (const Access& access : pass.accesses)
+			{
+				if (lastWriter[access.resource] != UINT32_MAX)
+				{
+					dependencies[passIndex].push_back(lastWriter[access.resource]);
+				}
+				alive[passIndex] = alive[passIndex] || (access.write && m_resources[access.resource].imported);
+			}
+			for (const Access& access : pass.accesses)
+			{
+				if (access.write) lastWriter[access.resource] = passIndex;
+			}
+		}
+
+		for (uint32_t passIndex = static_cast<uint32_t>(m_passes.size()); passIndex-- > 0;)
+		{
+			if (!alive[passIndex]) continue;
+			for (uint32_t dependency : dependencies[passIndex])
+			{
+				alive[dependency] = true;
+			}
+		}
+
+		m_executionOrder.clear();
+		for (uint32_t passIndex = 0; passIndex < m_passes.size(); passIndex++)
+		{
+			m_passes[passIndex].culled = !alive[passIndex];
+			if (alive[passIndex]) m_executionOrder.push_back(passIndex);
+		}
+		m_statistics.passCount = static_cast<uint32_t>(m_passes.size());
+		m_statistics.culledPassCount = static_cast<uint32_t>(m_passes.size() - m_executionOrder.size());
+	}
+
+	/*
+	* An async compute pass moves to the compute queue when it only touches transient resources no earlier graphics pass
+	* touched, so the only cross queue dependencies run from the compute submission to the graphics one.
+	* The compute submission waits for nothing, imported resources may still be in use by the previous frame on the
+	* graphics queue while transients belong to the frame slot whose previous use has completed.
+	*/
+	void RenderGraph::assignQueues()
+	{
+		std::vector<bool> touchedByGraphics(m_resources.size(), false);
+		m_statistics.asyncComputePassCount = 0;
+		for (uint32_t passIndex : m_executionOrder)
+		{
+			Pass& pass = m_passes[passIndex];
+			bool async = pass.type == RenderGraphPassType::AsyncCompute && m_asyncComputeSupported;
+			for (const Access& access : pass.accesses)
+			{
+				async = async && !touchedByGraphics[access.resource] && !m_resources[access.resource].imported;
+			}
+			pass.asyncCompute = async;
+			if (async)
+			{
+				m_statistics.asyncComputePassCount++;
+				continue;
+			}
+			for (const Access& access : pass.accesses)
+			{
+				touchedByGraphics[access.resource] = true;
+			}
+		}
+	}
+
+	void RenderGraph::computeLifetimes()
+	{
+		for (uint32_t order = 0; order < m_executionOrder.size(); order++)
+		{
+			const Pass& pass = m_passes[m_executionOrder[order]];
+			for (const Access& access : pass.accesses)
+			{
+				Resource& resource = m_resources[access.resource];
+				resource.firstPass = std::min(resource.firstPass, order);
+				resource.lastPass = order;
+				resource.usedStages |= access.stages;
+				if (access.write)
+				{
+					resource.writeStages |= access.stages;
+					resource.writeAccess |= access.access & WRITE_ACCESS_MASK;
+				}
+				resource.usedByCompute = resource.usedByCompute || pass.asyncCompute;
+				resource.usedByGraphics = resource.usedByGraphics || !pass.asyncCompute;
+			}
+		}
+	}
+
+	/*
+	* Create the transient resources of the frame slot, or reuse the ones created for the same declarations.
+	* Resources touched by the compute queue are concurrent so the pool never aliases them.
+	*/
+	void RenderGraph::realizeTransients()
+	{
+		PVE_PROFILE_FUNCTION();
+
+		TransientSlot& slot = m_frames[m_currentFrame].transients;
+		std::vector<uint64_t> signature;
+		for (const Resource& resource : m_resources)
+		{
+			if (resource.imported) continue;
+			bool used = resource.firstPass != UINT32_MAX;
+			signature.push_back(static_cast<uint64_t>(used) | static_cast<uint64_t>(resource.isImage) << 1 | static_cast<uint64_t>(resource.usedByCompute) << 2);
+			if (!used) continue;
+			signature.push_back(static_cast<uint64_t>(resource.firstPass) << 32 | resource.lastPass);
+			if (resource.isImage)
+			{
+				signature.push_back(static_cast<uint64_t>(resource.imageDesc.format) << 32 | (resource.imageUsage | resource.imageDesc.additionalUsage));
+				signature.push_back(static_cast<uint64_t>(resource.imageDesc.extent.width) << 32 | resource.imageDesc.extent.height);
+			}
+			else
+			{
+				signature.push_back(resource.bufferDesc.size);
+				signature.push_back(resource.bufferUsage | resource.bufferDesc.additionalUsage);
+			}
+		}
+
+		if (signature != slot.signature)
+		{
+			// The slot's previous frame has completed, its resources can be destroyed right away
+			slot.pool.reset();
+			slot.signature = signature;
+			slot.poolResources.clear();
+			for (RenderGraphResource resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+			{
+				const Resource& resource = m_resources[resourceIndex];
+				if (resource.imported || resource.firstPass == UINT32_MAX) continue;
+				if (resource.isImage)
+				{
+					slot.pool.addImage(resource.name.c_str(), resource.imageDesc.format, resource.imageDesc.extent,
+						resource.imageUsage | resource.imageDesc.additionalUsage, resource.firstPass, resource.lastPass, resource.usedByCompute);
+				}
+				else
+				{
+					slot.pool.addBuffer(resource.name.c_str(), resource.bufferDesc.size,
+						resource.bufferUsage | resource.bufferDesc.additionalUsage, resource.firstPass, resource.lastPass, resource.usedByCompute);
+				}
+				slot.poolResources.push_back(resourceIndex);
+			}
+			slot.pool.allocate();
+
+			for (uint32_t poolResource = 0; poolResource < slot.poolResources.size(); poolResource++)
+			{
+				VkImage image = slot.pool.getImage(poolResource);
+				if (image != VK_NULL_HANDLE && m_annotator != nullptr)
+				{
+					m_annotator->setObjectName(image, m_resources[slot.poolResources[poolResource]].name.c_str());
+				}
+			}
+		}
+
+		for (uint32_t poolResource = 0; poolResource < slot.poolResources.size(); poolResource++)
+		{
+			Resource& resource = m_resources[slot.poolResources[poolResource]];
+			resource.image = slot.pool.getImage(poolResource);
+			resource.view = slot.pool.getImageView(poolResource);
+			resource.buffer = slot.pool.getBuffer(poolResource);
+		}
+		const TransientPoolStatistics& poolStatistics = slot.pool.getStatistics();
+		m_statistics.transientRequestedSize = poolStatistics.requestedSize;
+		m_statistics.transientAllocatedSize = poolStatistics.allocatedSize;
+		m_statistics.transientLazilyAllocatedSize = poolStatistics.lazilyAllocatedSize;
+	}
+
+	/*
+	* Walk the alive passes in order and emit the barriers their accesses need given what happened to each resource so far
+	*/
+	void RenderGraph::planBarriers()
+	{
+		const TransientSlot& slot = m_frames[m_currentFrame].transients;
+		std::vector<ResourceState> states(m_resources.size());
+		for (const Resource& resource : m_resources)
+		{
+			if (!resource.imported) continue;
+			ResourceState& state = states[&resource - m_resources.data()];
+			state.layout = resource.initialState.layout;
+			state.visibleStages = resource.initialState.stages;
+			state.visibleAccess = resource.initialState.access;
+			state.fresh = true;
+			if (resource.initialState.access & WRITE_ACCESS_MASK)
+			{
+				state.writeStages = resource.initialState.stages;
+				state.writeAccess = resource.initialState.access & WRITE_ACCESS_MASK;
+			}
+			else
+			{
+				state.readStages = resource.initialState.stages;
+			}
+		}
+		for (uint32_t poolResource = 0; poolResource < slot.poolResources.size(); poolResource++)
+		{
+			// Memory shared with earlier transients is reused once every stage using them is done and their writes are available
+			ResourceState& state = states[slot.poolResources[poolResource]];
+			for (uint32_t predecessor : slot.pool.getAliasPredecessors(poolResource))
+			{
+				const Resource& predecessorResource = m_resources[slot.poolResources[predecessor]];
+				state.readStages |= predecessorResource.usedStages;
+				state.writeStages |= predecessorResource.writeStages;
+				state.writeAccess |= predecessorResource.writeAccess;
+			}
+		}
+
+		for (uint32_t passIndex : m_executionOrder)
+		{
+			Pass& pass = m_passes[passIndex];
+			pass.barriers.clear();
+			for (const Access& access : pass.accesses)
+			{
+				planAccess(pass.barriers, states[access.resource], access, pass.asyncCompute);
+			}
+			if (!pass.barriers.empty()) m_statistics.barrierBatchCount++;
+		}
+
+		// Hand imported resources over in the layout and stages declared as their final state
+		m_finalBarriers.clear();
+		for (RenderGraphResource resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+		{
+			const Resource& resource = m_resources[resourceIndex];
+			ResourceState& state = states[resourceIndex];
+			if (!resource.imported || !state.touched) continue;
+			const RenderGraphResourceState& finalState = resource.finalState;
+			bool transition = resource.isImage && finalState.layout != VK_IMAGE_LAYOUT_UNDEFINED && finalState.layout != state.layout;
+			bool pendingStages = ((state.writeStages | state.readStages) & ~finalState.stages) != 0 || (state.writeAccess & ~finalState.access) != 0;
+			if (!transition && !(finalState.stages != 0 && pendingStages)) continue;
+
+			Barrier barrier{};
+			barrier.resource = resourceIndex;
+			barrier.srcStages = state.writeStages | state.readStages;
+			barrier.srcAccess = state.writeAccess;
+			barrier.dstStages = finalState.stages != 0 ? finalState.stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+			barrier.dstAccess = finalState.access;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = transition ? finalState.layout : state.layout;
+			m_finalBarriers.push_back(barrier);
+		}
+		if (!m_finalBarriers.empty()) m_statistics.barrierBatchCount++;
+
+		auto countBarriers = [this](const std::vector<Barrier>& barriers)
+		{
+			for (const Barrier& barrier : barriers)
+			{
+				(m_resources[barrier.resource].isImage ? m_statistics.imageBarrierCount : m_statistics.bufferBarrierCount)++;
+			}
+		};
+		for (uint32_t passIndex : m_executionOrder) countBarriers(m_passes[passIndex].barriers);
+		countBarriers(m_finalBarriers);
+	}
+
+	/*
+	* Layout changes and writes wait for every earlier access, reads only for the last write and only once per stage
+	*/
+	void RenderGraph::planAccess(std::vector<Barrier>& barriers, ResourceState& state, const Access& access, bool onComputeQueue)
+	{
+		const Resource& resource = m_resources[access.resource];
+		if (state.touched && state.onComputeQueue != onComputeQueue)
+		{
+			// Compute to graphics, the semaphore wait at these stages orders and makes visible everything done before
+			m_computeWaitStages |= access.stages;
+			state.writeStages = access.stages;
+			state.writeAccess = 0;
+			state.readStages = 0;
+			state.visibleStages = access.stages;
+			state.visibleAccess = access.access;
+			state.fresh = true;
+		}
+		state.touched = true;
+		state.onComputeQueue = onComputeQueue;
+
+		Barrier barrier{};
+		barrier.resource = access.resource;
+		barrier.dstStages = access.stages;
+		barrier.dstAccess = access.access;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = resource.isImage ? access.layout : state.layout;
+
+		bool transition = resource.isImage && state.layout != access.layout;
+		bool visible = (access.stages & ~state.visibleStages) == 0 && (access.access & ~state.visibleAccess) == 0;
+		bool fresh = state.fresh;
+		state.fresh = false;
+		if (transition || access.write)
+		{
+			barrier.srcStages = state.writeStages | state.readStages;
+			barrier.srcAccess = state.writeAccess;
+			// The dependency an imported resource arrives with already covers a first write at its stages
+			if (transition || (barrier.srcStages != 0 && !(fresh && visible)))
+			{
+				barriers.push_back(barrier);
+			}
+			state.layout = barrier.newLayout;
+			state.writeStages = access.stages;
+			state.writeAccess = access.write ? access.access & WRITE_ACCESS_MASK : 0;
+			state.readStages = access.write ? 0 : access.stages;
+			state.visibleStages = access.stages;
+			state.visibleAccess = access.access;
+			return;
+		}
+
+		if (state.writeStages != 0 && !visible)
+		{
+			barrier.srcStages = state.writeStages;
+			barrier.srcAccess = state.writeAccess;
+			barriers.push_back(barrier);
+			state.visibleStages |= access.stages;
+			state.visibleAccess |= access.access;
+		}
+		state.readStages |= access.stages;
+	}
+
+	void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers)
+	{
+		if (barriers.empty()) return;
+
+		if (m_useSynchronization2)
+		{
+			std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+			std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+			for (const Barrier& barrier : barriers)
+			{
+				const Resource& resource = m_resources[barrier.resource];
+				if (resource.isImage)
+				{
+					VkImageMemoryBarrier2KHR imageBarrier{};
+					imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+					imageBarrier.srcStageMask = barrier.srcStages;
+					imageBarrier.srcAccessMask = barrier.srcAccess;
+					imageBarrier.dstStageMask = barrier.dstStages;
+					imageBarrier.dstAccessMask = barrier.dstAccess;
+					imageBarrier.oldLayout = barrier.oldLayout;
+					imageBarrier.newLayout = barrier.newLayout;
+					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					imageBarrier.image = resource.image;
+					imageBarrier.subresourceRange = { TransientResourcePool::getImageAspect(resource.imageDesc.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+					imageBarriers.push_back(imageBarrier);
+				}
+				else
+				{
+					VkBufferMemoryBarrier2KHR bufferBarrier{};
+					bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+					bufferBarrier.srcStageMask = barrier.srcStages;
+					bufferBarrier.srcAccessMask = barrier.srcAccess;
+					bufferBarrier.dstStageMask = barrier.dstStages;
+					bufferBarrier.dstAccessMask = barrier.dstAccess;
+					bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					bufferBarrier.buffer = resource.buffer;
+					bufferBarrier.offset = 0;
+					bufferBarrier.size = VK_WHOLE_SIZE;
+					bufferBarriers.push_back(bufferBarrier);
+				}
+			}
+			VkDependencyInfoKHR dependencyInfo{};
+			dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+			dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+			dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+			dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+			dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+			vkd.vkCmdPipelineBarrier2KHR(commandBuffer, &dependencyInfo);
+			return;
+		}
+
+		// Without synchronization2 one call carries the union of the stage masks
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		for (const Barrier& barrier : barriers)
+		{
+			const Resource& resource = m_resources[barrier.resource];
+			srcStages |= barrier.srcStages;
+			dstStages |= barrier.dstStages;
+			if (resource.isImage)
+			{
+				VkImageMemoryBarrier imageBarrier{};
+				imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				imageBarrier.srcAccessMask = barrier.srcAccess;
+				imageBarrier.dstAccessMask = barrier.dstAccess;
+				imageBarrier.oldLayout = barrier.oldLayout;
+				imageBarrier.newLayout = barrier.newLayout;
+				imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.image = resource.image;
+				imageBarrier.subresourceRange = { TransientResourcePool::getImageAspect(resource.imageDesc.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+				imageBarriers.push_back(imageBarrier);
+			}
+			else
+			{
+				VkBufferMemoryBarrier bufferBarrier{};
+				bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				bufferBarrier.srcAccessMask = barrier.srcAccess;
+				bufferBarrier.dstAccessMask = barrier.dstAccess;
+				bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				bufferBarrier.buffer = resource.buffer;
+				bufferBarrier.offset = 0;
+				bufferBarrier.size = VK_WHOLE_SIZE;
+				bufferBarriers.push_back(bufferBarrier);
+			}
+		}
+		vkd.vkCmdPipelineBarrier(commandBuffer,
+			srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), dstStages, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	void RenderGraph::recordPass(VkCommandBuffer commandBuffer, const Pass& pass)
+	{
+		if (m_annotator != nullptr) m_annotator->beginLabel(commandBuffer, pass.name.c_str());
+		recordBarriers(commandBuffer, pass.barriers);
+		if (pass.execute) pass.execute(commandBuffer, *this);
+		if (m_annotator != nullptr) m_annotator->endLabel(commandBuffer);
+	}
+
+	void RenderGraph::execute(VkCommandBuffer commandBuffer)
+	{
+		PVE_PROFILE_FUNCTION();
+
+		if (!m_compiled)
+		{
+			throw std::runtime_error("render graph executed before it was compiled!");
+		}
+
+		if (m_statistics.asyncComputePassCount > 0)
+		{
+			FrameSlot& frame = m_frames[m_currentFrame];
+			vkd.vkResetCommandBuffer(frame.computeCommandBuffer, 0);
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkd.vkBeginCommandBuffer(frame.computeCommandBuffer, &beginInfo);
+			for (uint32_t passIndex : m_executionOrder)
+			{
+				if (m_passes[passIndex].asyncCompute) recordPass(frame.computeCommandBuffer, m_passes[passIndex]);
+			}
+			if (vkd.vkEndCommandBuffer(frame.computeCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record render graph compute command buffer!");
+			}
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &frame.computeCommandBuffer;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &frame.computeFinishedSemaphore;
+			vkd.vkResetFences(m_device, 1, &frame.computeFence);
+			if (vkd.vkQueueSubmit(m_computeQueue, 1, &submitInfo, frame.computeFence) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit render graph compute command buffer!");
+			}
+			m_computeSubmitted = true;
+		}
+
+		for (uint32_t passIndex : m_executionOrder)
+		{
+			if (!m_passes[passIndex].asyncCompute) recordPass(commandBuffer, m_passes[passIndex]);
+		}
+		recordBarriers(commandBuffer, m_finalBarriers);
+	}
+
+	bool RenderGraph::getAsyncComputeWait(VkSemaphore& semaphore, VkPipelineStageFlags& waitStage) const
+	{
+		if (!m_computeSubmitted) return false;
+		semaphore = m_frames[m_currentFrame].computeFinishedSemaphore;
+		// The semaphore still has to be waited on when no graphics pass consumes the compute results
+		waitStage = m_computeWaitStages != 0 ? m_computeWaitStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		return true;
+	}
+
+	void RenderGraph::printPlan() const
+	{
+		std::cout << "\n=============================Render graph=============================";
+		for (uint32_t passIndex = 0; passIndex < m_passes.size(); passIndex++)
+		{
+			const Pass& pass = m_passes[passIndex];
+			std::cout << "\n" << std::setw(32) << std::left << pass.name << std::right
+				<< (pass.culled ? "culled" : pass.asyncCompute ? "compute queue" : "graphics queue");
+			if (!pass.culled) std::cout << ", " << pass.barriers.size() << " barriers";
+		}
+		std::cout << "\nfinal barriers " << m_finalBarriers.size()
+			<< ", transient memory " << m_statistics.transientAllocatedSize / 1024 << " KiB for "
+			<< m_statistics.transientRequestedSize / 1024 << " KiB of resources, "
+			<< m_statistics.transientLazilyAllocatedSize / 1024 << " KiB lazily allocated" << std::endl;
+	}
+} // namespace PVulkanExamples
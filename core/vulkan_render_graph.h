@@ -0,0 +1,286 @@
+#pragma once
+
+#include "vulkan_debug_annotation.h"
+#include "vulkan_transient_pool.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// Index of a resource declared in the current frame's graph
+	using RenderGraphResource = uint32_t;
+	constexpr RenderGraphResource RENDER_GRAPH_INVALID_RESOURCE = UINT32_MAX;
+
+	enum class RenderGraphPassType
+	{
+		Raster,         // Draws on the graphics queue
+		Compute,        // Dispatches on the graphics queue
+		AsyncCompute,   // Dispatches on the compute queue when the device has a separate compute family and it only touches transients
+	};
+
+	/*
+	* How a pass accesses a resource, determines the pipeline stages, access mask, image layout and usage flags.
+	* Shader accesses cover the vertex and fragment stages in raster passes, plus the task and mesh stages when the graph
+	* was initialized with mesh shaders, and the compute stage in compute passes.
+	*/
+	enum class RenderGraphUsage
+	{
+		ColorAttachment,            // Write
+		DepthStencilAttachment,     // Write, depth test with depth writes
+		DepthStencilRead,           // Depth test without depth writes
+		SampledRead,                // Sampled image or uniform texel buffer
+		StorageRead,                // Storage image or storage buffer
+		StorageWrite,               // Write
+		UniformRead,                // Uniform buffer
+		VertexRead,                 // Vertex or index buffer
+		IndirectRead,               // Indirect draw or dispatch arguments
+		TransferRead,
+		TransferWrite,              // Write
+		AccelerationStructureInput, // Vertex, index or transform data of an acceleration structure build
+	};
+
+	/*
+	* Synchronization state of an imported resource at the boundaries of the graph
+	*/
+	struct RenderGraphResourceState
+	{
+		VkImageLayout           layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags    stages{ 0 };
+		VkAccessFlags           access{ 0 };
+	};
+
+	struct RenderGraphImageDesc
+	{
+		VkFormat            format{ VK_FORMAT_UNDEFINED };
+		VkExtent2D          extent{};
+		VkImageUsageFlags   additionalUsage{ 0 };   // Added to the usage derived from the passes
+	};
+
+	struct RenderGraphBufferDesc
+	{
+		VkDeviceSize        size{ 0 };
+		VkBufferUsageFlags  additionalUsage{ 0 };
+	};
+
+	struct RenderGraphStatistics
+	{
+		uint32_t        passCount{ 0 };
+		uint32_t        culledPassCount{ 0 };
+		uint32_t        asyncComputePassCount{ 0 };
+		uint32_t        barrierBatchCount{ 0 };
+		uint32_t        imageBarrierCount{ 0 };
+		uint32_t        bufferBarrierCount{ 0 };
+		VkDeviceSize    transientRequestedSize{ 0 };    // Sum of the transient resource sizes
+		VkDeviceSize    transientAllocatedSize{ 0 };    // Device memory they occupy after aliasing
+		VkDeviceSize    transientLazilyAllocatedSize{ 0 };
+	};
+
+	/*
+	* Dependency the graph records for one resource, as planned by compile
+	*/
+	struct RenderGraphBarrier
+	{
+		RenderGraphResource     resource{ RENDER_GRAPH_INVALID_RESOURCE };
+		VkPipelineStageFlags    srcStages{ 0 };
+		VkAccessFlags           srcAccess{ 0 };
+		VkPipelineStageFlags    dstStages{ 0 };
+		VkAccessFlags           dstAccess{ 0 };
+		VkImageLayout           oldLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkImageLayout           newLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	};
+
+	class RenderGraph;
+
+	/*
+	* Declares the resources a pass reads and writes, returned by RenderGraph::addPass
+	*/
+	class RenderGraphPassBuilder
+	{
+	public:
+		RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+		RenderGraphPassBuilder& read(RenderGraphResource resource, RenderGraphUsage usage);
+		RenderGraphPassBuilder& write(RenderGraphResource resource, RenderGraphUsage usage);
+		RenderGraphPassBuilder& setSideEffects();  // Never culled, for passes writing outside the graph
+		uint32_t getIndex() const { return m_pass; }
+
+	private:
+		RenderGraph&    m_graph;
+		uint32_t        m_pass;
+	};
+
+	/*
+	* Frame graph rebuilt every frame above ExampleBase.
+	* Passes declare the resources they read and write and record their commands in a callback, the graph then
+	*  - culls passes none of whose results reach an imported resource or a pass with side effects,
+	*  - moves async compute passes to the compute queue when they only touch transient resources untouched by earlier
+	*    graphics passes, the graphics submission waits for them through a semaphore at the stages of their first graphics
+	*    consumers,
+	*  - records one barrier batch before each pass holding exactly the layout transitions and the read after write,
+	*    write after read and write after write dependencies of its resources, with vkCmdPipelineBarrier2KHR when
+	*    synchronization2 is enabled and vkCmdPipelineBarrier otherwise,
+	*  - creates transient resources from a TransientResourcePool per frame in flight, aliasing the memory of resources
+	*    with disjoint pass lifetimes, and keeps them while the declarations of the slot stay the same.
+	* Resources touched by the compute queue are never aliased and are created with concurrent sharing. Passes touching
+	* imported resources stay on the graphics queue, the previous frame may still use those there.
+	*/
+	class RenderGraph
+	{
+	public:
+		using ExecuteCallback = std::function<void(VkCommandBuffer commandBuffer, const RenderGraph& graph)>;
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t graphicsFamily, uint32_t computeFamily,
+			VkQueue computeQueue, uint32_t maxFrameInFlight, const VkAllocationCallbacks* pAllocator,
+			bool useSynchronization2, bool meshShaders = false, const DebugAnnotator* pAnnotator = nullptr);
+		void cleanup();
+		bool hasAsyncCompute() const { return m_asyncComputeSupported; }
+
+		// Starts declaring a new frame, the previous use of the slot must have completed on the graphics queue
+		void beginFrame(uint32_t frameIndex);
+
+		RenderGraphResource importImage(const char* name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+			const RenderGraphResourceState& initialState, const RenderGraphResourceState& finalState);
+		RenderGraphResource importBuffer(const char* name, VkBuffer buffer, VkDeviceSize size,
+			const RenderGraphResourceState& initialState, const RenderGraphResourceState& finalState);
+		RenderGraphResource createImage(const char* name, const RenderGraphImageDesc& desc);
+		RenderGraphResource createBuffer(const char* name, const RenderGraphBufferDesc& desc);
+
+		RenderGraphPassBuilder addPass(const char* name, RenderGraphPassType type, ExecuteCallback execute);
+
+		void compile();
+		// Submits the async compute passes and records the graphics passes into the given command buffer
+		void execute(VkCommandBuffer commandBuffer);
+		// Semaphore the graphics submission of the frame has to wait for, false when nothing ran on the compute queue
+		bool getAsyncComputeWait(VkSemaphore& semaphore, VkPipelineStageFlags& waitStage) const;
+
+		VkImage getImage(RenderGraphResource resource) const { return m_resources[resource].image; }
+		VkImageView getImageView(RenderGraphResource resource) const { return m_resources[resource].view; }
+		VkBuffer getBuffer(RenderGraphResource resource) const { return m_resources[resource].buffer; }
+		VkExtent2D getExtent(RenderGraphResource resource) const { return m_resources[resource].imageDesc.extent; }
+		bool isPassCulled(uint32_t pass) const { return m_passes[pass].culled; }
+		bool isPassOnComputeQueue(uint32_t pass) const { return m_passes[pass].asyncCompute; }
+		const std::vector<RenderGraphBarrier>& getPassBarriers(uint32_t pass) const { return m_passes[pass].barriers; }
+		const std::vector<RenderGraphBarrier>& getFinalBarriers() const { return m_finalBarriers; }
+		const RenderGraphStatistics& getStatistics() const { return m_statistics; }
+		void printPlan() const;
+
+	private:
+		friend class RenderGraphPassBuilder;
+
+		struct Access
+		{
+			RenderGraphResource     resource{ RENDER_GRAPH_INVALID_RESOURCE };
+			VkPipelineStageFlags    stages{ 0 };
+			VkAccessFlags           access{ 0 };
+			VkImageLayout           layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			bool                    write{ false };
+		};
+
+		using Barrier = RenderGraphBarrier;
+
+		struct Pass
+		{
+			std::string             name{};
+			RenderGraphPassType     type{ RenderGraphPassType::Raster };
+			bool                    asyncCompute{ false };  // Recorded into the compute queue command buffer
+			ExecuteCallback         execute{};
+			std::vector<Access>     accesses{};     // One per resource
+			std::vector<Barrier>    barriers{};     // Recorded before the pass
+			bool                    sideEffects{ false };
+			bool                    culled{ false };
+		};
+
+		struct Resource
+		{
+			std::string                 name{};
+			bool                        isImage{ false };
+			bool                        imported{ false };
+			RenderGraphImageDesc        imageDesc{};
+			RenderGraphBufferDesc       bufferDesc{};
+			VkImageUsageFlags           imageUsage{ 0 };            // Derived from the passes using it
+			VkBufferUsageFlags          bufferUsage{ 0 };
+			RenderGraphResourceState    initialState{};
+			RenderGraphResourceState    finalState{};
+			VkImage                     image{ VK_NULL_HANDLE };
+			VkImageView                 view{ VK_NULL_HANDLE };
+			VkBuffer                    buffer{ VK_NULL_HANDLE };
+			uint32_t                    firstPass{ UINT32_MAX };    // Execution order of the first and last alive pass using it
+			uint32_t                    lastPass{ 0 };
+			VkPipelineStageFlags        usedStages{ 0 };
+			VkPipelineStageFlags        writeStages{ 0 };           // Of the alive passes writing it
+			VkAccessFlags               writeAccess{ 0 };
+			bool                        usedByCompute{ false };
+			bool                        usedByGraphics{ false };
+		};
+
+		// Everything the barrier planner tracks per resource on one queue
+		struct ResourceState
+		{
+			VkImageLayout           layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkPipelineStageFlags    writeStages{ 0 };       // Stages of the last write or layout transition
+			VkAccessFlags           writeAccess{ 0 };
+			VkPipelineStageFlags    readStages{ 0 };        // Stages reading since the last write
+			VkPipelineStageFlags    visibleStages{ 0 };     // Stages the last write was already made visible to
+			VkAccessFlags           visibleAccess{ 0 };
+			bool                    onComputeQueue{ false };
+			bool                    touched{ false };
+			bool                    fresh{ false };         // Nothing accessed it since the dependency into visibleStages
+		};
+
+		// Transient resources of one frame slot, reused while the declarations keep the same signature
+		struct TransientSlot
+		{
+			TransientResourcePool               pool{};
+			std::vector<uint64_t>               signature{};
+			std::vector<RenderGraphResource>    poolResources{};    // Graph resource of each pool resource
+		};
+
+		struct FrameSlot
+		{
+			VkCommandPool   computeCommandPool{ VK_NULL_HANDLE };
+			VkCommandBuffer computeCommandBuffer{ VK_NULL_HANDLE };
+			VkSemaphore     computeFinishedSemaphore{ VK_NULL_HANDLE };
+			VkFence         computeFence{ VK_NULL_HANDLE };
+			TransientSlot   transients{};
+		};
+
+		void addAccess(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage, bool write);
+		void cullPasses();
+		void assignQueues();
+		void computeLifetimes();
+		void realizeTransients();
+		void planBarriers();
+		void planAccess(std::vector<Barrier>& barriers, ResourceState& state, const Access& access, bool onComputeQueue);
+		void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers);
+		void recordPass(VkCommandBuffer commandBuffer, const Pass& pass);
+
+	private:
+		VkPhysicalDevice                m_physicalDevice{ VK_NULL_HANDLE };
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		const DebugAnnotator*           m_annotator{ nullptr };
+		uint32_t                        m_graphicsFamily{ 0 };
+		uint32_t                        m_computeFamily{ 0 };
+		VkQueue                         m_computeQueue{ VK_NULL_HANDLE };
+		bool                            m_useSynchronization2{ false };
+		bool                            m_asyncComputeSupported{ false };
+		VkPipelineStageFlags            m_rasterShaderStages{ VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+
+		std::vector<FrameSlot>          m_frames{};
+		uint32_t                        m_currentFrame{ 0 };
+
+		// Declarations and compiled plan of the current frame
+		std::vector<Resource>           m_resources{};
+		std::vector<Pass>               m_passes{};
+		std::vector<uint32_t>           m_executionOrder{};     // Alive passes
+		std::vector<Barrier>            m_finalBarriers{};      // Hand imported resources over in their final state
+		VkPipelineStageFlags            m_computeWaitStages{ 0 };
+		bool                            m_compiled{ false };
+		bool                            m_computeSubmitted{ false };
+		RenderGraphStatistics           m_statistics{};
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,63 @@
+#include "vulkan_ring_buffer.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void RingBuffer::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize frameSize, VkBufferUsageFlags usage, uint32_t frameCount,
+		const VkAllocationCallbacks* pAllocator)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+
+		VkPhysicalDeviceProperties properties{};
+		vkd.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		m_minAlignment = std::max<VkDeviceSize>({ 16, properties.limits.minUniformBufferOffsetAlignment,
+			properties.limits.minStorageBufferOffsetAlignment, properties.limits.nonCoherentAtomSize });
+		// Every region starts aligned, so offsets aligned within a region are aligned in the buffer
+		m_frameSize = (frameSize + m_minAlignment - 1) / m_minAlignment * m_minAlignment;
+
+		VulkanUtil::createBuffer(physicalDevice, device, m_frameSize * frameCount, usage,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_buffer, m_memory, pAllocator);
+		if (vkd.vkMapMemory(device, m_memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&m_data)) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map ring buffer memory!");
+		}
+		m_frameBegin = 0;
+		m_head = 0;
+		m_peakFrameUsage = 0;
+	}
+
+	void RingBuffer::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		vkd.vkDestroyBuffer(m_device, m_buffer, m_allocator);
+		vkd.vkFreeMemory(m_device, m_memory, m_allocator);
+		m_buffer = VK_NULL_HANDLE;
+		m_memory = VK_NULL_HANDLE;
+		m_data = nullptr;
+		m_device = VK_NULL_HANDLE;
+	}
+
+	void RingBuffer::beginFrame(uint32_t frameIndex)
+	{
+		m_frameBegin = m_frameSize * frameIndex;
+		m_head = m_frameBegin;
+	}
+
+	RingBufferAllocation RingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		alignment = std::max(alignment, m_minAlignment);
+		VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+		if (offset + size > m_frameBegin + m_frameSize)
+		{
+			throw std::runtime_error("failed to allocate from ring buffer, frame region exhausted!");
+		}
+		m_head = offset + size;
+		m_peakFrameUsage = std::max(m_peakFrameUsage, m_head - m_frameBegin);
+		return { m_buffer, offset, size, m_data + offset };
+	}
+} // namespace PVulkanExamples
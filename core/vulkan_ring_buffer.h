@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+namespace PVulkanExamples
+{
+	struct RingBufferAllocation
+	{
+		VkBuffer        buffer{ VK_NULL_HANDLE };
+		VkDeviceSize    offset{ 0 };
+		VkDeviceSize    size{ 0 };
+		void*           pData{ nullptr };   // Host pointer to offset, writes are visible to the GPU at the next submission
+	};
+
+	/*
+	* Persistently mapped, host coherent buffer for data written every frame: uniforms, dynamic storage data and staging
+	* copies. The buffer is split into one region per frame in flight. Allocations are bump allocated from the region of
+	* the current frame at the alignment of uniform and storage buffer offsets, and beginFrame releases a region as a
+	* whole once the fence of its frame slot has signaled, so per frame data needs neither buffers of its own nor any
+	* synchronization beyond the frame fences.
+	*/
+	class RingBuffer
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize frameSize, VkBufferUsageFlags usage, uint32_t frameCount,
+			const VkAllocationCallbacks* pAllocator = nullptr);
+		void cleanup();
+
+		// Release the region of the frame slot, its previous frame has completed
+		void beginFrame(uint32_t frameIndex);
+		// Alignment 0 uses the offset alignment of uniform and storage buffers, throws when the frame region is exhausted
+		RingBufferAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+		VkBuffer getBuffer() const { return m_buffer; }
+		VkDeviceSize getFrameSize() const { return m_frameSize; }
+		VkDeviceSize getFrameUsage() const { return m_head - m_frameBegin; }
+		// Bytes left in the current frame region, an allocation can lose up to getMinAlignment() - 1 of them to padding
+		VkDeviceSize getFrameAvailable() const { return m_frameBegin + m_frameSize - m_head; }
+		VkDeviceSize getMinAlignment() const { return m_minAlignment; }
+		VkDeviceSize getPeakFrameUsage() const { return m_peakFrameUsage; }
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		VkBuffer                        m_buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory                  m_memory{ VK_NULL_HANDLE };
+		uint8_t*                        m_data{ nullptr };
+		VkDeviceSize                    m_frameSize{ 0 };
+		VkDeviceSize                    m_minAlignment{ 1 };
+		VkDeviceSize                    m_frameBegin{ 0 };
+		VkDeviceSize                    m_head{ 0 };    // Next free byte of the current frame region
+		VkDeviceSize                    m_peakFrameUsage{ 0 };
+	};
+} // namespace PVulkanExamples
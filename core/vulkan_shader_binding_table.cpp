@@ -0,0 +1,231 @@
+#include "vulkan_shader_binding_table.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr VkDeviceSize MAX_UPDATE_BUFFER_SIZE = 65536;  // vkCmdUpdateBuffer limit
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		void bufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+			VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			vkd.vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		}
+	}
+
+	void ShaderBindingTable::init(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* pAllocator)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		m_allocator = pAllocator;
+
+		VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayTracingProperties{};
+		rayTracingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &rayTracingProperties;
+		vkd.vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+		m_handleSize = rayTracingProperties.shaderGroupHandleSize;
+		m_handleAlignment = std::max(rayTracingProperties.shaderGroupHandleAlignment, 4u);     // Keeps updates 4 byte aligned
+		m_baseAlignment = std::max(rayTracingProperties.shaderGroupBaseAlignment, m_handleAlignment);
+		m_maxStride = rayTracingProperties.maxShaderGroupStride;
+	}
+
+	void ShaderBindingTable::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		destroyBuffer();
+		for (std::vector<Record>& records : m_records) records.clear();
+		m_handles.clear();
+		m_tableData.clear();
+		m_dirtyRanges.clear();
+		m_device = VK_NULL_HANDLE;
+	}
+
+	uint32_t ShaderBindingTable::addRecord(ShaderRecordKind kind, uint32_t group, const void* pData, uint32_t dataSize, uint32_t maxDataSize)
+	{
+		Record record{};
+		record.group = group;
+		record.data.assign(static_cast<const uint8_t*>(pData), static_cast<const uint8_t*>(pData) + (pData != nullptr ? dataSize : 0));
+		record.maxDataSize = std::max(dataSize, maxDataSize);
+		std::vector<Record>& records = m_records[static_cast<size_t>(kind)];
+		records.push_back(record);
+		return static_cast<uint32_t>(records.size() - 1);
+	}
+
+	/*
+	* Regions in ray generation, miss, hit, callable order. Ray generation records are traced one at a time,
+	* each of them starts at the base alignment.
+	*/
+	void ShaderBindingTable::build(VkPipeline pipeline)
+	{
+		uint32_t groupCount = 0;
+		VkDeviceSize tableSize = 0;
+		for (size_t kind = 0; kind < KIND_COUNT; kind++)
+		{
+			uint32_t maxDataSize = 0;
+			for (const Record& record : m_records[kind])
+			{
+				maxDataSize = std::max(maxDataSize, record.maxDataSize);
+				groupCount = std::max(groupCount, record.group + 1);
+			}
+			VkDeviceSize stride = alignUp(m_handleSize + maxDataSize, kind == static_cast<size_t>(ShaderRecordKind::RayGen) ? m_baseAlignment : m_handleAlignment);
+			if (stride > m_maxStride)
+			{
+				throw std::runtime_error("shader binding table record stride exceeds maxShaderGroupStride!");
+			}
+			m_regionOffsets[kind] = alignUp(tableSize, m_baseAlignment);
+			m_regions[kind].stride = m_records[kind].empty() ? 0 : stride;
+			m_regions[kind].size = stride * m_records[kind].size();
+			tableSize = m_regionOffsets[kind] + m_regions[kind].size;
+		}
+
+		m_handles.resize(size_t(groupCount) * m_handleSize);
+		if (groupCount > 0 && vkd.vkGetRayTracingShaderGroupHandlesKHR(m_device, pipeline, 0, groupCount, m_handles.size(), m_handles.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to get ray tracing shader group handles!");
+		}
+
+		// Room to align the start of the table, a larger table replaces the buffer
+		VkDeviceSize bufferSize = alignUp(tableSize, m_handleAlignment) + m_baseAlignment;
+		if (bufferSize > m_bufferSize)
+		{
+			destroyBuffer();
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, bufferSize,
+				VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_buffer, m_memory, m_allocator);
+			m_bufferSize = bufferSize;
+		}
+		VkBufferDeviceAddressInfo addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressInfo.buffer = m_buffer;
+		VkDeviceAddress bufferAddress = vkd.vkGetBufferDeviceAddress(m_device, &addressInfo);
+		VkDeviceAddress tableAddress = alignUp(bufferAddress, m_baseAlignment);
+		m_bufferOffset = tableAddress - bufferAddress;
+		for (size_t kind = 0; kind < KIND_COUNT; kind++)
+		{
+			m_regions[kind].deviceAddress = m_records[kind].empty() ? 0 : tableAddress + m_regionOffsets[kind];
+		}
+
+		m_tableData.assign(alignUp(tableSize, m_handleAlignment), 0);
+		for (size_t kind = 0; kind < KIND_COUNT; kind++)
+		{
+			for (uint32_t record = 0; record < m_records[kind].size(); record++)
+			{
+				writeRecord(static_cast<ShaderRecordKind>(kind), record);
+			}
+		}
+		m_dirtyRanges.clear();
+		markDirty(0, m_tableData.size());
+	}
+
+	void ShaderBindingTable::setRecord(ShaderRecordKind kind, uint32_t record, uint32_t group, const void* pData, uint32_t dataSize)
+	{
+		Record& target = m_records[static_cast<size_t>(kind)][record];
+		if (dataSize > target.maxDataSize)
+		{
+			throw std::runtime_error("shader record data exceeds the size declared for the record!");
+		}
+		if (size_t(group + 1) * m_handleSize > m_handles.size())
+		{
+			throw std::runtime_error("shader record group is not part of the pipeline the table was built for!");
+		}
+		target.group = group;
+		target.data.assign(static_cast<const uint8_t*>(pData), static_cast<const uint8_t*>(pData) + (pData != nullptr ? dataSize : 0));
+		writeRecord(kind, record);
+		markDirty(getRecordOffset(kind, record), m_handleSize + target.maxDataSize);
+	}
+
+	/*
+	* Changed ranges go through vkCmdUpdateBuffer, tables change rarely and by a few records
+	*/
+	void ShaderBindingTable::flush(VkCommandBuffer commandBuffer)
+	{
+		if (m_dirtyRanges.empty()) return;
+		bufferBarrier(commandBuffer, m_buffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		for (const auto& range : m_dirtyRanges)
+		{
+			for (VkDeviceSize offset = range.first; offset < range.first + range.second; offset += MAX_UPDATE_BUFFER_SIZE)
+			{
+				VkDeviceSize size = std::min(MAX_UPDATE_BUFFER_SIZE, range.first + range.second - offset);
+				vkd.vkCmdUpdateBuffer(commandBuffer, m_buffer, m_bufferOffset + offset, size, m_tableData.data() + offset);
+			}
+		}
+		bufferBarrier(commandBuffer, m_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT);
+		m_dirtyRanges.clear();
+	}
+
+	VkStridedDeviceAddressRegionKHR ShaderBindingTable::getRayGenRegion(uint32_t record) const
+	{
+		const VkStridedDeviceAddressRegionKHR& region = m_regions[static_cast<size_t>(ShaderRecordKind::RayGen)];
+		return { region.deviceAddress + record * region.stride, region.stride, region.stride };
+	}
+
+	VkDeviceSize ShaderBindingTable::getRecordOffset(ShaderRecordKind kind, uint32_t record) const
+	{
+		return m_regionOffsets[static_cast<size_t>(kind)] + record * m_regions[static_cast<size_t>(kind)].stride;
+	}
+
+	void ShaderBindingTable::writeRecord(ShaderRecordKind kind, uint32_t record)
+	{
+		const Record& source = m_records[static_cast<size_t>(kind)][record];
+		uint8_t* destination = m_tableData.data() + getRecordOffset(kind, record);
+		std::memcpy(destination, m_handles.data() + size_t(source.group) * m_handleSize, m_handleSize);
+		std::memset(destination + m_handleSize, 0, source.maxDataSize);
+		if (!source.data.empty()) std::memcpy(destination + m_handleSize, source.data.data(), source.data.size());
+	}
+
+	/*
+	* Ranges are widened to 4 bytes for vkCmdUpdateBuffer and merged with overlapping or touching ones
+	*/
+	void ShaderBindingTable::markDirty(VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkDeviceSize begin = offset / 4 * 4;
+		VkDeviceSize end = std::min<VkDeviceSize>(alignUp(offset + size, 4), m_tableData.size());
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> merged;
+		for (const auto& range : m_dirtyRanges)
+		{
+			if (range.first + range.second < begin || end < range.first)
+			{
+				merged.push_back(range);
+				continue;
+			}
+			begin = std::min(begin, range.first);
+			end = std::max(end, range.first + range.second);
+		}
+		merged.emplace_back(begin, end - begin);
+		std::sort(merged.begin(), merged.end());
+		m_dirtyRanges = merged;
+	}
+
+	void ShaderBindingTable::destroyBuffer()
+	{
+		vkd.vkDestroyBuffer(m_device, m_buffer, m_allocator);
+		vkd.vkFreeMemory(m_device, m_memory, m_allocator);
+		m_buffer = VK_NULL_HANDLE;
+		m_memory = VK_NULL_HANDLE;
+		m_bufferSize = 0;
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <utility>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	enum class ShaderRecordKind
+	{
+		RayGen,
+		Miss,
+		Hit,
+		Callable,
+	};
+
+	/*
+	* Shader binding table of a ray tracing pipeline in one device buffer.
+	* Records are a shader group handle followed by inline data read through shaderRecordEXT. Each kind of record gets its
+	* own region whose stride is the handle plus the largest inline data of the region rounded up to shaderGroupHandleAlignment,
+	* regions start at shaderGroupBaseAlignment. build lays the table out and fetches the handles, setRecord changes the
+	* group or data of a record afterwards without changing the layout. Changes are written to the buffer by flush,
+	* recorded in the frame command buffer before the rays are traced, only the changed byte ranges are transferred.
+	*/
+	class ShaderBindingTable
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* pAllocator);
+		void cleanup();
+
+		// Declare a record of the group with room for maxDataSize bytes of inline data, returns its index within its region
+		uint32_t addRecord(ShaderRecordKind kind, uint32_t group, const void* pData = nullptr, uint32_t dataSize = 0, uint32_t maxDataSize = 0);
+		// Lay out the regions, fetch the group handles of the pipeline and create the buffer, the whole table is written by the next flush.
+		// A table outgrowing its buffer replaces it, traces using the old buffer must have completed
+		void build(VkPipeline pipeline);
+		// Point a record at another group or replace its inline data, the data must fit the room declared by addRecord
+		void setRecord(ShaderRecordKind kind, uint32_t record, uint32_t group, const void* pData = nullptr, uint32_t dataSize = 0);
+		// Write the changed records, earlier ray tracing reads are waited for and traces recorded afterwards see the new records
+		void flush(VkCommandBuffer commandBuffer);
+
+		// Ray generation region holding one record, as vkCmdTraceRaysKHR expects
+		VkStridedDeviceAddressRegionKHR getRayGenRegion(uint32_t record = 0) const;
+		const VkStridedDeviceAddressRegionKHR& getMissRegion() const { return m_regions[static_cast<size_t>(ShaderRecordKind::Miss)]; }
+		const VkStridedDeviceAddressRegionKHR& getHitRegion() const { return m_regions[static_cast<size_t>(ShaderRecordKind::Hit)]; }
+		const VkStridedDeviceAddressRegionKHR& getCallableRegion() const { return m_regions[static_cast<size_t>(ShaderRecordKind::Callable)]; }
+		VkDeviceSize getSize() const { return m_tableData.size(); }
+		// Host copy of the table and the byte ranges of it the next flush writes, offset and size
+		const std::vector<uint8_t>& getTableData() const { return m_tableData; }
+		const std::vector<std::pair<VkDeviceSize, VkDeviceSize>>& getDirtyRanges() const { return m_dirtyRanges; }
+
+	private:
+		struct Record
+		{
+			uint32_t                group{ 0 };
+			std::vector<uint8_t>    data{};
+			uint32_t                maxDataSize{ 0 };
+		};
+
+		static constexpr size_t KIND_COUNT = 4;
+
+		VkDeviceSize getRecordOffset(ShaderRecordKind kind, uint32_t record) const;
+		void writeRecord(ShaderRecordKind kind, uint32_t record);
+		void markDirty(VkDeviceSize offset, VkDeviceSize size);
+		void destroyBuffer();
+
+	private:
+		VkPhysicalDevice                m_physicalDevice{ VK_NULL_HANDLE };
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		uint32_t                        m_handleSize{ 32 };
+		uint32_t                        m_handleAlignment{ 32 };
+		uint32_t                        m_baseAlignment{ 64 };
+		uint32_t                        m_maxStride{ 4096 };
+
+		std::vector<Record>             m_records[KIND_COUNT]{};
+		VkDeviceSize                    m_regionOffsets[KIND_COUNT]{};
+		VkStridedDeviceAddressRegionKHR m_regions[KIND_COUNT]{};
+		std::vector<uint8_t>            m_handles{};
+		std::vector<uint8_t>            m_tableData{};      // Host copy of the buffer contents
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> m_dirtyRanges{};     // Offset and size, sorted and disjoint
+
+		VkBuffer                        m_buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory                  m_memory{ VK_NULL_HANDLE };
+		VkDeviceSize                    m_bufferOffset{ 0 };    // Where the table starts, aligning its device address
+		VkDeviceSize                    m_bufferSize{ 0 };
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,298 @@
+#include "vulkan_shader_hot_reload.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		const std::vector<std::string> shaderSourceExtensions = {
+			".vert", ".frag", ".comp", ".geom", ".tesc", ".tese", ".mesh", ".task",
+			".rgen", ".rchit", ".rahit", ".rmiss", ".rint", ".rcall"
+		};
+		const std::vector<std::string> shaderHeaderExtensions = { ".glsl", ".h" };
+
+		bool hasExtension(const std::string& path, const std::vector<std::string>& extensions)
+		{
+			std::string extension = std::filesystem::path(path).extension().string();
+			return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+		}
+
+		std::string normalizePath(const std::string& path)
+		{
+			return std::filesystem::weakly_canonical(std::filesystem::path(path)).string();
+		}
+	}
+
+
+
+	/*
+	* Start watching the given directories, the callback runs on the watcher thread
+	*/
+	bool ShaderFileWatcher::start(const std::vector<std::string>& directories, ChangeCallback callback)
+	{
+		stop();
+#ifdef __linux__
+		m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotifyFd < 0)
+		{
+			std::cerr << "shader hot reload: inotify_init1 failed" << std::endl;
+			return false;
+		}
+		for (const std::string& directory : directories)
+		{
+			// Editors often save through a temporary file and a rename, so catch moves as well as writes
+			int wd = inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (wd < 0)
+			{
+				std::cerr << "shader hot reload: cannot watch " << directory << std::endl;
+				continue;
+			}
+			m_watchDirectories[wd] = directory;
+		}
+		m_callback = callback;
+		m_running = true;
+		m_thread = std::thread(&ShaderFileWatcher::watchLoop, this);
+		return true;
+#else
+		std::cerr << "shader hot reload: file watching is only implemented with inotify on Linux" << std::endl;
+		return false;
+#endif
+	}
+
+	void ShaderFileWatcher::stop()
+	{
+		m_running = false;
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+		}
+#ifdef __linux__
+		if (m_inotifyFd >= 0)
+		{
+			close(m_inotifyFd);
+			m_inotifyFd = -1;
+		}
+#endif
+		m_watchDirectories.clear();
+	}
+
+	/*
+	* Poll inotify events, bursts of events are coalesced so one save triggers one callback
+	*/
+	void ShaderFileWatcher::watchLoop()
+	{
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		std::vector<std::string> changedFiles;
+		auto readEvents = [&]()
+		{
+			ssize_t length;
+			while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+			{
+				for (char* p = buffer; p < buffer + length; )
+				{
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+					auto directoryIt = m_watchDirectories.find(event->wd);
+					if (event->len > 0 && directoryIt != m_watchDirectories.end())
+					{
+						std::string file = directoryIt->second + "/" + event->name;
+						if (std::find(changedFiles.begin(), changedFiles.end(), file) == changedFiles.end())
+							changedFiles.push_back(file);
+					}
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+		};
+
+		while (m_running)
+		{
+			pollfd pfd{ m_inotifyFd, POLLIN, 0 };
+			if (poll(&pfd, 1, 100) <= 0) continue;
+
+			readEvents();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Debounce
+			readEvents();
+
+			if (!changedFiles.empty() && m_callback)
+			{
+				m_callback(changedFiles);
+			}
+			changedFiles.clear();
+		}
+#endif
+	}
+
+
+
+	void ShaderHotReloader::init(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight)
+	{
+		m_device = device;
+		m_pipelineCache = pipelineCache;
+		m_allocator = pAllocator;
+		m_maxFrameInFlight = maxFrameInFlight;
+	}
+
+	void ShaderHotReloader::cleanup()
+	{
+		m_watcher.stop();
+		for (RetiredPipeline& retired : m_retiredPipelines)
+			vkd.vkDestroyPipeline(m_device, retired.pipeline, m_allocator);
+		for (RegisteredPipeline& registered : m_pipelines)
+			if (registered.pipeline != VK_NULL_HANDLE) vkd.vkDestroyPipeline(m_device, registered.pipeline, m_allocator);
+		m_retiredPipelines.clear();
+		m_pipelines.clear();
+		m_watchedDirectories.clear();
+		m_knownSources.clear();
+		m_pendingSources.clear();
+	}
+
+	/*
+	* Add a shader source directory to the watch list
+	*/
+	bool ShaderHotReloader::watchDirectory(const std::string& directory)
+	{
+		std::string normalized = normalizePath(directory);
+		if (std::find(m_watchedDirectories.begin(), m_watchedDirectories.end(), normalized) == m_watchedDirectories.end())
+		{
+			m_watchedDirectories.push_back(normalized);
+		}
+		return m_watcher.start(m_watchedDirectories, [this](const std::vector<std::string>& changedFiles) { onFilesChanged(changedFiles); });
+	}
+
+	/*
+	* Register a pipeline built from the given GLSL sources, the pipeline is created right away from the compiled SPIR-V
+	*/
+	uint32_t ShaderHotReloader::registerPipeline(const std::vector<std::string>& glslSources, PipelineBuilder builder)
+	{
+		RegisteredPipeline registered{};
+		std::vector<std::vector<uint32_t>> spirvStages;
+		for (const std::string& source : glslSources)
+		{
+			registered.sources.push_back(normalizePath(source));
+			spirvStages.push_back(VulkanUtil::readSpirvFile(spirvPath(registered.sources.back())));
+		}
+		registered.builder = builder;
+		registered.pipeline = builder(spirvStages, m_pipelineCache);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_knownSources.insert(registered.sources.begin(), registered.sources.end());
+		}
+		m_pipelines.push_back(registered);
+		return static_cast<uint32_t>(m_pipelines.size() - 1);
+	}
+
+	/*
+	* Swap in pipelines whose shaders were recompiled since the last frame, and destroy retired pipelines
+	* no frame in flight can reference anymore
+	*/
+	void ShaderHotReloader::applyPendingReloads()
+	{
+		for (auto it = m_retiredPipelines.begin(); it != m_retiredPipelines.end(); )
+		{
+			if (--it->framesRemaining == 0)
+			{
+				vkd.vkDestroyPipeline(m_device, it->pipeline, m_allocator);
+				it = m_retiredPipelines.erase(it);
+			}
+			else ++it;
+		}
+
+		std::set<std::string> changedSources;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_pendingSources.empty()) return;
+			changedSources.swap(m_pendingSources);
+		}
+
+		for (RegisteredPipeline& registered : m_pipelines)
+		{
+			bool affected = std::any_of(registered.sources.begin(), registered.sources.end(),
+				[&](const std::string& source) { return changedSources.count(source) > 0; });
+			if (!affected) continue;
+
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			try
+			{
+				std::vector<std::vector<uint32_t>> spirvStages;
+				for (const std::string& source : registered.sources)
+					spirvStages.push_back(VulkanUtil::readSpirvFile(spirvPath(source)));
+				pipeline = registered.builder(spirvStages, m_pipelineCache);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "shader hot reload: failed to rebuild pipeline: " << e.what() << std::endl;
+			}
+			if (pipeline == VK_NULL_HANDLE) continue; // Keep rendering with the previous pipeline
+
+			m_retiredPipelines.push_back({ registered.pipeline, m_maxFrameInFlight });
+			registered.pipeline = pipeline;
+		}
+	}
+
+	/*
+	* Runs on the watcher thread: recompile touched sources, a touched header recompiles every known source next to it
+	*/
+	void ShaderHotReloader::onFilesChanged(const std::vector<std::string>& changedFiles)
+	{
+		std::set<std::string> toCompile;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (const std::string& file : changedFiles)
+			{
+				std::string normalized = normalizePath(file);
+				if (hasExtension(normalized, shaderSourceExtensions))
+				{
+					if (m_knownSources.count(normalized)) toCompile.insert(normalized);
+				}
+				else if (hasExtension(normalized, shaderHeaderExtensions))
+				{
+					std::filesystem::path directory = std::filesystem::path(normalized).parent_path();
+					for (const std::string& source : m_knownSources)
+						if (std::filesystem::path(source).parent_path() == directory) toCompile.insert(source);
+				}
+			}
+		}
+
+		for (const std::string& source : toCompile)
+		{
+			if (compile(source))
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pendingSources.insert(source);
+			}
+		}
+	}
+
+	/*
+	* Compile a GLSL source next to itself, mirroring the build time shader compilation
+	*/
+	bool ShaderHotReloader::compile(const std::string& glslSource)
+	{
+		if (m_compilerPath.empty())
+		{
+			std::cerr << "shader hot reload: no GLSL compiler configured" << std::endl;
+			return false;
+		}
+		std::string command = "\"" + m_compilerPath + "\" " + m_compilerFlags + " -o \"" + spirvPath(glslSource) + "\" \"" + glslSource + "\"";
+		if (std::system(command.c_str()) != 0)
+		{
+			std::cerr << "shader hot reload: compilation failed, keeping previous pipeline for " << glslSource << "\n  " << command << std::endl;
+			return false;
+		}
+		return true;
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace PVulkanExamples
+{
+	/*
+	* Watches directories for modified files on a background thread (inotify, Linux only)
+	*/
+	class ShaderFileWatcher
+	{
+	public:
+		using ChangeCallback = std::function<void(const std::vector<std::string>& changedFiles)>;
+
+		~ShaderFileWatcher() { stop(); }
+
+		bool start(const std::vector<std::string>& directories, ChangeCallback callback);
+		void stop();
+		bool isRunning() const { return m_running; }
+
+	private:
+		void watchLoop();
+
+	private:
+		std::thread         m_thread{};
+		std::atomic<bool>   m_running{ false };
+		ChangeCallback      m_callback{};
+		int                 m_inotifyFd{ -1 };
+		std::map<int, std::string> m_watchDirectories{};
+	};
+
+	/*
+	* Recompiles edited GLSL sources in the background and rebuilds only the pipelines using them.
+	* New pipelines are created through the pipeline cache while the old ones keep rendering, they are
+	* swapped in at a frame boundary and the replaced pipelines are destroyed once every frame in flight
+	* that could still reference them has signaled its fence.
+	*/
+	class ShaderHotReloader
+	{
+	public:
+		// Builds a pipeline from the SPIR-V of each registered source, in registration order
+		using PipelineBuilder = std::function<VkPipeline(const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)>;
+
+		~ShaderHotReloader() { cleanup(); }
+
+		void init(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight);
+		void cleanup();
+
+		bool watchDirectory(const std::string& directory);
+
+		uint32_t registerPipeline(const std::vector<std::string>& glslSources, PipelineBuilder builder);
+		VkPipeline getPipeline(uint32_t pipelineId) const { return m_pipelines[pipelineId].pipeline; }
+
+		// Call once per frame after the fence of the frame about to be recorded has been waited on
+		void applyPendingReloads();
+
+		static std::string spirvPath(const std::string& glslSource) { return glslSource + ".spv"; }
+
+	public:
+		std::string m_compilerPath{};
+		std::string m_compilerFlags{ "-g --target-env vulkan1.2" }; // Same flags as compile_glsl in ShaderCompile.cmake
+
+	private:
+		struct RegisteredPipeline
+		{
+			std::vector<std::string>    sources{};
+			PipelineBuilder             builder{};
+			VkPipeline                  pipeline{ VK_NULL_HANDLE };
+		};
+
+		struct RetiredPipeline
+		{
+			VkPipeline  pipeline{ VK_NULL_HANDLE };
+			uint32_t    framesRemaining{ 0 };
+		};
+
+		void onFilesChanged(const std::vector<std::string>& changedFiles);
+		bool compile(const std::string& glslSource);
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		VkPipelineCache                 m_pipelineCache{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		uint32_t                        m_maxFrameInFlight{ 3 };
+
+		ShaderFileWatcher               m_watcher{};
+		std::vector<std::string>        m_watchedDirectories{};
+		std::vector<RegisteredPipeline> m_pipelines{};
+		std::vector<RetiredPipeline>    m_retiredPipelines{};
+
+		std::mutex                      m_mutex{};          // Guards everything below, shared with the watcher thread
+		std::set<std::string>           m_knownSources{};
+		std::set<std::string>           m_pendingSources{}; // Sources recompiled successfully since the last frame boundary
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,268 @@
+#include "vulkan_shader_permutations.h"
+#include "vulkan_dispatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		/*
+		* FNV-1a over the canonical constant values, the shader id is mixed in so keys are unique per manager
+		*/
+		ShaderPermutationKey hashPermutation(uint32_t shaderId, const std::vector<uint64_t>& values)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			auto mix = [&hash](uint64_t word)
+			{
+				for (int byte = 0; byte < 8; byte++)
+				{
+					hash ^= (word >> (byte * 8)) & 0xFF;
+					hash *= 0x100000001b3ull;
+				}
+			};
+			mix(shaderId);
+			for (uint64_t value : values) mix(value);
+			return hash;
+		}
+	}
+
+
+
+	void ShaderPermutationManager::init(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight)
+	{
+		m_device = device;
+		m_pipelineCache = pipelineCache;
+		m_allocator = pAllocator;
+		m_maxFrameInFlight = maxFrameInFlight;
+	}
+
+	void ShaderPermutationManager::cleanup()
+	{
+		for (RetiredPipeline& retired : m_retiredPipelines)
+			vkd.vkDestroyPipeline(m_device, retired.pipeline, m_allocator);
+		for (ShaderFamily& family : m_shaders)
+			for (auto& [key, permutation] : family.permutations)
+				if (permutation.pipeline != VK_NULL_HANDLE) vkd.vkDestroyPipeline(m_device, permutation.pipeline, m_allocator);
+		m_retiredPipelines.clear();
+		m_shaders.clear();
+		m_statistics = {};
+		m_frame = 0;
+	}
+
+	/*
+	* Declare a set of shader stages whose permutations differ only by specialization constants.
+	* The constants are taken from the reflected stages, a constant shared by several stages is declared once.
+	*/
+	uint32_t ShaderPermutationManager::declareShader(const std::vector<ShaderReflection>& stages, PipelineBuilder builder)
+	{
+		ShaderFamily family{};
+		for (const ShaderReflection& stage : stages)
+		{
+			for (const ShaderSpecializationConstant& constant : stage.specializationConstants)
+			{
+				auto it = std::find_if(family.constants.begin(), family.constants.end(),
+					[&](const ShaderSpecializationConstant& c) { return c.constantId == constant.constantId; });
+				if (it == family.constants.end())
+				{
+					family.constants.push_back(constant);
+				}
+				else if (it->size != constant.size)
+				{
+					throw std::runtime_error("specialization constant " + std::to_string(constant.constantId) + " has different sizes across stages");
+				}
+			}
+		}
+		std::sort(family.constants.begin(), family.constants.end(),
+			[](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b) { return a.constantId < b.constantId; });
+		family.builder = builder;
+		m_shaders.push_back(std::move(family));
+		return static_cast<uint32_t>(m_shaders.size() - 1);
+	}
+
+	/*
+	* Declare a permutation by constant id, unspecified constants keep their default value.
+	* Nothing is compiled until the permutation is first requested.
+	*/
+	ShaderPermutationKey ShaderPermutationManager::declarePermutation(uint32_t shaderId, const std::map<uint32_t, uint64_t>& values)
+	{
+		ShaderFamily& family = m_shaders.at(shaderId);
+
+		Permutation permutation{};
+		permutation.values.reserve(family.constants.size());
+		for (const ShaderSpecializationConstant& constant : family.constants)
+		{
+			auto it = values.find(constant.constantId);
+			uint64_t value = it != values.end() ? it->second : constant.defaultValue;
+			if (constant.isBool) value = value != 0 ? VK_TRUE : VK_FALSE;
+			if (constant.size < sizeof(uint64_t)) value &= (uint64_t(1) << (constant.size * 8)) - 1;
+			permutation.values.push_back(value);
+		}
+		for (const auto& [constantId, value] : values)
+		{
+			if (std::none_of(family.constants.begin(), family.constants.end(),
+				[constantId = constantId](const ShaderSpecializationConstant& c) { return c.constantId == constantId; }))
+			{
+				throw std::runtime_error("shader has no specialization constant with id " + std::to_string(constantId));
+			}
+		}
+
+		ShaderPermutationKey key = hashPermutation(shaderId, permutation.values);
+		auto it = family.permutations.find(key);
+		if (it != family.permutations.end())
+		{
+			if (it->second.values != permutation.values)
+			{
+				throw std::runtime_error("shader permutation hash collision");
+			}
+			m_statistics.deduplicated++;
+			return key;
+		}
+		family.permutations[key] = std::move(permutation);
+		return key;
+	}
+
+	/*
+	* Declare a permutation by constant name as written in the shader
+	*/
+	ShaderPermutationKey ShaderPermutationManager::declarePermutation(uint32_t shaderId, const std::map<std::string, uint64_t>& namedValues)
+	{
+		const ShaderFamily& family = m_shaders.at(shaderId);
+		std::map<uint32_t, uint64_t> values;
+		for (const auto& [name, value] : namedValues)
+		{
+			auto it = std::find_if(family.constants.begin(), family.constants.end(),
+				[&name = name](const ShaderSpecializationConstant& c) { return c.name == name; });
+			if (it == family.constants.end())
+			{
+				throw std::runtime_error("shader has no specialization constant named " + name);
+			}
+			values[it->constantId] = value;
+		}
+		return declarePermutation(shaderId, values);
+	}
+
+	/*
+	* Return the pipeline of a declared permutation, compiling it on first use
+	*/
+	VkPipeline ShaderPermutationManager::getPipeline(uint32_t shaderId, ShaderPermutationKey key)
+	{
+		ShaderFamily& family = m_shaders.at(shaderId);
+		auto it = family.permutations.find(key);
+		if (it == family.permutations.end())
+		{
+			throw std::runtime_error("shader permutation was not declared");
+		}
+
+		Permutation& permutation = it->second;
+		if (permutation.pipeline == VK_NULL_HANDLE)
+		{
+			permutation.pipeline = compile(family, permutation);
+			m_statistics.compilations++;
+		}
+		permutation.useCount++;
+		permutation.lastUsedFrame = m_frame;
+		m_statistics.requests++;
+		return permutation.pipeline;
+	}
+
+	/*
+	* Advance the frame counter and destroy evicted pipelines no frame in flight can still use
+	*/
+	void ShaderPermutationManager::nextFrame()
+	{
+		m_frame++;
+		auto retiredEnd = std::remove_if(m_retiredPipelines.begin(), m_retiredPipelines.end(), [this](const RetiredPipeline& retired)
+		{
+			if (m_frame - retired.retireFrame < m_maxFrameInFlight) return false;
+			vkd.vkDestroyPipeline(m_device, retired.pipeline, m_allocator);
+			return true;
+		});
+		m_retiredPipelines.erase(retiredEnd, m_retiredPipelines.end());
+	}
+
+	/*
+	* Evict compiled permutations idle for more than maxIdleFrames, they stay declared and recompile on demand
+	*/
+	size_t ShaderPermutationManager::evictUnused(uint32_t maxIdleFrames)
+	{
+		size_t evicted = 0;
+		for (ShaderFamily& family : m_shaders)
+		{
+			for (auto& [key, permutation] : family.permutations)
+			{
+				if (permutation.pipeline == VK_NULL_HANDLE || m_frame - permutation.lastUsedFrame <= maxIdleFrames) continue;
+				m_retiredPipelines.push_back({ permutation.pipeline, m_frame });
+				permutation.pipeline = VK_NULL_HANDLE;
+				evicted++;
+			}
+		}
+		m_statistics.evictions += evicted;
+		return evicted;
+	}
+
+	/*
+	* Print usage of every permutation, rarely used variants are candidates for eviction
+	*/
+	void ShaderPermutationManager::printStatistics() const
+	{
+		std::cout << "\n=============================Shader permutations=============================";
+		std::cout << "\nrequests: " << m_statistics.requests << "  compilations: " << m_statistics.compilations
+			<< "  evictions: " << m_statistics.evictions << "  deduplicated: " << m_statistics.deduplicated;
+		for (size_t shaderId = 0; shaderId < m_shaders.size(); shaderId++)
+		{
+			for (const auto& [key, permutation] : m_shaders[shaderId].permutations)
+			{
+				std::cout << "\nshader " << shaderId << " permutation " << std::hex << std::setw(16) << std::setfill('0') << key << std::dec << std::setfill(' ')
+					<< "  uses: " << std::setw(10) << std::left << permutation.useCount << std::right
+					<< "  last used frame: " << permutation.lastUsedFrame
+					<< (permutation.pipeline != VK_NULL_HANDLE ? "  resident" : "");
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	/*
+	* Raw bits of a float constant, for use in declarePermutation
+	*/
+	uint64_t ShaderPermutationManager::floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	VkPipeline ShaderPermutationManager::compile(const ShaderFamily& family, const Permutation& permutation)
+	{
+		std::vector<VkSpecializationMapEntry> mapEntries;
+		std::vector<uint8_t> data;
+		for (size_t i = 0; i < family.constants.size(); i++)
+		{
+			const ShaderSpecializationConstant& constant = family.constants[i];
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constant.constantId;
+			entry.offset = static_cast<uint32_t>(data.size());
+			entry.size = constant.size;
+			mapEntries.push_back(entry);
+			data.resize(data.size() + constant.size);
+			std::memcpy(data.data() + entry.offset, &permutation.values[i], constant.size); // Little endian, low bytes first
+		}
+
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+		specializationInfo.pMapEntries = mapEntries.data();
+		specializationInfo.dataSize = data.size();
+		specializationInfo.pData = data.data();
+
+		VkPipeline pipeline = family.builder(specializationInfo, m_pipelineCache);
+		if (pipeline == VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("failed to create shader permutation pipeline!");
+		}
+		return pipeline;
+	}
+} // namespace PVulkanExamples
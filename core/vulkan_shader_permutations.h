@@ -0,0 +1,86 @@
+#pragma once
+
+#include "vulkan_shader_reflection.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+
+namespace PVulkanExamples
+{
+	typedef uint64_t ShaderPermutationKey;
+
+	struct ShaderPermutationStatistics
+	{
+		uint64_t    requests{ 0 };          // getPipeline calls
+		uint64_t    compilations{ 0 };      // Pipelines created, first use or after eviction
+		uint64_t    evictions{ 0 };
+		uint64_t    deduplicated{ 0 };      // Declarations folded into an existing permutation
+	};
+
+	/*
+	* Shader permutations expressed as specialization constant values of one set of SPIR-V modules.
+	* Permutations are deduplicated by hash, compiled lazily through the pipeline cache on first use
+	* and can be evicted again when they have not been used for a number of frames.
+	*/
+	class ShaderPermutationManager
+	{
+	public:
+		using PipelineBuilder = std::function<VkPipeline(const VkSpecializationInfo& specializationInfo, VkPipelineCache pipelineCache)>;
+
+		void init(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight);
+		void cleanup();
+
+		uint32_t declareShader(const std::vector<ShaderReflection>& stages, PipelineBuilder builder);
+		ShaderPermutationKey declarePermutation(uint32_t shaderId, const std::map<uint32_t, uint64_t>& values);
+		ShaderPermutationKey declarePermutation(uint32_t shaderId, const std::map<std::string, uint64_t>& namedValues);
+
+		VkPipeline getPipeline(uint32_t shaderId, ShaderPermutationKey key);
+
+		void nextFrame();
+		size_t evictUnused(uint32_t maxIdleFrames);
+
+		const ShaderPermutationStatistics& getStatistics() const { return m_statistics; }
+		void printStatistics() const;
+
+		static uint64_t floatBits(float value);
+
+	private:
+		struct Permutation
+		{
+			std::vector<uint64_t>   values{};           // One value per declared constant, defaults filled in
+			VkPipeline              pipeline{ VK_NULL_HANDLE };
+			uint64_t                useCount{ 0 };
+			uint64_t                lastUsedFrame{ 0 };
+		};
+
+		struct ShaderFamily
+		{
+			std::vector<ShaderSpecializationConstant>       constants{};   // Sorted by constant id
+			PipelineBuilder                                 builder{};
+			std::map<ShaderPermutationKey, Permutation>     permutations{};
+		};
+
+		struct RetiredPipeline
+		{
+			VkPipeline  pipeline{ VK_NULL_HANDLE };
+			uint64_t    retireFrame{ 0 };
+		};
+
+		VkPipeline compile(const ShaderFamily& family, const Permutation& permutation);
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		VkPipelineCache                 m_pipelineCache{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		uint32_t                        m_maxFrameInFlight{ 3 };
+		uint64_t                        m_frame{ 0 };
+
+		std::vector<ShaderFamily>       m_shaders{};
+		std::vector<RetiredPipeline>    m_retiredPipelines{};
+		ShaderPermutationStatistics     m_statistics{};
+	};
+} // namespace PVulkanExamples
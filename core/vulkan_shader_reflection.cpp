@@ -0,0 +1,765 @@
+#include "vulkan_shader_reflection.h"
+#include "vulkan_dispatch.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		// Subset of the SPIR-V grammar needed for interface reflection (SPIR-V 1.5 unified spec)
+		const uint32_t SpvMagicNumber = 0x07230203;
+
+		enum SpvOp : uint32_t
+		{
+			OpName = 5,
+			OpEntryPoint = 15,
+			OpExecutionMode = 16,
+			OpTypeBool = 20,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstantTrue = 41,
+			OpConstantFalse = 42,
+			OpConstant = 43,
+			OpConstantComposite = 44,
+			OpSpecConstantTrue = 48,
+			OpSpecConstantFalse = 49,
+			OpSpecConstant = 50,
+			OpSpecConstantComposite = 51,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+			OpExecutionModeId = 331,
+			OpTypeAccelerationStructureKHR = 5341,
+		};
+
+		enum SpvDecoration : uint32_t
+		{
+			DecorationSpecId = 1,
+			DecorationBlock = 2,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+		};
+
+		enum SpvStorageClass : uint32_t
+		{
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+		};
+
+		const uint32_t ExecutionModeLocalSize = 17;
+		const uint32_t ExecutionModeLocalSizeId = 38;
+		const uint32_t BuiltInWorkgroupSize = 25;
+		const uint32_t ImageDimBuffer = 5;
+		const uint32_t ImageDimSubpassData = 6;
+
+		struct SpvDecorations
+		{
+			uint32_t set{ 0 };
+			uint32_t binding{ UINT32_MAX };
+			uint32_t location{ UINT32_MAX };
+			uint32_t specId{ UINT32_MAX };
+			uint32_t arrayStride{ 0 };
+			uint32_t builtIn{ UINT32_MAX };
+			bool     block{ false };
+			bool     bufferBlock{ false };
+		};
+
+		struct SpvMemberDecorations
+		{
+			uint32_t offset{ 0 };
+			uint32_t matrixStride{ 0 };
+		};
+
+		struct SpvInstruction
+		{
+			uint32_t        opcode{ 0 };
+			const uint32_t* operands{ nullptr };
+			uint32_t        operandCount{ 0 };
+		};
+
+		struct SpvVariable
+		{
+			uint32_t id;
+			uint32_t pointerTypeId;
+			uint32_t storageClass;
+		};
+
+		/*
+		* Module level tables gathered in a single pass over the instruction stream
+		*/
+		struct SpvModule
+		{
+			std::unordered_map<uint32_t, std::string>                           names;
+			std::unordered_map<uint32_t, SpvDecorations>                        decorations;
+			std::unordered_map<uint32_t, std::vector<SpvMemberDecorations>>     memberDecorations;
+			std::unordered_map<uint32_t, SpvInstruction>                        types;
+			std::unordered_map<uint32_t, SpvInstruction>                        constants;
+			std::vector<SpvVariable>                                            variables;
+			std::vector<uint32_t>                                               workgroupSizeIds;
+			uint32_t                                                            executionModel{ UINT32_MAX };
+			uint32_t                                                            entryPointId{ 0 };
+			std::vector<uint32_t>                                               entryPointInterface;
+		};
+
+		std::string readLiteralString(const uint32_t* words, uint32_t wordCount, uint32_t* pConsumedWords = nullptr)
+		{
+			const char* str = reinterpret_cast<const char*>(words);
+			size_t maxLength = static_cast<size_t>(wordCount) * sizeof(uint32_t);
+			size_t length = 0;
+			while (length < maxLength && str[length] != '\0') length++;
+			if (pConsumedWords) *pConsumedWords = static_cast<uint32_t>(length / sizeof(uint32_t) + 1);
+			return std::string(str, length);
+		}
+
+		VkShaderStageFlagBits executionModelToStage(uint32_t executionModel)
+		{
+			switch (executionModel)
+			{
+			case 0:    return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1:    return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2:    return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3:    return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4:    return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5:    return VK_SHADER_STAGE_COMPUTE_BIT;
+			case 5267: return VK_SHADER_STAGE_TASK_BIT_NV;
+			case 5268: return VK_SHADER_STAGE_MESH_BIT_NV;
+			case 5313: return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+			case 5314: return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+			case 5315: return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+			case 5316: return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+			case 5317: return VK_SHADER_STAGE_MISS_BIT_KHR;
+			case 5318: return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+			default:   throw std::runtime_error("unsupported SPIR-V execution model " + std::to_string(executionModel));
+			}
+		}
+
+		SpvModule parseModule(const uint32_t* pCode, size_t wordCount)
+		{
+			if (pCode == nullptr || wordCount < 5 || pCode[0] != SpvMagicNumber)
+			{
+				throw std::runtime_error("invalid SPIR-V module!");
+			}
+
+			SpvModule module;
+			size_t offset = 5; // Skip header
+			while (offset < wordCount)
+			{
+				uint32_t instructionWordCount = pCode[offset] >> 16;
+				uint32_t opcode = pCode[offset] & 0xFFFF;
+				if (instructionWordCount == 0 || offset + instructionWordCount > wordCount)
+				{
+					throw std::runtime_error("truncated SPIR-V instruction stream!");
+				}
+				const uint32_t* operands = pCode + offset + 1;
+				uint32_t operandCount = instructionWordCount - 1;
+
+				switch (opcode)
+				{
+				case OpName:
+					module.names[operands[0]] = readLiteralString(operands + 1, operandCount - 1);
+					break;
+				case OpEntryPoint:
+					// Only the first entry point is reflected, glslang emits one per module
+					if (module.executionModel == UINT32_MAX)
+					{
+						uint32_t nameWords = 0;
+						module.executionModel = operands[0];
+						module.entryPointId = operands[1];
+						module.names[operands[1]] = readLiteralString(operands + 2, operandCount - 2, &nameWords);
+						module.entryPointInterface.assign(operands + 2 + nameWords, operands + operandCount);
+					}
+					break;
+				case OpExecutionMode:
+				case OpExecutionModeId:
+					if (operands[0] == module.entryPointId && operandCount >= 5 &&
+						(operands[1] == ExecutionModeLocalSize || operands[1] == ExecutionModeLocalSizeId))
+					{
+						// LocalSize carries literals, LocalSizeId carries constant ids: tag literals by storing them with the high bit set
+						for (uint32_t i = 0; i < 3; i++)
+							module.workgroupSizeIds.push_back(operands[1] == ExecutionModeLocalSize ? (operands[2 + i] | 0x80000000u) : operands[2 + i]);
+					}
+					break;
+				case OpDecorate:
+				{
+					SpvDecorations& decoration = module.decorations[operands[0]];
+					switch (operands[1])
+					{
+					case DecorationSpecId:          decoration.specId = operands[2]; break;
+					case DecorationBlock:           decoration.block = true; break;
+					case DecorationBufferBlock:     decoration.bufferBlock = true; break;
+					case DecorationArrayStride:     decoration.arrayStride = operands[2]; break;
+					case DecorationBuiltIn:         decoration.builtIn = operands[2]; break;
+					case DecorationLocation:        decoration.location = operands[2]; break;
+					case DecorationBinding:         decoration.binding = operands[2]; break;
+					case DecorationDescriptorSet:   decoration.set = operands[2]; break;
+					default: break;
+					}
+					break;
+				}
+				case OpMemberDecorate:
+				{
+					std::vector<SpvMemberDecorations>& members = module.memberDecorations[operands[0]];
+					if (members.size() <= operands[1]) members.resize(operands[1] + 1);
+					if (operands[2] == DecorationOffset) members[operands[1]].offset = operands[3];
+					else if (operands[2] == DecorationMatrixStride) members[operands[1]].matrixStride = operands[3];
+					break;
+				}
+				case OpTypeBool:
+				case OpTypeInt:
+				case OpTypeFloat:
+				case OpTypeVector:
+				case OpTypeMatrix:
+				case OpTypeImage:
+				case OpTypeSampler:
+				case OpTypeSampledImage:
+				case OpTypeArray:
+				case OpTypeRuntimeArray:
+				case OpTypeStruct:
+				case OpTypePointer:
+				case OpTypeAccelerationStructureKHR:
+					module.types[operands[0]] = { opcode, operands, operandCount };
+					break;
+				case OpConstantTrue:
+				case OpConstantFalse:
+				case OpConstant:
+				case OpConstantComposite:
+				case OpSpecConstantTrue:
+				case OpSpecConstantFalse:
+				case OpSpecConstant:
+				case OpSpecConstantComposite:
+					module.constants[operands[1]] = { opcode, operands, operandCount };
+					break;
+				case OpVariable:
+					module.variables.push_back({ operands[1], operands[0], operands[2] });
+					break;
+				default:
+					break;
+				}
+				offset += instructionWordCount;
+			}
+
+			if (module.executionModel == UINT32_MAX)
+			{
+				throw std::runtime_error("SPIR-V module has no entry point!");
+			}
+			return module;
+		}
+
+		const SpvInstruction& findType(const SpvModule& module, uint32_t typeId)
+		{
+			auto it = module.types.find(typeId);
+			if (it == module.types.end())
+			{
+				throw std::runtime_error("unknown SPIR-V type id " + std::to_string(typeId));
+			}
+			return it->second;
+		}
+
+		uint64_t constantValue(const SpvModule& module, uint32_t constantId)
+		{
+			auto it = module.constants.find(constantId);
+			if (it == module.constants.end()) return 0;
+			const SpvInstruction& constant = it->second;
+			if (constant.opcode == OpConstantTrue || constant.opcode == OpSpecConstantTrue) return 1;
+			if (constant.opcode == OpConstantFalse || constant.opcode == OpSpecConstantFalse) return 0;
+			if (constant.operandCount >= 4) return uint64_t(constant.operands[2]) | (uint64_t(constant.operands[3]) << 32);
+			return constant.operandCount >= 3 ? constant.operands[2] : 0;
+		}
+
+		const SpvDecorations& findDecorations(const SpvModule& module, uint32_t id)
+		{
+			static const SpvDecorations none{};
+			auto it = module.decorations.find(id);
+			return it == module.decorations.end() ? none : it->second;
+		}
+
+		/*
+		* Byte size of a type laid out with explicit offsets/strides (push constant and buffer blocks)
+		*/
+		uint32_t typeSize(const SpvModule& module, uint32_t typeId, uint32_t matrixStride = 0)
+		{
+			const SpvInstruction& type = findType(module, typeId);
+			switch (type.opcode)
+			{
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.operands[1] / 8;
+			case OpTypeVector:
+				return typeSize(module, type.operands[1]) * type.operands[2];
+			case OpTypeMatrix:
+				return (matrixStride != 0 ? matrixStride : typeSize(module, type.operands[1])) * type.operands[2];
+			case OpTypeArray:
+			{
+				uint32_t stride = findDecorations(module, typeId).arrayStride;
+				if (stride == 0) stride = typeSize(module, type.operands[1], matrixStride);
+				return stride * static_cast<uint32_t>(constantValue(module, type.operands[2]));
+			}
+			case OpTypeRuntimeArray:
+				return 0;
+			case OpTypeStruct:
+			{
+				uint32_t size = 0;
+				auto membersIt = module.memberDecorations.find(typeId);
+				for (uint32_t member = 0; member + 1 < type.operandCount; member++)
+				{
+					SpvMemberDecorations memberDecoration{};
+					if (membersIt != module.memberDecorations.end() && member < membersIt->second.size())
+						memberDecoration = membersIt->second[member];
+					uint32_t memberEnd = memberDecoration.offset + typeSize(module, type.operands[member + 1], memberDecoration.matrixStride);
+					size = std::max(size, memberEnd);
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+
+		VkFormat vertexInputFormat(const SpvModule& module, uint32_t typeId)
+		{
+			const SpvInstruction& type = findType(module, typeId);
+			uint32_t componentCount = 1;
+			const SpvInstruction* component = &type;
+			if (type.opcode == OpTypeVector)
+			{
+				componentCount = type.operands[2];
+				component = &findType(module, type.operands[1]);
+			}
+			if (component->operands[1] != 32) return VK_FORMAT_UNDEFINED; // Only 32 bit attributes are mapped
+
+			static const VkFormat floatFormats[4] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+			static const VkFormat sintFormats[4] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+			static const VkFormat uintFormats[4] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+			if (component->opcode == OpTypeFloat) return floatFormats[componentCount - 1];
+			if (component->opcode == OpTypeInt) return component->operands[2] ? sintFormats[componentCount - 1] : uintFormats[componentCount - 1];
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		/*
+		* Peel arrays off a resource type, returning the element type id and the descriptor count
+		*/
+		uint32_t unwrapArrays(const SpvModule& module, uint32_t typeId, uint32_t& descriptorCount)
+		{
+			descriptorCount = 1;
+			const SpvInstruction* type = &findType(module, typeId);
+			while (type->opcode == OpTypeArray || type->opcode == OpTypeRuntimeArray)
+			{
+				if (type->opcode == OpTypeArray)
+					descriptorCount *= static_cast<uint32_t>(constantValue(module, type->operands[2]));
+				else
+					descriptorCount = 0;
+				typeId = type->operands[1];
+				type = &findType(module, typeId);
+			}
+			return typeId;
+		}
+
+		VkDescriptorType descriptorTypeOf(const SpvModule& module, uint32_t storageClass, uint32_t typeId)
+		{
+			const SpvInstruction& type = findType(module, typeId);
+			const SpvDecorations& typeDecorations = findDecorations(module, typeId);
+			switch (storageClass)
+			{
+			case StorageClassStorageBuffer:
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			case StorageClassUniform:
+				return typeDecorations.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			case StorageClassUniformConstant:
+				switch (type.opcode)
+				{
+				case OpTypeSampler:
+					return VK_DESCRIPTOR_TYPE_SAMPLER;
+				case OpTypeSampledImage:
+					return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				case OpTypeAccelerationStructureKHR:
+					return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+				case OpTypeImage:
+				{
+					uint32_t dim = type.operands[2];
+					uint32_t sampled = type.operands[6];
+					if (dim == ImageDimBuffer) return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+					if (dim == ImageDimSubpassData) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+					return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+				default:
+					break;
+				}
+				break;
+			default:
+				break;
+			}
+			return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		}
+
+		/*
+		* Serialize bindings in a canonical order so identical interfaces produce identical keys
+		*/
+		std::vector<uint64_t> descriptorSetLayoutKey(std::vector<VkDescriptorSetLayoutBinding> bindings)
+		{
+			std::sort(bindings.begin(), bindings.end(),
+				[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+			std::vector<uint64_t> key;
+			key.reserve(bindings.size() * 2);
+			for (const VkDescriptorSetLayoutBinding& binding : bindings)
+			{
+				key.push_back((uint64_t(binding.binding) << 32) | uint64_t(binding.descriptorType));
+				key.push_back((uint64_t(binding.descriptorCount) << 32) | uint64_t(binding.stageFlags));
+			}
+			return key;
+		}
+	}
+
+
+
+	/*
+	* Reflect the resource interface of a compiled SPIR-V module
+	*/
+	ShaderReflection ShaderReflectionUtil::reflect(const uint32_t* pCode, size_t wordCount)
+	{
+		SpvModule module = parseModule(pCode, wordCount);
+
+		ShaderReflection reflection{};
+		reflection.stage = executionModelToStage(module.executionModel);
+		reflection.entryPoint = module.names[module.entryPointId];
+
+		for (const SpvVariable& variable : module.variables)
+		{
+			const SpvInstruction& pointerType = findType(module, variable.pointerTypeId);
+			uint32_t pointeeTypeId = pointerType.operands[2];
+			const SpvDecorations& decorations = findDecorations(module, variable.id);
+			auto nameIt = module.names.find(variable.id);
+			std::string name = nameIt != module.names.end() ? nameIt->second : std::string();
+
+			switch (variable.storageClass)
+			{
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer:
+			{
+				if (decorations.binding == UINT32_MAX) break;
+				ShaderDescriptorBinding binding{};
+				uint32_t elementTypeId = unwrapArrays(module, pointeeTypeId, binding.descriptorCount);
+				binding.set = decorations.set;
+				binding.binding = decorations.binding;
+				binding.descriptorType = descriptorTypeOf(module, variable.storageClass, elementTypeId);
+				binding.stageFlags = reflection.stage;
+				binding.name = name.empty() && module.names.count(elementTypeId) ? module.names[elementTypeId] : name;
+				if (binding.descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+				{
+					throw std::runtime_error("cannot deduce descriptor type of " + binding.name);
+				}
+				reflection.descriptorBindings.push_back(binding);
+				break;
+			}
+			case StorageClassPushConstant:
+			{
+				const SpvInstruction& blockType = findType(module, pointeeTypeId);
+				uint32_t begin = UINT32_MAX;
+				auto membersIt = module.memberDecorations.find(pointeeTypeId);
+				if (membersIt != module.memberDecorations.end())
+				{
+					for (uint32_t member = 0; member + 1 < blockType.operandCount && member < membersIt->second.size(); member++)
+						begin = std::min(begin, membersIt->second[member].offset);
+				}
+				if (begin == UINT32_MAX) begin = 0;
+				uint32_t end = typeSize(module, pointeeTypeId);
+				if (end > begin)
+				{
+					reflection.pushConstantRanges.push_back({ static_cast<VkShaderStageFlags>(reflection.stage), begin, end - begin });
+				}
+				break;
+			}
+			case StorageClassInput:
+			{
+				if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || decorations.builtIn != UINT32_MAX || decorations.location == UINT32_MAX) break;
+				const SpvInstruction& inputType = findType(module, pointeeTypeId);
+				if (inputType.opcode == OpTypeMatrix)
+				{
+					// Matrices consume one location per column
+					for (uint32_t column = 0; column < inputType.operands[2]; column++)
+						reflection.vertexInputs.push_back({ decorations.location + column, vertexInputFormat(module, inputType.operands[1]), name });
+				}
+				else
+				{
+					reflection.vertexInputs.push_back({ decorations.location, vertexInputFormat(module, pointeeTypeId), name });
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		// Specialization constants and the WorkgroupSize builtin composite
+		for (const auto& [id, constant] : module.constants)
+		{
+			const SpvDecorations& decorations = findDecorations(module, id);
+			if (decorations.specId != UINT32_MAX &&
+				(constant.opcode == OpSpecConstant || constant.opcode == OpSpecConstantTrue || constant.opcode == OpSpecConstantFalse))
+			{
+				ShaderSpecializationConstant specConstant{};
+				specConstant.constantId = decorations.specId;
+				specConstant.isBool = constant.opcode != OpSpecConstant;
+				specConstant.size = specConstant.isBool ? static_cast<uint32_t>(sizeof(VkBool32)) : typeSize(module, constant.operands[0]);
+				specConstant.defaultValue = constantValue(module, id);
+				auto nameIt = module.names.find(id);
+				if (nameIt != module.names.end()) specConstant.name = nameIt->second;
+				reflection.specializationConstants.push_back(specConstant);
+			}
+			if (decorations.builtIn == BuiltInWorkgroupSize && constant.operandCount >= 5)
+			{
+				module.workgroupSizeIds.assign(constant.operands + 2, constant.operands + 5);
+			}
+		}
+		std::sort(reflection.specializationConstants.begin(), reflection.specializationConstants.end(),
+			[](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b) { return a.constantId < b.constantId; });
+
+		// The WorkgroupSize builtin overrides the execution mode, so only the last three ids matter
+		if (module.workgroupSizeIds.size() >= 3)
+		{
+			size_t first = module.workgroupSizeIds.size() - 3;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				uint32_t value = module.workgroupSizeIds[first + i];
+				if (value & 0x80000000u)
+				{
+					reflection.workgroupSize[i] = value & 0x7FFFFFFFu;
+				}
+				else
+				{
+					reflection.workgroupSize[i] = static_cast<uint32_t>(constantValue(module, value));
+					reflection.workgroupSizeSpecIds[i] = findDecorations(module, value).specId;
+				}
+			}
+		}
+
+		std::sort(reflection.descriptorBindings.begin(), reflection.descriptorBindings.end(),
+			[](const ShaderDescriptorBinding& a, const ShaderDescriptorBinding& b) { return a.set != b.set ? a.set < b.set : a.binding < b.binding; });
+		std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+			[](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a.location < b.location; });
+
+		return reflection;
+	}
+
+	/*
+	* Merge the interfaces of all stages of a pipeline, bindings used by several stages get combined stage flags.
+	* Push constants are merged into a single range visible to every stage using them.
+	*/
+	PipelineLayoutDescription ShaderReflectionUtil::mergeStages(const std::vector<ShaderReflection>& stages)
+	{
+		PipelineLayoutDescription description{};
+		VkPushConstantRange pushConstantRange{ 0, UINT32_MAX, 0 };
+		uint32_t pushConstantEnd = 0;
+
+		for (const ShaderReflection& stage : stages)
+		{
+			for (const ShaderDescriptorBinding& binding : stage.descriptorBindings)
+			{
+				std::vector<VkDescriptorSetLayoutBinding>& setBindings = description.sets[binding.set];
+				auto it = std::find_if(setBindings.begin(), setBindings.end(),
+					[&](const VkDescriptorSetLayoutBinding& b) { return b.binding == binding.binding; });
+				if (it == setBindings.end())
+				{
+					setBindings.push_back({ binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags, nullptr });
+				}
+				else if (it->descriptorType != binding.descriptorType || it->descriptorCount != binding.descriptorCount)
+				{
+					throw std::runtime_error("conflicting declarations of set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding));
+				}
+				else
+				{
+					it->stageFlags |= binding.stageFlags;
+				}
+			}
+
+			for (const VkPushConstantRange& range : stage.pushConstantRanges)
+			{
+				pushConstantRange.stageFlags |= range.stageFlags;
+				pushConstantRange.offset = std::min(pushConstantRange.offset, range.offset);
+				pushConstantEnd = std::max(pushConstantEnd, range.offset + range.size);
+			}
+		}
+
+		for (auto& [set, bindings] : description.sets)
+		{
+			std::sort(bindings.begin(), bindings.end(),
+				[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+		}
+		if (pushConstantRange.stageFlags != 0)
+		{
+			pushConstantRange.size = pushConstantEnd - pushConstantRange.offset;
+			description.pushConstantRanges.push_back(pushConstantRange);
+		}
+		return description;
+	}
+
+	/*
+	* Print the reflected interface, used in debug mode
+	*/
+	void ShaderReflectionUtil::printReflection(const ShaderReflection& reflection)
+	{
+		std::cout << "\n=============================Shader reflection: stage " << reflection.stage << " entry " << reflection.entryPoint << "=============================";
+		for (const ShaderDescriptorBinding& binding : reflection.descriptorBindings)
+			std::cout << "\n  set " << binding.set << " binding " << binding.binding << " type " << binding.descriptorType << " count " << binding.descriptorCount << " " << binding.name;
+		for (const VkPushConstantRange& range : reflection.pushConstantRanges)
+			std::cout << "\n  push constants offset " << range.offset << " size " << range.size;
+		for (const ShaderVertexInput& input : reflection.vertexInputs)
+			std::cout << "\n  vertex input location " << input.location << " format " << input.format << " " << input.name;
+		for (const ShaderSpecializationConstant& specConstant : reflection.specializationConstants)
+			std::cout << "\n  specialization constant " << specConstant.constantId << " size " << specConstant.size << " default " << specConstant.defaultValue << " " << specConstant.name;
+		if (reflection.stage == VK_SHADER_STAGE_COMPUTE_BIT)
+			std::cout << "\n  workgroup size " << reflection.workgroupSize[0] << " x " << reflection.workgroupSize[1] << " x " << reflection.workgroupSize[2];
+		std::cout << std::endl;
+	}
+
+
+
+	void PipelineLayoutCache::init(VkDevice device, const VkAllocationCallbacks* pAllocator, bool descriptorIndexing)
+	{
+		m_device = device;
+		m_allocator = pAllocator;
+		m_descriptorIndexing = descriptorIndexing;
+		m_emptySetLayout = getDescriptorSetLayout({});
+	}
+
+	void PipelineLayoutCache::cleanup()
+	{
+		for (auto& [key, layout] : m_pipelineLayouts)
+			vkd.vkDestroyPipelineLayout(m_device, layout, m_allocator);
+		for (auto& [key, layout] : m_descriptorSetLayouts)
+			vkd.vkDestroyDescriptorSetLayout(m_device, layout, m_allocator);
+		m_pipelineLayouts.clear();
+		m_descriptorSetLayouts.clear();
+		m_emptySetLayout = VK_NULL_HANDLE;
+	}
+
+	/*
+	* Get or create the descriptor set layout for the given bindings
+	*/
+	VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+	{
+		std::vector<uint64_t> key = descriptorSetLayoutKey(bindings);
+		auto it = m_descriptorSetLayouts.find(key);
+		if (it != m_descriptorSetLayouts.end()) return it->second;
+
+		// Runtime sized arrays become partially bound arrays, variable sized when they are the last binding
+		std::vector<VkDescriptorSetLayoutBinding> layoutBindings = bindings;
+		std::vector<VkDescriptorBindingFlags> bindingFlags(layoutBindings.size(), 0);
+		bool hasRuntimeArray = false;
+		uint32_t lastBinding = 0;
+		for (const VkDescriptorSetLayoutBinding& binding : layoutBindings)
+			lastBinding = std::max(lastBinding, binding.binding);
+		for (size_t i = 0; i < layoutBindings.size(); i++)
+		{
+			if (layoutBindings[i].descriptorCount == 0)
+			{
+				if (!m_descriptorIndexing)
+				{
+					throw std::runtime_error("runtime sized descriptor array at binding " + std::to_string(layoutBindings[i].binding) +
+						" needs the descriptor indexing features!");
+				}
+				hasRuntimeArray = true;
+				layoutBindings[i].descriptorCount = m_runtimeArrayDescriptorCount;
+				bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+				if (layoutBindings[i].binding == lastBinding)
+					bindingFlags[i] |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+			}
+		}
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		createInfo.pNext = hasRuntimeArray ? &bindingFlagsInfo : nullptr;
+		createInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+		createInfo.pBindings = layoutBindings.data();
+
+		VkDescriptorSetLayout layout;
+		if (vkd.vkCreateDescriptorSetLayout(m_device, &createInfo, m_allocator, &layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+		m_descriptorSetLayouts[key] = layout;
+		return layout;
+	}
+
+	/*
+	* Get or create the pipeline layout for the given set layouts and push constant ranges
+	*/
+	VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+	{
+		std::vector<uint64_t> key;
+		for (VkDescriptorSetLayout setLayout : setLayouts)
+			key.push_back(reinterpret_cast<uint64_t>(setLayout));
+		key.push_back(UINT64_MAX); // Separator between set layouts and push constant ranges
+		for (const VkPushConstantRange& range : pushConstantRanges)
+		{
+			key.push_back(range.stageFlags);
+			key.push_back((uint64_t(range.offset) << 32) | range.size);
+		}
+		auto it = m_pipelineLayouts.find(key);
+		if (it != m_pipelineLayouts.end()) return it->second;
+
+		VkPipelineLayoutCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		createInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		createInfo.pSetLayouts = setLayouts.data();
+		createInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+		createInfo.pPushConstantRanges = pushConstantRanges.data();
+
+		VkPipelineLayout layout;
+		if (vkd.vkCreatePipelineLayout(m_device, &createInfo, m_allocator, &layout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+		m_pipelineLayouts[key] = layout;
+		return layout;
+	}
+
+	/*
+	* Build the pipeline layout straight from the reflected stages of a pipeline.
+	* Holes in the set numbering are filled with an empty set layout.
+	*/
+	VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const std::vector<ShaderReflection>& stages, std::vector<VkDescriptorSetLayout>* pSetLayouts)
+	{
+		PipelineLayoutDescription description = ShaderReflectionUtil::mergeStages(stages);
+
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		if (!description.sets.empty())
+		{
+			setLayouts.resize(description.sets.rbegin()->first + 1, m_emptySetLayout);
+			for (const auto& [set, bindings] : description.sets)
+				setLayouts[set] = getDescriptorSetLayout(bindings);
+		}
+		if (pSetLayouts) *pSetLayouts = setLayouts;
+
+		return getPipelineLayout(setLayouts, description.pushConstantRanges);
+	}
+} // namespace PVulkanExamples
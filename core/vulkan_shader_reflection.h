@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <map>
+#include <string>
+
+namespace PVulkanExamples
+{
+	struct ShaderDescriptorBinding
+	{
+		uint32_t            set{ 0 };
+		uint32_t            binding{ 0 };
+		VkDescriptorType    descriptorType{ VK_DESCRIPTOR_TYPE_MAX_ENUM };
+		uint32_t            descriptorCount{ 1 };   // 0 for runtime sized arrays
+		VkShaderStageFlags  stageFlags{ 0 };
+		std::string         name;
+	};
+
+	struct ShaderVertexInput
+	{
+		uint32_t    location{ 0 };
+		VkFormat    format{ VK_FORMAT_UNDEFINED };
+		std::string name;
+	};
+
+	struct ShaderSpecializationConstant
+	{
+		uint32_t    constantId{ 0 };
+		uint32_t    size{ 4 };              // Byte size expected in VkSpecializationMapEntry
+		uint64_t    defaultValue{ 0 };      // Raw bits of the default value
+		bool        isBool{ false };
+		std::string name;
+	};
+
+	/*
+	* Everything the pipeline side needs to know about one shader stage
+	*/
+	struct ShaderReflection
+	{
+		VkShaderStageFlagBits                       stage{ VK_SHADER_STAGE_ALL };
+		std::string                                 entryPoint{ "main" };
+		std::vector<ShaderDescriptorBinding>        descriptorBindings{};
+		std::vector<VkPushConstantRange>            pushConstantRanges{};
+		std::vector<ShaderVertexInput>              vertexInputs{};
+		std::vector<ShaderSpecializationConstant>   specializationConstants{};
+		uint32_t                                    workgroupSize[3]{ 1, 1, 1 };
+		uint32_t                                    workgroupSizeSpecIds[3]{ UINT32_MAX, UINT32_MAX, UINT32_MAX }; // Spec ids overriding workgroupSize
+	};
+
+	/*
+	* Merged descriptor and push constant interface of all stages of a pipeline
+	*/
+	struct PipelineLayoutDescription
+	{
+		std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>>   sets{};
+		std::vector<VkPushConstantRange>                                pushConstantRanges{};
+	};
+
+	class ShaderReflectionUtil
+	{
+	public:
+		static ShaderReflection reflect(const uint32_t* pCode, size_t wordCount);
+		static ShaderReflection reflect(const std::vector<uint32_t>& spirv) { return reflect(spirv.data(), spirv.size()); }
+
+		static PipelineLayoutDescription mergeStages(const std::vector<ShaderReflection>& stages);
+		static void printReflection(const ShaderReflection& reflection);
+	};
+
+	/*
+	* Creates descriptor set layouts and pipeline layouts from reflected shaders.
+	* Identical layouts are created only once, so pipelines sharing an interface also share set layouts
+	* and descriptor sets stay compatible (and bound) across pipeline switches.
+	* Runtime sized arrays need the runtimeDescriptorArray, descriptorBindingPartiallyBound and
+	* descriptorBindingVariableDescriptorCount features, layouts with them throw unless init was told they are enabled.
+	*/
+	class PipelineLayoutCache
+	{
+	public:
+		void init(VkDevice device, const VkAllocationCallbacks* pAllocator = nullptr, bool descriptorIndexing = false);
+		void cleanup();
+
+		VkDescriptorSetLayout getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+		VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+		VkPipelineLayout getPipelineLayout(const std::vector<ShaderReflection>& stages, std::vector<VkDescriptorSetLayout>* pSetLayouts = nullptr);
+
+		size_t descriptorSetLayoutCount() const { return m_descriptorSetLayouts.size(); }
+		size_t pipelineLayoutCount() const { return m_pipelineLayouts.size(); }
+
+	public:
+		uint32_t m_runtimeArrayDescriptorCount{ 1024 }; // Descriptor count used for runtime sized arrays
+
+	private:
+		VkDevice                                            m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*                        m_allocator{ nullptr };
+		bool                                                m_descriptorIndexing{ false };
+		VkDescriptorSetLayout                               m_emptySetLayout{ VK_NULL_HANDLE };
+		std::map<std::vector<uint64_t>, VkDescriptorSetLayout> m_descriptorSetLayouts{};
+		std::map<std::vector<uint64_t>, VkPipelineLayout>   m_pipelineLayouts{};
+	};
+} // namespace PVulkanExamples
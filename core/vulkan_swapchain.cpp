@@ -0,0 +1,181 @@
+#include "vulkan_swapchain.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void SwapchainManager::init(VkDevice device, VkSurfaceKHR surface, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight)
+	{
+		m_device = device;
+		m_surface = surface;
+		m_allocator = pAllocator;
+		m_maxFrameInFlight = maxFrameInFlight;
+	}
+
+	void SwapchainManager::cleanup()
+	{
+		for (RetiredSwapchain& retired : m_retiredSwapchains)
+		{
+			destroyImageViews(retired.imageViews);
+			vkd.vkDestroySwapchainKHR(m_device, retired.swapchain, m_allocator);
+		}
+		m_retiredSwapchains.clear();
+		destroyImageViews(m_imageViews);
+		if (m_swapchain != VK_NULL_HANDLE)
+		{
+			vkd.vkDestroySwapchainKHR(m_device, m_swapchain, m_allocator);
+			m_swapchain = VK_NULL_HANDLE;
+		}
+		m_images.clear();
+	}
+
+	/*
+	* Create the swapchain, or recreate it from the current one.
+	* The previous swapchain is handed over as oldSwapchain and destroyed later by destroyRetired,
+	* once every frame that could still use its images has completed, so resizing never waits for the device to idle.
+	*/
+	void SwapchainManager::create(const SwapChainSupportDetails& support, VkSurfaceFormatKHR surfaceFormat, VkPresentModeKHR presentMode,
+		VkExtent2D extent, uint32_t imageCount, const std::vector<uint32_t>& queueFamilies)
+	{
+		VkSwapchainCreateInfoKHR createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		createInfo.surface = m_surface;
+		createInfo.minImageCount = imageCount;
+		createInfo.imageFormat = surfaceFormat.format;
+		createInfo.imageColorSpace = surfaceFormat.colorSpace;
+		createInfo.imageExtent = extent;
+		createInfo.imageArrayLayers = 1;
+		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			(support.capabilities.supportedUsageFlags & (VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+		if (queueFamilies.size() > 1)
+		{
+			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+			createInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
+		else
+		{
+			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		}
+		createInfo.preTransform = support.capabilities.currentTransform;
+		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+		createInfo.presentMode = presentMode;
+		createInfo.clipped = VK_TRUE;
+		createInfo.oldSwapchain = m_swapchain;
+
+		VkSwapchainKHR swapchain;
+		if (vkd.vkCreateSwapchainKHR(m_device, &createInfo, m_allocator, &swapchain) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create swap chain!");
+		}
+
+		if (m_swapchain != VK_NULL_HANDLE)
+		{
+			m_retiredSwapchains.push_back({ m_swapchain, m_imageViews, m_frameCounter });
+			m_imageViews.clear();
+		}
+		m_swapchain = swapchain;
+		m_format = surfaceFormat.format;
+		m_imageUsage = createInfo.imageUsage;
+		m_extent = extent;
+		m_presentMode = presentMode;
+
+		uint32_t swapchainImageCount = 0;
+		vkd.vkGetSwapchainImagesKHR(m_device, m_swapchain, &swapchainImageCount, nullptr);
+		m_images.resize(swapchainImageCount);
+		vkd.vkGetSwapchainImagesKHR(m_device, m_swapchain, &swapchainImageCount, m_images.data());
+
+		m_imageViews.resize(swapchainImageCount);
+		for (uint32_t i = 0; i < swapchainImageCount; i++)
+		{
+			m_imageViews[i] = VulkanUtil::createImageView2D(m_device, m_images[i], m_format, VK_IMAGE_ASPECT_COLOR_BIT, m_allocator);
+		}
+	}
+
+	/*
+	* Destroy retired swapchains whose last frames have completed, call after waiting on the current frame fence
+	*/
+	void SwapchainManager::destroyRetired(uint64_t frameCounter)
+	{
+		auto retiredEnd = std::remove_if(m_retiredSwapchains.begin(), m_retiredSwapchains.end(), [&](RetiredSwapchain& retired)
+		{
+			if (frameCounter < retired.retireFrame + m_maxFrameInFlight) return false;
+			destroyImageViews(retired.imageViews);
+			vkd.vkDestroySwapchainKHR(m_device, retired.swapchain, m_allocator);
+			return true;
+		});
+		m_retiredSwapchains.erase(retiredEnd, m_retiredSwapchains.end());
+	}
+
+	VkResult SwapchainManager::acquireNextImage(VkSemaphore imageAvailableSemaphore, uint32_t& imageIndex)
+	{
+		return vkd.vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	}
+
+	VkResult SwapchainManager::present(VkQueue presentQueue, VkSemaphore renderFinishedSemaphore, uint32_t imageIndex)
+	{
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_swapchain;
+		presentInfo.pImageIndices = &imageIndex;
+		return vkd.vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+
+	/*
+	* Pick the present mode of a latency policy, FIFO is the fallback every implementation supports
+	*/
+	VkPresentModeKHR SwapchainManager::choosePresentMode(PresentPolicy policy, const std::vector<VkPresentModeKHR>& availablePresentModes)
+	{
+		std::vector<VkPresentModeKHR> preferred;
+		switch (policy)
+		{
+		case PresentPolicy::LowLatency:  preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }; break;
+		case PresentPolicy::Uncapped:    preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR }; break;
+		case PresentPolicy::PowerSaving: break;
+		}
+		for (VkPresentModeKHR presentMode : preferred)
+		{
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end())
+			{
+				return presentMode;
+			}
+		}
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	/*
+	* Choose the image count explicitly instead of the surface minimum:
+	* mailbox needs a spare image to replace queued frames without blocking,
+	* FIFO and immediate keep the queue short to limit latency and memory.
+	* A non zero requested count overrides the policy, clamped to the surface limits.
+	*/
+	uint32_t SwapchainManager::chooseImageCount(VkPresentModeKHR presentMode, const VkSurfaceCapabilitiesKHR& capabilities, uint32_t requestedImageCount)
+	{
+		uint32_t imageCount = requestedImageCount;
+		if (imageCount == 0)
+		{
+			imageCount = presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? std::max(capabilities.minImageCount + 1, 3u) : std::max(capabilities.minImageCount, 2u);
+		}
+		imageCount = std::max(imageCount, capabilities.minImageCount);
+		if (capabilities.maxImageCount > 0)
+		{
+			imageCount = std::min(imageCount, capabilities.maxImageCount);
+		}
+		return imageCount;
+	}
+
+	void SwapchainManager::destroyImageViews(std::vector<VkImageView>& imageViews)
+	{
+		for (VkImageView imageView : imageViews)
+		{
+			vkd.vkDestroyImageView(m_device, imageView, m_allocator);
+		}
+		imageViews.clear();
+	}
+} // namespace PVulkanExamples
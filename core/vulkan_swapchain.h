@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+
+namespace PVulkanExamples
+{
+	struct SwapChainSupportDetails
+	{
+		VkSurfaceCapabilitiesKHR        capabilities{};
+		std::vector<VkSurfaceFormatKHR> formats;
+		std::vector<VkPresentModeKHR>   presentModes;
+	};
+
+	/*
+	* Latency policies, each maps to a preferred present mode with fallbacks
+	*   LowLatency  : MAILBOX, newest frame replaces the queued one, no tearing
+	*   PowerSaving : FIFO, vsync capped, the CPU blocks instead of rendering discarded frames
+	*   Uncapped    : IMMEDIATE, lowest latency with tearing, for benchmarking
+	*/
+	enum class PresentPolicy
+	{
+		LowLatency,
+		PowerSaving,
+		Uncapped
+	};
+
+	class SwapchainManager
+	{
+	public:
+		void init(VkDevice device, VkSurfaceKHR surface, const VkAllocationCallbacks* pAllocator, uint32_t maxFrameInFlight);
+		void cleanup();
+
+		void create(const SwapChainSupportDetails& support, VkSurfaceFormatKHR surfaceFormat, VkPresentModeKHR presentMode,
+			VkExtent2D extent, uint32_t imageCount, const std::vector<uint32_t>& queueFamilies);
+		void destroyRetired(uint64_t frameCounter);
+
+		VkResult acquireNextImage(VkSemaphore imageAvailableSemaphore, uint32_t& imageIndex);
+		VkResult present(VkQueue presentQueue, VkSemaphore renderFinishedSemaphore, uint32_t imageIndex);
+
+		static VkPresentModeKHR choosePresentMode(PresentPolicy policy, const std::vector<VkPresentModeKHR>& availablePresentModes);
+		static uint32_t chooseImageCount(VkPresentModeKHR presentMode, const VkSurfaceCapabilitiesKHR& capabilities, uint32_t requestedImageCount = 0);
+
+		VkSwapchainKHR getSwapchain() const { return m_swapchain; }
+		VkFormat getFormat() const { return m_format; }
+		VkImageUsageFlags getImageUsage() const { return m_imageUsage; }
+		VkExtent2D getExtent() const { return m_extent; }
+		VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+		uint32_t getImageCount() const { return static_cast<uint32_t>(m_images.size()); }
+		VkImage getImage(uint32_t imageIndex) const { return m_images[imageIndex]; }
+		VkImageView getImageView(uint32_t imageIndex) const { return m_imageViews[imageIndex]; }
+
+	public:
+		uint64_t m_frameCounter{ 0 };   // Frames submitted so far, set by the owner before recreation
+
+	private:
+		struct RetiredSwapchain
+		{
+			VkSwapchainKHR              swapchain{ VK_NULL_HANDLE };
+			std::vector<VkImageView>    imageViews{};
+			uint64_t                    retireFrame{ 0 };
+		};
+
+		void destroyImageViews(std::vector<VkImageView>& imageViews);
+
+	private:
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		VkSurfaceKHR                    m_surface{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		uint32_t                        m_maxFrameInFlight{ 3 };
+
+		VkSwapchainKHR                  m_swapchain{ VK_NULL_HANDLE };
+		VkFormat                        m_format{ VK_FORMAT_UNDEFINED };
+		VkImageUsageFlags               m_imageUsage{ 0 };
+		VkExtent2D                      m_extent{};
+		VkPresentModeKHR                m_presentMode{ VK_PRESENT_MODE_FIFO_KHR };
+		std::vector<VkImage>            m_images{};
+		std::vector<VkImageView>        m_imageViews{};
+		std::vector<RetiredSwapchain>   m_retiredSwapchains{};
+	};
+} // namespace PVulkanExamples
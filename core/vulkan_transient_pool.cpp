@@ -0,0 +1,278 @@
+#include "vulkan_transient_pool.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr VkImageUsageFlags ATTACHMENT_USAGE_MASK = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	void TransientResourcePool::init(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* pAllocator,
+		const std::vector<uint32_t>& concurrentQueueFamilies)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		m_allocator = pAllocator;
+		m_concurrentQueueFamilies = concurrentQueueFamilies;
+
+		VkPhysicalDeviceProperties properties;
+		vkd.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		m_bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	}
+
+	void TransientResourcePool::cleanup()
+	{
+		reset();
+		m_device = VK_NULL_HANDLE;
+	}
+
+	uint32_t TransientResourcePool::addImage(const char* name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage,
+		uint32_t firstPass, uint32_t lastPass, bool concurrent)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.isImage = true;
+		resource.format = format;
+		resource.extent = extent;
+		resource.imageUsage = usage;
+		resource.firstPass = firstPass;
+		resource.lastPass = lastPass;
+		resource.concurrent = concurrent && m_concurrentQueueFamilies.size() > 1;
+		// Contents never leave the pass, tilers can keep them in tile memory without committing device memory
+		resource.lazilyAllocated = firstPass == lastPass && (usage & ATTACHMENT_USAGE_MASK) != 0 && (usage & ~ATTACHMENT_USAGE_MASK) == 0;
+		m_resources.push_back(resource);
+		return static_cast<uint32_t>(m_resources.size() - 1);
+	}
+
+	uint32_t TransientResourcePool::addBuffer(const char* name, VkDeviceSize size, VkBufferUsageFlags usage,
+		uint32_t firstPass, uint32_t lastPass, bool concurrent)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.size = size;
+		resource.bufferUsage = usage;
+		resource.firstPass = firstPass;
+		resource.lastPass = lastPass;
+		resource.concurrent = concurrent && m_concurrentQueueFamilies.size() > 1;
+		m_resources.push_back(resource);
+		return static_cast<uint32_t>(m_resources.size() - 1);
+	}
+
+	void TransientResourcePool::allocate()
+	{
+		if (m_allocated)
+		{
+			throw std::runtime_error("transient resource pool allocated twice without a reset!");
+		}
+		m_allocated = true;
+
+		std::map<uint32_t, std::vector<uint32_t>> aliasedGroups;   // Per memory type
+		std::vector<std::vector<uint32_t>> dedicatedGroups;
+		for (uint32_t index = 0; index < m_resources.size(); index++)
+		{
+			Resource& resource = m_resources[index];
+			VkSharingMode sharingMode = resource.concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+			uint32_t queueFamilyCount = resource.concurrent ? static_cast<uint32_t>(m_concurrentQueueFamilies.size()) : 0;
+			const uint32_t* pQueueFamilies = resource.concurrent ? m_concurrentQueueFamilies.data() : nullptr;
+			if (resource.isImage)
+			{
+				VkImageCreateInfo imageInfo{};
+				imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+				imageInfo.imageType = VK_IMAGE_TYPE_2D;
+				imageInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+				imageInfo.mipLevels = 1;
+				imageInfo.arrayLayers = 1;
+				imageInfo.format = resource.format;
+				imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+				imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				imageInfo.usage = resource.imageUsage | (resource.lazilyAllocated ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+				imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+				imageInfo.sharingMode = sharingMode;
+				imageInfo.queueFamilyIndexCount = queueFamilyCount;
+				imageInfo.pQueueFamilyIndices = pQueueFamilies;
+				if (vkd.vkCreateImage(m_device, &imageInfo, m_allocator, &resource.image) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create transient image " + resource.name + "!");
+				}
+				vkd.vkGetImageMemoryRequirements(m_device, resource.image, &resource.requirements);
+			}
+			else
+			{
+				VkBufferCreateInfo bufferInfo{};
+				bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+				bufferInfo.size = resource.size;
+				bufferInfo.usage = resource.bufferUsage;
+				bufferInfo.sharingMode = sharingMode;
+				bufferInfo.queueFamilyIndexCount = queueFamilyCount;
+				bufferInfo.pQueueFamilyIndices = pQueueFamilies;
+				if (vkd.vkCreateBuffer(m_device, &bufferInfo, m_allocator, &resource.buffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create transient buffer " + resource.name + "!");
+				}
+				vkd.vkGetBufferMemoryRequirements(m_device, resource.buffer, &resource.requirements);
+			}
+			// Buffers and optimal images may share a block, keep every placement apart by the granularity
+			resource.requirements.alignment = std::max(resource.requirements.alignment, m_bufferImageGranularity);
+
+			resource.memoryType = UINT32_MAX;
+			if (resource.lazilyAllocated)
+			{
+				try
+				{
+					resource.memoryType = VulkanUtil::findMemoryType(m_physicalDevice, resource.requirements.memoryTypeBits,
+						VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+				}
+				catch (const std::runtime_error&)
+				{
+					resource.lazilyAllocated = false;   // Desktop GPUs have no lazily allocated memory
+				}
+			}
+			if (resource.memoryType == UINT32_MAX)
+			{
+				resource.memoryType = VulkanUtil::findMemoryType(m_physicalDevice, resource.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			}
+			m_statistics.requestedSize += resource.requirements.size;
+
+			if (resource.concurrent)
+				dedicatedGroups.push_back({ index });
+			else
+				aliasedGroups[resource.memoryType].push_back(index);
+		}
+
+		for (auto& group : aliasedGroups) allocateGroup(group.second);
+		for (auto& group : dedicatedGroups) allocateGroup(group);
+
+		for (Resource& resource : m_resources)
+		{
+			if (!resource.isImage) continue;
+			resource.view = VulkanUtil::createImageView2D(m_device, resource.image, resource.format, getImageAspect(resource.format), m_allocator);
+		}
+	}
+
+	/*
+	* Largest first, each resource goes to the lowest offset not overlapping a placed resource alive at the same time
+	*/
+	void TransientResourcePool::allocateGroup(const std::vector<uint32_t>& group)
+	{
+		std::vector<uint32_t> order = group;
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+		{
+			return m_resources[a].requirements.size > m_resources[b].requirements.size;
+		});
+
+		VkDeviceSize blockSize = 0;
+		for (size_t placed = 0; placed < order.size(); placed++)
+		{
+			Resource& resource = m_resources[order[placed]];
+			std::vector<VkDeviceSize> candidates{ 0 };
+			for (size_t other = 0; other < placed; other++)
+			{
+				const Resource& otherResource = m_resources[order[other]];
+				if (!lifetimesOverlap(resource, otherResource)) continue;
+				candidates.push_back(alignUp(otherResource.offset + otherResource.requirements.size, resource.requirements.alignment));
+			}
+			std::sort(candidates.begin(), candidates.end());
+			for (VkDeviceSize candidate : candidates)
+			{
+				bool fits = true;
+				for (size_t other = 0; other < placed && fits; other++)
+				{
+					const Resource& otherResource = m_resources[order[other]];
+					fits = !lifetimesOverlap(resource, otherResource) ||
+						candidate >= otherResource.offset + otherResource.requirements.size ||
+						otherResource.offset >= candidate + resource.requirements.size;
+				}
+				if (fits)
+				{
+					resource.offset = candidate;
+					break;
+				}
+			}
+			blockSize = std::max(blockSize, resource.offset + resource.requirements.size);
+		}
+
+		const Resource& first = m_resources[order.front()];
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = blockSize;
+		allocInfo.memoryTypeIndex = first.memoryType;
+		VkDeviceMemory memory;
+		if (vkd.vkAllocateMemory(m_device, &allocInfo, m_allocator, &memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate transient resource memory!");
+		}
+		m_memories.push_back(memory);
+		m_statistics.memoryCount++;
+		m_statistics.allocatedSize += blockSize;
+		if (first.lazilyAllocated) m_statistics.lazilyAllocatedSize += blockSize;
+
+		for (uint32_t index : group)
+		{
+			Resource& resource = m_resources[index];
+			if (resource.isImage)
+				vkd.vkBindImageMemory(m_device, resource.image, memory, resource.offset);
+			else
+				vkd.vkBindBufferMemory(m_device, resource.buffer, memory, resource.offset);
+
+			for (uint32_t other : group)
+			{
+				const Resource& otherResource = m_resources[other];
+				bool memoryOverlaps = resource.offset < otherResource.offset + otherResource.requirements.size &&
+					otherResource.offset < resource.offset + resource.requirements.size;
+				if (memoryOverlaps && otherResource.lastPass < resource.firstPass)
+				{
+					resource.aliasPredecessors.push_back(other);
+				}
+			}
+		}
+	}
+
+	void TransientResourcePool::reset()
+	{
+		for (Resource& resource : m_resources)
+		{
+			vkd.vkDestroyImageView(m_device, resource.view, m_allocator);
+			vkd.vkDestroyImage(m_device, resource.image, m_allocator);
+			vkd.vkDestroyBuffer(m_device, resource.buffer, m_allocator);
+		}
+		for (VkDeviceMemory memory : m_memories)
+		{
+			vkd.vkFreeMemory(m_device, memory, m_allocator);
+		}
+		m_resources.clear();
+		m_memories.clear();
+		m_statistics = {};
+		m_allocated = false;
+	}
+
+	VkImageAspectFlags TransientResourcePool::getImageAspect(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+} // namespace PVulkanExamples
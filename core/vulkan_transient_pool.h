@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	struct TransientPoolStatistics
+	{
+		VkDeviceSize    requestedSize{ 0 };         // Sum of the resource sizes
+		VkDeviceSize    allocatedSize{ 0 };         // Device memory allocated for them after aliasing
+		VkDeviceSize    lazilyAllocatedSize{ 0 };   // Part of allocatedSize in lazily allocated memory, committed only when needed
+		uint32_t        memoryCount{ 0 };
+	};
+
+	/*
+	* Images and buffers living for a known range of passes inside a frame.
+	* Resources are declared with an inclusive range of pass indices, allocate creates them and binds every resource of a
+	* memory type into a single VkDeviceMemory, resources whose ranges do not overlap are placed at overlapping offsets.
+	* Images used only as attachments of a single pass get VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and lazily allocated
+	* memory when the device has it, on tiled GPUs they never need backing memory outside the tile buffer.
+	* Concurrent resources, shared between queues whose work overlaps arbitrarily in time, get memory of their own.
+	* Users have to order the last access of an alias predecessor before the first access of the resource reusing its memory,
+	* whose contents are undefined.
+	*/
+	class TransientResourcePool
+	{
+	public:
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, const VkAllocationCallbacks* pAllocator,
+			const std::vector<uint32_t>& concurrentQueueFamilies = {});
+		void cleanup();
+
+		uint32_t addImage(const char* name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage,
+			uint32_t firstPass, uint32_t lastPass, bool concurrent = false);
+		uint32_t addBuffer(const char* name, VkDeviceSize size, VkBufferUsageFlags usage,
+			uint32_t firstPass, uint32_t lastPass, bool concurrent = false);
+
+		// Create every declared resource and bind it to aliased memory
+		void allocate();
+		// Destroy the resources and free their memory, their last use must have completed
+		void reset();
+
+		uint32_t getResourceCount() const { return static_cast<uint32_t>(m_resources.size()); }
+		VkImage getImage(uint32_t resource) const { return m_resources[resource].image; }
+		VkImageView getImageView(uint32_t resource) const { return m_resources[resource].view; }
+		VkBuffer getBuffer(uint32_t resource) const { return m_resources[resource].buffer; }
+		bool isLazilyAllocated(uint32_t resource) const { return m_resources[resource].lazilyAllocated; }
+		// Earlier resources whose memory the resource reuses
+		const std::vector<uint32_t>& getAliasPredecessors(uint32_t resource) const { return m_resources[resource].aliasPredecessors; }
+		const TransientPoolStatistics& getStatistics() const { return m_statistics; }
+
+		static VkImageAspectFlags getImageAspect(VkFormat format);
+
+	private:
+		struct Resource
+		{
+			std::string             name{};
+			bool                    isImage{ false };
+			VkFormat                format{ VK_FORMAT_UNDEFINED };
+			VkExtent2D              extent{};
+			VkImageUsageFlags       imageUsage{ 0 };
+			VkDeviceSize            size{ 0 };
+			VkBufferUsageFlags      bufferUsage{ 0 };
+			uint32_t                firstPass{ 0 };
+			uint32_t                lastPass{ 0 };
+			bool                    concurrent{ false };
+			bool                    lazilyAllocated{ false };
+
+			VkImage                 image{ VK_NULL_HANDLE };
+			VkImageView             view{ VK_NULL_HANDLE };
+			VkBuffer                buffer{ VK_NULL_HANDLE };
+			VkMemoryRequirements    requirements{};
+			uint32_t                memoryType{ 0 };
+			VkDeviceSize            offset{ 0 };
+			std::vector<uint32_t>   aliasPredecessors{};
+		};
+
+		bool lifetimesOverlap(const Resource& a, const Resource& b) const { return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass; }
+		void allocateGroup(const std::vector<uint32_t>& group);
+
+	private:
+		VkPhysicalDevice                m_physicalDevice{ VK_NULL_HANDLE };
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		std::vector<uint32_t>           m_concurrentQueueFamilies{};
+		VkDeviceSize                    m_bufferImageGranularity{ 1 };
+
+		std::vector<Resource>           m_resources{};
+		std::vector<VkDeviceMemory>     m_memories{};
+		TransientPoolStatistics         m_statistics{};
+		bool                            m_allocated{ false };
+	};
+} // namespace PVulkanExamples
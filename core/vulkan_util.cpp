@@ -1,8 +1,10 @@
 #include "vulkan_util.h"
 #include "vulkan_reflection_util.h"
+#include "vulkan_dispatch.h"
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 
 namespace PVulkanExamples
 {
@@ -74,7 +76,8 @@ namespace PVulkanExamples
     */
     void VulkanUtil::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo,
         PFN_vkDebugUtilsMessengerCallbackEXT debugCallback,
-        bool debug)
+        bool debug,
+        void* pUserData)
     {
         createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -91,6 +94,7 @@ namespace PVulkanExamples
             createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
         }
         createInfo.pfnUserCallback = debugCallback;
+        createInfo.pUserData = pUserData;
     }
 
     /*
@@ -101,9 +105,8 @@ namespace PVulkanExamples
         const VkAllocationCallbacks* pAllocator,
         VkDebugUtilsMessengerEXT* pDebugMessenger)
     {
-        auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-        if (func != nullptr) {
-            return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+        if (vkd.vkCreateDebugUtilsMessengerEXT != nullptr) {
+            return vkd.vkCreateDebugUtilsMessengerEXT(instance, pCreateInfo, pAllocator, pDebugMessenger);
         }
         else {
             return VK_ERROR_EXTENSION_NOT_PRESENT;
@@ -115,11 +118,9 @@ namespace PVulkanExamples
     */
     void VulkanUtil::destroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
     {
-        auto func =
-            (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-        if (func != nullptr)
+        if (vkd.vkDestroyDebugUtilsMessengerEXT != nullptr)
         {
-            func(instance, debugMessenger, pAllocator);
+            vkd.vkDestroyDebugUtilsMessengerEXT(instance, debugMessenger, pAllocator);
         }
     }
 
@@ -140,7 +141,7 @@ namespace PVulkanExamples
         VkMemoryPropertyFlags properties_flag)
     {
         VkPhysicalDeviceMemoryProperties physical_device_memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device, &physical_device_memory_properties);
+        vkd.vkGetPhysicalDeviceMemoryProperties(physical_device, &physical_device_memory_properties);
         for (uint32_t i = 0; i < physical_device_memory_properties.memoryTypeCount; i++)
         {
             if (type_filter & (1 << i) && (physical_device_memory_properties.memoryTypes[i].propertyFlags & properties_flag) == properties_flag)
@@ -150,4 +151,137 @@ namespace PVulkanExamples
         }
         throw std::runtime_error("Failed to find memory type");
     }
+
+    /*
+    * Create a buffer with dedicated memory bound to it
+    */
+    void VulkanUtil::createBuffer(VkPhysicalDevice physicalDevice, VkDevice device,
+        VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+        VkBuffer& buffer, VkDeviceMemory& memory, const VkAllocationCallbacks* pAllocator)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkd.vkCreateBuffer(device, &bufferInfo, pAllocator, &buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkd.vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+        VkMemoryAllocateFlagsInfo allocateFlags{};
+        allocateFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+        allocateFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) ? &allocateFlags : nullptr;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+        if (vkd.vkAllocateMemory(device, &allocInfo, pAllocator, &memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate buffer memory!");
+        }
+        vkd.vkBindBufferMemory(device, buffer, memory, 0);
+    }
+
+    /*
+    * Create a single mip 2D image with dedicated memory bound to it
+    */
+    void VulkanUtil::createImage2D(VkPhysicalDevice physicalDevice, VkDevice device,
+        VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+        VkImage& image, VkDeviceMemory& memory, const VkAllocationCallbacks* pAllocator, uint32_t mipLevels)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkd.vkCreateImage(device, &imageInfo, pAllocator, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkd.vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+        if (vkd.vkAllocateMemory(device, &allocInfo, pAllocator, &memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+        vkd.vkBindImageMemory(device, image, memory, 0);
+    }
+
+    VkImageView VulkanUtil::createImageView2D(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect,
+        const VkAllocationCallbacks* pAllocator, uint32_t baseMipLevel, uint32_t levelCount)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { aspect, baseMipLevel, levelCount, 0, 1 };
+
+        VkImageView imageView;
+        if (vkd.vkCreateImageView(device, &viewInfo, pAllocator, &imageView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image view!");
+        }
+        return imageView;
+    }
+
+    /*
+    * Record a layout transition of the whole image
+    */
+    void VulkanUtil::transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+        VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = { aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+        vkd.vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    /*
+    * Read a compiled SPIR-V binary into 32-bit words
+    */
+    std::vector<uint32_t> VulkanUtil::readSpirvFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open file " + path);
+        }
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+        {
+            throw std::runtime_error("invalid SPIR-V file " + path);
+        }
+        std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), fileSize);
+        return code;
+    }
 } // namespace PVulkanExamples
\ No newline at end of file
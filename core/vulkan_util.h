@@ -4,6 +4,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace PVulkanExamples
 {
@@ -16,7 +17,8 @@ namespace PVulkanExamples
 
         static void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo,
             PFN_vkDebugUtilsMessengerCallbackEXT debugCallback,
-            bool debug = true);
+            bool debug = true,
+            void* pUserData = nullptr);
         static VkResult createDebugUtilsMessengerEXT(VkInstance instance,
             const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
             const VkAllocationCallbacks* pAllocator,
@@ -28,9 +30,23 @@ namespace PVulkanExamples
             const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
             void* pUserData);
 
-        uint32_t VulkanUtil::findMemoryType(VkPhysicalDevice      physical_device,
+        static uint32_t findMemoryType(VkPhysicalDevice      physical_device,
             uint32_t              type_filter,
             VkMemoryPropertyFlags properties_flag);
+
+        static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device,
+            VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+            VkBuffer& buffer, VkDeviceMemory& memory, const VkAllocationCallbacks* pAllocator = nullptr);
+        static void createImage2D(VkPhysicalDevice physicalDevice, VkDevice device,
+            VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+            VkImage& image, VkDeviceMemory& memory, const VkAllocationCallbacks* pAllocator = nullptr, uint32_t mipLevels = 1);
+        static VkImageView createImageView2D(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect,
+            const VkAllocationCallbacks* pAllocator = nullptr, uint32_t baseMipLevel = 0, uint32_t levelCount = 1);
+        static void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+            VkImageLayout oldLayout, VkImageLayout newLayout,
+            VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+        static std::vector<uint32_t> readSpirvFile(const std::string& path);
     private:
         static const int alignmentDefault = 60;
         static std::map<std::string, int> valuePrintColNum;
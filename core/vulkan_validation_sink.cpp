@@ -0,0 +1,215 @@
+#include "vulkan_validation_sink.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace PVulkanExamples
+{
+	namespace
+	{
+		const char* severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+		{
+			switch (severity)
+			{
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "verbose";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:    return "info";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:   return "error";
+			default:                                              return "unknown";
+			}
+		}
+
+		void copyString(char* destination, const char* source, size_t capacity)
+		{
+			if (source == nullptr) source = "";
+			std::strncpy(destination, source, capacity - 1);
+			destination[capacity - 1] = '\0';
+		}
+	}
+
+	void ValidationMessageSink::start()
+	{
+		if (m_running.load()) return;
+
+		m_queue = std::make_unique<QueueCell[]>(QUEUE_CAPACITY);
+		for (uint32_t i = 0; i < QUEUE_CAPACITY; i++)
+		{
+			m_queue[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		m_ids = std::make_unique<IdCounter[]>(ID_TABLE_CAPACITY);
+		m_untracked.count.store(0);
+		m_untracked.reported = 0;
+		m_enqueuePosition.store(0);
+		m_dequeuePosition = 0;
+		m_running.store(true);
+		m_thread = std::thread(&ValidationMessageSink::run, this);
+	}
+
+	/*
+	* Print what is left in the queue and a final summary, call after the debug messenger and instance are destroyed
+	*/
+	void ValidationMessageSink::stop()
+	{
+		if (!m_running.exchange(false)) return;
+		m_thread.join();
+		drain();
+		printSummary();
+		uint64_t dropped = m_droppedMessages.exchange(0);
+		if (dropped > 0)
+		{
+			std::cerr << "validation layer: " << dropped << " messages dropped, the queue was full\n";
+		}
+		std::cerr.flush();
+	}
+
+	VKAPI_ATTR VkBool32 VKAPI_CALL ValidationMessageSink::debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+		VkDebugUtilsMessageTypeFlagsEXT,
+		const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+		void* pUserData)
+	{
+		ValidationMessageSink* sink = static_cast<ValidationMessageSink*>(pUserData);
+		if (sink != nullptr && sink->m_running.load(std::memory_order_relaxed))
+		{
+			sink->submit(messageSeverity, pCallbackData);
+		}
+		return VK_FALSE;
+	}
+
+	/*
+	* Called on the driver thread: count the id and queue the message while the id is below its occurrence limit.
+	* Nothing is printed here, a full queue drops the message and counts it instead.
+	*/
+	void ValidationMessageSink::submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+	{
+		if (severity < m_severityThreshold) return;
+
+		IdCounter* counter = findCounter(pCallbackData->messageIdNumber);
+		if (counter == nullptr) counter = &m_untracked;
+		uint64_t occurrence = counter->count.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (occurrence > m_firstOccurrences) return;
+
+		if (!push(severity, pCallbackData))
+		{
+			m_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/*
+	* Open addressing lookup, slots are claimed with a compare exchange and never released while running
+	*/
+	ValidationMessageSink::IdCounter* ValidationMessageSink::findCounter(int32_t messageId)
+	{
+		uint64_t key = (1ull << 32) | static_cast<uint32_t>(messageId);
+		uint32_t slot = (static_cast<uint32_t>(messageId) * 2654435761u) & (ID_TABLE_CAPACITY - 1);
+		for (uint32_t probe = 0; probe < ID_TABLE_CAPACITY; probe++)
+		{
+			IdCounter& counter = m_ids[(slot + probe) & (ID_TABLE_CAPACITY - 1)];
+			uint64_t current = counter.key.load(std::memory_order_acquire);
+			if (current == key) return &counter;
+			if (current == 0)
+			{
+				if (counter.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) return &counter;
+				if (current == key) return &counter;
+			}
+		}
+		return nullptr;
+	}
+
+	bool ValidationMessageSink::push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData)
+	{
+		uint64_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+		QueueCell* cell = nullptr;
+		while (true)
+		{
+			cell = &m_queue[position & (QUEUE_CAPACITY - 1)];
+			uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+			int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+			if (difference == 0)
+			{
+				if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if (difference < 0)
+			{
+				return false; // Full
+			}
+			else
+			{
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->message.severity = severity;
+		cell->message.messageId = pCallbackData->messageIdNumber;
+		copyString(cell->message.idName, pCallbackData->pMessageIdName, MAX_ID_NAME_LENGTH);
+		copyString(cell->message.text, pCallbackData->pMessage, MAX_MESSAGE_LENGTH);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool ValidationMessageSink::pop(Message& message)
+	{
+		QueueCell& cell = m_queue[m_dequeuePosition & (QUEUE_CAPACITY - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) return false; // Empty or still being written
+		message = cell.message;
+		cell.sequence.store(m_dequeuePosition + QUEUE_CAPACITY, std::memory_order_release);
+		m_dequeuePosition++;
+		return true;
+	}
+
+	void ValidationMessageSink::drain()
+	{
+		Message message;
+		bool printed = false;
+		while (pop(message))
+		{
+			m_idNames.emplace(static_cast<uint32_t>(message.messageId), message.idName);
+			std::cerr << "validation layer [" << severityName(message.severity) << "] " << message.text << '\n';
+			printed = true;
+		}
+		if (printed) std::cerr.flush();
+	}
+
+	/*
+	* Report ids that repeated past their occurrence limit since the previous summary
+	*/
+	void ValidationMessageSink::printSummary()
+	{
+		for (uint32_t i = 0; i < ID_TABLE_CAPACITY; i++)
+		{
+			IdCounter& counter = m_ids[i];
+			if (counter.key.load(std::memory_order_acquire) == 0) continue;
+			uint32_t messageId = static_cast<uint32_t>(counter.key.load(std::memory_order_relaxed));
+			auto name = m_idNames.find(messageId);
+			char id[16];
+			std::snprintf(id, sizeof(id), "0x%08x", messageId);
+			printMuted(counter, "message " + (name != m_idNames.end() ? name->second : std::string(id)));
+		}
+		printMuted(m_untracked, "messages with untracked ids");
+		std::cerr.flush();
+	}
+
+	void ValidationMessageSink::printMuted(IdCounter& counter, const std::string& name)
+	{
+		uint64_t count = counter.count.load(std::memory_order_relaxed);
+		uint64_t muted = count > m_firstOccurrences ? count - m_firstOccurrences : 0;
+		if (muted <= counter.reported) return;
+		std::cerr << "validation layer: " << name << " repeated " << (muted - counter.reported) << " more times (" << count << " total)\n";
+		counter.reported = muted;
+	}
+
+	void ValidationMessageSink::run()
+	{
+		auto nextSummary = std::chrono::steady_clock::now() + m_summaryPeriod;
+		while (m_running.load(std::memory_order_relaxed))
+		{
+			drain();
+			if (std::chrono::steady_clock::now() >= nextSummary)
+			{
+				printSummary();
+				nextSummary += m_summaryPeriod;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+} // namespace PVulkanExamples
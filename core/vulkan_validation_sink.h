@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace PVulkanExamples
+{
+	/*
+	* Debug messenger sink that keeps validation output off the driver threads.
+	* The callback only counts the message id in a lock-free table and, for the first occurrences of an id,
+	* copies the message into a bounded lock-free queue. Ids that no longer fit in the table share one counter
+	* with the same limit. A background thread prints queued messages in order, errors included, and periodic
+	* summaries of ids that kept repeating after they were muted. stop prints whatever is still queued.
+	*/
+	class ValidationMessageSink
+	{
+	public:
+		ValidationMessageSink() = default;
+		ValidationMessageSink(const ValidationMessageSink&) = delete;
+		ValidationMessageSink& operator=(const ValidationMessageSink&) = delete;
+		~ValidationMessageSink() { stop(); }
+
+		void start();
+		void stop();
+
+		static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+			VkDebugUtilsMessageTypeFlagsEXT messageType,
+			const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+			void* pUserData);
+
+	public:
+		// Settings, read by the callback, change them before the messenger is created
+		VkDebugUtilsMessageSeverityFlagBitsEXT  m_severityThreshold{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT };
+		uint32_t                                m_firstOccurrences{ 3 };                    // Printed in full per message id
+		std::chrono::milliseconds               m_summaryPeriod{ std::chrono::seconds(5) }; // Between summaries of muted ids
+
+	private:
+		static const uint32_t QUEUE_CAPACITY = 256;     // Power of two
+		static const uint32_t ID_TABLE_CAPACITY = 1024; // Power of two
+		static const uint32_t MAX_ID_NAME_LENGTH = 128;
+		static const uint32_t MAX_MESSAGE_LENGTH = 2048;
+
+		struct Message
+		{
+			VkDebugUtilsMessageSeverityFlagBitsEXT  severity{};
+			int32_t                                 messageId{ 0 };
+			char                                    idName[MAX_ID_NAME_LENGTH]{};
+			char                                    text[MAX_MESSAGE_LENGTH]{};
+		};
+
+		// Bounded multi producer queue cell, the sequence number tells producers and the consumer whose turn it is
+		struct QueueCell
+		{
+			std::atomic<uint64_t>   sequence{ 0 };
+			Message                 message{};
+		};
+
+		struct IdCounter
+		{
+			std::atomic<uint64_t>   key{ 0 };       // Message id tagged with an occupied bit, 0 for free slots
+			std::atomic<uint64_t>   count{ 0 };
+			uint64_t                reported{ 0 };  // Owned by the background thread
+		};
+
+		void submit(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+		IdCounter* findCounter(int32_t messageId);
+		bool push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+		bool pop(Message& message);
+		void drain();
+		void printSummary();
+		void printMuted(IdCounter& counter, const std::string& name);
+		void run();
+
+	private:
+		std::unique_ptr<QueueCell[]>    m_queue{};
+		std::unique_ptr<IdCounter[]>    m_ids{};
+		std::atomic<uint64_t>           m_enqueuePosition{ 0 };
+		uint64_t                        m_dequeuePosition{ 0 };     // Single consumer
+		std::atomic<uint64_t>           m_droppedMessages{ 0 };
+		IdCounter                       m_untracked{};              // Shared by the ids that did not fit in the table
+		std::atomic<bool>               m_running{ false };
+		std::thread                     m_thread{};
+		std::unordered_map<uint32_t, std::string> m_idNames{};      // Owned by the background thread
+	};
+} // namespace PVulkanExamples
@@ -0,0 +1,317 @@
+#include "vulkan_vertex_blending.h"
+#include "vulkan_dispatch.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace PVulkanExamples
+{
+	void VertexBlending::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxMeshCount, const VkAllocationCallbacks* pAllocator)
+	{
+		m_physicalDevice = physicalDevice;
+		m_device = device;
+		m_allocator = pAllocator;
+		m_maxMeshCount = maxMeshCount;
+		VkPhysicalDeviceProperties properties{};
+		vkd.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		m_maxWorkgroupCount[0] = properties.limits.maxComputeWorkGroupCount[0];
+		m_maxWorkgroupCount[1] = properties.limits.maxComputeWorkGroupCount[1];
+		m_geometries.clear();
+		m_vertices.clear();
+		m_deltas.clear();
+		m_meshes.clear();
+		m_meshGeometries.clear();
+		m_workgroups.clear();
+		m_joints.clear();
+		m_weights.clear();
+		m_outputVertexCount = 0;
+		m_dispatchSize = {};
+		m_pendingUpload = false;
+		m_statistics = {};
+	}
+
+	void VertexBlending::cleanup()
+	{
+		if (m_device == VK_NULL_HANDLE) return;
+		for (Buffer& buffer : m_buffers)
+		{
+			vkd.vkDestroyBuffer(m_device, buffer.buffer, m_allocator);
+			vkd.vkFreeMemory(m_device, buffer.memory, m_allocator);
+			buffer = {};
+		}
+		m_outputAddress = 0;
+		vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_allocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+		m_descriptorSets.clear();
+		m_shaderHotReloader = nullptr;
+		m_geometries.clear();
+		m_vertices.clear();
+		m_deltas.clear();
+		m_meshes.clear();
+		m_meshGeometries.clear();
+		m_workgroups.clear();
+		m_joints.clear();
+		m_weights.clear();
+		m_device = VK_NULL_HANDLE;
+	}
+
+	/*
+	* The pipeline stays registered with the hot reloader, which destroys it, the layouts belong to the layout cache
+	*/
+	void VertexBlending::createPipeline(ShaderHotReloader& shaderHotReloader, PipelineLayoutCache& pipelineLayoutCache,
+		const std::string& shaderDirectory, uint32_t frameCount)
+	{
+		m_shaderHotReloader = &shaderHotReloader;
+		m_pipeline = shaderHotReloader.registerPipeline({ shaderDirectory + "/vertex_blending.comp" },
+			[this, &pipelineLayoutCache](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+			{
+				std::vector<VkDescriptorSetLayout> setLayouts;
+				m_pipelineLayout = pipelineLayoutCache.getPipelineLayout({ ShaderReflectionUtil::reflect(spirvStages[0]) }, &setLayouts);
+				m_setLayout = setLayouts[0];
+
+				VkShaderModuleCreateInfo moduleInfo{};
+				moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+				moduleInfo.codeSize = spirvStages[0].size() * sizeof(uint32_t);
+				moduleInfo.pCode = spirvStages[0].data();
+				VkShaderModule module;
+				if (vkd.vkCreateShaderModule(m_device, &moduleInfo, m_allocator, &module) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create vertex blending shader module!");
+				}
+				VkComputePipelineCreateInfo createInfo{};
+				createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+				createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+				createInfo.stage.module = module;
+				createInfo.stage.pName = "main";
+				createInfo.layout = m_pipelineLayout;
+				VkPipeline pipeline;
+				VkResult result = vkd.vkCreateComputePipelines(m_device, pipelineCache, 1, &createInfo, m_allocator, &pipeline);
+				vkd.vkDestroyShaderModule(m_device, module, m_allocator);
+				if (result != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create vertex blending pipeline!");
+				}
+				return pipeline;
+			});
+
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * frameCount };
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = frameCount;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_allocator, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create vertex blending descriptor pool!");
+		}
+		std::vector<VkDescriptorSetLayout> layouts(frameCount, m_setLayout);
+		m_descriptorSets.resize(frameCount);
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = m_descriptorPool;
+		allocateInfo.descriptorSetCount = frameCount;
+		allocateInfo.pSetLayouts = layouts.data();
+		if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, m_descriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate vertex blending descriptor sets!");
+		}
+	}
+
+	uint32_t VertexBlending::addGeometry(const BlendGeometryDesc& desc)
+	{
+		if (getBuffer(VertexBlendingBuffer::Output) != VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("failed to add blend geometry, vertex blending buffers were already created!");
+		}
+		uint32_t vertexCount = static_cast<uint32_t>(desc.vertices.size());
+		if (vertexCount == 0 || desc.blendShapes.size() % vertexCount != 0 || desc.jointCount == 0 || desc.jointCount > 256)
+		{
+			throw std::runtime_error("failed to add blend geometry, invalid vertex, blend shape or joint count!");
+		}
+		Geometry geometry{};
+		geometry.firstVertex = static_cast<uint32_t>(m_vertices.size());
+		geometry.vertexCount = vertexCount;
+		geometry.firstDelta = static_cast<uint32_t>(m_deltas.size());
+		geometry.shapeCount = static_cast<uint32_t>(desc.blendShapes.size() / vertexCount);
+		geometry.jointCount = desc.jointCount;
+		m_vertices.insert(m_vertices.end(), desc.vertices.begin(), desc.vertices.end());
+		m_deltas.insert(m_deltas.end(), desc.blendShapes.begin(), desc.blendShapes.end());
+		m_geometries.push_back(geometry);
+		return static_cast<uint32_t>(m_geometries.size() - 1);
+	}
+
+	uint32_t VertexBlending::addMesh(uint32_t geometry)
+	{
+		if (getBuffer(VertexBlendingBuffer::Output) != VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("failed to add blended mesh, vertex blending buffers were already created!");
+		}
+		if (m_meshes.size() == m_maxMeshCount)
+		{
+			throw std::runtime_error("failed to add blended mesh, mesh count exceeds maxVertexBlendingMeshCount!");
+		}
+		const Geometry& source = m_geometries[geometry];
+		VertexBlendingMesh mesh{};
+		mesh.firstSourceVertex = source.firstVertex;
+		mesh.firstOutputVertex = m_outputVertexCount;
+		mesh.vertexCount = source.vertexCount;
+		mesh.firstDelta = source.firstDelta;
+		mesh.shapeCount = source.shapeCount;
+		mesh.firstJoint = static_cast<uint32_t>(m_joints.size());
+		mesh.firstWeight = static_cast<uint32_t>(m_weights.size());
+		uint32_t meshIndex = static_cast<uint32_t>(m_meshes.size());
+		m_meshes.push_back(mesh);
+		m_meshGeometries.push_back(geometry);
+		m_joints.resize(m_joints.size() + source.jointCount);
+		m_weights.resize(m_weights.size() + source.shapeCount, 0.0f);
+		m_outputVertexCount += source.vertexCount;
+
+		for (uint32_t vertex = 0; vertex < source.vertexCount; vertex += WORKGROUP_SIZE)
+		{
+			m_workgroups.push_back(meshIndex);
+			m_workgroups.push_back(vertex);
+		}
+		return meshIndex;
+	}
+
+	/*
+	* The workgroups fill rows of at most maxComputeWorkGroupCount[0], the shader skips the ones past the table in the last row
+	*/
+	void VertexBlending::createBuffers(bool accelerationStructureInput)
+	{
+		uint32_t workgroupCount = getWorkgroupCount();
+		uint32_t rowLength = std::min(workgroupCount, m_maxWorkgroupCount[0]);
+		uint32_t rowCount = rowLength == 0 ? 0 : (workgroupCount + rowLength - 1) / rowLength;
+		if (rowCount > m_maxWorkgroupCount[1])
+		{
+			throw std::runtime_error("failed to create vertex blending buffers, workgroup count exceeds maxComputeWorkGroupCount!");
+		}
+		m_dispatchSize = { rowLength, rowCount };
+
+		// Empty tables still get a buffer, descriptors cannot point at nothing
+		const VkDeviceSize sizes[] = {
+			std::max<VkDeviceSize>(m_meshes.size(), 1) * sizeof(VertexBlendingMesh),
+			std::max<VkDeviceSize>(m_workgroups.size(), 2) * sizeof(uint32_t),
+			std::max<VkDeviceSize>(m_vertices.size(), 1) * sizeof(BlendVertex),
+			std::max<VkDeviceSize>(m_deltas.size(), 1) * sizeof(BlendShapeDelta),
+			std::max<VkDeviceSize>(m_outputVertexCount, 1) * sizeof(BlendedVertex) };
+		for (uint32_t index = 0; index < static_cast<uint32_t>(VertexBlendingBuffer::Count); index++)
+		{
+			VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			if (index == static_cast<uint32_t>(VertexBlendingBuffer::Output))
+			{
+				usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+				if (accelerationStructureInput)
+				{
+					usage |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+				}
+			}
+			Buffer& buffer = m_buffers[index];
+			buffer.size = sizes[index];
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, buffer.size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				buffer.buffer, buffer.memory, m_allocator);
+		}
+		if (accelerationStructureInput)
+		{
+			VkBufferDeviceAddressInfo addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+			addressInfo.buffer = getBuffer(VertexBlendingBuffer::Output);
+			m_outputAddress = vkd.vkGetBufferDeviceAddress(m_device, &addressInfo);
+		}
+		m_pendingUpload = true;
+	}
+
+	void VertexBlending::setJoints(uint32_t mesh, const InstanceTransform* pJoints)
+	{
+		std::copy(pJoints, pJoints + m_geometries[m_meshGeometries[mesh]].jointCount, m_joints.begin() + m_meshes[mesh].firstJoint);
+	}
+
+	void VertexBlending::setBlendWeights(uint32_t mesh, const float* pWeights)
+	{
+		std::copy(pWeights, pWeights + m_meshes[mesh].shapeCount, m_weights.begin() + m_meshes[mesh].firstWeight);
+	}
+
+	/*
+	* The tables are static once the buffers exist, all of them are staged in one ring allocation and copied once
+	*/
+	VkDeviceSize VertexBlending::upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing)
+	{
+		if (!m_pendingUpload) return 0;
+		const void* sources[] = { m_meshes.data(), m_workgroups.data(), m_vertices.data(), m_deltas.data() };
+		const VkDeviceSize sizes[] = {
+			m_meshes.size() * sizeof(VertexBlendingMesh),
+			m_workgroups.size() * sizeof(uint32_t),
+			m_vertices.size() * sizeof(BlendVertex),
+			m_deltas.size() * sizeof(BlendShapeDelta) };
+		VkDeviceSize stagedSize = 0;
+		for (VkDeviceSize size : sizes) stagedSize += size;
+		if (stagedSize == 0)
+		{
+			m_pendingUpload = false;
+			return 0;
+		}
+
+		RingBufferAllocation staging = stagingRing.allocate(stagedSize);
+		VkDeviceSize offset = 0;
+		for (uint32_t index = 0; index < static_cast<uint32_t>(std::size(sizes)); index++)
+		{
+			if (sizes[index] == 0) continue;
+			std::memcpy(static_cast<uint8_t*>(staging.pData) + offset, sources[index], sizes[index]);
+			VkBufferCopy region{ staging.offset + offset, 0, sizes[index] };
+			vkd.vkCmdCopyBuffer(commandBuffer, staging.buffer, m_buffers[index].buffer, 1, &region);
+			offset += sizes[index];
+		}
+		m_pendingUpload = false;
+		return stagedSize;
+	}
+
+	/*
+	* Binding order of vertex_blending.comp: the four tables, the joint palettes, the weights and the output vertices
+	*/
+	VertexBlendingFrameData VertexBlending::writeFrameData(RingBuffer& ring, uint32_t frameIndex)
+	{
+		VkDeviceSize jointSize = std::max<VkDeviceSize>(m_joints.size(), 1) * sizeof(InstanceTransform);
+		VkDeviceSize weightSize = std::max<VkDeviceSize>(m_weights.size(), 1) * sizeof(float);
+		RingBufferAllocation joints = ring.allocate(jointSize);
+		RingBufferAllocation weights = ring.allocate(weightSize);
+		if (!m_joints.empty()) std::memcpy(joints.pData, m_joints.data(), m_joints.size() * sizeof(InstanceTransform));
+		if (!m_weights.empty()) std::memcpy(weights.pData, m_weights.data(), m_weights.size() * sizeof(float));
+		m_statistics.frameDataBytes += jointSize + weightSize;
+		VertexBlendingFrameData frameData{ { joints.buffer, joints.offset, joints.size }, { weights.buffer, weights.offset, weights.size } };
+
+		if (m_descriptorSets.empty()) return frameData;
+		VkDescriptorBufferInfo infos[7]{};
+		const VertexBlendingBuffer tables[4] = { VertexBlendingBuffer::Meshes, VertexBlendingBuffer::Workgroups,
+			VertexBlendingBuffer::Vertices, VertexBlendingBuffer::Deltas };
+		for (uint32_t table = 0; table < 4; table++) infos[table] = { getBuffer(tables[table]), 0, VK_WHOLE_SIZE };
+		infos[4] = frameData.joints;
+		infos[5] = frameData.weights;
+		infos[6] = { getBuffer(VertexBlendingBuffer::Output), 0, VK_WHOLE_SIZE };
+		VkWriteDescriptorSet writes[7]{};
+		for (uint32_t binding = 0; binding < 7; binding++)
+		{
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = m_descriptorSets[frameIndex];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[binding].pBufferInfo = &infos[binding];
+		}
+		vkd.vkUpdateDescriptorSets(m_device, 7, writes, 0, nullptr);
+		return frameData;
+	}
+
+	void VertexBlending::dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (m_workgroups.empty()) return;
+		vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_shaderHotReloader->getPipeline(m_pipeline));
+		vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[frameIndex], 0, nullptr);
+		vkd.vkCmdDispatch(commandBuffer, m_dispatchSize.width, m_dispatchSize.height, 1);
+		m_statistics.dispatches++;
+		m_statistics.blendedVertices += m_outputVertexCount;
+	}
+} // namespace PVulkanExamples
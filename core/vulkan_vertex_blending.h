@@ -0,0 +1,204 @@
+#pragma once
+
+#include "vulkan_instance_store.h"
+#include "vulkan_ring_buffer.h"
+#include "vulkan_shader_hot_reload.h"
+#include "vulkan_shader_reflection.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PVulkanExamples
+{
+	// std430 layout of a rest pose vertex, 32 bytes
+	struct BlendVertex
+	{
+		float       position[3]{ 0.0f, 0.0f, 0.0f };
+		uint32_t    joints{ 0 };                        // Four 8 bit joint indices into the palette of the mesh
+		float       normal[3]{ 0.0f, 1.0f, 0.0f };
+		uint32_t    weights{ 0xFF };                    // Four 8 bit unorm joint weights summing to 255
+	};
+
+	// Offset of one vertex in one blend shape, added scaled by the weight of the shape
+	struct BlendShapeDelta
+	{
+		float       position[3]{ 0.0f, 0.0f, 0.0f };
+		float       normal[3]{ 0.0f, 0.0f, 0.0f };
+	};
+
+	// Output vertex of the blending stage, 24 bytes
+	struct BlendedVertex
+	{
+		float       position[3];
+		float       normal[3];
+	};
+
+	// std430 layout of one mesh in the mesh table read by the blending shader
+	struct VertexBlendingMesh
+	{
+		uint32_t    firstSourceVertex{ 0 };
+		uint32_t    firstOutputVertex{ 0 };
+		uint32_t    vertexCount{ 0 };
+		uint32_t    firstDelta{ 0 };        // Deltas of shape s start at firstDelta + s * vertexCount
+		uint32_t    shapeCount{ 0 };
+		uint32_t    firstJoint{ 0 };        // In the joint palette of the frame, three vec4 rows per joint
+		uint32_t    firstWeight{ 0 };       // In the blend shape weights of the frame
+		uint32_t    padding{ 0 };
+	};
+
+	// Rest pose, skinning weights and blend shapes shared by the meshes created from it
+	struct BlendGeometryDesc
+	{
+		std::vector<BlendVertex>        vertices{};
+		std::vector<BlendShapeDelta>    blendShapes{};  // Shape after shape, vertices.size() deltas each
+		uint32_t                        jointCount{ 1 };
+	};
+
+	enum class VertexBlendingBuffer : uint32_t
+	{
+		Meshes,         // VertexBlendingMesh per mesh
+		Workgroups,     // uvec2 mesh index and first vertex per workgroup
+		Vertices,       // BlendVertex of every geometry
+		Deltas,         // BlendShapeDelta of every geometry
+		Output,         // BlendedVertex of every mesh
+		Count,
+	};
+
+	// Ranges of the frame's joint palettes and blend shape weights in the upload ring
+	struct VertexBlendingFrameData
+	{
+		VkDescriptorBufferInfo  joints{};
+		VkDescriptorBufferInfo  weights{};
+	};
+
+	struct VertexBlendingStatistics
+	{
+		uint64_t    dispatches{ 0 };
+		uint64_t    blendedVertices{ 0 };
+		uint64_t    frameDataBytes{ 0 };    // Joint palettes and weights written to the ring
+	};
+
+	/*
+	* Skinning and blend shapes on the GPU for all meshes at once. Geometries hold the rest pose vertices with up to four
+	* joint influences and the blend shape deltas, meshes are animated instances of a geometry with their own joint palette,
+	* blend shape weights and range of the shared output vertex buffer. One dispatch blends every vertex of every mesh:
+	* workgroups of WORKGROUP_SIZE vertices never span two meshes, a table gives each workgroup its mesh and first vertex.
+	* More workgroups than the device's maxComputeWorkGroupCount[0] are dispatched as rows of a 2D grid.
+	* The output buffer is bound as a vertex buffer by draws and read by refits of the meshes' BLASes. The blending
+	* shader is vertex_blending.comp in the core shader directory, its pipeline is registered with the hot reloader and
+	* its layouts come from the pipeline layout cache, each frame in flight gets a descriptor set of its own.
+	*/
+	class VertexBlending
+	{
+	public:
+		static constexpr uint32_t WORKGROUP_SIZE = 64;  // local_size_x of the blending shader
+
+		void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t maxMeshCount, const VkAllocationCallbacks* pAllocator = nullptr);
+		void cleanup();
+
+		/*
+		* Register the blending pipeline built from shaderDirectory/vertex_blending.comp and allocate frameCount
+		* descriptor sets, the hot reloader and the layout cache must outlive the stage
+		*/
+		void createPipeline(ShaderHotReloader& shaderHotReloader, PipelineLayoutCache& pipelineLayoutCache,
+			const std::string& shaderDirectory, uint32_t frameCount);
+
+		// Returns the index of the geometry
+		uint32_t addGeometry(const BlendGeometryDesc& desc);
+		// Returns the index of the mesh, throws past maxMeshCount. Joints start at identity, blend shape weights at zero.
+		uint32_t addMesh(uint32_t geometry);
+
+		/*
+		* Create the device buffers of the geometries and meshes added so far, nothing can be added afterwards. With
+		* accelerationStructureInput builds can read the output vertices from their device address. Throws when the
+		* workgroups do not fit in the device's maximum dispatch size.
+		*/
+		void createBuffers(bool accelerationStructureInput);
+
+		// jointCount transforms of the mesh's geometry, from rest pose to posed space
+		void setJoints(uint32_t mesh, const InstanceTransform* pJoints);
+		// One weight per blend shape of the mesh's geometry
+		void setBlendWeights(uint32_t mesh, const float* pWeights);
+
+		/*
+		* Record the copies of the geometry, mesh and workgroup tables, staged in the current frame region of the ring.
+		* Only the first call after createBuffers copies anything. Returns the bytes uploaded.
+		*/
+		VkDeviceSize upload(VkCommandBuffer commandBuffer, RingBuffer& stagingRing);
+		/*
+		* Write the joint palettes and weights of all meshes to the ring, valid for the current frame, and point the
+		* frame's descriptor set at them and at the device buffers
+		*/
+		VertexBlendingFrameData writeFrameData(RingBuffer& ring, uint32_t frameIndex);
+		// Record the dispatch blending every mesh with the blending pipeline and the frame's descriptor set
+		void dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		bool hasPendingUploads() const { return m_pendingUpload; }
+		VkBuffer getBuffer(VertexBlendingBuffer buffer) const { return m_buffers[static_cast<uint32_t>(buffer)].buffer; }
+		VkDeviceSize getBufferSize(VertexBlendingBuffer buffer) const { return m_buffers[static_cast<uint32_t>(buffer)].size; }
+		const VertexBlendingMesh& getMesh(uint32_t mesh) const { return m_meshes[mesh]; }
+		uint32_t getMeshGeometry(uint32_t mesh) const { return m_meshGeometries[mesh]; }
+		VkDeviceSize getOutputOffset(uint32_t mesh) const { return VkDeviceSize(m_meshes[mesh].firstOutputVertex) * sizeof(BlendedVertex); }
+		// Needs createBuffers(true)
+		VkDeviceAddress getOutputAddress(uint32_t mesh) const { return m_outputAddress + getOutputOffset(mesh); }
+		uint32_t getMeshCount() const { return static_cast<uint32_t>(m_meshes.size()); }
+		uint32_t getMeshCapacity() const { return m_maxMeshCount; }
+		uint32_t getGeometryCount() const { return static_cast<uint32_t>(m_geometries.size()); }
+		uint32_t getOutputVertexCount() const { return m_outputVertexCount; }
+		uint32_t getWorkgroupCount() const { return static_cast<uint32_t>(m_workgroups.size() / 2); }
+		// Workgroup grid of the dispatch, valid after createBuffers
+		VkExtent2D getDispatchSize() const { return m_dispatchSize; }
+		const VertexBlendingStatistics& getStatistics() const { return m_statistics; }
+		void resetStatistics() { m_statistics = {}; }
+
+	private:
+		struct Geometry
+		{
+			uint32_t    firstVertex{ 0 };
+			uint32_t    vertexCount{ 0 };
+			uint32_t    firstDelta{ 0 };
+			uint32_t    shapeCount{ 0 };
+			uint32_t    jointCount{ 0 };
+		};
+
+		struct Buffer
+		{
+			VkBuffer        buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory  memory{ VK_NULL_HANDLE };
+			VkDeviceSize    size{ 0 };
+		};
+
+		VkPhysicalDevice                m_physicalDevice{ VK_NULL_HANDLE };
+		VkDevice                        m_device{ VK_NULL_HANDLE };
+		const VkAllocationCallbacks*    m_allocator{ nullptr };
+		uint32_t                        m_maxMeshCount{ 0 };
+		uint32_t                        m_maxWorkgroupCount[2]{ 0, 0 };    // maxComputeWorkGroupCount in x and y
+
+		std::vector<Geometry>           m_geometries{};
+		std::vector<BlendVertex>        m_vertices{};
+		std::vector<BlendShapeDelta>    m_deltas{};
+		std::vector<VertexBlendingMesh> m_meshes{};
+		std::vector<uint32_t>           m_meshGeometries{};
+		std::vector<uint32_t>           m_workgroups{};     // Mesh index and first vertex pairs
+		uint32_t                        m_outputVertexCount{ 0 };
+		VkExtent2D                      m_dispatchSize{};
+
+		std::vector<InstanceTransform>  m_joints{};         // Joint palettes of all meshes
+		std::vector<float>              m_weights{};        // Blend shape weights of all meshes
+
+		Buffer                          m_buffers[static_cast<uint32_t>(VertexBlendingBuffer::Count)]{};
+		VkDeviceAddress                 m_outputAddress{ 0 };
+		bool                            m_pendingUpload{ false };
+		VertexBlendingStatistics        m_statistics{};
+
+		ShaderHotReloader*              m_shaderHotReloader{ nullptr };
+		uint32_t                        m_pipeline{ 0 };
+		VkPipelineLayout                m_pipelineLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout           m_setLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool                m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<VkDescriptorSet>    m_descriptorSets{};
+	};
+} // namespace PVulkanExamples
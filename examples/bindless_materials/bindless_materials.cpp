@@ -0,0 +1,841 @@
+#include "vulkan_example_base.h"
+#include "vulkan_instance_store.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* Bindless materials: every object is its own draw, and the parameters of all materials are held by the material system of
+* the base in one storage buffer indexed by material ID, their textures in one bindless sampled image array. A single
+* descriptor set per frame stays bound for the whole frame, switching materials between draws costs nothing but the draw,
+* and the draws are sorted by pipeline so only three pipeline binds remain whatever the object count. A few materials are
+* animated every frame and only those are uploaded.
+*
+*   bindless_materials [--objects <n>] [--animated <n>] [--unsorted] [common options]
+*
+* --animated sets the materials changed per frame, 8 by default. --unsorted draws in scene order, binding the pipeline
+* whenever it changes, for comparison. Pipeline binds, the CPU time spent sorting and recording the draws and the material
+* upload volume are printed on exit, counted from the frame after the initial upload. The camera follows a fixed path
+* driven by the frame number so headless runs are reproducible.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t TEXTURE_COUNT = 32;
+		constexpr uint32_t TEXTURE_SIZE = 64;
+		constexpr float OBJECT_SPACING = 2.5f;
+		constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		// Descriptor bindings of set 0, see object.vert and the fragment shaders
+		constexpr uint32_t MATERIAL_BINDING = 3;
+		constexpr uint32_t TEXTURE_BINDING = 4;
+
+		enum ShadingModel : uint32_t
+		{
+			SHADING_LIT,
+			SHADING_EMISSIVE,
+			SHADING_CUTOUT,		// Alpha tested and two sided
+			SHADING_COUNT,
+		};
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+			float uv[2];
+		};
+
+		// std140 FrameData block of all shaders
+		struct FrameData
+		{
+			Mat4	viewProjection{};
+			float	cameraPosition[4]{};
+			float	lightDirection[4]{};
+		};
+	}
+
+	struct MaterialSettings
+	{
+		uint32_t	objectCount{ 16384 };
+		uint32_t	animatedMaterials{ 8 };		// Materials changed per frame
+		bool		unsorted{ false };			// Draw in scene order
+	};
+
+	class BindlessMaterialsExample : public ExampleBase
+	{
+	public:
+		explicit BindlessMaterialsExample(const MaterialSettings& settings) : m_settings(settings)
+		{
+			m_title = "Bindless Materials";
+			m_shaderDirectory = getShaderDirectory("bindless_materials");
+		}
+
+		void printStatistics() const
+		{
+			const MaterialUploadStatistics& upload = m_materialSystem.getStatistics();
+			double frames = std::max<uint64_t>(m_recordedFrames, 1);
+			std::cout << "\n=====Bindless Materials=====";
+			std::cout << "\n" << std::setw(30) << std::left << "Draw order" << (m_settings.unsorted ? "Scene order" : "Sorted by pipeline");
+			std::cout << "\n" << std::setw(30) << std::left << "Draws / frame" << m_settings.objectCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Materials" << m_materialSystem.getMaterialCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Bindless textures" << m_materialSystem.getTextureCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Frames" << m_recordedFrames;
+			std::cout << "\n" << std::setw(30) << std::left << "Pipeline binds / frame" << std::fixed << std::setprecision(1) << m_pipelineBinds / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Sort + record CPU (ms)" << std::setprecision(3) << m_recordSeconds * 1000.0 / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Uploaded materials / frame" << std::setprecision(1) << upload.uploadedMaterials / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Material copy regions / frame" << upload.copyRegions / frames;
+			std::cout << std::defaultfloat << std::endl;
+		}
+
+	protected:
+		void configureDeviceRequirements() override
+		{
+			// Bindless texture array, sized by the pipeline layout cache and bound only as far as textures were added,
+			// devices without these features are not picked and the layout cache rejects runtime arrays without the set
+			addDeviceFeatureSet("DescriptorIndexing", FeatureSetPriority::Required);
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "runtimeDescriptorArray", "DescriptorIndexing");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "descriptorBindingPartiallyBound", "DescriptorIndexing");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "descriptorBindingVariableDescriptorCount", "DescriptorIndexing");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "shaderSampledImageArrayNonUniformIndexing", "DescriptorIndexing");
+		}
+
+		void createResources() override
+		{
+			createMesh();
+			createObjects();
+			uploadMeshAndTextures();
+			createRenderPass();
+			createPipelines();
+			createMaterials();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			vkd.vkDestroySampler(m_device, m_sampler, m_defaultAllocator);
+			for (size_t index = 0; index < m_textureImages.size(); index++)
+			{
+				vkd.vkDestroyImageView(m_device, m_textureViews[index], m_defaultAllocator);
+				vkd.vkDestroyImage(m_device, m_textureImages[index], m_defaultAllocator);
+				vkd.vkFreeMemory(m_device, m_textureMemories[index], m_defaultAllocator);
+			}
+			m_textureImages.clear();
+			m_textureViews.clear();
+			m_textureMemories.clear();
+			m_objects.cleanup();
+			destroyBuffer(m_vertexBuffer, m_vertexMemory);
+			destroyBuffer(m_indexBuffer, m_indexMemory);
+			m_frameSets.clear();
+			m_renderPass = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+			m_sampler = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Animate a rolling window of materials, write the frame uniforms to the upload ring and bring the descriptor set
+		* of the frame slot up to date, its previous frame has completed
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureDepthTarget(m_targets, extent);
+
+			float time = 0.016f * static_cast<float>(m_frameCounter);
+			float fieldSize = m_gridSide * OBJECT_SPACING;
+			float angle = 0.1f * time;
+			Vec3 eye{ 0.6f * fieldSize * std::cos(angle), 0.35f * fieldSize, 0.6f * fieldSize * std::sin(angle) };
+			RingBufferAllocation frameAllocation = m_uploadRing.allocate(sizeof(FrameData));
+			FrameData* data = static_cast<FrameData*>(frameAllocation.pData);
+			data->viewProjection = perspective(1.0f, float(extent.width) / float(extent.height), 0.5f, 2.0f * fieldSize) *
+				lookAt(eye, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+			data->cameraPosition[0] = eye.x;
+			data->cameraPosition[1] = eye.y;
+			data->cameraPosition[2] = eye.z;
+			Vec3 light = normalize({ -0.5f, -1.0f, -0.25f });
+			data->lightDirection[0] = light.x;
+			data->lightDirection[1] = light.y;
+			data->lightDirection[2] = light.z;
+
+			// Statistics cover the steady state, from the frame after all materials were first uploaded
+			if (!m_initialUploadDone && !m_materialSystem.hasPendingUploads())
+			{
+				m_materialSystem.resetStatistics();
+				m_recordedFrames = 0;
+				m_pipelineBinds = 0;
+				m_recordSeconds = 0.0;
+				m_initialUploadDone = true;
+			}
+
+			uint32_t materialCount = static_cast<uint32_t>(m_materialIds.size());
+			for (uint32_t animated = 0; animated < std::min(m_settings.animatedMaterials, materialCount); animated++)
+			{
+				uint32_t materialId = m_materialIds[(m_animationCursor + animated) % materialCount];
+				MaterialParameters parameters = m_materialSystem.getParameters(materialId);
+				float pulse = 0.5f + 0.5f * std::sin(4.0f * time + float(materialId));
+				if (m_materialSystem.getPipeline(materialId) == m_pipelines[SHADING_EMISSIVE]) parameters.emissive[3] = 1.0f + 3.0f * pulse;
+				else parameters.roughness = 0.2f + 0.7f * pulse;
+				m_materialSystem.updateMaterial(materialId, parameters);
+			}
+			m_animationCursor = (m_animationCursor + m_settings.animatedMaterials) % std::max(materialCount, 1u);
+
+			VkDescriptorBufferInfo uniformInfo{ frameAllocation.buffer, frameAllocation.offset, frameAllocation.size };
+			VkDescriptorBufferInfo transformInfo{ m_objects.getBuffer(InstanceStream::Transform), 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo materialIdInfo{ m_objects.getBuffer(InstanceStream::Material), 0, VK_WHOLE_SIZE };
+			VkWriteDescriptorSet writes[3] = {
+				bufferWrite(m_frameSets[frameIndex], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+				bufferWrite(m_frameSets[frameIndex], 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &transformInfo),
+				bufferWrite(m_frameSets[frameIndex], 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &materialIdInfo) };
+			vkd.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+			m_materialSystem.updateDescriptorSet(frameIndex, m_frameSets[frameIndex], MATERIAL_BINDING, TEXTURE_BINDING);
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test is waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+			// Uploads wait for the previous frame's shader reads
+			RenderGraphResourceState objectState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+			RenderGraphResourceState materialState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+			RenderGraphResource transforms = m_renderGraph.importBuffer("Object Transforms", m_objects.getBuffer(InstanceStream::Transform),
+				VK_WHOLE_SIZE, objectState, objectState);
+			RenderGraphResource materialIds = m_renderGraph.importBuffer("Object Material IDs", m_objects.getBuffer(InstanceStream::Material),
+				VK_WHOLE_SIZE, objectState, objectState);
+			RenderGraphResource materials = m_renderGraph.importBuffer("Materials", m_materialSystem.getBuffer(), VK_WHOLE_SIZE, materialState, materialState);
+
+			if (m_objects.hasDirtyPages() || m_materialSystem.hasPendingUploads())
+			{
+				m_renderGraph.addPass("Upload Objects And Materials", RenderGraphPassType::Compute,
+					[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+					{
+						m_objects.upload(commandBuffer, m_uploadRing);
+						m_materialSystem.upload(commandBuffer, m_uploadRing);
+					})
+					.write(transforms, RenderGraphUsage::TransferWrite)
+					.write(materialIds, RenderGraphUsage::TransferWrite)
+					.write(materials, RenderGraphUsage::TransferWrite);
+			}
+
+			m_renderGraph.addPass("Draw Objects", RenderGraphPassType::Raster,
+				[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordDraws(commandBuffer, target); })
+				.read(transforms, RenderGraphUsage::StorageRead)
+				.read(materialIds, RenderGraphUsage::StorageRead)
+				.read(materials, RenderGraphUsage::StorageRead)
+				.write(color, RenderGraphUsage::ColorAttachment)
+				.write(depth, RenderGraphUsage::DepthStencilAttachment);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+		}
+
+	private:
+		/*
+		* Unit cube, four vertices per face for flat normals and per face texture coordinates, counter clockwise seen from outside
+		*/
+		void createMesh()
+		{
+			const Vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+			for (const Vec3& normal : normals)
+			{
+				// u x v is the normal, so the corners run counter clockwise seen from outside
+				Vec3 u = std::abs(normal.y) > 0.5f ? Vec3{ 0, 0, 1 } : Vec3{ 0, 1, 0 };
+				Vec3 v = cross(normal, u);
+				uint32_t base = static_cast<uint32_t>(m_vertices.size());
+				const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+				for (const auto& corner : corners)
+				{
+					Vertex vertex{};
+					vertex.position[0] = 0.5f * (normal.x + corner[0] * u.x + corner[1] * v.x);
+					vertex.position[1] = 0.5f * (normal.y + corner[0] * u.y + corner[1] * v.y);
+					vertex.position[2] = 0.5f * (normal.z + corner[0] * u.z + corner[1] * v.z);
+					vertex.normal[0] = normal.x;
+					vertex.normal[1] = normal.y;
+					vertex.normal[2] = normal.z;
+					vertex.uv[0] = 0.5f + 0.5f * corner[0];
+					vertex.uv[1] = 0.5f + 0.5f * corner[1];
+					m_vertices.push_back(vertex);
+				}
+				m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+			}
+		}
+
+		/*
+		* Objects on a square grid with random sizes and orientations, their materials are assigned by createMaterials
+		*/
+		void createObjects()
+		{
+			m_objects.init(m_physicalDevice, m_device, m_settings.objectCount, m_defaultAllocator);
+			m_gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(double(m_settings.objectCount))));
+			float halfField = 0.5f * m_gridSide * OBJECT_SPACING;
+			std::mt19937 random(31);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (uint32_t index = 0; index < m_settings.objectCount; index++)
+			{
+				float scale = 0.8f + 0.8f * unit(random);
+				float heading = 6.2831853f * unit(random);
+				float c = std::cos(heading) * scale;
+				float s = std::sin(heading) * scale;
+				InstanceTransform transform{};
+				transform.rows[0][0] = c;		transform.rows[0][2] = s;		transform.rows[0][3] = (index % m_gridSide + 0.5f) * OBJECT_SPACING - halfField;
+				transform.rows[1][1] = scale;									transform.rows[1][3] = 0.5f * scale;
+				transform.rows[2][0] = -s;		transform.rows[2][2] = c;		transform.rows[2][3] = (index / m_gridSide + 0.5f) * OBJECT_SPACING - halfField;
+				m_objects.add(transform, 0, 0);
+			}
+		}
+
+		/*
+		* Copy the cube and the procedural textures into device local memory once, through one staging buffer and a single
+		* submission. Odd textures get a round hole in their alpha for the alpha tested materials.
+		*/
+		void uploadMeshAndTextures()
+		{
+			VkDeviceSize vertexSize = m_vertices.size() * sizeof(Vertex);
+			VkDeviceSize indexSize = m_indices.size() * sizeof(uint32_t);
+			VkDeviceSize textureSize = VkDeviceSize(TEXTURE_SIZE) * TEXTURE_SIZE * 4;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory, m_defaultAllocator);
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize + indexSize + TEXTURE_COUNT * textureSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			uint8_t* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&staging));
+			std::memcpy(staging, m_vertices.data(), vertexSize);
+			std::memcpy(staging + vertexSize, m_indices.data(), indexSize);
+
+			std::mt19937 random(7);
+			for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++)
+			{
+				uint8_t colors[2][3];
+				for (auto& color : colors)
+				{
+					for (uint8_t& channel : color) channel = static_cast<uint8_t>(96 + random() % 160);
+				}
+				uint32_t cellSize = 4u << (texture % 3);
+				uint8_t* texels = staging + vertexSize + indexSize + texture * textureSize;
+				for (uint32_t y = 0; y < TEXTURE_SIZE; y++)
+				{
+					for (uint32_t x = 0; x < TEXTURE_SIZE; x++)
+					{
+						const uint8_t* color = colors[((x / cellSize) + (y / cellSize)) % 2];
+						float dx = float(x) + 0.5f - 0.5f * TEXTURE_SIZE;
+						float dy = float(y) + 0.5f - 0.5f * TEXTURE_SIZE;
+						bool hole = texture % 2 == 1 && dx * dx + dy * dy < 0.1f * TEXTURE_SIZE * TEXTURE_SIZE;
+						uint8_t* texel = texels + (y * TEXTURE_SIZE + x) * 4;
+						texel[0] = color[0];
+						texel[1] = color[1];
+						texel[2] = color[2];
+						texel[3] = hole ? 0 : 255;
+					}
+				}
+			}
+
+			for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++)
+			{
+				VkImage image;
+				VkDeviceMemory memory;
+				VulkanUtil::createImage2D(m_physicalDevice, m_device, { TEXTURE_SIZE, TEXTURE_SIZE }, TEXTURE_FORMAT,
+					VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory, m_defaultAllocator);
+				m_textureImages.push_back(image);
+				m_textureMemories.push_back(memory);
+				m_textureViews.push_back(VulkanUtil::createImageView2D(m_device, image, TEXTURE_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, m_defaultAllocator));
+			}
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			VkBufferCopy vertexRegion{ 0, 0, vertexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_vertexBuffer, 1, &vertexRegion);
+			VkBufferCopy indexRegion{ vertexSize, 0, indexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_indexBuffer, 1, &indexRegion);
+			for (uint32_t texture = 0; texture < TEXTURE_COUNT; texture++)
+			{
+				VulkanUtil::transitionImageLayout(commandBuffer, m_textureImages[texture], VK_IMAGE_ASPECT_COLOR_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+				VkBufferImageCopy region{};
+				region.bufferOffset = vertexSize + indexSize + texture * textureSize;
+				region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				region.imageExtent = { TEXTURE_SIZE, TEXTURE_SIZE, 1 };
+				vkd.vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_textureImages[texture], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				VulkanUtil::transitionImageLayout(commandBuffer, m_textureImages[texture], VK_IMAGE_ASPECT_COLOR_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			}
+			// The mesh buffers are never written again, this makes them visible to every later frame
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+
+			VkSamplerCreateInfo samplerInfo{};
+			samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			samplerInfo.magFilter = VK_FILTER_NEAREST;
+			samplerInfo.minFilter = VK_FILTER_LINEAR;
+			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+			samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			samplerInfo.maxLod = 0.0f;
+			if (vkd.vkCreateSampler(m_device, &samplerInfo, m_defaultAllocator, &m_sampler) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create sampler!");
+			}
+		}
+
+		/*
+		* Fill the material system to its capacity, m_maxMaterialCount, with every shading model. Objects pick materials at
+		* random, so in scene order consecutive draws rarely share a pipeline.
+		*/
+		void createMaterials()
+		{
+			std::vector<uint32_t> textureIndices;
+			for (VkImageView view : m_textureViews) textureIndices.push_back(m_materialSystem.addTexture(view, m_sampler));
+
+			std::mt19937 random(11);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			uint32_t materialCount = m_materialSystem.getMaterialCapacity() - m_materialSystem.getMaterialCount();
+			for (uint32_t index = 0; index < materialCount; index++)
+			{
+				ShadingModel shading = index % 8 == 0 ? SHADING_EMISSIVE : (index % 8 < 3 ? SHADING_CUTOUT : SHADING_LIT);
+				MaterialParameters parameters{};
+				for (int channel = 0; channel < 3; channel++) parameters.baseColor[channel] = 0.4f + 0.6f * unit(random);
+				parameters.roughness = 0.2f + 0.7f * unit(random);
+				parameters.metallic = unit(random) < 0.3f ? 1.0f : 0.0f;
+				// Alpha tested materials use the odd textures with a hole, the others any texture or none
+				uint32_t texture = static_cast<uint32_t>(random() % TEXTURE_COUNT);
+				if (shading == SHADING_CUTOUT) parameters.baseColorTexture = textureIndices[texture | 1];
+				else if (index % 4 != 3) parameters.baseColorTexture = textureIndices[texture];
+				if (shading == SHADING_EMISSIVE)
+				{
+					for (int channel = 0; channel < 3; channel++) parameters.emissive[channel] = 0.3f + 0.7f * unit(random);
+					parameters.emissive[3] = 2.0f;
+				}
+				m_materialIds.push_back(m_materialSystem.createMaterial(parameters, m_pipelines[shading]));
+			}
+
+			for (uint32_t object = 0; object < m_objects.getCount(); object++)
+			{
+				m_objects.setMaterial(object, m_materialIds[random() % m_materialIds.size()]);
+			}
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared by the render pass.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* One pipeline per shading model, registered with the hot reloader. All of them declare the same set 0, so the
+		* pipeline layout cache gives them one layout and the frame's descriptor set stays bound across pipeline binds.
+		* The hot reloader IDs double as the pipeline keys of the materials.
+		*/
+		void createPipelines()
+		{
+			const char* fragmentShaders[SHADING_COUNT] = { "/lit.frag", "/emissive.frag", "/cutout.frag" };
+			for (uint32_t shading = 0; shading < SHADING_COUNT; shading++)
+			{
+				m_pipelines[shading] = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/object.vert", m_shaderDirectory + fragmentShaders[shading] },
+					[this, shading](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+					{
+						return buildPipeline(spirvStages, pipelineCache, shading == SHADING_CUTOUT);
+					});
+			}
+		}
+
+		VkPipeline buildPipeline(const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache, bool twoSided)
+		{
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			m_objectLayout = m_pipelineLayoutCache.getPipelineLayout(
+				{ ShaderReflectionUtil::reflect(spirvStages[0]), ShaderReflectionUtil::reflect(spirvStages[1]) }, &setLayouts);
+			m_frameSetLayout = setLayouts[0];
+
+			VkPipelineShaderStageCreateInfo stages[2]{};
+			const VkShaderStageFlagBits stageFlags[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+			for (uint32_t stage = 0; stage < 2; stage++)
+			{
+				stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				stages[stage].stage = stageFlags[stage];
+				stages[stage].module = createShaderModule(spirvStages[stage]);
+				stages[stage].pName = "main";
+			}
+
+			VkVertexInputBindingDescription binding{ 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+			VkVertexInputAttributeDescription attributes[3] = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) },
+				{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) },
+				{ 2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) } };
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInput.vertexBindingDescriptionCount = 1;
+			vertexInput.pVertexBindingDescriptions = &binding;
+			vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(attributes));
+			vertexInput.pVertexAttributeDescriptions = attributes;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+			VkPipelineViewportStateCreateInfo viewportState{};
+			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			// The projection flips y, counter clockwise faces stay counter clockwise in framebuffer space
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+			rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterization.cullMode = twoSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterization.lineWidth = 1.0f;
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+			VkPipelineColorBlendAttachmentState blendAttachment{};
+			blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &blendAttachment;
+
+			VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
+
+			VkGraphicsPipelineCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.stageCount = 2;
+			createInfo.pStages = stages;
+			createInfo.pVertexInputState = &vertexInput;
+			createInfo.pInputAssemblyState = &inputAssembly;
+			createInfo.pViewportState = &viewportState;
+			createInfo.pRasterizationState = &rasterization;
+			createInfo.pMultisampleState = &multisample;
+			createInfo.pDepthStencilState = &depthStencil;
+			createInfo.pColorBlendState = &colorBlend;
+			createInfo.pDynamicState = &dynamicState;
+			createInfo.layout = m_objectLayout;
+			createInfo.renderPass = m_renderPass;
+			createInfo.subpass = 0;
+			VkPipeline pipeline;
+			VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+			for (VkPipelineShaderStageCreateInfo& stage : stages) vkd.vkDestroyShaderModule(m_device, stage.module, m_defaultAllocator);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create object pipeline!");
+			}
+			return pipeline;
+		}
+
+		/*
+		* One descriptor set per frame in flight, the bindless texture array is allocated at the capacity of the material
+		* system
+		*/
+		void createFrameResources()
+		{
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSizes[] = {
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frameCount },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_materialSystem.getTextureCapacity() * frameCount } };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = frameCount;
+			poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+			poolInfo.pPoolSizes = poolSizes;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			std::vector<VkDescriptorSetLayout> layouts(frameCount, m_frameSetLayout);
+			std::vector<uint32_t> textureCounts(frameCount, m_materialSystem.getTextureCapacity());
+			VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+			variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+			variableCountInfo.descriptorSetCount = frameCount;
+			variableCountInfo.pDescriptorCounts = textureCounts.data();
+			m_frameSets.resize(frameCount);
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.pNext = &variableCountInfo;
+			allocateInfo.descriptorPool = m_descriptorPool;
+			allocateInfo.descriptorSetCount = frameCount;
+			allocateInfo.pSetLayouts = layouts.data();
+			if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, m_frameSets.data()) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor sets!");
+			}
+		}
+
+		/*
+		* One draw per object, firstInstance selects its transform and material ID. The descriptor set is bound once, only
+		* a change of pipeline between consecutive draws costs a bind.
+		*/
+		void recordDraws(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Objects");
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Objects");
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_objectLayout, 0, 1, &m_frameSets[m_currentFrameIndex], 0, nullptr);
+			VkDeviceSize offset = 0;
+			vkd.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+			vkd.vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+			auto begin = std::chrono::steady_clock::now();
+			m_draws.resize(m_objects.getCount());
+			for (uint32_t object = 0; object < m_objects.getCount(); object++) m_draws[object] = { m_objects.getMaterial(object), object };
+			if (!m_settings.unsorted) m_materialSystem.sortDraws(m_draws);
+
+			uint32_t indexCount = static_cast<uint32_t>(m_indices.size());
+			uint32_t boundPipeline = UINT32_MAX;
+			for (const MaterialDraw& draw : m_draws)
+			{
+				uint32_t pipeline = m_materialSystem.getPipeline(draw.materialId);
+				if (pipeline != boundPipeline)
+				{
+					vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(pipeline));
+					boundPipeline = pipeline;
+					m_pipelineBinds++;
+				}
+				vkd.vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, draw.drawIndex);
+			}
+			m_recordSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			m_recordedFrames++;
+
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+	private:
+		MaterialSettings				m_settings{};
+
+		// Cube mesh shared by all objects, their transforms and material IDs in the instance streams
+		std::vector<Vertex>				m_vertices{};
+		std::vector<uint32_t>			m_indices{};
+		VkBuffer						m_vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_indexMemory{ VK_NULL_HANDLE };
+		InstanceStore					m_objects{};
+		uint32_t						m_gridSide{ 1 };
+
+		// Textures registered with the material system, and the IDs of the materials created
+		std::vector<VkImage>			m_textureImages{};
+		std::vector<VkDeviceMemory>		m_textureMemories{};
+		std::vector<VkImageView>		m_textureViews{};
+		VkSampler						m_sampler{ VK_NULL_HANDLE };
+		std::vector<uint32_t>			m_materialIds{};
+		uint32_t						m_animationCursor{ 0 };
+		bool							m_initialUploadDone{ false };
+
+		// Draw list rebuilt and sorted every frame, and what recording it cost
+		std::vector<MaterialDraw>		m_draws{};
+		uint64_t						m_recordedFrames{ 0 };
+		uint64_t						m_pipelineBinds{ 0 };
+		double							m_recordSeconds{ 0.0 };
+
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+
+		// Hot reloader pipeline ids per shading model, all sharing one layout from the pipeline layout cache
+		uint32_t						m_pipelines[SHADING_COUNT]{};
+		VkPipelineLayout				m_objectLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_frameSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<VkDescriptorSet>	m_frameSets{};
+	};
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	MaterialSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--objects" && i + 1 < argc) settings.objectCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--animated" && i + 1 < argc) settings.animatedMaterials = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (argument == "--unsorted") settings.unsorted = true;
+	}
+
+	BindlessMaterialsExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
@@ -0,0 +1,1019 @@
+#include "vulkan_example_base.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* Clustered forward lighting: the view frustum is divided into a grid of 64 x 64 pixel tiles and 24 exponentially spaced
+* depth slices. Every frame a compute pass assigns the lights to the clusters their spheres touch and compacts the light
+* lists of all clusters into one storage buffer, the forward pass then shades each fragment with the lights of its cluster
+* only. The lights move every frame, they are written into the upload ring buffer of the base together with the frame
+* uniforms, descriptor layouts come from reflection through the pipeline layout cache. A depth prepass keeps the lighting
+* to one fragment per pixel.
+*
+*   clustered_lighting [--lights <n>] [--naive] [common options]
+*   clustered_lighting --sweep [--frames <n>] [--output <result.json>] [--naive] [--mock]
+*
+* --naive shades every fragment with every light for comparison. --sweep is the benchmark: it runs the headless scene for
+* every light count and resolution of the sweep and prints the GPU time of the clustering, depth prepass and shading, the
+* numbers are also written as JSON when an output file is given. The camera follows a fixed path driven by the frame
+* number so runs are reproducible.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t CLUSTER_WORKGROUP_SIZE = 64;		// local_size_x of cluster_lights.comp
+		constexpr uint32_t TILE_SIZE = 64;					// Pixels per cluster in x and y
+		constexpr uint32_t DEPTH_SLICES = 24;
+		constexpr uint32_t AVERAGE_CLUSTER_LIGHTS = 128;	// Light index list capacity per cluster
+		constexpr float NEAR_PLANE = 0.5f;
+		constexpr float FAR_PLANE = 250.0f;
+		constexpr float GROUND_HALF_EXTENT = 80.0f;
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+		};
+
+		// std430 layout of the shaders
+		struct Light
+		{
+			float	positionRadius[4]{};	// World space
+			float	colorIntensity[4]{};
+		};
+
+		struct Cluster
+		{
+			uint32_t	offset{ 0 };
+			uint32_t	count{ 0 };
+		};
+
+		// std140 FrameData block shared by all shaders
+		struct FrameData
+		{
+			Mat4		viewProjection{};
+			Mat4		view{};
+			float		cameraPosition[4]{};
+			float		projection[4]{};		// Tangents of the half field of view in x and y, near and far plane distances
+			uint32_t	clusterGrid[4]{};		// Cluster counts in x, y and z, tile size in pixels
+			float		screen[4]{};			// Width, height, depth slice scale and bias
+			uint32_t	lightCount{ 0 };
+			uint32_t	lightIndexCapacity{ 0 };
+			uint32_t	naiveShading{ 0 };
+			uint32_t	padding{ 0 };
+		};
+
+		// Written by cluster_lights.comp
+		struct ClusterCounters
+		{
+			uint32_t	lightIndexCount{ 0 };
+			uint32_t	visibleLightCount{ 0 };
+			uint32_t	maxClusterLightCount{ 0 };
+			uint32_t	saturatedClusterCount{ 0 };
+		};
+
+		// Animation parameters of a light, its position is recomputed on the host every frame
+		struct LightMotion
+		{
+			float	center[3]{};
+			float	orbitRadius{ 0.0f };
+			float	angularSpeed{ 0.0f };
+			float	phase{ 0.0f };
+		};
+	}
+
+	struct LightingSettings
+	{
+		uint32_t	lightCount{ 4096 };
+		bool		naiveShading{ false };		// Every fragment loops over every light, no clustering pass
+	};
+
+	class ClusteredLightingExample : public ExampleBase
+	{
+	public:
+		explicit ClusteredLightingExample(const LightingSettings& settings) : m_settings(settings)
+		{
+			m_title = "Clustered Lighting";
+			m_shaderDirectory = getShaderDirectory("clustered_lighting");
+			// Lights and frame uniforms of a frame are written to the upload ring
+			m_uploadRingFrameSize = std::max<VkDeviceSize>(m_uploadRingFrameSize, m_settings.lightCount * sizeof(Light) + (64 << 10));
+		}
+
+		struct ClusterStatistics
+		{
+			uint64_t	countedFrames{ 0 };
+			uint64_t	lightIndices{ 0 };
+			uint64_t	visibleLights{ 0 };
+			uint32_t	maxClusterLights{ 0 };
+			uint64_t	saturatedClusters{ 0 };
+			uint32_t	clusterCount{ 0 };
+		};
+
+		const ClusterStatistics& getClusterStatistics() const { return m_statistics; }
+
+		void printStatistics() const
+		{
+			double frames = std::max<uint64_t>(m_statistics.countedFrames, 1);
+			std::cout << "\n=====Clustered Lighting=====";
+			std::cout << "\n" << std::setw(30) << std::left << "Mode" << (m_settings.naiveShading ? "Naive shading" : "Clustered shading");
+			std::cout << "\n" << std::setw(30) << std::left << "Lights" << m_settings.lightCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Clusters" << m_statistics.clusterCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Counted frames" << m_statistics.countedFrames;
+			std::cout << "\n" << std::setw(30) << std::left << "Visible lights / frame" << std::fixed << std::setprecision(1) << m_statistics.visibleLights / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Light indices / frame" << m_statistics.lightIndices / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Lights / cluster" << m_statistics.lightIndices / frames / std::max(m_statistics.clusterCount, 1u);
+			std::cout << "\n" << std::setw(30) << std::left << "Max lights in a cluster" << m_statistics.maxClusterLights;
+			std::cout << "\n" << std::setw(30) << std::left << "Saturated clusters / frame" << m_statistics.saturatedClusters / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Upload ring peak (KiB)" << m_uploadRing.getPeakFrameUsage() / 1024.0;
+			std::cout << std::defaultfloat << std::endl;
+		}
+
+	protected:
+		void createResources() override
+		{
+			createScene();
+			uploadScene();
+			createRenderPass();
+			createPipelines();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroyClusterBuffers();
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			for (FrameResources& frame : m_frames) destroyBuffer(frame.counterReadbackBuffer, frame.counterReadbackMemory);
+			m_frames.clear();
+			destroyBuffer(m_vertexBuffer, m_vertexMemory);
+			destroyBuffer(m_indexBuffer, m_indexMemory);
+			destroyBuffer(m_counterBuffer, m_counterMemory);
+			m_renderPass = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Collect the counters this frame slot read back when it was last used, then move the lights and write them and the
+		* camera of the new frame into the upload ring, the descriptor sets of the slot are pointed at the new allocations
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			FrameResources& frame = m_frames[frameIndex];
+			if (frame.countersPending)
+			{
+				const ClusterCounters* counters = static_cast<const ClusterCounters*>(frame.counterReadbackData);
+				m_statistics.lightIndices += counters->lightIndexCount;
+				m_statistics.visibleLights += counters->visibleLightCount;
+				m_statistics.maxClusterLights = std::max(m_statistics.maxClusterLights, counters->maxClusterLightCount);
+				m_statistics.saturatedClusters += counters->saturatedClusterCount;
+				m_statistics.countedFrames++;
+				frame.countersPending = false;
+			}
+
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureTargets(extent);
+
+			// Circle the scene at a low height, looking across it
+			float time = 0.016f * static_cast<float>(m_frameCounter);
+			float angle = 0.25f * time;
+			Vec3 eye{ 70.0f * std::cos(angle), 12.0f, 70.0f * std::sin(angle) };
+			float fovY = 1.0f;
+			float aspect = float(extent.width) / float(extent.height);
+			Mat4 view = lookAt(eye, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+
+			RingBufferAllocation frameAllocation = m_uploadRing.allocate(sizeof(FrameData));
+			FrameData* data = static_cast<FrameData*>(frameAllocation.pData);
+			*data = FrameData{};
+			data->viewProjection = perspective(fovY, aspect, NEAR_PLANE, FAR_PLANE) * view;
+			data->view = view;
+			data->cameraPosition[0] = eye.x;
+			data->cameraPosition[1] = eye.y;
+			data->cameraPosition[2] = eye.z;
+			data->projection[1] = std::tan(0.5f * fovY);
+			data->projection[0] = data->projection[1] * aspect;
+			data->projection[2] = NEAR_PLANE;
+			data->projection[3] = FAR_PLANE;
+			data->clusterGrid[0] = m_clusterCounts[0];
+			data->clusterGrid[1] = m_clusterCounts[1];
+			data->clusterGrid[2] = m_clusterCounts[2];
+			data->clusterGrid[3] = TILE_SIZE;
+			data->screen[0] = float(extent.width);
+			data->screen[1] = float(extent.height);
+			data->screen[2] = DEPTH_SLICES / std::log(FAR_PLANE / NEAR_PLANE);
+			data->screen[3] = DEPTH_SLICES * std::log(NEAR_PLANE) / std::log(FAR_PLANE / NEAR_PLANE);
+			data->lightCount = m_settings.lightCount;
+			data->lightIndexCapacity = m_lightIndexCapacity;
+			data->naiveShading = m_settings.naiveShading ? 1 : 0;
+
+			RingBufferAllocation lightAllocation = m_uploadRing.allocate(m_settings.lightCount * sizeof(Light));
+			Light* lights = static_cast<Light*>(lightAllocation.pData);
+			for (uint32_t index = 0; index < m_settings.lightCount; index++)
+			{
+				const LightMotion& motion = m_lightMotions[index];
+				float lightAngle = motion.phase + motion.angularSpeed * time;
+				Light& light = lights[index];
+				light.positionRadius[0] = motion.center[0] + motion.orbitRadius * std::cos(lightAngle);
+				light.positionRadius[1] = motion.center[1] + 0.5f * std::sin(1.7f * lightAngle);
+				light.positionRadius[2] = motion.center[2] + motion.orbitRadius * std::sin(lightAngle);
+				light.positionRadius[3] = m_lightColors[index].positionRadius[3];
+				std::memcpy(light.colorIntensity, m_lightColors[index].colorIntensity, sizeof(light.colorIntensity));
+			}
+
+			VkDescriptorBufferInfo uniformInfo{ frameAllocation.buffer, frameAllocation.offset, frameAllocation.size };
+			VkDescriptorBufferInfo lightInfo{ lightAllocation.buffer, lightAllocation.offset, lightAllocation.size };
+			VkDescriptorBufferInfo clusterInfo{ m_clusterBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo lightIndexInfo{ m_lightIndexBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo counterInfo{ m_counterBuffer, 0, VK_WHOLE_SIZE };
+			std::vector<VkWriteDescriptorSet> writes = {
+				bufferWrite(frame.drawSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+				bufferWrite(frame.drawSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &lightInfo),
+				bufferWrite(frame.drawSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &clusterInfo),
+				bufferWrite(frame.drawSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &lightIndexInfo),
+				bufferWrite(frame.clusterSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+				bufferWrite(frame.clusterSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &lightInfo),
+				bufferWrite(frame.clusterSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &clusterInfo),
+				bufferWrite(frame.clusterSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &lightIndexInfo),
+				bufferWrite(frame.clusterSet, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &counterInfo) };
+			vkd.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+			FrameResources& frame = m_frames[m_currentFrameIndex];
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test is waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+
+			if (m_settings.naiveShading)
+			{
+				m_renderGraph.addPass("Forward", RenderGraphPassType::Raster,
+					[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordForward(commandBuffer, target); })
+					.write(color, RenderGraphUsage::ColorAttachment)
+					.write(depth, RenderGraphUsage::DepthStencilAttachment);
+				m_renderGraph.compile();
+				m_renderGraph.execute(commandBuffer);
+				return;
+			}
+
+			// The light lists are rebuilt every frame, the previous frame's fragment shader reads are waited for
+			RenderGraphResourceState listState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+			RenderGraphResource clusters = m_renderGraph.importBuffer("Clusters", m_clusterBuffer, VK_WHOLE_SIZE, listState, listState);
+			RenderGraphResource lightIndices = m_renderGraph.importBuffer("Light Indices", m_lightIndexBuffer, VK_WHOLE_SIZE, listState, listState);
+			RenderGraphResourceState counterState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+			RenderGraphResource counters = m_renderGraph.importBuffer("Cluster Counters", m_counterBuffer, sizeof(ClusterCounters), counterState, counterState);
+			RenderGraphResourceState hostState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT };
+			RenderGraphResource readback = m_renderGraph.importBuffer("Cluster Counter Readback", frame.counterReadbackBuffer,
+				sizeof(ClusterCounters), hostState, hostState);
+
+			m_renderGraph.addPass("Clear Clusters", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					vkd.vkCmdFillBuffer(commandBuffer, m_clusterBuffer, 0, VK_WHOLE_SIZE, 0);
+					vkd.vkCmdFillBuffer(commandBuffer, m_counterBuffer, 0, sizeof(ClusterCounters), 0);
+				})
+				.write(clusters, RenderGraphUsage::TransferWrite)
+				.write(counters, RenderGraphUsage::TransferWrite);
+
+			m_renderGraph.addPass("Cluster Lights", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&) { recordClustering(commandBuffer); })
+				.write(clusters, RenderGraphUsage::StorageWrite)
+				.write(lightIndices, RenderGraphUsage::StorageWrite)
+				.write(counters, RenderGraphUsage::StorageWrite);
+
+			m_renderGraph.addPass("Forward", RenderGraphPassType::Raster,
+				[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordForward(commandBuffer, target); })
+				.read(clusters, RenderGraphUsage::StorageRead)
+				.read(lightIndices, RenderGraphUsage::StorageRead)
+				.write(color, RenderGraphUsage::ColorAttachment)
+				.write(depth, RenderGraphUsage::DepthStencilAttachment);
+
+			m_renderGraph.addPass("Read Back Cluster Counters", RenderGraphPassType::Compute,
+				[this, &frame](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					VkBufferCopy region{ 0, 0, sizeof(ClusterCounters) };
+					vkd.vkCmdCopyBuffer(commandBuffer, m_counterBuffer, frame.counterReadbackBuffer, 1, &region);
+				})
+				.read(counters, RenderGraphUsage::TransferRead)
+				.write(readback, RenderGraphUsage::TransferWrite);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+			frame.countersPending = true;
+		}
+
+	private:
+		struct FrameResources
+		{
+			VkBuffer		counterReadbackBuffer{ VK_NULL_HANDLE };
+			VkDeviceMemory	counterReadbackMemory{ VK_NULL_HANDLE };
+			void*			counterReadbackData{ nullptr };
+			bool			countersPending{ false };	// Counters of the last submission of the slot are read back
+			VkDescriptorSet	clusterSet{ VK_NULL_HANDLE };
+			VkDescriptorSet	drawSet{ VK_NULL_HANDLE };
+		};
+
+		/*
+		* A subdivided ground plane with a grid of pillars, and the lights scattered over it from a fixed seed, each
+		* circling its own center
+		*/
+		void createScene()
+		{
+			m_vertices.clear();
+			m_indices.clear();
+			auto addQuadGrid = [this](const Vec3& origin, const Vec3& u, const Vec3& v, const Vec3& normal, uint32_t subdivisions)
+			{
+				uint32_t base = static_cast<uint32_t>(m_vertices.size());
+				for (uint32_t row = 0; row <= subdivisions; row++)
+				{
+					for (uint32_t column = 0; column <= subdivisions; column++)
+					{
+						float s = float(column) / subdivisions;
+						float t = float(row) / subdivisions;
+						m_vertices.push_back({ { origin.x + s * u.x + t * v.x, origin.y + s * u.y + t * v.y, origin.z + s * u.z + t * v.z },
+							{ normal.x, normal.y, normal.z } });
+					}
+				}
+				for (uint32_t row = 0; row < subdivisions; row++)
+				{
+					for (uint32_t column = 0; column < subdivisions; column++)
+					{
+						uint32_t current = base + row * (subdivisions + 1) + column;
+						uint32_t above = current + subdivisions + 1;
+						m_indices.insert(m_indices.end(), { current, current + 1, above + 1, current, above + 1, above });
+					}
+				}
+			};
+
+			// Counter clockwise seen from above
+			float extent = 2.0f * GROUND_HALF_EXTENT;
+			addQuadGrid({ -GROUND_HALF_EXTENT, 0.0f, GROUND_HALF_EXTENT }, { extent, 0.0f, 0.0f }, { 0.0f, 0.0f, -extent }, { 0.0f, 1.0f, 0.0f }, 64);
+
+			// Pillars, four sides counter clockwise seen from outside
+			const float spacing = 10.0f;
+			const float halfWidth = 0.6f;
+			const float height = 6.0f;
+			for (float x = -GROUND_HALF_EXTENT + spacing; x < GROUND_HALF_EXTENT; x += spacing)
+			{
+				for (float z = -GROUND_HALF_EXTENT + spacing; z < GROUND_HALF_EXTENT; z += spacing)
+				{
+					addQuadGrid({ x - halfWidth, 0.0f, z + halfWidth }, { 2 * halfWidth, 0, 0 }, { 0, height, 0 }, { 0, 0, 1 }, 4);
+					addQuadGrid({ x + halfWidth, 0.0f, z + halfWidth }, { 0, 0, -2 * halfWidth }, { 0, height, 0 }, { 1, 0, 0 }, 4);
+					addQuadGrid({ x + halfWidth, 0.0f, z - halfWidth }, { -2 * halfWidth, 0, 0 }, { 0, height, 0 }, { 0, 0, -1 }, 4);
+					addQuadGrid({ x - halfWidth, 0.0f, z - halfWidth }, { 0, 0, 2 * halfWidth }, { 0, height, 0 }, { -1, 0, 0 }, 4);
+					addQuadGrid({ x - halfWidth, height, z + halfWidth }, { 2 * halfWidth, 0, 0 }, { 0, 0, -2 * halfWidth }, { 0, 1, 0 }, 1);
+				}
+			}
+
+			std::mt19937 random(1234);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			m_lightMotions.resize(m_settings.lightCount);
+			m_lightColors.resize(m_settings.lightCount);
+			for (uint32_t index = 0; index < m_settings.lightCount; index++)
+			{
+				LightMotion& motion = m_lightMotions[index];
+				motion.center[0] = (2.0f * unit(random) - 1.0f) * GROUND_HALF_EXTENT;
+				motion.center[1] = 0.5f + 4.0f * unit(random);
+				motion.center[2] = (2.0f * unit(random) - 1.0f) * GROUND_HALF_EXTENT;
+				motion.orbitRadius = 1.0f + 3.0f * unit(random);
+				motion.angularSpeed = 0.5f + unit(random);
+				motion.phase = 6.2831853f * unit(random);
+
+				Light& light = m_lightColors[index];
+				light.positionRadius[3] = 2.5f + 2.5f * unit(random);
+				for (int channel = 0; channel < 3; channel++) light.colorIntensity[channel] = 0.2f + 0.8f * unit(random);
+				light.colorIntensity[3] = 4.0f;
+			}
+		}
+
+		/*
+		* Copy the static geometry into device local buffers once, through one staging buffer and a single submission
+		*/
+		void uploadScene()
+		{
+			VkDeviceSize vertexSize = m_vertices.size() * sizeof(Vertex);
+			VkDeviceSize indexSize = m_indices.size() * sizeof(uint32_t);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(ClusterCounters),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_counterBuffer, m_counterMemory, m_defaultAllocator);
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			uint8_t* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&staging));
+			std::memcpy(staging, m_vertices.data(), vertexSize);
+			std::memcpy(staging + vertexSize, m_indices.data(), indexSize);
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			VkBufferCopy vertexRegion{ 0, 0, vertexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_vertexBuffer, 1, &vertexRegion);
+			VkBufferCopy indexRegion{ vertexSize, 0, indexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_indexBuffer, 1, &indexRegion);
+			// The scene buffers are never written again, this makes them visible to every later frame
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared by the render pass and filled by the prepass.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* Pipelines are registered with the hot reloader, layouts come from reflection through the pipeline layout cache.
+		* The depth prepass reflects the fragment shader too, without using it, so both scene pipelines share one layout
+		*/
+		void createPipelines()
+		{
+			m_clusterPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/cluster_lights.comp" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					std::vector<VkDescriptorSetLayout> setLayouts;
+					m_clusterLayout = m_pipelineLayoutCache.getPipelineLayout({ ShaderReflectionUtil::reflect(spirvStages[0]) }, &setLayouts);
+					m_clusterSetLayout = setLayouts[0];
+
+					VkShaderModule module = createShaderModule(spirvStages[0]);
+					VkComputePipelineCreateInfo createInfo{};
+					createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+					createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+					createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+					createInfo.stage.module = module;
+					createInfo.stage.pName = "main";
+					createInfo.layout = m_clusterLayout;
+					VkPipeline pipeline;
+					VkResult result = vkd.vkCreateComputePipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+					vkd.vkDestroyShaderModule(m_device, module, m_defaultAllocator);
+					if (result != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create light clustering pipeline!");
+					}
+					return pipeline;
+				});
+			m_depthPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/scene.vert", m_shaderDirectory + "/scene.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildScenePipeline(spirvStages, pipelineCache, true);
+				});
+			m_shadePipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/scene.vert", m_shaderDirectory + "/scene.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildScenePipeline(spirvStages, pipelineCache, false);
+				});
+		}
+
+		/*
+		* The depth prepass writes depth only, shading tests for equal depth without writing it
+		*/
+		VkPipeline buildScenePipeline(const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache, bool depthOnly)
+		{
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			m_sceneLayout = m_pipelineLayoutCache.getPipelineLayout(
+				{ ShaderReflectionUtil::reflect(spirvStages[0]), ShaderReflectionUtil::reflect(spirvStages[1]) }, &setLayouts);
+			m_sceneSetLayout = setLayouts[0];
+
+			VkPipelineShaderStageCreateInfo stages[2]{};
+			const VkShaderStageFlagBits stageFlags[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+			uint32_t stageCount = depthOnly ? 1 : 2;
+			for (uint32_t stage = 0; stage < stageCount; stage++)
+			{
+				stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				stages[stage].stage = stageFlags[stage];
+				stages[stage].module = createShaderModule(spirvStages[stage]);
+				stages[stage].pName = "main";
+			}
+
+			VkVertexInputBindingDescription binding{ 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+			VkVertexInputAttributeDescription attributes[2] = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) },
+				{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) } };
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInput.vertexBindingDescriptionCount = 1;
+			vertexInput.pVertexBindingDescriptions = &binding;
+			vertexInput.vertexAttributeDescriptionCount = 2;
+			vertexInput.pVertexAttributeDescriptions = attributes;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+			VkPipelineViewportStateCreateInfo viewportState{};
+			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			// The projection flips y, counter clockwise faces stay counter clockwise in framebuffer space
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+			rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+			rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterization.lineWidth = 1.0f;
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = depthOnly ? VK_TRUE : VK_FALSE;
+			depthStencil.depthCompareOp = depthOnly ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_EQUAL;
+
+			VkPipelineColorBlendAttachmentState blendAttachment{};
+			blendAttachment.colorWriteMask = depthOnly ? 0 :
+				VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &blendAttachment;
+
+			VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
+
+			VkGraphicsPipelineCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.stageCount = stageCount;
+			createInfo.pStages = stages;
+			createInfo.pVertexInputState = &vertexInput;
+			createInfo.pInputAssemblyState = &inputAssembly;
+			createInfo.pViewportState = &viewportState;
+			createInfo.pRasterizationState = &rasterization;
+			createInfo.pMultisampleState = &multisample;
+			createInfo.pDepthStencilState = &depthStencil;
+			createInfo.pColorBlendState = &colorBlend;
+			createInfo.pDynamicState = &dynamicState;
+			createInfo.layout = m_sceneLayout;
+			createInfo.renderPass = m_renderPass;
+			createInfo.subpass = 0;
+			VkPipeline pipeline;
+			VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+			for (uint32_t stage = 0; stage < stageCount; stage++) vkd.vkDestroyShaderModule(m_device, stages[stage].module, m_defaultAllocator);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create scene pipeline!");
+			}
+			return pipeline;
+		}
+
+		/*
+		* Counter readbacks and descriptor sets per frame in flight, the sets are written every frame by updateFrameData
+		*/
+		void createFrameResources()
+		{
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSizes[] = {
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * frameCount },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * frameCount } };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = 2 * frameCount;
+			poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+			poolInfo.pPoolSizes = poolSizes;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			m_frames.resize(frameCount);
+			for (FrameResources& frame : m_frames)
+			{
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(ClusterCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					frame.counterReadbackBuffer, frame.counterReadbackMemory, m_defaultAllocator);
+				vkd.vkMapMemory(m_device, frame.counterReadbackMemory, 0, VK_WHOLE_SIZE, 0, &frame.counterReadbackData);
+				frame.clusterSet = allocateDescriptorSet(m_clusterSetLayout);
+				frame.drawSet = allocateDescriptorSet(m_sceneSetLayout);
+			}
+		}
+
+		/*
+		* Depth buffer, cluster grid and light index list of the frame size, recreated when the size changes
+		*/
+		void ensureTargets(VkExtent2D extent)
+		{
+			if (!ensureDepthTarget(m_targets, extent)) return;
+			destroyClusterBuffers();
+
+			m_clusterCounts[0] = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+			m_clusterCounts[1] = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+			m_clusterCounts[2] = DEPTH_SLICES;
+			m_statistics.clusterCount = m_clusterCounts[0] * m_clusterCounts[1] * m_clusterCounts[2];
+			m_lightIndexCapacity = m_statistics.clusterCount * AVERAGE_CLUSTER_LIGHTS;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, m_statistics.clusterCount * sizeof(Cluster),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_clusterBuffer, m_clusterMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, VkDeviceSize(m_lightIndexCapacity) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_lightIndexBuffer, m_lightIndexMemory, m_defaultAllocator);
+		}
+
+		void destroyClusterBuffers()
+		{
+			destroyBuffer(m_clusterBuffer, m_clusterMemory);
+			destroyBuffer(m_lightIndexBuffer, m_lightIndexMemory);
+		}
+
+		/*
+		* Count, reserve and fill, each phase waits for the writes of the one before
+		*/
+		void recordClustering(VkCommandBuffer commandBuffer)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Cluster Lights");
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_shaderHotReloader.getPipeline(m_clusterPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_clusterLayout, 0, 1, &m_frames[m_currentFrameIndex].clusterSet, 0, nullptr);
+			uint32_t lightGroups = (m_settings.lightCount + CLUSTER_WORKGROUP_SIZE - 1) / CLUSTER_WORKGROUP_SIZE;
+			uint32_t clusterGroups = (m_statistics.clusterCount + CLUSTER_WORKGROUP_SIZE - 1) / CLUSTER_WORKGROUP_SIZE;
+			for (uint32_t phase = 0; phase < 3; phase++)
+			{
+				if (phase > 0)
+				{
+					VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+					vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+						0, 1, &barrier, 0, nullptr, 0, nullptr);
+				}
+				vkd.vkCmdPushConstants(commandBuffer, m_clusterLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+				vkd.vkCmdDispatch(commandBuffer, phase == 1 ? clusterGroups : lightGroups, 1, 1);
+			}
+		}
+
+		/*
+		* Depth prepass then shading with the equal depth test, in one subpass
+		*/
+		void recordForward(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Forward");
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_sceneLayout, 0, 1, &m_frames[m_currentFrameIndex].drawSet, 0, nullptr);
+			VkDeviceSize offset = 0;
+			vkd.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+			vkd.vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			uint32_t indexCount = static_cast<uint32_t>(m_indices.size());
+			{
+				GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Depth Prepass");
+				vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_depthPipeline));
+				vkd.vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			}
+			{
+				GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Shade");
+				vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_shadePipeline));
+				vkd.vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			}
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+		VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout)
+		{
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = m_descriptorPool;
+			allocateInfo.descriptorSetCount = 1;
+			allocateInfo.pSetLayouts = &layout;
+			VkDescriptorSet set;
+			if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, &set) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+			return set;
+		}
+
+	private:
+		LightingSettings				m_settings{};
+		ClusterStatistics				m_statistics{};
+
+		// Static geometry and the lights, whose colors and radii are kept in m_lightColors
+		std::vector<Vertex>				m_vertices{};
+		std::vector<uint32_t>			m_indices{};
+		std::vector<LightMotion>		m_lightMotions{};
+		std::vector<Light>				m_lightColors{};
+
+		VkBuffer						m_vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_indexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_counterBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_counterMemory{ VK_NULL_HANDLE };
+
+		// Depth buffer and the cluster grid of the frame size
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+		uint32_t						m_clusterCounts[3]{};
+		uint32_t						m_lightIndexCapacity{ 0 };
+		VkBuffer						m_clusterBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_clusterMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_lightIndexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_lightIndexMemory{ VK_NULL_HANDLE };
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+
+		// Hot reloader pipeline ids and the layouts their builders took from the pipeline layout cache
+		uint32_t						m_clusterPipeline{ 0 };
+		uint32_t						m_depthPipeline{ 0 };
+		uint32_t						m_shadePipeline{ 0 };
+		VkPipelineLayout				m_clusterLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout				m_sceneLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_clusterSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_sceneSetLayout{ VK_NULL_HANDLE };
+
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<FrameResources>		m_frames{};
+	};
+
+	struct SweepResult
+	{
+		uint32_t	lightCount{ 0 };
+		VkExtent2D	resolution{};
+		double		clusterMs{ 0.0 };
+		double		depthPrepassMs{ 0.0 };
+		double		shadeMs{ 0.0 };
+		double		frameMs{ 0.0 };
+		double		lightsPerCluster{ 0.0 };
+		uint32_t	maxClusterLights{ 0 };
+	};
+
+	/*
+	* Benchmark: one headless run per light count and resolution, GPU zone averages over the frames of each run
+	*/
+	std::vector<SweepResult> runSweep(const LightingSettings& baseSettings, int argc, char** argv)
+	{
+		const uint32_t lightCounts[] = { 256, 1024, 4096, 10240 };
+		const VkExtent2D resolutions[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 } };
+		std::vector<SweepResult> results;
+		for (VkExtent2D resolution : resolutions)
+		{
+			for (uint32_t lightCount : lightCounts)
+			{
+				LightingSettings settings = baseSettings;
+				settings.lightCount = lightCount;
+				ClusteredLightingExample example(settings);
+				example.parseArguments(argc, argv);
+				example.m_headless = true;
+				example.m_windowWidth = resolution.width;
+				example.m_windowHeight = resolution.height;
+				if (example.m_headlessFrameCount < 2) example.m_headlessFrameCount = 120;
+				example.init();
+				example.run();
+
+				SweepResult result{ lightCount, resolution };
+				for (const GpuZoneStatistics& zone : example.m_gpuProfiler.getStatistics())
+				{
+					if (zone.name == "Cluster Lights") result.clusterMs = zone.avgMs;
+					else if (zone.name == "Depth Prepass") result.depthPrepassMs = zone.avgMs;
+					else if (zone.name == "Shade") result.shadeMs = zone.avgMs;
+					else if (zone.name == "Frame") result.frameMs = zone.avgMs;
+				}
+				const ClusteredLightingExample::ClusterStatistics& statistics = example.getClusterStatistics();
+				result.lightsPerCluster = double(statistics.lightIndices) / std::max<uint64_t>(statistics.countedFrames, 1) /
+					std::max(statistics.clusterCount, 1u);
+				result.maxClusterLights = statistics.maxClusterLights;
+				example.cleanup();
+				results.push_back(result);
+			}
+		}
+		return results;
+	}
+
+	void printSweep(const std::vector<SweepResult>& results, bool naiveShading)
+	{
+		std::cout << "\n=====Clustered Lighting Sweep (" << (naiveShading ? "naive" : "clustered") << ", GPU ms)=====";
+		std::cout << "\n" << std::setw(12) << std::left << "Lights" << std::setw(14) << "Resolution" << std::setw(10) << "Cluster"
+			<< std::setw(10) << "Prepass" << std::setw(10) << "Shade" << std::setw(10) << "Frame" << std::setw(16) << "Lights/cluster" << "Max";
+		std::cout << std::fixed;
+		for (const SweepResult& result : results)
+		{
+			std::string resolution = std::to_string(result.resolution.width) + "x" + std::to_string(result.resolution.height);
+			std::cout << "\n" << std::setw(12) << std::left << result.lightCount << std::setw(14) << resolution << std::setprecision(3)
+				<< std::setw(10) << result.clusterMs << std::setw(10) << result.depthPrepassMs << std::setw(10) << result.shadeMs
+				<< std::setw(10) << result.frameMs << std::setprecision(1) << std::setw(16) << result.lightsPerCluster << result.maxClusterLights;
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	std::string toJson(const std::vector<SweepResult>& results, bool naiveShading)
+	{
+		std::ostringstream json;
+		json << std::fixed << std::setprecision(4);
+		json << "{\n  \"benchmark\": \"clustered_lighting\",\n  \"naive\": " << (naiveShading ? "true" : "false") << ",\n  \"runs\": [\n";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SweepResult& result = results[i];
+			json << "    { \"lights\": " << result.lightCount << ", \"width\": " << result.resolution.width << ", \"height\": " << result.resolution.height
+				<< ", \"cluster_ms\": " << result.clusterMs << ", \"depth_prepass_ms\": " << result.depthPrepassMs << ", \"shade_ms\": " << result.shadeMs
+				<< ", \"frame_ms\": " << result.frameMs << ", \"lights_per_cluster\": " << result.lightsPerCluster
+				<< ", \"max_cluster_lights\": " << result.maxClusterLights << " }" << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		json << "  ]\n}\n";
+		return json.str();
+	}
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	LightingSettings settings{};
+	bool sweep = false;
+	std::string outputPath;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--lights" && i + 1 < argc) settings.lightCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--naive") settings.naiveShading = true;
+		else if (argument == "--sweep") sweep = true;
+		else if (argument == "--output" && i + 1 < argc) outputPath = argv[++i];
+	}
+
+	if (sweep)
+	{
+		std::vector<SweepResult> results = runSweep(settings, argc, argv);
+		printSweep(results, settings.naiveShading);
+		if (!outputPath.empty())
+		{
+			std::ofstream file(outputPath);
+			file << toJson(results, settings.naiveShading);
+			if (!file.good())
+			{
+				std::cerr << "failed to write " << outputPath << std::endl;
+				return 2;
+			}
+		}
+		return 0;
+	}
+
+	ClusteredLightingExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
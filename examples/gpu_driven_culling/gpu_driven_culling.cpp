@@ -0,0 +1,1124 @@
+#include "vulkan_example_base.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* GPU driven rendering: every scene instance is uploaded once, a compute pass culls them each frame against the view frustum
+* and the depth pyramid of the previous frame and appends one indexed draw per survivor, the scene is then drawn by a single
+* vkCmdDrawIndexedIndirectCount whatever the instance count. The depth pyramid is rebuilt from the depth buffer at the end of
+* the frame. Occlusion is tested against the previous frame, objects coming into view behind moving occluders show up one
+* frame late.
+*
+*   gpu_driven_culling [--instances <n>] [--cpu-submit] [--no-occlusion] [common options]
+*
+* The benchmark scene is a grid of instances walled into cells, the camera follows a fixed path driven by the frame number so
+* headless runs are reproducible, for example gpu_driven_culling --headless --frames 1000. Culling counters and the CPU time
+* spent recording the draw submission are printed on exit, --cpu-submit records one vkCmdDrawIndexed per instance passing a
+* CPU frustum test instead for comparison.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t CULL_WORKGROUP_SIZE = 64;		// local_size_x of cull.comp
+		constexpr uint32_t PYRAMID_WORKGROUP_SIZE = 8;		// local_size_x and local_size_y of depth_pyramid.comp
+		constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		constexpr float GRID_SPACING = 3.0f;
+		constexpr uint32_t WALL_INTERVAL = 12;				// Every 12th row and column of the grid is a wall
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+		};
+
+		// std430 layouts of cull.comp and scene.vert
+		struct Instance
+		{
+			Mat4		model{};
+			float		boundingSphere[4]{};	// World space center and radius
+			float		color[4]{};
+			uint32_t	mesh{ 0 };
+			uint32_t	padding[3]{};
+		};
+		static_assert(sizeof(Instance) == 112, "Instance must match the std430 layout of the shaders");
+
+		struct MeshRecord
+		{
+			uint32_t	indexCount{ 0 };
+			uint32_t	firstIndex{ 0 };
+			int32_t		vertexOffset{ 0 };
+			uint32_t	padding{ 0 };
+		};
+
+		// std140 FrameData block shared by all shaders
+		struct FrameData
+		{
+			Mat4		viewProjection{};
+			Mat4		previousViewProjection{};
+			float		frustumPlanes[6][4]{};
+			float		lightDirection[4]{};
+			uint32_t	instanceCount{ 0 };
+			uint32_t	occlusionCulling{ 0 };
+			uint32_t	pyramidWidth{ 0 };
+			uint32_t	pyramidHeight{ 0 };
+			uint32_t	pyramidLevelCount{ 0 };
+			uint32_t	padding[3]{};
+		};
+
+		// Written by cull.comp, drawCount is the count buffer of the indirect draw
+		struct CullCounters
+		{
+			uint32_t	drawCount{ 0 };
+			uint32_t	frustumCulledCount{ 0 };
+			uint32_t	occlusionCulledCount{ 0 };
+			uint32_t	padding{ 0 };
+		};
+
+		struct PyramidLevelConstants
+		{
+			uint32_t	sourceSize[2];
+			uint32_t	destinationSize[2];
+			uint32_t	fromDepthBuffer;
+		};
+
+		/*
+		* Planes of the frustum, normals point inside, from the rows of a view projection matrix with depth in [0, 1]
+		*/
+		void extractFrustumPlanes(const Mat4& viewProjection, float planes[6][4])
+		{
+			auto row = [&](int index, int column) { return viewProjection.m[column * 4 + index]; };
+			for (int column = 0; column < 4; column++)
+			{
+				planes[0][column] = row(3, column) + row(0, column);	// Left
+				planes[1][column] = row(3, column) - row(0, column);	// Right
+				planes[2][column] = row(3, column) + row(1, column);	// Top, clip space y points down
+				planes[3][column] = row(3, column) - row(1, column);	// Bottom
+				planes[4][column] = row(2, column);						// Near
+				planes[5][column] = row(3, column) - row(2, column);	// Far
+			}
+			for (int plane = 0; plane < 6; plane++)
+			{
+				float length = std::sqrt(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+				for (int component = 0; component < 4; component++) planes[plane][component] /= length;
+			}
+		}
+
+		bool isOutsideFrustum(const float planes[6][4], const float sphere[4])
+		{
+			for (int plane = 0; plane < 6; plane++)
+			{
+				if (planes[plane][0] * sphere[0] + planes[plane][1] * sphere[1] + planes[plane][2] * sphere[2] + planes[plane][3] < -sphere[3]) return true;
+			}
+			return false;
+		}
+
+		uint32_t floorPowerOfTwo(uint32_t value)
+		{
+			uint32_t power = 1;
+			while (power * 2 <= value) power *= 2;
+			return power;
+		}
+	}
+
+	struct CullingSettings
+	{
+		uint32_t	instanceCount{ 1u << 17 };
+		bool		cpuSubmission{ false };		// One vkCmdDrawIndexed per visible instance instead of the culling pass
+		bool		occlusionCulling{ true };
+	};
+
+	class GpuDrivenCullingExample : public ExampleBase
+	{
+	public:
+		explicit GpuDrivenCullingExample(const CullingSettings& settings) : m_settings(settings)
+		{
+			m_title = "GPU Driven Culling";
+			m_shaderDirectory = getShaderDirectory("gpu_driven_culling");
+		}
+
+		void printStatistics() const
+		{
+			double frames = std::max<uint64_t>(m_statistics.countedFrames, 1);
+			double recordedFrames = std::max<uint64_t>(m_statistics.recordedFrames, 1);
+			std::cout << "\n=====GPU Driven Culling=====";
+			std::cout << "\n" << std::setw(28) << std::left << "Mode" << (m_settings.cpuSubmission ? "CPU submission" : "GPU culling");
+			std::cout << "\n" << std::setw(28) << std::left << "Instances" << m_settings.instanceCount;
+			std::cout << "\n" << std::setw(28) << std::left << "Counted frames" << m_statistics.countedFrames;
+			std::cout << "\n" << std::setw(28) << std::left << "Drawn / frame" << std::fixed << std::setprecision(1) << m_statistics.drawn / frames;
+			std::cout << "\n" << std::setw(28) << std::left << "Frustum culled / frame" << m_statistics.frustumCulled / frames;
+			std::cout << "\n" << std::setw(28) << std::left << "Occlusion culled / frame" << m_statistics.occlusionCulled / frames;
+			std::cout << "\n" << std::setw(28) << std::left << "Draw recording (ms / frame)" << std::setprecision(3) << m_statistics.recordMilliseconds / recordedFrames;
+			std::cout << std::defaultfloat << std::endl;
+		}
+
+	protected:
+		void configureDeviceRequirements() override
+		{
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "multiDrawIndirect");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "drawIndirectCount");
+		}
+
+		void createResources() override
+		{
+			createScene();
+			uploadScene();
+			createRenderPass();
+			createPipelines();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroyPyramid();
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroySampler(m_device, m_sampler, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			for (FrameResources& frame : m_frames)
+			{
+				destroyBuffer(frame.uniformBuffer, frame.uniformMemory);
+				destroyBuffer(frame.counterReadbackBuffer, frame.counterReadbackMemory);
+			}
+			m_frames.clear();
+			destroyBuffer(m_vertexBuffer, m_vertexMemory);
+			destroyBuffer(m_indexBuffer, m_indexMemory);
+			destroyBuffer(m_instanceBuffer, m_instanceMemory);
+			destroyBuffer(m_meshBuffer, m_meshMemory);
+			destroyBuffer(m_drawCommandBuffer, m_drawCommandMemory);
+			destroyBuffer(m_counterBuffer, m_counterMemory);
+			m_renderPass = VK_NULL_HANDLE;
+			m_sampler = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Collect the counters this frame slot read back when it was last used, then set up the camera of the new frame
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			FrameResources& frame = m_frames[frameIndex];
+			if (frame.countersPending)
+			{
+				const CullCounters* counters = static_cast<const CullCounters*>(frame.counterReadbackData);
+				m_statistics.drawn += counters->drawCount;
+				m_statistics.frustumCulled += counters->frustumCulledCount;
+				m_statistics.occlusionCulled += counters->occlusionCulledCount;
+				m_statistics.countedFrames++;
+				frame.countersPending = false;
+			}
+
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureTargets(extent);
+
+			// Orbit inside the grid at eye height, looking across the walled cells
+			float angle = 0.004f * static_cast<float>(m_frameCounter);
+			float radius = 0.3f * m_gridHalfExtent;
+			Vec3 eye{ radius * std::cos(angle), 5.0f, radius * std::sin(angle) };
+			Vec3 center{ 0.0f, 2.0f, 0.0f };
+			Mat4 viewProjection = perspective(1.0f, float(extent.width) / float(extent.height), 0.1f, 4.0f * m_gridHalfExtent) *
+				lookAt(eye, center, { 0.0f, 1.0f, 0.0f });
+
+			FrameData& data = m_frameData;
+			data.previousViewProjection = m_pyramidValid ? data.viewProjection : viewProjection;
+			data.viewProjection = viewProjection;
+			extractFrustumPlanes(viewProjection, data.frustumPlanes);
+			Vec3 light = normalize({ -0.4f, -1.0f, -0.3f });
+			data.lightDirection[0] = light.x;
+			data.lightDirection[1] = light.y;
+			data.lightDirection[2] = light.z;
+			data.instanceCount = m_settings.instanceCount;
+			data.occlusionCulling = m_settings.occlusionCulling && m_pyramidValid ? 1 : 0;
+			data.pyramidWidth = m_pyramidExtent.width;
+			data.pyramidHeight = m_pyramidExtent.height;
+			data.pyramidLevelCount = m_pyramidLevelCount;
+			std::memcpy(frame.uniformData, &data, sizeof(FrameData));
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+			FrameResources& frame = m_frames[m_currentFrameIndex];
+			m_recordMilliseconds = 0.0;
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test and pyramid reads are waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+
+			if (m_settings.cpuSubmission)
+			{
+				m_renderGraph.addPass("Draw Instances", RenderGraphPassType::Raster,
+					[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordCpuDraws(commandBuffer, target); })
+					.write(color, RenderGraphUsage::ColorAttachment)
+					.write(depth, RenderGraphUsage::DepthStencilAttachment);
+				m_renderGraph.compile();
+				m_renderGraph.execute(commandBuffer);
+				m_statistics.recordMilliseconds += m_recordMilliseconds;
+				m_statistics.recordedFrames++;
+				return;
+			}
+
+			RenderGraphResourceState pyramidState{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT };
+			RenderGraphResource pyramid = m_renderGraph.importImage("Depth Pyramid", m_pyramidImage, m_pyramidView, PYRAMID_FORMAT, m_pyramidExtent,
+				m_pyramidValid ? pyramidState : RenderGraphResourceState{}, pyramidState);
+			RenderGraphResourceState indirectState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+			RenderGraphResource drawCommands = m_renderGraph.importBuffer("Draw Commands", m_drawCommandBuffer,
+				VK_WHOLE_SIZE, indirectState, indirectState);
+			RenderGraphResourceState counterState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+			RenderGraphResource counters = m_renderGraph.importBuffer("Cull Counters", m_counterBuffer, sizeof(CullCounters), counterState, counterState);
+			RenderGraphResourceState hostState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT };
+			RenderGraphResource readback = m_renderGraph.importBuffer("Cull Counter Readback", frame.counterReadbackBuffer,
+				sizeof(CullCounters), hostState, hostState);
+
+			m_renderGraph.addPass("Reset Cull Counters", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					vkd.vkCmdFillBuffer(commandBuffer, m_counterBuffer, 0, sizeof(CullCounters), 0);
+				})
+				.write(counters, RenderGraphUsage::TransferWrite);
+
+			m_renderGraph.addPass("Cull Instances", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&) { recordCulling(commandBuffer); })
+				.read(pyramid, RenderGraphUsage::SampledRead)
+				.write(drawCommands, RenderGraphUsage::StorageWrite)
+				.write(counters, RenderGraphUsage::StorageWrite);
+
+			m_renderGraph.addPass("Draw Instances", RenderGraphPassType::Raster,
+				[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordIndirectDraws(commandBuffer, target); })
+				.read(drawCommands, RenderGraphUsage::IndirectRead)
+				.read(counters, RenderGraphUsage::IndirectRead)
+				.write(color, RenderGraphUsage::ColorAttachment)
+				.write(depth, RenderGraphUsage::DepthStencilAttachment);
+
+			m_renderGraph.addPass("Build Depth Pyramid", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&) { recordDepthPyramid(commandBuffer); })
+				.read(depth, RenderGraphUsage::SampledRead)
+				.write(pyramid, RenderGraphUsage::StorageWrite);
+
+			m_renderGraph.addPass("Read Back Cull Counters", RenderGraphPassType::Compute,
+				[this, &frame](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					VkBufferCopy region{ 0, 0, sizeof(CullCounters) };
+					vkd.vkCmdCopyBuffer(commandBuffer, m_counterBuffer, frame.counterReadbackBuffer, 1, &region);
+				})
+				.read(counters, RenderGraphUsage::TransferRead)
+				.write(readback, RenderGraphUsage::TransferWrite);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+			m_pyramidValid = true;
+			frame.countersPending = true;
+			m_statistics.recordMilliseconds += m_recordMilliseconds;
+			m_statistics.recordedFrames++;
+		}
+
+	private:
+		struct FrameResources
+		{
+			VkBuffer		uniformBuffer{ VK_NULL_HANDLE };
+			VkDeviceMemory	uniformMemory{ VK_NULL_HANDLE };
+			void*			uniformData{ nullptr };
+			VkBuffer		counterReadbackBuffer{ VK_NULL_HANDLE };
+			VkDeviceMemory	counterReadbackMemory{ VK_NULL_HANDLE };
+			void*			counterReadbackData{ nullptr };
+			bool			countersPending{ false };	// Counters of the last submission of the slot are read back
+			VkDescriptorSet	cullSet{ VK_NULL_HANDLE };
+			VkDescriptorSet	sceneSet{ VK_NULL_HANDLE };
+		};
+
+		struct CullingStatistics
+		{
+			uint64_t	countedFrames{ 0 };
+			uint64_t	drawn{ 0 };
+			uint64_t	frustumCulled{ 0 };
+			uint64_t	occlusionCulled{ 0 };
+			uint64_t	recordedFrames{ 0 };
+			double		recordMilliseconds{ 0.0 };
+		};
+
+		/*
+		* Cube and two spheres in one vertex and index buffer, then the benchmark grid: random meshes, sizes, rotations and
+		* colors from a fixed seed, with rows and columns of box walls splitting it into cells that hide most of the grid
+		*/
+		void createScene()
+		{
+			m_vertices.clear();
+			m_indices.clear();
+			m_meshes.clear();
+			std::vector<float> meshRadii;
+
+			// Cube, faces counter clockwise seen from outside
+			{
+				MeshRecord mesh{ 0, static_cast<uint32_t>(m_indices.size()), static_cast<int32_t>(m_vertices.size()), 0 };
+				const float faces[6][3][3] = {
+					{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } }, { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+					{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } }, { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+					{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 } } };
+				for (const auto& face : faces)
+				{
+					uint32_t base = static_cast<uint32_t>(m_vertices.size()) - mesh.vertexOffset;
+					const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+					for (const auto& corner : corners)
+					{
+						Vertex vertex{};
+						for (int axis = 0; axis < 3; axis++)
+						{
+							vertex.position[axis] = face[0][axis] + corner[0] * face[1][axis] + corner[1] * face[2][axis];
+							vertex.normal[axis] = face[0][axis];
+						}
+						m_vertices.push_back(vertex);
+					}
+					m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+				}
+				mesh.indexCount = static_cast<uint32_t>(m_indices.size()) - mesh.firstIndex;
+				m_meshes.push_back(mesh);
+				meshRadii.push_back(std::sqrt(3.0f));
+			}
+
+			// Unit spheres from rings and segments
+			for (uint32_t segments : { 32u, 12u })
+			{
+				uint32_t rings = segments / 2;
+				MeshRecord mesh{ 0, static_cast<uint32_t>(m_indices.size()), static_cast<int32_t>(m_vertices.size()), 0 };
+				for (uint32_t ring = 0; ring <= rings; ring++)
+				{
+					float theta = 3.14159265f * ring / rings;
+					for (uint32_t segment = 0; segment <= segments; segment++)
+					{
+						float phi = 2.0f * 3.14159265f * segment / segments;
+						float x = std::sin(theta) * std::cos(phi);
+						float y = std::cos(theta);
+						float z = std::sin(theta) * std::sin(phi);
+						m_vertices.push_back({ { x, y, z }, { x, y, z } });
+					}
+				}
+				for (uint32_t ring = 0; ring < rings; ring++)
+				{
+					for (uint32_t segment = 0; segment < segments; segment++)
+					{
+						uint32_t current = ring * (segments + 1) + segment;
+						uint32_t below = current + segments + 1;
+						m_indices.insert(m_indices.end(), { current, current + 1, below, current + 1, below + 1, below });
+					}
+				}
+				mesh.indexCount = static_cast<uint32_t>(m_indices.size()) - mesh.firstIndex;
+				m_meshes.push_back(mesh);
+				meshRadii.push_back(1.0f);
+			}
+
+			uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(double(m_settings.instanceCount))));
+			m_gridHalfExtent = 0.5f * GRID_SPACING * side;
+			std::mt19937 random(1234);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			m_instances.resize(m_settings.instanceCount);
+			for (uint32_t index = 0; index < m_settings.instanceCount; index++)
+			{
+				uint32_t row = index / side;
+				uint32_t column = index % side;
+				bool rowWall = row % WALL_INTERVAL == WALL_INTERVAL / 2;
+				bool columnWall = column % WALL_INTERVAL == WALL_INTERVAL / 2;
+
+				Instance& instance = m_instances[index];
+				float scale[3];
+				float angle = 0.0f;
+				if (rowWall || columnWall)
+				{
+					// Boxes as wide as a grid cell, touching their neighbours
+					instance.mesh = 0;
+					scale[0] = rowWall ? 0.5f * GRID_SPACING : 0.25f;
+					scale[1] = 4.0f;
+					scale[2] = columnWall ? 0.5f * GRID_SPACING : 0.25f;
+					for (int channel = 0; channel < 3; channel++) instance.color[channel] = 0.6f;
+				}
+				else
+				{
+					instance.mesh = random() % m_meshes.size();
+					scale[0] = scale[1] = scale[2] = 0.4f + 0.6f * unit(random);
+					angle = 6.2831853f * unit(random);
+					for (int channel = 0; channel < 3; channel++) instance.color[channel] = 0.3f + 0.7f * unit(random);
+				}
+				instance.color[3] = 1.0f;
+
+				// Translation * rotation around y * scale, resting on the ground plane
+				float position[3] = { (column + 0.5f) * GRID_SPACING - m_gridHalfExtent, scale[1], (row + 0.5f) * GRID_SPACING - m_gridHalfExtent };
+				Mat4& model = instance.model;
+				model.m[0] = std::cos(angle) * scale[0];	model.m[2] = -std::sin(angle) * scale[0];
+				model.m[5] = scale[1];
+				model.m[8] = std::sin(angle) * scale[2];	model.m[10] = std::cos(angle) * scale[2];
+				model.m[12] = position[0];	model.m[13] = position[1];	model.m[14] = position[2];
+
+				std::memcpy(instance.boundingSphere, position, sizeof(position));
+				instance.boundingSphere[3] = meshRadii[instance.mesh] * std::max({ scale[0], scale[1], scale[2] });
+			}
+		}
+
+		/*
+		* Copy the scene into device local buffers once, through one staging buffer and a single submission
+		*/
+		void uploadScene()
+		{
+			VkDeviceSize vertexSize = m_vertices.size() * sizeof(Vertex);
+			VkDeviceSize indexSize = m_indices.size() * sizeof(uint32_t);
+			VkDeviceSize instanceSize = m_instances.size() * sizeof(Instance);
+			VkDeviceSize meshSize = m_meshes.size() * sizeof(MeshRecord);
+
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_instanceBuffer, m_instanceMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, meshSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_meshBuffer, m_meshMemory, m_defaultAllocator);
+			// One command per instance in the worst case, written by the culling pass
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, m_instances.size() * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_drawCommandBuffer, m_drawCommandMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(CullCounters),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_counterBuffer, m_counterMemory, m_defaultAllocator);
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VkDeviceSize stagingSize = vertexSize + indexSize + instanceSize + meshSize;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			uint8_t* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&staging));
+			std::memcpy(staging, m_vertices.data(), vertexSize);
+			std::memcpy(staging + vertexSize, m_indices.data(), indexSize);
+			std::memcpy(staging + vertexSize + indexSize, m_instances.data(), instanceSize);
+			std::memcpy(staging + vertexSize + indexSize + instanceSize, m_meshes.data(), meshSize);
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			VkDeviceSize offset = 0;
+			for (auto [buffer, size] : { std::make_pair(m_vertexBuffer, vertexSize), std::make_pair(m_indexBuffer, indexSize),
+				std::make_pair(m_instanceBuffer, instanceSize), std::make_pair(m_meshBuffer, meshSize) })
+			{
+				VkBufferCopy region{ offset, 0, size };
+				vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &region);
+				offset += size;
+			}
+			// The scene buffers are never written again, this makes them visible to every later frame
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared and kept for the depth pyramid.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* Pipelines are registered with the hot reloader, layouts come from reflection through the pipeline layout cache
+		*/
+		void createPipelines()
+		{
+			auto buildCompute = [this](const std::vector<uint32_t>& spirv, VkPipelineCache pipelineCache,
+				VkPipelineLayout& layout, VkDescriptorSetLayout& setLayout)
+			{
+				std::vector<VkDescriptorSetLayout> setLayouts;
+				layout = m_pipelineLayoutCache.getPipelineLayout({ ShaderReflectionUtil::reflect(spirv) }, &setLayouts);
+				setLayout = setLayouts[0];
+
+				VkShaderModule module = createShaderModule(spirv);
+				VkComputePipelineCreateInfo createInfo{};
+				createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+				createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+				createInfo.stage.module = module;
+				createInfo.stage.pName = "main";
+				createInfo.layout = layout;
+				VkPipeline pipeline;
+				VkResult result = vkd.vkCreateComputePipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+				vkd.vkDestroyShaderModule(m_device, module, m_defaultAllocator);
+				if (result != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create compute pipeline!");
+				}
+				return pipeline;
+			};
+
+			m_cullPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/cull.comp" },
+				[this, buildCompute](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildCompute(spirvStages[0], pipelineCache, m_cullLayout, m_cullSetLayout);
+				});
+			m_pyramidPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/depth_pyramid.comp" },
+				[this, buildCompute](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildCompute(spirvStages[0], pipelineCache, m_pyramidLayout, m_pyramidSetLayout);
+				});
+			m_scenePipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/scene.vert", m_shaderDirectory + "/scene.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildScenePipeline(spirvStages, pipelineCache);
+				});
+		}
+
+		VkPipeline buildScenePipeline(const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+		{
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			m_sceneLayout = m_pipelineLayoutCache.getPipelineLayout(
+				{ ShaderReflectionUtil::reflect(spirvStages[0]), ShaderReflectionUtil::reflect(spirvStages[1]) }, &setLayouts);
+			m_sceneSetLayout = setLayouts[0];
+
+			VkPipelineShaderStageCreateInfo stages[2]{};
+			const VkShaderStageFlagBits stageFlags[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+			for (uint32_t stage = 0; stage < 2; stage++)
+			{
+				stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				stages[stage].stage = stageFlags[stage];
+				stages[stage].module = createShaderModule(spirvStages[stage]);
+				stages[stage].pName = "main";
+			}
+
+			VkVertexInputBindingDescription binding{ 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX };
+			VkVertexInputAttributeDescription attributes[2] = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) },
+				{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) } };
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInput.vertexBindingDescriptionCount = 1;
+			vertexInput.pVertexBindingDescriptions = &binding;
+			vertexInput.vertexAttributeDescriptionCount = 2;
+			vertexInput.pVertexAttributeDescriptions = attributes;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+			VkPipelineViewportStateCreateInfo viewportState{};
+			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			// The projection flips y, counter clockwise faces stay counter clockwise in framebuffer space
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+			rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+			rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterization.lineWidth = 1.0f;
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+			VkPipelineColorBlendAttachmentState blendAttachment{};
+			blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &blendAttachment;
+
+			VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
+
+			VkGraphicsPipelineCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.stageCount = 2;
+			createInfo.pStages = stages;
+			createInfo.pVertexInputState = &vertexInput;
+			createInfo.pInputAssemblyState = &inputAssembly;
+			createInfo.pViewportState = &viewportState;
+			createInfo.pRasterizationState = &rasterization;
+			createInfo.pMultisampleState = &multisample;
+			createInfo.pDepthStencilState = &depthStencil;
+			createInfo.pColorBlendState = &colorBlend;
+			createInfo.pDynamicState = &dynamicState;
+			createInfo.layout = m_sceneLayout;
+			createInfo.renderPass = m_renderPass;
+			createInfo.subpass = 0;
+			VkPipeline pipeline;
+			VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+			for (const VkPipelineShaderStageCreateInfo& stage : stages) vkd.vkDestroyShaderModule(m_device, stage.module, m_defaultAllocator);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create scene pipeline!");
+			}
+			return pipeline;
+		}
+
+		/*
+		* Uniform buffers, counter readbacks and descriptor sets per frame in flight, one descriptor set per pyramid level
+		*/
+		void createFrameResources()
+		{
+			VkSamplerCreateInfo samplerInfo{};
+			samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			samplerInfo.magFilter = VK_FILTER_NEAREST;
+			samplerInfo.minFilter = VK_FILTER_NEAREST;
+			samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+			samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+			samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+			if (vkd.vkCreateSampler(m_device, &samplerInfo, m_defaultAllocator, &m_sampler) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create depth pyramid sampler!");
+			}
+
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSizes[] = {
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * frameCount },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * frameCount },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount + MAX_PYRAMID_LEVELS },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * MAX_PYRAMID_LEVELS } };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = 2 * frameCount + MAX_PYRAMID_LEVELS;
+			poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+			poolInfo.pPoolSizes = poolSizes;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			m_frames.resize(frameCount);
+			for (FrameResources& frame : m_frames)
+			{
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(FrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.uniformBuffer, frame.uniformMemory, m_defaultAllocator);
+				vkd.vkMapMemory(m_device, frame.uniformMemory, 0, VK_WHOLE_SIZE, 0, &frame.uniformData);
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(CullCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					frame.counterReadbackBuffer, frame.counterReadbackMemory, m_defaultAllocator);
+				vkd.vkMapMemory(m_device, frame.counterReadbackMemory, 0, VK_WHOLE_SIZE, 0, &frame.counterReadbackData);
+
+				frame.cullSet = allocateDescriptorSet(m_cullSetLayout);
+				frame.sceneSet = allocateDescriptorSet(m_sceneSetLayout);
+				VkDescriptorBufferInfo uniformInfo{ frame.uniformBuffer, 0, sizeof(FrameData) };
+				VkDescriptorBufferInfo instanceInfo{ m_instanceBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo meshInfo{ m_meshBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo drawCommandInfo{ m_drawCommandBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo counterInfo{ m_counterBuffer, 0, VK_WHOLE_SIZE };
+				std::vector<VkWriteDescriptorSet> writes = {
+					bufferWrite(frame.cullSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+					bufferWrite(frame.cullSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instanceInfo),
+					bufferWrite(frame.cullSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshInfo),
+					bufferWrite(frame.cullSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &drawCommandInfo),
+					bufferWrite(frame.cullSet, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &counterInfo),
+					bufferWrite(frame.sceneSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+					bufferWrite(frame.sceneSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instanceInfo) };
+				vkd.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			}
+			for (VkDescriptorSet& set : m_pyramidSets) set = allocateDescriptorSet(m_pyramidSetLayout);
+		}
+
+		/*
+		* Depth buffer and depth pyramid of the frame size, recreated with their descriptors when the size changes
+		*/
+		void ensureTargets(VkExtent2D extent)
+		{
+			if (!ensureDepthTarget(m_targets, extent)) return;
+			destroyPyramid();
+
+			m_pyramidExtent = { floorPowerOfTwo(extent.width), floorPowerOfTwo(extent.height) };
+			m_pyramidLevelCount = 1;
+			while (m_pyramidLevelCount < MAX_PYRAMID_LEVELS && std::max(m_pyramidExtent.width, m_pyramidExtent.height) >> m_pyramidLevelCount) m_pyramidLevelCount++;
+			VulkanUtil::createImage2D(m_physicalDevice, m_device, m_pyramidExtent, PYRAMID_FORMAT,
+				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				m_pyramidImage, m_pyramidMemory, m_defaultAllocator, m_pyramidLevelCount);
+			m_pyramidView = VulkanUtil::createImageView2D(m_device, m_pyramidImage, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT,
+				m_defaultAllocator, 0, m_pyramidLevelCount);
+			for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+			{
+				m_pyramidLevelViews.push_back(VulkanUtil::createImageView2D(m_device, m_pyramidImage, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT,
+					m_defaultAllocator, level, 1));
+			}
+			m_pyramidValid = false;
+
+			std::vector<VkDescriptorImageInfo> imageInfos;
+			imageInfos.reserve(m_frames.size() + 3 * m_pyramidLevelCount);
+			std::vector<VkWriteDescriptorSet> writes;
+			for (FrameResources& frame : m_frames)
+			{
+				imageInfos.push_back({ m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+				writes.push_back(imageWrite(frame.cullSet, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfos.back()));
+			}
+			for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+			{
+				// Level 0 reads the depth buffer, its source binding is never read but has to be valid
+				imageInfos.push_back({ m_sampler, m_targets.depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+				writes.push_back(imageWrite(m_pyramidSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfos.back()));
+				imageInfos.push_back({ VK_NULL_HANDLE, m_pyramidLevelViews[level > 0 ? level - 1 : 0], VK_IMAGE_LAYOUT_GENERAL });
+				writes.push_back(imageWrite(m_pyramidSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &imageInfos.back()));
+				imageInfos.push_back({ VK_NULL_HANDLE, m_pyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL });
+				writes.push_back(imageWrite(m_pyramidSets[level], 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &imageInfos.back()));
+			}
+			vkd.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+
+		void destroyPyramid()
+		{
+			for (VkImageView view : m_pyramidLevelViews) vkd.vkDestroyImageView(m_device, view, m_defaultAllocator);
+			m_pyramidLevelViews.clear();
+			vkd.vkDestroyImageView(m_device, m_pyramidView, m_defaultAllocator);
+			vkd.vkDestroyImage(m_device, m_pyramidImage, m_defaultAllocator);
+			vkd.vkFreeMemory(m_device, m_pyramidMemory, m_defaultAllocator);
+			m_pyramidView = VK_NULL_HANDLE;
+			m_pyramidImage = VK_NULL_HANDLE;
+			m_pyramidMemory = VK_NULL_HANDLE;
+		}
+
+		void recordCulling(VkCommandBuffer commandBuffer)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Cull Instances");
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_shaderHotReloader.getPipeline(m_cullPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0, 1, &m_frames[m_currentFrameIndex].cullSet, 0, nullptr);
+			vkd.vkCmdDispatch(commandBuffer, (m_settings.instanceCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+			m_recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		void beginScenePass(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_scenePipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_sceneLayout, 0, 1, &m_frames[m_currentFrameIndex].sceneSet, 0, nullptr);
+			VkDeviceSize offset = 0;
+			vkd.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+			vkd.vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		}
+
+		/*
+		* One draw call for the whole scene, the culling pass wrote the commands and their count
+		*/
+		void recordIndirectDraws(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Instances");
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Instances");
+			beginScenePass(commandBuffer, target);
+			vkd.vkCmdDrawIndexedIndirectCount(commandBuffer, m_drawCommandBuffer, 0, m_counterBuffer, offsetof(CullCounters, drawCount),
+				m_settings.instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+			m_recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		/*
+		* Reference path: frustum culling on the CPU and one draw call per visible instance
+		*/
+		void recordCpuDraws(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Instances");
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Instances");
+			beginScenePass(commandBuffer, target);
+			uint64_t drawn = 0;
+			for (uint32_t index = 0; index < m_settings.instanceCount; index++)
+			{
+				const Instance& instance = m_instances[index];
+				if (isOutsideFrustum(m_frameData.frustumPlanes, instance.boundingSphere)) continue;
+				const MeshRecord& mesh = m_meshes[instance.mesh];
+				vkd.vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, index);
+				drawn++;
+			}
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+			m_recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+			m_statistics.drawn += drawn;
+			m_statistics.frustumCulled += m_settings.instanceCount - drawn;
+			m_statistics.countedFrames++;
+		}
+
+		/*
+		* Level 0 from the depth buffer, then each level from the one above, waiting for its writes in between
+		*/
+		void recordDepthPyramid(VkCommandBuffer commandBuffer)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Build Depth Pyramid");
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_shaderHotReloader.getPipeline(m_pyramidPipeline));
+			for (uint32_t level = 0; level < m_pyramidLevelCount; level++)
+			{
+				PyramidLevelConstants constants{};
+				constants.sourceSize[0] = level == 0 ? m_targets.extent.width : std::max(1u, m_pyramidExtent.width >> (level - 1));
+				constants.sourceSize[1] = level == 0 ? m_targets.extent.height : std::max(1u, m_pyramidExtent.height >> (level - 1));
+				constants.destinationSize[0] = std::max(1u, m_pyramidExtent.width >> level);
+				constants.destinationSize[1] = std::max(1u, m_pyramidExtent.height >> level);
+				constants.fromDepthBuffer = level == 0 ? 1 : 0;
+				if (level > 0)
+				{
+					VkImageMemoryBarrier barrier{};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+					barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+					barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.image = m_pyramidImage;
+					barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+					vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+						0, 0, nullptr, 0, nullptr, 1, &barrier);
+				}
+				vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidLayout, 0, 1, &m_pyramidSets[level], 0, nullptr);
+				vkd.vkCmdPushConstants(commandBuffer, m_pyramidLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+				vkd.vkCmdDispatch(commandBuffer, (constants.destinationSize[0] + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE,
+					(constants.destinationSize[1] + PYRAMID_WORKGROUP_SIZE - 1) / PYRAMID_WORKGROUP_SIZE, 1);
+			}
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+		VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout)
+		{
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = m_descriptorPool;
+			allocateInfo.descriptorSetCount = 1;
+			allocateInfo.pSetLayouts = &layout;
+			VkDescriptorSet set;
+			if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, &set) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+			return set;
+		}
+
+	private:
+		CullingSettings					m_settings{};
+		CullingStatistics				m_statistics{};
+		double							m_recordMilliseconds{ 0.0 };	// Draw submission recording of the current frame
+
+		// Scene, kept on the host for the CPU submission path
+		std::vector<Vertex>				m_vertices{};
+		std::vector<uint32_t>			m_indices{};
+		std::vector<MeshRecord>			m_meshes{};
+		std::vector<Instance>			m_instances{};
+		float							m_gridHalfExtent{ 0.0f };
+		FrameData						m_frameData{};
+
+		VkBuffer						m_vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_indexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_instanceBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_instanceMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_meshBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_meshMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_drawCommandBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_drawCommandMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_counterBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_counterMemory{ VK_NULL_HANDLE };
+
+		// Depth buffer and the pyramid of its farthest depths, one view per level for the storage writes
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+		VkExtent2D						m_pyramidExtent{};
+		uint32_t						m_pyramidLevelCount{ 0 };
+		VkImage							m_pyramidImage{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_pyramidMemory{ VK_NULL_HANDLE };
+		VkImageView						m_pyramidView{ VK_NULL_HANDLE };
+		std::vector<VkImageView>		m_pyramidLevelViews{};
+		bool							m_pyramidValid{ false };	// Holds the depth of the previous frame
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+		VkSampler						m_sampler{ VK_NULL_HANDLE };
+
+		// Hot reloader pipeline ids and the layouts their builders took from the pipeline layout cache
+		uint32_t						m_cullPipeline{ 0 };
+		uint32_t						m_pyramidPipeline{ 0 };
+		uint32_t						m_scenePipeline{ 0 };
+		VkPipelineLayout				m_cullLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout				m_pyramidLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout				m_sceneLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_cullSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_pyramidSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_sceneSetLayout{ VK_NULL_HANDLE };
+
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<FrameResources>		m_frames{};
+		VkDescriptorSet					m_pyramidSets[MAX_PYRAMID_LEVELS]{};
+	};
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	CullingSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--instances" && i + 1 < argc) settings.instanceCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--cpu-submit") settings.cpuSubmission = true;
+		else if (argument == "--no-occlusion") settings.occlusionCulling = false;
+	}
+
+	GpuDrivenCullingExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
@@ -0,0 +1,834 @@
+#include "vulkan_example_base.h"
+#include "vulkan_vertex_blending.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* GPU skinning: a crowd of bending, breathing tube characters animated with a joint chain and two blend shapes. The host
+* only computes the joint palettes and blend shape weights, one compute dispatch blends the vertices of every character
+* into a shared output buffer, which the draws read as their vertex buffer. With the ray tracing feature set every
+* character also has a deforming BLAS, refitted from the same output buffer each frame with one build command, and the
+* TLAS over all of them is ready for ray queries.
+*
+*   gpu_skinning [--characters <n>] [--no-ray-tracing] [common options]
+*
+* --characters sets the crowd size, 1024 by default, and m_maxVertexBlendingMeshCount with it. The blended vertices,
+* the joint palette volume, the host animation time and the GPU time of the blending and refit passes are printed on
+* exit, the animation is driven by the frame number so headless runs are reproducible.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t JOINT_COUNT = 8;			// Joint chain along each tube
+		constexpr uint32_t RING_COUNT = 33;			// Vertex rings along each tube
+		constexpr uint32_t RING_SEGMENTS = 16;		// Vertices per ring
+		constexpr uint32_t GEOMETRY_COUNT = 3;		// Tube variants shared by the characters
+		constexpr float CHARACTER_SPACING = 2.0f;
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		Mat4 translate(float x, float y, float z)
+		{
+			Mat4 result{};
+			result.m[12] = x;
+			result.m[13] = y;
+			result.m[14] = z;
+			return result;
+		}
+
+		Mat4 rotateY(float angle)
+		{
+			Mat4 result{};
+			result.m[0] = std::cos(angle);	result.m[8] = std::sin(angle);
+			result.m[2] = -std::sin(angle);	result.m[10] = std::cos(angle);
+			return result;
+		}
+
+		Mat4 rotateZ(float angle)
+		{
+			Mat4 result{};
+			result.m[0] = std::cos(angle);	result.m[4] = -std::sin(angle);
+			result.m[1] = std::sin(angle);	result.m[5] = std::cos(angle);
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		InstanceTransform toInstanceTransform(const Mat4& matrix)
+		{
+			InstanceTransform transform{};
+			for (int row = 0; row < 3; row++)
+			{
+				for (int column = 0; column < 4; column++) transform.rows[row][column] = matrix.m[column * 4 + row];
+			}
+			return transform;
+		}
+
+		// std140 FrameData block of character.vert and character.frag
+		struct FrameData
+		{
+			Mat4	viewProjection{};
+			float	lightDirection[4]{};
+		};
+
+		// Animation parameters of a character, its joints and blend shape weights are recomputed on the host every frame
+		struct CharacterMotion
+		{
+			float	position[2]{};		// On the ground plane
+			float	heading{ 0.0f };
+			float	phase{ 0.0f };
+			float	speed{ 1.0f };
+			float	bend{ 0.2f };		// Per joint bend amplitude in radians
+			float	segmentLength{ 0.25f };
+		};
+	}
+
+	struct SkinningSettings
+	{
+		uint32_t	characterCount{ 1024 };
+		bool		rayTracing{ true };		// Refit the characters' BLASes when the ray tracing feature set is enabled
+	};
+
+	class GpuSkinningExample : public ExampleBase
+	{
+	public:
+		explicit GpuSkinningExample(const SkinningSettings& settings) : m_settings(settings)
+		{
+			m_title = "GPU Skinning";
+			m_shaderDirectory = getShaderDirectory("gpu_skinning");
+			m_maxVertexBlendingMeshCount = settings.characterCount;
+			// Joint palettes and weights every frame, the blending tables once
+			VkDeviceSize frameData = VkDeviceSize(settings.characterCount) * (JOINT_COUNT * sizeof(InstanceTransform) + 2 * sizeof(float));
+			VkDeviceSize tables = VkDeviceSize(settings.characterCount) * (sizeof(VertexBlendingMesh) + 2 * sizeof(uint32_t) *
+				((RING_COUNT * RING_SEGMENTS + VertexBlending::WORKGROUP_SIZE - 1) / VertexBlending::WORKGROUP_SIZE));
+			m_uploadRingFrameSize = std::max(m_uploadRingFrameSize, frameData + tables + (1 << 20));
+		}
+
+		void printStatistics() const
+		{
+			const VertexBlendingStatistics& blending = m_vertexBlending.getStatistics();
+			double frames = std::max<uint64_t>(m_animatedFrames, 1);
+			std::cout << "\n=====GPU Skinning=====";
+			std::cout << "\n" << std::setw(30) << std::left << "Characters" << m_vertexBlending.getMeshCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Geometries" << m_vertexBlending.getGeometryCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Frames" << m_animatedFrames;
+			std::cout << "\n" << std::setw(30) << std::left << "Blend dispatches / frame" << std::fixed << std::setprecision(1) << blending.dispatches / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Workgroups / dispatch" << m_vertexBlending.getWorkgroupCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Blended vertices / frame" << std::setprecision(0) << blending.blendedVertices / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Joint data KiB / frame" << std::setprecision(1) << blending.frameDataBytes / frames / 1024.0;
+			std::cout << "\n" << std::setw(30) << std::left << "Animation CPU (ms)" << std::setprecision(3) << m_animationSeconds * 1000.0 / frames;
+			for (const GpuZoneStatistics& zone : m_gpuProfiler.getStatistics())
+			{
+				if (zone.name == "Blend Vertices" || zone.name == "Refit BLAS")
+				{
+					std::cout << "\n" << std::setw(30) << std::left << (zone.name + " GPU (ms)") << zone.avgMs;
+				}
+			}
+			std::cout << "\n" << std::setw(30) << std::left << "BLAS refits" << (m_blases.empty() ? "Disabled" : "Enabled");
+			std::cout << std::defaultfloat << std::endl;
+			if (!m_blases.empty()) m_accelerationStructures.printStatistics();
+		}
+
+	protected:
+		void createResources() override
+		{
+			createCharacters();
+			uploadIndices();
+			createBlases();
+			createRenderPass();
+			createPipelines();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			m_vertexBlending.cleanup();
+			destroyBuffer(m_indexBuffer, m_indexMemory);
+			m_frames.clear();
+			m_blases.clear();
+			m_renderPass = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Pose every character on the host, write the frame uniforms, joint palettes and blend shape weights to the upload
+		* ring and point the frame slot's descriptor sets at them, its previous frame has completed
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureDepthTarget(m_targets, extent);
+
+			float time = 0.016f * static_cast<float>(m_frameCounter);
+			auto begin = std::chrono::steady_clock::now();
+			animateCharacters(time);
+			m_vertexBlending.writeFrameData(m_uploadRing, frameIndex);
+			m_animationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			m_animatedFrames++;
+
+			float fieldSize = m_gridSide * CHARACTER_SPACING;
+			float angle = 0.1f * time;
+			Vec3 eye{ 0.6f * fieldSize * std::cos(angle), 0.3f * fieldSize + 2.0f, 0.6f * fieldSize * std::sin(angle) };
+			RingBufferAllocation frameAllocation = m_uploadRing.allocate(sizeof(FrameData));
+			FrameData* data = static_cast<FrameData*>(frameAllocation.pData);
+			data->viewProjection = perspective(1.0f, float(extent.width) / float(extent.height), 0.5f, 2.0f * fieldSize + 10.0f) *
+				lookAt(eye, { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+			Vec3 light = normalize({ -0.5f, -1.0f, -0.25f });
+			data->lightDirection[0] = light.x;
+			data->lightDirection[1] = light.y;
+			data->lightDirection[2] = light.z;
+
+			FrameResources& frame = m_frames[frameIndex];
+			VkDescriptorBufferInfo uniformInfo{ frameAllocation.buffer, frameAllocation.offset, frameAllocation.size };
+			VkWriteDescriptorSet write = bufferWrite(frame.drawSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo);
+			vkd.vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test is waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+
+			// The tables are written once, the blended vertices every frame after the previous frame's draws and refits read them
+			RenderGraphResourceState tableState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+			const VertexBlendingBuffer tableBuffers[4] = { VertexBlendingBuffer::Meshes, VertexBlendingBuffer::Workgroups,
+				VertexBlendingBuffer::Vertices, VertexBlendingBuffer::Deltas };
+			const char* tableNames[4] = { "Blend Meshes", "Blend Workgroups", "Blend Vertices", "Blend Shape Deltas" };
+			RenderGraphResource tables[4];
+			for (uint32_t table = 0; table < 4; table++)
+			{
+				tables[table] = m_renderGraph.importBuffer(tableNames[table], m_vertexBlending.getBuffer(tableBuffers[table]), VK_WHOLE_SIZE,
+					tableState, tableState);
+			}
+			bool refit = !m_blases.empty();
+			VkPipelineStageFlags outputStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+			VkAccessFlags outputAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+			if (refit)
+			{
+				outputStages |= VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+				outputAccess |= VK_ACCESS_SHADER_READ_BIT;
+			}
+			RenderGraphResourceState outputState{ VK_IMAGE_LAYOUT_UNDEFINED, outputStages, outputAccess };
+			RenderGraphResource output = m_renderGraph.importBuffer("Blended Vertices", m_vertexBlending.getBuffer(VertexBlendingBuffer::Output),
+				VK_WHOLE_SIZE, outputState, outputState);
+
+			if (m_vertexBlending.hasPendingUploads())
+			{
+				RenderGraphPassBuilder upload = m_renderGraph.addPass("Upload Blend Tables", RenderGraphPassType::Compute,
+					[this](VkCommandBuffer commandBuffer, const RenderGraph&) { m_vertexBlending.upload(commandBuffer, m_uploadRing); });
+				for (RenderGraphResource table : tables) upload.write(table, RenderGraphUsage::TransferWrite);
+			}
+
+			RenderGraphPassBuilder blend = m_renderGraph.addPass("Blend Vertices", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&) { recordBlending(commandBuffer); });
+			for (RenderGraphResource table : tables) blend.read(table, RenderGraphUsage::StorageRead);
+			blend.write(output, RenderGraphUsage::StorageWrite);
+
+			if (refit)
+			{
+				// The TLAS lives outside the graph, the builder orders its builds and the shaders tracing it
+				m_renderGraph.addPass("Refit BLAS", RenderGraphPassType::Compute,
+					[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+					{
+						GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Refit BLAS");
+						m_accelerationStructures.refitBlas(commandBuffer, m_blases);
+						m_accelerationStructures.buildTlas(commandBuffer, m_tlasInstances);
+					})
+					.read(output, RenderGraphUsage::AccelerationStructureInput)
+					.setSideEffects();
+			}
+
+			m_renderGraph.addPass("Draw Characters", RenderGraphPassType::Raster,
+				[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordDraws(commandBuffer, target); })
+				.read(output, RenderGraphUsage::VertexRead)
+				.write(color, RenderGraphUsage::ColorAttachment)
+				.write(depth, RenderGraphUsage::DepthStencilAttachment);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+		}
+
+	private:
+		struct FrameResources
+		{
+			VkDescriptorSet	drawSet{ VK_NULL_HANDLE };
+		};
+
+		/*
+		* Open tube along y in its rest pose, rings skinned to the two nearest joints of the chain. Blend shape 0 bulges the
+		* middle outwards, blend shape 1 squashes the tube into a wider, lower one.
+		*/
+		BlendGeometryDesc createTube(float radius, float height, std::vector<uint32_t>& indices)
+		{
+			BlendGeometryDesc desc{};
+			desc.jointCount = JOINT_COUNT;
+			float segmentLength = height / JOINT_COUNT;
+			std::vector<BlendShapeDelta> bulge;
+			std::vector<BlendShapeDelta> squash;
+			for (uint32_t ring = 0; ring < RING_COUNT; ring++)
+			{
+				float y = height * ring / (RING_COUNT - 1);
+				float chain = std::min(y / segmentLength, float(JOINT_COUNT - 1));
+				uint32_t joint = std::min(static_cast<uint32_t>(chain), JOINT_COUNT - 2);
+				uint32_t nextWeight = static_cast<uint32_t>(std::lround(std::min(chain - joint, 1.0f) * 255.0f));
+				float swell = std::sin(3.14159265f * y / height);
+				for (uint32_t segment = 0; segment < RING_SEGMENTS; segment++)
+				{
+					float angle = 6.2831853f * segment / RING_SEGMENTS;
+					float nx = std::cos(angle);
+					float nz = std::sin(angle);
+					BlendVertex vertex{};
+					vertex.position[0] = radius * nx;
+					vertex.position[1] = y;
+					vertex.position[2] = radius * nz;
+					vertex.normal[0] = nx;
+					vertex.normal[1] = 0.0f;
+					vertex.normal[2] = nz;
+					vertex.joints = joint | (joint + 1) << 8;
+					vertex.weights = (255 - nextWeight) | nextWeight << 8;
+					desc.vertices.push_back(vertex);
+
+					BlendShapeDelta bulgeDelta{};
+					bulgeDelta.position[0] = 0.6f * radius * swell * swell * nx;
+					bulgeDelta.position[2] = 0.6f * radius * swell * swell * nz;
+					bulge.push_back(bulgeDelta);
+					BlendShapeDelta squashDelta{};
+					squashDelta.position[0] = 0.3f * radius * nx;
+					squashDelta.position[1] = -0.2f * y;
+					squashDelta.position[2] = 0.3f * radius * nz;
+					squash.push_back(squashDelta);
+				}
+			}
+			desc.blendShapes = bulge;
+			desc.blendShapes.insert(desc.blendShapes.end(), squash.begin(), squash.end());
+
+			// Counter clockwise seen from outside
+			for (uint32_t ring = 0; ring + 1 < RING_COUNT; ring++)
+			{
+				for (uint32_t segment = 0; segment < RING_SEGMENTS; segment++)
+				{
+					uint32_t a = ring * RING_SEGMENTS + segment;
+					uint32_t b = (ring + 1) * RING_SEGMENTS + segment;
+					uint32_t c = ring * RING_SEGMENTS + (segment + 1) % RING_SEGMENTS;
+					uint32_t d = (ring + 1) * RING_SEGMENTS + (segment + 1) % RING_SEGMENTS;
+					indices.insert(indices.end(), { a, b, c, c, b, d });
+				}
+			}
+			return desc;
+		}
+
+		/*
+		* GEOMETRY_COUNT tube variants, the characters on a square grid each use one of them with a motion of its own
+		*/
+		void createCharacters()
+		{
+			m_vertexBlending.init(m_physicalDevice, m_device, m_maxVertexBlendingMeshCount, m_defaultAllocator);
+			const float radii[GEOMETRY_COUNT] = { 0.25f, 0.35f, 0.3f };
+			const float heights[GEOMETRY_COUNT] = { 2.0f, 2.5f, 1.6f };
+			for (uint32_t geometry = 0; geometry < GEOMETRY_COUNT; geometry++)
+			{
+				m_firstIndices.push_back(static_cast<uint32_t>(m_indices.size()));
+				m_vertexBlending.addGeometry(createTube(radii[geometry], heights[geometry], m_indices));
+				m_indexCounts.push_back(static_cast<uint32_t>(m_indices.size()) - m_firstIndices.back());
+			}
+
+			m_gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(double(m_settings.characterCount))));
+			float halfField = 0.5f * m_gridSide * CHARACTER_SPACING;
+			std::mt19937 random(23);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (uint32_t character = 0; character < m_settings.characterCount; character++)
+			{
+				uint32_t geometry = character % GEOMETRY_COUNT;
+				m_vertexBlending.addMesh(geometry);
+				CharacterMotion motion{};
+				motion.position[0] = (character % m_gridSide + 0.5f) * CHARACTER_SPACING - halfField;
+				motion.position[1] = (character / m_gridSide + 0.5f) * CHARACTER_SPACING - halfField;
+				motion.heading = 6.2831853f * unit(random);
+				motion.phase = 6.2831853f * unit(random);
+				motion.speed = 1.0f + 2.0f * unit(random);
+				motion.bend = 0.1f + 0.15f * unit(random);
+				motion.segmentLength = heights[geometry] / JOINT_COUNT;
+				m_motions.push_back(motion);
+			}
+			m_rayTracing = m_settings.rayTracing && isFeatureSetEnabled("RayTracing");
+			m_vertexBlending.createBuffers(m_rayTracing);
+		}
+
+		/*
+		* Joint j of the chain starts at j segment lengths up the tube and bends around its local z axis, the skinning
+		* transforms take the rest pose to world space so the blended vertices need no further transform
+		*/
+		void animateCharacters(float time)
+		{
+			InstanceTransform joints[JOINT_COUNT];
+			float weights[2];
+			for (uint32_t character = 0; character < static_cast<uint32_t>(m_motions.size()); character++)
+			{
+				const CharacterMotion& motion = m_motions[character];
+				float cycle = motion.speed * time + motion.phase;
+				Mat4 world = translate(motion.position[0], 0.0f, motion.position[1]) * rotateY(motion.heading);
+				for (uint32_t joint = 0; joint < JOINT_COUNT; joint++)
+				{
+					if (joint > 0) world = world * translate(0.0f, motion.segmentLength, 0.0f);
+					world = world * rotateZ(motion.bend * std::sin(cycle + 0.6f * joint));
+					joints[joint] = toInstanceTransform(world * translate(0.0f, -motion.segmentLength * joint, 0.0f));
+				}
+				m_vertexBlending.setJoints(character, joints);
+				weights[0] = 0.5f + 0.5f * std::sin(1.3f * cycle);
+				weights[1] = 0.5f + 0.5f * std::sin(0.7f * cycle + motion.phase);
+				m_vertexBlending.setBlendWeights(character, weights);
+			}
+		}
+
+		/*
+		* The index buffers of the geometries, shared by the draws and the BLASes of the characters
+		*/
+		void uploadIndices()
+		{
+			VkDeviceSize indexSize = m_indices.size() * sizeof(uint32_t);
+			VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+				(m_rayTracing ? VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				m_indexBuffer, m_indexMemory, m_defaultAllocator);
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			void* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &staging);
+			std::memcpy(staging, m_indices.data(), indexSize);
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			VkBufferCopy region{ 0, 0, indexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_indexBuffer, 1, &region);
+			// The index buffer is never written again, this makes it visible to every later draw and build
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT };
+			VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+			if (m_rayTracing)
+			{
+				barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+				dstStages |= VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+			}
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+		}
+
+		/*
+		* One deforming BLAS per character over its range of the blended vertices, built by the first frame's refit once
+		* the vertices exist. The TLAS instances keep identity transforms, the vertices are already in world space.
+		*/
+		void createBlases()
+		{
+			if (!m_rayTracing) return;
+			VkBufferDeviceAddressInfo addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+			addressInfo.buffer = m_indexBuffer;
+			VkDeviceAddress indexAddress = vkd.vkGetBufferDeviceAddress(m_device, &addressInfo);
+			for (uint32_t character = 0; character < m_vertexBlending.getMeshCount(); character++)
+			{
+				uint32_t geometry = m_vertexBlending.getMeshGeometry(character);
+				BlasTriangleGeometry triangles{};
+				triangles.vertexAddress = m_vertexBlending.getOutputAddress(character);
+				triangles.vertexStride = sizeof(BlendedVertex);
+				triangles.maxVertex = m_vertexBlending.getMesh(character).vertexCount - 1;
+				triangles.indexAddress = indexAddress + m_firstIndices[geometry] * sizeof(uint32_t);
+				triangles.triangleCount = m_indexCounts[geometry] / 3;
+				BlasDesc desc{};
+				desc.name = "Character " + std::to_string(character);
+				desc.geometries.push_back(triangles);
+				desc.allowUpdate = true;
+				m_blases.push_back(m_accelerationStructures.addBlas(desc));
+
+				TlasInstance instance{};
+				instance.blas = m_blases.back();
+				instance.customIndex = character;
+				m_tlasInstances.push_back(instance);
+			}
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared by the render pass.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* Registered with the hot reloader, the layouts come from reflection through the pipeline layout cache
+		*/
+		void createPipelines()
+		{
+			m_vertexBlending.createPipeline(m_shaderHotReloader, m_pipelineLayoutCache, getShaderDirectory("core"), m_maxFrameInFlight);
+			m_drawPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/character.vert", m_shaderDirectory + "/character.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildDrawPipeline(spirvStages, pipelineCache);
+				});
+		}
+
+		VkPipeline buildDrawPipeline(const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+		{
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			m_drawLayout = m_pipelineLayoutCache.getPipelineLayout(
+				{ ShaderReflectionUtil::reflect(spirvStages[0]), ShaderReflectionUtil::reflect(spirvStages[1]) }, &setLayouts);
+			m_drawSetLayout = setLayouts[0];
+
+			VkPipelineShaderStageCreateInfo stages[2]{};
+			const VkShaderStageFlagBits stageFlags[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+			for (uint32_t stage = 0; stage < 2; stage++)
+			{
+				stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				stages[stage].stage = stageFlags[stage];
+				stages[stage].module = createShaderModule(spirvStages[stage]);
+				stages[stage].pName = "main";
+			}
+
+			// The blended vertices, tightly packed positions and normals
+			VkVertexInputBindingDescription binding{ 0, sizeof(BlendedVertex), VK_VERTEX_INPUT_RATE_VERTEX };
+			VkVertexInputAttributeDescription attributes[2] = {
+				{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(BlendedVertex, position) },
+				{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(BlendedVertex, normal) } };
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInput.vertexBindingDescriptionCount = 1;
+			vertexInput.pVertexBindingDescriptions = &binding;
+			vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(attributes));
+			vertexInput.pVertexAttributeDescriptions = attributes;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+			VkPipelineViewportStateCreateInfo viewportState{};
+			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			// The tubes are open at both ends, their insides are visible
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+			rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterization.cullMode = VK_CULL_MODE_NONE;
+			rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterization.lineWidth = 1.0f;
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+			VkPipelineColorBlendAttachmentState blendAttachment{};
+			blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &blendAttachment;
+
+			VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
+
+			VkGraphicsPipelineCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.stageCount = 2;
+			createInfo.pStages = stages;
+			createInfo.pVertexInputState = &vertexInput;
+			createInfo.pInputAssemblyState = &inputAssembly;
+			createInfo.pViewportState = &viewportState;
+			createInfo.pRasterizationState = &rasterization;
+			createInfo.pMultisampleState = &multisample;
+			createInfo.pDepthStencilState = &depthStencil;
+			createInfo.pColorBlendState = &colorBlend;
+			createInfo.pDynamicState = &dynamicState;
+			createInfo.layout = m_drawLayout;
+			createInfo.renderPass = m_renderPass;
+			createInfo.subpass = 0;
+			VkPipeline pipeline;
+			VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+			for (VkPipelineShaderStageCreateInfo& stage : stages) vkd.vkDestroyShaderModule(m_device, stage.module, m_defaultAllocator);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create character pipeline!");
+			}
+			return pipeline;
+		}
+
+		/*
+		* A draw descriptor set per frame in flight, the blending stage allocates its own
+		*/
+		void createFrameResources()
+		{
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = frameCount;
+			poolInfo.poolSizeCount = 1;
+			poolInfo.pPoolSizes = &poolSize;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			m_frames.resize(frameCount);
+			for (FrameResources& frame : m_frames)
+			{
+				VkDescriptorSetAllocateInfo allocateInfo{};
+				allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+				allocateInfo.descriptorPool = m_descriptorPool;
+				allocateInfo.descriptorSetCount = 1;
+				allocateInfo.pSetLayouts = &m_drawSetLayout;
+				if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, &frame.drawSet) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate descriptor sets!");
+				}
+			}
+		}
+
+		void recordBlending(VkCommandBuffer commandBuffer)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Blend Vertices");
+			m_vertexBlending.dispatch(commandBuffer, m_currentFrameIndex);
+		}
+
+		/*
+		* One draw per character over its range of the blended vertices, the first instance tells the shaders which character
+		*/
+		void recordDraws(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Characters");
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Characters");
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_drawPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawLayout, 0, 1, &m_frames[m_currentFrameIndex].drawSet, 0, nullptr);
+			VkBuffer vertexBuffer = m_vertexBlending.getBuffer(VertexBlendingBuffer::Output);
+			VkDeviceSize offset = 0;
+			vkd.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+			vkd.vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			for (uint32_t character = 0; character < m_vertexBlending.getMeshCount(); character++)
+			{
+				uint32_t geometry = m_vertexBlending.getMeshGeometry(character);
+				vkd.vkCmdDrawIndexed(commandBuffer, m_indexCounts[geometry], 1, m_firstIndices[geometry],
+					static_cast<int32_t>(m_vertexBlending.getMesh(character).firstOutputVertex), character);
+			}
+
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+	private:
+		SkinningSettings				m_settings{};
+		bool							m_rayTracing{ false };
+
+		// Geometries and characters in the vertex blending stage, the index ranges of the geometries in m_indexBuffer
+		VertexBlending					m_vertexBlending{};
+		std::vector<CharacterMotion>	m_motions{};
+		std::vector<uint32_t>			m_indices{};
+		std::vector<uint32_t>			m_firstIndices{};
+		std::vector<uint32_t>			m_indexCounts{};
+		VkBuffer						m_indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_indexMemory{ VK_NULL_HANDLE };
+		uint32_t						m_gridSide{ 1 };
+		uint64_t						m_animatedFrames{ 0 };
+		double							m_animationSeconds{ 0.0 };
+
+		// A deforming BLAS per character, owned by the acceleration structure builder of the base
+		std::vector<BlasHandle>			m_blases{};
+		std::vector<TlasInstance>		m_tlasInstances{};
+
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+
+		// Hot reloader pipeline ids and their layouts from the pipeline layout cache
+		uint32_t						m_drawPipeline{ 0 };
+		VkPipelineLayout				m_drawLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_drawSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<FrameResources>		m_frames{};
+	};
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	SkinningSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--characters" && i + 1 < argc) settings.characterCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--no-ray-tracing") settings.rayTracing = false;
+	}
+
+	GpuSkinningExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
@@ -0,0 +1,717 @@
+#include "vulkan_example_base.h"
+#include "vulkan_instance_store.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* Instanced crowd: a million agents drawn by one instanced vkCmdDrawIndexed. The per instance data lives in an InstanceStore,
+* one device local stream each for transforms, material IDs and flags, bound as separate instance rate vertex buffers.
+* Every frame one group of agents walks, a few agents change material and a few toggle their highlight flag, and only the
+* dirty pages of the touched streams are staged through the upload ring, instead of the whole array of instance structs.
+*
+*   instanced_crowd [--instances <n>] [--moving <n>] [--full-upload] [common options]
+*
+* --moving sets the agents moved per frame, 1% of the crowd by default. --full-upload re-uploads every stream in full each
+* frame for comparison, the cost of an array of structures instance buffer. Upload volume, copy regions and the CPU time
+* spent updating and staging the instances are printed on exit, counted from the end of the initial upload, which is spread
+* over the first frames. The camera follows a fixed path driven by the frame number so headless runs are reproducible.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr float AGENT_SPACING = 2.0f;
+		constexpr uint32_t MATERIAL_COUNT = 8;					// Palette size of crowd.frag
+		constexpr uint32_t FLAG_VISIBLE = 1;
+		constexpr uint32_t FLAG_HIGHLIGHTED = 2;
+		constexpr uint32_t RANDOM_CHANGES_PER_FRAME = 32;		// Material and flag changes of scattered agents
+		constexpr VkDeviceSize MIN_UPLOAD_RING_SIZE = 16ull << 20;
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		// Rotation about y by the heading, then translation
+		InstanceTransform agentTransform(float x, float z, float heading)
+		{
+			float c = std::cos(heading);
+			float s = std::sin(heading);
+			InstanceTransform transform{};
+			transform.rows[0][0] = c;		transform.rows[0][2] = s;		transform.rows[0][3] = x;
+			transform.rows[2][0] = -s;		transform.rows[2][2] = c;		transform.rows[2][3] = z;
+			return transform;
+		}
+
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+		};
+
+		// std140 FrameData block of crowd.vert and crowd.frag
+		struct FrameData
+		{
+			Mat4	viewProjection{};
+			float	lightDirection[4]{};
+		};
+	}
+
+	struct CrowdSettings
+	{
+		uint32_t	instanceCount{ 1000000 };
+		uint32_t	movingCount{ 0 };			// Agents moved per frame, 0 moves 1% of the crowd
+		bool		fullUpload{ false };		// Re-upload every stream in full each frame
+	};
+
+	class InstancedCrowdExample : public ExampleBase
+	{
+	public:
+		explicit InstancedCrowdExample(const CrowdSettings& settings) : m_settings(settings)
+		{
+			m_title = "Instanced Crowd";
+			m_shaderDirectory = getShaderDirectory("instanced_crowd");
+			if (m_settings.movingCount == 0) m_settings.movingCount = std::max(1u, m_settings.instanceCount / 100);
+			m_settings.movingCount = std::min(m_settings.movingCount, m_settings.instanceCount);
+
+			// The initial upload is spread over the first frames when the crowd does not fit one frame region
+			VkDeviceSize instanceSize = sizeof(InstanceTransform) + 2 * sizeof(uint32_t);
+			VkDeviceSize frameUpload = m_settings.fullUpload ? m_settings.instanceCount * instanceSize :
+				2 * (m_settings.movingCount + InstanceStore::PAGE_SIZE * RANDOM_CHANGES_PER_FRAME) * sizeof(InstanceTransform);
+			m_uploadRingFrameSize = std::max({ m_uploadRingFrameSize, MIN_UPLOAD_RING_SIZE, frameUpload + (1 << 20) });
+		}
+
+		void printStatistics() const
+		{
+			const InstanceUploadStatistics& upload = m_instances.getStatistics();
+			double frames = std::max<uint64_t>(m_updatedFrames, 1);
+			double fullSize = double(m_instances.getCount()) * (sizeof(InstanceTransform) + 2 * sizeof(uint32_t));
+			std::cout << "\n=====Instanced Crowd=====";
+			std::cout << "\n" << std::setw(30) << std::left << "Mode" << (m_settings.fullUpload ? "Full upload" : "Dirty pages");
+			std::cout << "\n" << std::setw(30) << std::left << "Instances" << m_instances.getCount();
+			std::cout << "\n" << std::setw(30) << std::left << "Moving instances / frame" << m_settings.movingCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Frames" << m_updatedFrames;
+			std::cout << "\n" << std::setw(30) << std::left << "Uploaded KiB / frame" << std::fixed << std::setprecision(1) << upload.uploadedBytes / frames / 1024.0;
+			std::cout << "\n" << std::setw(30) << std::left << "Full instance data KiB" << fullSize / 1024.0;
+			std::cout << "\n" << std::setw(30) << std::left << "Uploaded pages / frame" << upload.uploadedPages / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Copy regions / frame" << upload.copyRegions / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Update + staging CPU (ms)" << std::setprecision(3) << m_updateSeconds * 1000.0 / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Upload ring peak (KiB)" << std::setprecision(1) << m_uploadRing.getPeakFrameUsage() / 1024.0;
+			std::cout << std::defaultfloat << std::endl;
+		}
+
+	protected:
+		void createResources() override
+		{
+			createAgentMesh();
+			createCrowd();
+			uploadMesh();
+			createRenderPass();
+			createPipeline();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			m_instances.cleanup();
+			destroyBuffer(m_vertexBuffer, m_vertexMemory);
+			destroyBuffer(m_indexBuffer, m_indexMemory);
+			m_frameSets.clear();
+			m_renderPass = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Walk one group of agents and change a few scattered ones, the store records the dirty pages, the frame uniforms
+		* go to the upload ring
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureDepthTarget(m_targets, extent);
+
+			float time = 0.016f * static_cast<float>(m_frameCounter);
+			float fieldSize = m_gridSide * AGENT_SPACING;
+			float angle = 0.05f * time;
+			Vec3 eye{ 0.45f * fieldSize * std::cos(angle), 0.2f * fieldSize, 0.45f * fieldSize * std::sin(angle) };
+			Mat4 view = lookAt(eye, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+			RingBufferAllocation frameAllocation = m_uploadRing.allocate(sizeof(FrameData));
+			FrameData* data = static_cast<FrameData*>(frameAllocation.pData);
+			data->viewProjection = perspective(1.0f, float(extent.width) / float(extent.height), 1.0f, 2.0f * fieldSize) * view;
+			Vec3 light = normalize({ -0.4f, -1.0f, -0.3f });
+			data->lightDirection[0] = light.x;
+			data->lightDirection[1] = light.y;
+			data->lightDirection[2] = light.z;
+
+			VkDescriptorBufferInfo uniformInfo{ frameAllocation.buffer, frameAllocation.offset, frameAllocation.size };
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = m_frameSets[frameIndex];
+			write.dstBinding = 0;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			write.pBufferInfo = &uniformInfo;
+			vkd.vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+			// Statistics cover the steady state, from the frame after the initial upload has completed
+			if (!m_initialUploadDone && !m_instances.hasDirtyPages())
+			{
+				m_instances.resetStatistics();
+				m_updatedFrames = 0;
+				m_updateSeconds = 0.0;
+				m_initialUploadDone = true;
+			}
+
+			auto begin = std::chrono::steady_clock::now();
+			moveAgents();
+			m_updateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test is waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+			// Uploads wait for the previous frame's vertex input reads
+			RenderGraphResourceState streamState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT };
+			RenderGraphResource transforms = m_renderGraph.importBuffer("Instance Transforms", m_instances.getBuffer(InstanceStream::Transform),
+				VK_WHOLE_SIZE, streamState, streamState);
+			RenderGraphResource materials = m_renderGraph.importBuffer("Instance Materials", m_instances.getBuffer(InstanceStream::Material),
+				VK_WHOLE_SIZE, streamState, streamState);
+			RenderGraphResource flags = m_renderGraph.importBuffer("Instance Flags", m_instances.getBuffer(InstanceStream::Flags),
+				VK_WHOLE_SIZE, streamState, streamState);
+
+			if (m_instances.hasDirtyPages())
+			{
+				m_renderGraph.addPass("Upload Instances", RenderGraphPassType::Compute,
+					[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+					{
+						GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Upload Instances");
+						auto begin = std::chrono::steady_clock::now();
+						m_instances.upload(commandBuffer, m_uploadRing);
+						m_updateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+					})
+					.write(transforms, RenderGraphUsage::TransferWrite)
+					.write(materials, RenderGraphUsage::TransferWrite)
+					.write(flags, RenderGraphUsage::TransferWrite);
+			}
+
+			m_renderGraph.addPass("Draw Crowd", RenderGraphPassType::Raster,
+				[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordDraw(commandBuffer, target); })
+				.read(transforms, RenderGraphUsage::VertexRead)
+				.read(materials, RenderGraphUsage::VertexRead)
+				.read(flags, RenderGraphUsage::VertexRead)
+				.write(color, RenderGraphUsage::ColorAttachment)
+				.write(depth, RenderGraphUsage::DepthStencilAttachment);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+		}
+
+	private:
+		/*
+		* Two boxes, a body and a head, counter clockwise seen from outside
+		*/
+		void createAgentMesh()
+		{
+			auto addBox = [this](Vec3 minimum, Vec3 maximum)
+			{
+				const Vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+				for (const Vec3& normal : normals)
+				{
+					// Two axes spanning the face, u x v is the normal so the corners below run counter clockwise
+					Vec3 u = std::abs(normal.y) > 0.5f ? Vec3{ 0, 0, 1 } : Vec3{ 0, 1, 0 };
+					Vec3 v = cross(normal, u);
+					Vec3 center{ (minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f };
+					Vec3 half{ (maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f };
+					auto corner = [&](float su, float sv)
+					{
+						return Vec3{ center.x + normal.x * half.x + (su * u.x + sv * v.x) * half.x,
+							center.y + normal.y * half.y + (su * u.y + sv * v.y) * half.y,
+							center.z + normal.z * half.z + (su * u.z + sv * v.z) * half.z };
+					};
+					uint32_t base = static_cast<uint32_t>(m_vertices.size());
+					const float signs[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+					for (const auto& sign : signs)
+					{
+						Vec3 position = corner(sign[0], sign[1]);
+						m_vertices.push_back({ { position.x, position.y, position.z }, { normal.x, normal.y, normal.z } });
+					}
+					m_indices.insert(m_indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+				}
+			};
+			m_vertices.clear();
+			m_indices.clear();
+			addBox({ -0.3f, 0.0f, -0.2f }, { 0.3f, 1.3f, 0.2f });
+			addBox({ -0.15f, 1.35f, -0.15f }, { 0.15f, 1.7f, 0.15f });
+		}
+
+		/*
+		* Agents on a square grid centered on the origin, from a fixed seed
+		*/
+		void createCrowd()
+		{
+			m_instances.init(m_physicalDevice, m_device, m_settings.instanceCount, m_defaultAllocator);
+			m_gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(double(m_settings.instanceCount))));
+			float halfField = 0.5f * m_gridSide * AGENT_SPACING;
+			std::mt19937 random(77);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			m_headings.resize(m_settings.instanceCount);
+			for (uint32_t index = 0; index < m_settings.instanceCount; index++)
+			{
+				float x = (index % m_gridSide + 0.5f) * AGENT_SPACING - halfField;
+				float z = (index / m_gridSide + 0.5f) * AGENT_SPACING - halfField;
+				m_headings[index] = 6.2831853f * unit(random);
+				m_instances.add(agentTransform(x, z, m_headings[index]), random() % MATERIAL_COUNT, FLAG_VISIBLE);
+			}
+		}
+
+		/*
+		* A contiguous group walks a step, groups take turns so the whole crowd moves over time. Scattered agents change
+		* material or toggle their highlight, only dirtying single pages of the material and flag streams.
+		*/
+		void moveAgents()
+		{
+			uint32_t count = m_instances.getCount();
+			float halfField = 0.5f * m_gridSide * AGENT_SPACING;
+			const float step = 0.05f * float(count) / float(m_settings.movingCount);	// Every agent covers the same distance per crowd cycle
+			for (uint32_t moved = 0; moved < m_settings.movingCount; moved++)
+			{
+				uint32_t index = (m_moveCursor + moved) % count;
+				const InstanceTransform& current = m_instances.getTransform(index);
+				float heading = m_headings[index] + 0.02f;
+				float x = current.rows[0][3] + step * std::sin(heading);
+				float z = current.rows[2][3] + step * std::cos(heading);
+				// Wrap around the field
+				if (x > halfField) x -= 2.0f * halfField;
+				if (x < -halfField) x += 2.0f * halfField;
+				if (z > halfField) z -= 2.0f * halfField;
+				if (z < -halfField) z += 2.0f * halfField;
+				m_headings[index] = heading;
+				m_instances.setTransform(index, agentTransform(x, z, heading));
+			}
+			m_moveCursor = (m_moveCursor + m_settings.movingCount) % count;
+
+			for (uint32_t change = 0; change < RANDOM_CHANGES_PER_FRAME; change++)
+			{
+				uint32_t index = m_random() % count;
+				if (change % 2 == 0) m_instances.setMaterial(index, (m_instances.getMaterial(index) + 1) % MATERIAL_COUNT);
+				else m_instances.setFlags(index, m_instances.getFlags(index) ^ FLAG_HIGHLIGHTED);
+			}
+
+			if (m_settings.fullUpload)
+			{
+				m_instances.invalidate(InstanceStream::Transform);
+				m_instances.invalidate(InstanceStream::Material);
+				m_instances.invalidate(InstanceStream::Flags);
+			}
+			m_updatedFrames++;
+		}
+
+		/*
+		* Copy the agent mesh into device local buffers once, through one staging buffer and a single submission
+		*/
+		void uploadMesh()
+		{
+			VkDeviceSize vertexSize = m_vertices.size() * sizeof(Vertex);
+			VkDeviceSize indexSize = m_indices.size() * sizeof(uint32_t);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexMemory, m_defaultAllocator);
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexMemory, m_defaultAllocator);
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, vertexSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			uint8_t* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&staging));
+			std::memcpy(staging, m_vertices.data(), vertexSize);
+			std::memcpy(staging + vertexSize, m_indices.data(), indexSize);
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			VkBufferCopy vertexRegion{ 0, 0, vertexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_vertexBuffer, 1, &vertexRegion);
+			VkBufferCopy indexRegion{ vertexSize, 0, indexSize };
+			vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_indexBuffer, 1, &indexRegion);
+			// The mesh buffers are never written again, this makes them visible to every later frame
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared by the render pass.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* Registered with the hot reloader, the layout comes from reflection through the pipeline layout cache.
+		* Binding 0 is the agent mesh, bindings 1 to 3 are the instance streams at instance rate.
+		*/
+		void createPipeline()
+		{
+			m_crowdPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/crowd.vert", m_shaderDirectory + "/crowd.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					std::vector<VkDescriptorSetLayout> setLayouts;
+					m_crowdLayout = m_pipelineLayoutCache.getPipelineLayout(
+						{ ShaderReflectionUtil::reflect(spirvStages[0]), ShaderReflectionUtil::reflect(spirvStages[1]) }, &setLayouts);
+					m_frameSetLayout = setLayouts[0];
+
+					VkPipelineShaderStageCreateInfo stages[2]{};
+					const VkShaderStageFlagBits stageFlags[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+					for (uint32_t stage = 0; stage < 2; stage++)
+					{
+						stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+						stages[stage].stage = stageFlags[stage];
+						stages[stage].module = createShaderModule(spirvStages[stage]);
+						stages[stage].pName = "main";
+					}
+
+					VkVertexInputBindingDescription bindings[4] = {
+						{ 0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX },
+						{ 1, m_instances.getElementSize(InstanceStream::Transform), VK_VERTEX_INPUT_RATE_INSTANCE },
+						{ 2, m_instances.getElementSize(InstanceStream::Material), VK_VERTEX_INPUT_RATE_INSTANCE },
+						{ 3, m_instances.getElementSize(InstanceStream::Flags), VK_VERTEX_INPUT_RATE_INSTANCE } };
+					VkVertexInputAttributeDescription attributes[7] = {
+						{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) },
+						{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) },
+						{ 2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0 },
+						{ 3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 16 },
+						{ 4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 32 },
+						{ 5, 2, VK_FORMAT_R32_UINT, 0 },
+						{ 6, 3, VK_FORMAT_R32_UINT, 0 } };
+					VkPipelineVertexInputStateCreateInfo vertexInput{};
+					vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+					vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(std::size(bindings));
+					vertexInput.pVertexBindingDescriptions = bindings;
+					vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(attributes));
+					vertexInput.pVertexAttributeDescriptions = attributes;
+
+					VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+					inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+					inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+					VkPipelineViewportStateCreateInfo viewportState{};
+					viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+					viewportState.viewportCount = 1;
+					viewportState.scissorCount = 1;
+
+					// The projection flips y, counter clockwise faces stay counter clockwise in framebuffer space
+					VkPipelineRasterizationStateCreateInfo rasterization{};
+					rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+					rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+					rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+					rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+					rasterization.lineWidth = 1.0f;
+
+					VkPipelineMultisampleStateCreateInfo multisample{};
+					multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+					multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+					VkPipelineDepthStencilStateCreateInfo depthStencil{};
+					depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+					depthStencil.depthTestEnable = VK_TRUE;
+					depthStencil.depthWriteEnable = VK_TRUE;
+					depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+					VkPipelineColorBlendAttachmentState blendAttachment{};
+					blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+					VkPipelineColorBlendStateCreateInfo colorBlend{};
+					colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+					colorBlend.attachmentCount = 1;
+					colorBlend.pAttachments = &blendAttachment;
+
+					VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+					VkPipelineDynamicStateCreateInfo dynamicState{};
+					dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+					dynamicState.dynamicStateCount = 2;
+					dynamicState.pDynamicStates = dynamicStates;
+
+					VkGraphicsPipelineCreateInfo createInfo{};
+					createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+					createInfo.stageCount = 2;
+					createInfo.pStages = stages;
+					createInfo.pVertexInputState = &vertexInput;
+					createInfo.pInputAssemblyState = &inputAssembly;
+					createInfo.pViewportState = &viewportState;
+					createInfo.pRasterizationState = &rasterization;
+					createInfo.pMultisampleState = &multisample;
+					createInfo.pDepthStencilState = &depthStencil;
+					createInfo.pColorBlendState = &colorBlend;
+					createInfo.pDynamicState = &dynamicState;
+					createInfo.layout = m_crowdLayout;
+					createInfo.renderPass = m_renderPass;
+					createInfo.subpass = 0;
+					VkPipeline pipeline;
+					VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+					for (VkPipelineShaderStageCreateInfo& stage : stages) vkd.vkDestroyShaderModule(m_device, stage.module, m_defaultAllocator);
+					if (result != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create crowd pipeline!");
+					}
+					return pipeline;
+				});
+		}
+
+		/*
+		* One descriptor set per frame in flight, pointed at the frame uniforms in the upload ring by updateFrameData
+		*/
+		void createFrameResources()
+		{
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = frameCount;
+			poolInfo.poolSizeCount = 1;
+			poolInfo.pPoolSizes = &poolSize;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			std::vector<VkDescriptorSetLayout> layouts(frameCount, m_frameSetLayout);
+			m_frameSets.resize(frameCount);
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = m_descriptorPool;
+			allocateInfo.descriptorSetCount = frameCount;
+			allocateInfo.pSetLayouts = layouts.data();
+			if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, m_frameSets.data()) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor sets!");
+			}
+		}
+
+		/*
+		* The whole crowd in one instanced draw, the mesh and the three instance streams bound side by side
+		*/
+		void recordDraw(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Crowd");
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Crowd");
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_crowdPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_crowdLayout, 0, 1, &m_frameSets[m_currentFrameIndex], 0, nullptr);
+			VkBuffer vertexBuffers[4] = { m_vertexBuffer, m_instances.getBuffer(InstanceStream::Transform),
+				m_instances.getBuffer(InstanceStream::Material), m_instances.getBuffer(InstanceStream::Flags) };
+			VkDeviceSize offsets[4]{};
+			vkd.vkCmdBindVertexBuffers(commandBuffer, 0, 4, vertexBuffers, offsets);
+			vkd.vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			vkd.vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_indices.size()), m_instances.getCount(), 0, 0, 0);
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+	private:
+		CrowdSettings					m_settings{};
+
+		// Agent mesh, shared by all instances
+		std::vector<Vertex>				m_vertices{};
+		std::vector<uint32_t>			m_indices{};
+		VkBuffer						m_vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_indexMemory{ VK_NULL_HANDLE };
+
+		// Per instance streams and the simulation state kept next to them
+		InstanceStore					m_instances{};
+		std::vector<float>				m_headings{};
+		uint32_t						m_gridSide{ 1 };
+		uint32_t						m_moveCursor{ 0 };
+		std::mt19937					m_random{ 5 };
+		uint64_t						m_updatedFrames{ 0 };
+		bool							m_initialUploadDone{ false };
+		double							m_updateSeconds{ 0.0 };
+
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+
+		uint32_t						m_crowdPipeline{ 0 };
+		VkPipelineLayout				m_crowdLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_frameSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<VkDescriptorSet>	m_frameSets{};
+	};
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	CrowdSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--instances" && i + 1 < argc) settings.instanceCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--moving" && i + 1 < argc) settings.movingCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (argument == "--full-upload") settings.fullUpload = true;
+	}
+
+	InstancedCrowdExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
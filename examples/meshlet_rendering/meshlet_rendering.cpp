@@ -0,0 +1,1014 @@
+#include "vulkan_example_base.h"
+#include "vulkan_meshlet.h"
+#include "vulkan_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+* Meshlet rendering: a dense part is split into meshlets of at most 64 vertices and 124 triangles, each with a bounding
+* sphere and a cone holding the normals of its triangles. Every frame each meshlet of every instance is culled against
+* the view frustum and, when all its triangles face away from the camera, against its cone, only the surviving
+* clusters are rasterized.
+*
+*   meshlet_rendering [--instances <n>] [--vertex-path] [--no-cone-culling] [--no-frustum-culling]
+*                     [--meshlet-cache <file>] [common options]
+*
+* With VK_NV_mesh_shader the task shader culls 32 meshlets per workgroup and launches one mesh shader workgroup per
+* survivor. Without it, or with --vertex-path, a compute pass culls the same meshlets and appends one non indexed draw
+* per survivor, which the vertex shader expands from the same meshlet buffers, drawn by a single vkCmdDrawIndirectCount.
+* --meshlet-cache reads the meshlets from a file written by an earlier run with the same mesh and writes it otherwise,
+* so the preprocessing runs once. Culling counters are printed on exit, the camera follows a fixed path driven by the
+* frame number so headless runs are reproducible, for example meshlet_rendering --headless --frames 1000.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		constexpr uint32_t TASK_WORKGROUP_SIZE = 32;		// local_size_x of meshlet.task, meshlets culled per task workgroup
+		constexpr uint32_t CULL_WORKGROUP_SIZE = 64;		// local_size_x of meshlet_cull.comp
+		constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		constexpr VkImageUsageFlags DEPTH_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		constexpr float GRID_SPACING = 4.5f;
+
+		struct Vec3
+		{
+			float x{ 0.0f };
+			float y{ 0.0f };
+			float z{ 0.0f };
+		};
+
+		Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+		Vec3 normalize(const Vec3& v)
+		{
+			float length = std::sqrt(dot(v, v));
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		// Column major like GLSL, element (row, column) is m[column * 4 + row]
+		struct Mat4
+		{
+			float m[16]{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		};
+
+		Mat4 operator*(const Mat4& a, const Mat4& b)
+		{
+			Mat4 result{};
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float sum = 0.0f;
+					for (int k = 0; k < 4; k++) sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+					result.m[column * 4 + row] = sum;
+				}
+			}
+			return result;
+		}
+
+		// Right handed view space, Vulkan clip space with y pointing down and depth in [0, 1]
+		Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+		{
+			float focal = 1.0f / std::tan(fovY * 0.5f);
+			Mat4 result{};
+			result.m[0] = focal / aspect;
+			result.m[5] = -focal;
+			result.m[10] = farPlane / (nearPlane - farPlane);
+			result.m[11] = -1.0f;
+			result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+			result.m[15] = 0.0f;
+			return result;
+		}
+
+		Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+		{
+			Vec3 forward = normalize(center - eye);
+			Vec3 side = normalize(cross(forward, up));
+			Vec3 upward = cross(side, forward);
+			Mat4 result{};
+			result.m[0] = side.x;		result.m[4] = side.y;		result.m[8] = side.z;		result.m[12] = -dot(side, eye);
+			result.m[1] = upward.x;		result.m[5] = upward.y;		result.m[9] = upward.z;		result.m[13] = -dot(upward, eye);
+			result.m[2] = -forward.x;	result.m[6] = -forward.y;	result.m[10] = -forward.z;	result.m[14] = dot(forward, eye);
+			return result;
+		}
+
+		// Read by the shaders as six floats, the meshlets index into it
+		struct Vertex
+		{
+			float position[3];
+			float normal[3];
+		};
+
+		// std430 layout of the shaders, model is rotation and uniform scale so bounds and cones transform with it
+		struct Instance
+		{
+			Mat4		model{};
+			float		color[4]{};
+			float		scale{ 1.0f };
+			uint32_t	padding[3]{};
+		};
+		static_assert(sizeof(Instance) == 96, "Instance must match the std430 layout of the shaders");
+		static_assert(sizeof(Meshlet) == 16 && sizeof(MeshletBounds) == 48, "Meshlet data must match the std430 layout of the shaders");
+
+		// std140 FrameData block shared by all shaders
+		struct FrameData
+		{
+			Mat4		viewProjection{};
+			float		frustumPlanes[6][4]{};
+			float		cameraPosition[4]{};
+			float		lightDirection[4]{};
+			uint32_t	meshletCount{ 0 };
+			uint32_t	instanceCount{ 0 };
+			uint32_t	coneCulling{ 0 };
+			uint32_t	frustumCulling{ 0 };
+		};
+
+		// Written by the task shader or the culling pass, visibleMeshletCount is the draw count of the vertex path
+		struct MeshletCounters
+		{
+			uint32_t	visibleMeshletCount{ 0 };
+			uint32_t	frustumCulledCount{ 0 };
+			uint32_t	coneCulledCount{ 0 };
+			uint32_t	visibleTriangleCount{ 0 };
+		};
+
+		/*
+		* Planes of the frustum, normals point inside, from the rows of a view projection matrix with depth in [0, 1]
+		*/
+		void extractFrustumPlanes(const Mat4& viewProjection, float planes[6][4])
+		{
+			auto row = [&](int index, int column) { return viewProjection.m[column * 4 + index]; };
+			for (int column = 0; column < 4; column++)
+			{
+				planes[0][column] = row(3, column) + row(0, column);	// Left
+				planes[1][column] = row(3, column) - row(0, column);	// Right
+				planes[2][column] = row(3, column) + row(1, column);	// Top, clip space y points down
+				planes[3][column] = row(3, column) - row(1, column);	// Bottom
+				planes[4][column] = row(2, column);						// Near
+				planes[5][column] = row(3, column) - row(2, column);	// Far
+			}
+			for (int plane = 0; plane < 6; plane++)
+			{
+				float length = std::sqrt(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+				for (int component = 0; component < 4; component++) planes[plane][component] /= length;
+			}
+		}
+	}
+
+	struct MeshletSettings
+	{
+		uint32_t	instanceCount{ 64 };
+		bool		vertexPath{ false };		// Cull in compute and draw through the vertex pipeline even with mesh shaders
+		bool		coneCulling{ true };
+		bool		frustumCulling{ true };
+		std::string	meshletCachePath{};			// Empty to build the meshlets on every run
+	};
+
+	class MeshletRenderingExample : public ExampleBase
+	{
+	public:
+		explicit MeshletRenderingExample(const MeshletSettings& settings) : m_settings(settings)
+		{
+			m_title = "Meshlet Rendering";
+			m_shaderDirectory = getShaderDirectory("meshlet_rendering");
+		}
+
+		void printStatistics() const
+		{
+			double frames = std::max<uint64_t>(m_statistics.countedFrames, 1);
+			double meshletCount = std::max<size_t>(m_meshletMesh.meshlets.size(), 1);
+			std::cout << "\n=====Meshlet Rendering=====";
+			std::cout << "\n" << std::setw(30) << std::left << "Mode" << (m_useMeshShaders ? "Task and mesh shaders" : "Compute culling, vertex pipeline");
+			std::cout << "\n" << std::setw(30) << std::left << "Instances" << m_settings.instanceCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Triangles / instance" << m_indices.size() / 3;
+			std::cout << "\n" << std::setw(30) << std::left << "Meshlets / instance" << m_meshletMesh.meshlets.size();
+			std::cout << "\n" << std::setw(30) << std::left << "Vertices / meshlet" << std::fixed << std::setprecision(1)
+				<< m_meshletMesh.vertexIndices.size() / meshletCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Triangles / meshlet" << m_indices.size() / 3 / meshletCount;
+			std::cout << "\n" << std::setw(30) << std::left << "Meshlet preprocessing (ms)" << std::setprecision(3) << m_statistics.buildMilliseconds
+				<< (m_statistics.loadedFromCache ? " (cache)" : "");
+			std::cout << "\n" << std::setw(30) << std::left << "Counted frames" << m_statistics.countedFrames;
+			std::cout << "\n" << std::setw(30) << std::left << "Visible meshlets / frame" << std::setprecision(1) << m_statistics.visibleMeshlets / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Frustum culled / frame" << m_statistics.frustumCulled / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Cone culled / frame" << m_statistics.coneCulled / frames;
+			std::cout << "\n" << std::setw(30) << std::left << "Visible triangles / frame" << m_statistics.visibleTriangles / frames;
+			std::cout << std::defaultfloat << std::endl;
+		}
+
+	protected:
+		// The vertex path is the fallback when the optional mesh shader feature set is not available
+		void configureDeviceRequirements() override
+		{
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "multiDrawIndirect");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "drawIndirectFirstInstance");
+			addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "drawIndirectCount");
+		}
+
+		void createResources() override
+		{
+			m_useMeshShaders = !m_settings.vertexPath && isFeatureSetEnabled("MeshShader");
+			if (m_useMeshShaders)
+			{
+				VkPhysicalDeviceMeshShaderPropertiesNV meshShaderProperties{};
+				meshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_NV;
+				VkPhysicalDeviceProperties2 properties{};
+				properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+				properties.pNext = &meshShaderProperties;
+				vkd.vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+				m_maxDrawMeshTasksCount = std::max(1u, meshShaderProperties.maxDrawMeshTasksCount);
+			}
+			createScene();
+			buildMeshlets();
+			uploadScene();
+			createRenderPass();
+			createPipelines();
+			createFrameResources();
+		}
+
+		void destroyResources() override
+		{
+			destroySceneTargets(m_targets);
+			vkd.vkDestroyRenderPass(m_device, m_renderPass, m_defaultAllocator);
+			vkd.vkDestroyDescriptorPool(m_device, m_descriptorPool, m_defaultAllocator);
+			for (FrameResources& frame : m_frames)
+			{
+				destroyBuffer(frame.uniformBuffer, frame.uniformMemory);
+				destroyBuffer(frame.counterReadbackBuffer, frame.counterReadbackMemory);
+			}
+			m_frames.clear();
+			destroyBuffer(m_vertexBuffer, m_vertexMemory);
+			destroyBuffer(m_meshletBuffer, m_meshletMemory);
+			destroyBuffer(m_boundsBuffer, m_boundsMemory);
+			destroyBuffer(m_vertexIndexBuffer, m_vertexIndexMemory);
+			destroyBuffer(m_triangleIndexBuffer, m_triangleIndexMemory);
+			destroyBuffer(m_instanceBuffer, m_instanceMemory);
+			destroyBuffer(m_counterBuffer, m_counterMemory);
+			destroyBuffer(m_drawCommandBuffer, m_drawCommandMemory);
+			destroyBuffer(m_visibleClusterBuffer, m_visibleClusterMemory);
+			m_renderPass = VK_NULL_HANDLE;
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		/*
+		* Collect the counters this frame slot read back when it was last used, then set up the camera of the new frame
+		*/
+		void updateFrameData(uint32_t frameIndex) override
+		{
+			FrameResources& frame = m_frames[frameIndex];
+			if (frame.countersPending)
+			{
+				const MeshletCounters* counters = static_cast<const MeshletCounters*>(frame.counterReadbackData);
+				m_statistics.visibleMeshlets += counters->visibleMeshletCount;
+				m_statistics.frustumCulled += counters->frustumCulledCount;
+				m_statistics.coneCulled += counters->coneCulledCount;
+				m_statistics.visibleTriangles += counters->visibleTriangleCount;
+				m_statistics.countedFrames++;
+				frame.countersPending = false;
+			}
+
+			VkExtent2D extent = m_headless ? VkExtent2D{ m_windowWidth, m_windowHeight } : m_swapchain.getExtent();
+			ensureDepthTarget(m_targets, extent);
+
+			// Circle the grid from outside, looking down across it
+			float angle = 0.004f * static_cast<float>(m_frameCounter);
+			float radius = m_gridHalfExtent + 6.0f;
+			Vec3 eye{ radius * std::cos(angle), 0.4f * radius, radius * std::sin(angle) };
+			Mat4 viewProjection = perspective(1.0f, float(extent.width) / float(extent.height), 0.1f, 4.0f * radius) *
+				lookAt(eye, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+
+			FrameData data{};
+			data.viewProjection = viewProjection;
+			extractFrustumPlanes(viewProjection, data.frustumPlanes);
+			data.cameraPosition[0] = eye.x;
+			data.cameraPosition[1] = eye.y;
+			data.cameraPosition[2] = eye.z;
+			Vec3 light = normalize({ -0.4f, -1.0f, -0.3f });
+			data.lightDirection[0] = light.x;
+			data.lightDirection[1] = light.y;
+			data.lightDirection[2] = light.z;
+			data.meshletCount = static_cast<uint32_t>(m_meshletMesh.meshlets.size());
+			data.instanceCount = m_settings.instanceCount;
+			data.coneCulling = m_settings.coneCulling ? 1 : 0;
+			data.frustumCulling = m_settings.frustumCulling ? 1 : 0;
+			std::memcpy(frame.uniformData, &data, sizeof(FrameData));
+		}
+
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, const FrameTarget& target) override
+		{
+			ensureSceneFramebuffer(m_targets, m_renderPass, target);
+			FrameResources& frame = m_frames[m_currentFrameIndex];
+
+			RenderGraphResource color = importFrameTarget(target);
+			// Contents are discarded every frame, the previous frame's depth test is waited for
+			RenderGraphResource depth = m_renderGraph.importImage("Depth", m_targets.depthImage, m_targets.depthView, DEPTH_FORMAT, target.extent,
+				{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT }, {});
+			RenderGraphResourceState counterState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+			RenderGraphResource counters = m_renderGraph.importBuffer("Meshlet Counters", m_counterBuffer, sizeof(MeshletCounters), counterState, counterState);
+			RenderGraphResourceState hostState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT };
+			RenderGraphResource readback = m_renderGraph.importBuffer("Meshlet Counter Readback", frame.counterReadbackBuffer,
+				sizeof(MeshletCounters), hostState, hostState);
+
+			m_renderGraph.addPass("Reset Meshlet Counters", RenderGraphPassType::Compute,
+				[this](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					vkd.vkCmdFillBuffer(commandBuffer, m_counterBuffer, 0, sizeof(MeshletCounters), 0);
+				})
+				.write(counters, RenderGraphUsage::TransferWrite);
+
+			if (m_useMeshShaders)
+			{
+				// The task shader culls and counts, the render graph includes the task and mesh stages in raster passes
+				m_renderGraph.addPass("Draw Meshlets", RenderGraphPassType::Raster,
+					[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordMeshTasks(commandBuffer, target); })
+					.write(counters, RenderGraphUsage::StorageWrite)
+					.write(color, RenderGraphUsage::ColorAttachment)
+					.write(depth, RenderGraphUsage::DepthStencilAttachment);
+			}
+			else
+			{
+				RenderGraphResourceState indirectState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+				RenderGraphResource drawCommands = m_renderGraph.importBuffer("Meshlet Draw Commands", m_drawCommandBuffer,
+					VK_WHOLE_SIZE, indirectState, indirectState);
+				RenderGraphResourceState clusterState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+				RenderGraphResource clusters = m_renderGraph.importBuffer("Visible Clusters", m_visibleClusterBuffer,
+					VK_WHOLE_SIZE, clusterState, clusterState);
+
+				m_renderGraph.addPass("Cull Meshlets", RenderGraphPassType::Compute,
+					[this](VkCommandBuffer commandBuffer, const RenderGraph&) { recordCulling(commandBuffer); })
+					.write(drawCommands, RenderGraphUsage::StorageWrite)
+					.write(clusters, RenderGraphUsage::StorageWrite)
+					.write(counters, RenderGraphUsage::StorageWrite);
+
+				m_renderGraph.addPass("Draw Meshlets", RenderGraphPassType::Raster,
+					[this, target](VkCommandBuffer commandBuffer, const RenderGraph&) { recordIndirectDraws(commandBuffer, target); })
+					.read(drawCommands, RenderGraphUsage::IndirectRead)
+					.read(counters, RenderGraphUsage::IndirectRead)
+					.read(clusters, RenderGraphUsage::StorageRead)
+					.write(color, RenderGraphUsage::ColorAttachment)
+					.write(depth, RenderGraphUsage::DepthStencilAttachment);
+			}
+
+			m_renderGraph.addPass("Read Back Meshlet Counters", RenderGraphPassType::Compute,
+				[this, &frame](VkCommandBuffer commandBuffer, const RenderGraph&)
+				{
+					VkBufferCopy region{ 0, 0, sizeof(MeshletCounters) };
+					vkd.vkCmdCopyBuffer(commandBuffer, m_counterBuffer, frame.counterReadbackBuffer, 1, &region);
+				})
+				.read(counters, RenderGraphUsage::TransferRead)
+				.write(readback, RenderGraphUsage::TransferWrite);
+
+			m_renderGraph.compile();
+			m_renderGraph.execute(commandBuffer);
+			frame.countersPending = true;
+		}
+
+	private:
+		struct FrameResources
+		{
+			VkBuffer		uniformBuffer{ VK_NULL_HANDLE };
+			VkDeviceMemory	uniformMemory{ VK_NULL_HANDLE };
+			void*			uniformData{ nullptr };
+			VkBuffer		counterReadbackBuffer{ VK_NULL_HANDLE };
+			VkDeviceMemory	counterReadbackMemory{ VK_NULL_HANDLE };
+			void*			counterReadbackData{ nullptr };
+			bool			countersPending{ false };	// Counters of the last submission of the slot are read back
+			VkDescriptorSet	cullSet{ VK_NULL_HANDLE };	// Vertex path only
+			VkDescriptorSet	drawSet{ VK_NULL_HANDLE };
+		};
+
+		struct MeshletStatistics
+		{
+			uint64_t	countedFrames{ 0 };
+			uint64_t	visibleMeshlets{ 0 };
+			uint64_t	frustumCulled{ 0 };
+			uint64_t	coneCulled{ 0 };
+			uint64_t	visibleTriangles{ 0 };
+			double		buildMilliseconds{ 0.0 };
+			bool		loadedFromCache{ false };
+		};
+
+		/*
+		* A machined part: a plate with finely subdivided faces and hard edges carrying a dense torus, then a grid of
+		* instances with random rotations around y, uniform scales and colors from a fixed seed
+		*/
+		void createScene()
+		{
+			m_vertices.clear();
+			m_indices.clear();
+
+			// Plate, faces counter clockwise seen from outside, one vertex set per face keeps the edges hard
+			const uint32_t subdivisions = 48;
+			const float halfExtent[3] = { 1.6f, 0.15f, 1.6f };
+			const float faces[6][3][3] = {
+				{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } }, { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+				{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } }, { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+				{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 } } };
+			for (const auto& face : faces)
+			{
+				uint32_t base = static_cast<uint32_t>(m_vertices.size());
+				for (uint32_t row = 0; row <= subdivisions; row++)
+				{
+					for (uint32_t column = 0; column <= subdivisions; column++)
+					{
+						float u = 2.0f * column / subdivisions - 1.0f;
+						float v = 2.0f * row / subdivisions - 1.0f;
+						Vertex vertex{};
+						for (int axis = 0; axis < 3; axis++)
+						{
+							vertex.position[axis] = (face[0][axis] + u * face[1][axis] + v * face[2][axis]) * halfExtent[axis];
+							vertex.normal[axis] = face[0][axis];
+						}
+						m_vertices.push_back(vertex);
+					}
+				}
+				for (uint32_t row = 0; row < subdivisions; row++)
+				{
+					for (uint32_t column = 0; column < subdivisions; column++)
+					{
+						uint32_t current = base + row * (subdivisions + 1) + column;
+						uint32_t above = current + subdivisions + 1;
+						m_indices.insert(m_indices.end(), { current, current + 1, above + 1, current, above + 1, above });
+					}
+				}
+			}
+
+			// Torus lying on the plate, rings around the y axis
+			const uint32_t segments = 320;
+			const uint32_t sides = 160;
+			const float majorRadius = 1.0f;
+			const float minorRadius = 0.35f;
+			uint32_t base = static_cast<uint32_t>(m_vertices.size());
+			for (uint32_t segment = 0; segment <= segments; segment++)
+			{
+				float u = 2.0f * 3.14159265f * segment / segments;
+				for (uint32_t side = 0; side <= sides; side++)
+				{
+					float v = 2.0f * 3.14159265f * side / sides;
+					Vertex vertex{ { (majorRadius + minorRadius * std::cos(v)) * std::cos(u), halfExtent[1] + minorRadius + minorRadius * std::sin(v),
+						(majorRadius + minorRadius * std::cos(v)) * std::sin(u) },
+						{ std::cos(v) * std::cos(u), std::sin(v), std::cos(v) * std::sin(u) } };
+					m_vertices.push_back(vertex);
+				}
+			}
+			for (uint32_t segment = 0; segment < segments; segment++)
+			{
+				for (uint32_t side = 0; side < sides; side++)
+				{
+					uint32_t current = base + segment * (sides + 1) + side;
+					uint32_t next = current + sides + 1;
+					m_indices.insert(m_indices.end(), { current, current + 1, next + 1, current, next + 1, next });
+				}
+			}
+
+			uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(double(m_settings.instanceCount))));
+			m_gridHalfExtent = 0.5f * GRID_SPACING * gridSide;
+			std::mt19937 random(1234);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			m_instances.resize(m_settings.instanceCount);
+			for (uint32_t index = 0; index < m_settings.instanceCount; index++)
+			{
+				Instance& instance = m_instances[index];
+				float angle = 6.2831853f * unit(random);
+				instance.scale = 0.8f + 0.4f * unit(random);
+				for (int channel = 0; channel < 3; channel++) instance.color[channel] = 0.3f + 0.7f * unit(random);
+				instance.color[3] = 1.0f;
+
+				// Translation * rotation around y * uniform scale
+				Mat4& model = instance.model;
+				model.m[0] = std::cos(angle) * instance.scale;	model.m[2] = -std::sin(angle) * instance.scale;
+				model.m[5] = instance.scale;
+				model.m[8] = std::sin(angle) * instance.scale;	model.m[10] = std::cos(angle) * instance.scale;
+				model.m[12] = ((index % gridSide) + 0.5f) * GRID_SPACING - m_gridHalfExtent;
+				model.m[14] = ((index / gridSide) + 0.5f) * GRID_SPACING - m_gridHalfExtent;
+			}
+		}
+
+		/*
+		* Meshlets from the cache file when it was written for this mesh, built and written back otherwise
+		*/
+		void buildMeshlets()
+		{
+			auto begin = std::chrono::steady_clock::now();
+			const float* pPositions = m_vertices.front().position;
+			uint64_t sourceHash = MeshletBuilder::hashSource(pPositions, sizeof(Vertex), m_vertices.size(), m_indices.data(), m_indices.size());
+			m_statistics.loadedFromCache = !m_settings.meshletCachePath.empty() &&
+				MeshletBuilder::load(m_settings.meshletCachePath, sourceHash, m_meshletMesh);
+			if (!m_statistics.loadedFromCache)
+			{
+				m_meshletMesh = MeshletBuilder::build(pPositions, sizeof(Vertex), m_vertices.size(), m_indices.data(), m_indices.size());
+				if (!m_settings.meshletCachePath.empty()) MeshletBuilder::save(m_settings.meshletCachePath, m_meshletMesh);
+			}
+			m_statistics.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		/*
+		* Copy the mesh, its meshlets and the instances into device local buffers once, through one staging buffer and a
+		* single submission. The culling outputs of the vertex path hold one draw per meshlet of every instance
+		*/
+		void uploadScene()
+		{
+			struct Upload
+			{
+				VkBuffer*		pBuffer;
+				VkDeviceMemory*	pMemory;
+				const void*		pData;
+				VkDeviceSize	size;
+			};
+			const Upload uploads[] = {
+				{ &m_vertexBuffer, &m_vertexMemory, m_vertices.data(), m_vertices.size() * sizeof(Vertex) },
+				{ &m_meshletBuffer, &m_meshletMemory, m_meshletMesh.meshlets.data(), m_meshletMesh.meshlets.size() * sizeof(Meshlet) },
+				{ &m_boundsBuffer, &m_boundsMemory, m_meshletMesh.bounds.data(), m_meshletMesh.bounds.size() * sizeof(MeshletBounds) },
+				{ &m_vertexIndexBuffer, &m_vertexIndexMemory, m_meshletMesh.vertexIndices.data(), m_meshletMesh.vertexIndices.size() * sizeof(uint32_t) },
+				{ &m_triangleIndexBuffer, &m_triangleIndexMemory, m_meshletMesh.triangleIndices.data(), m_meshletMesh.triangleIndices.size() },
+				{ &m_instanceBuffer, &m_instanceMemory, m_instances.data(), m_instances.size() * sizeof(Instance) } };
+
+			VkDeviceSize stagingSize = 0;
+			for (const Upload& upload : uploads)
+			{
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, upload.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, *upload.pBuffer, *upload.pMemory, m_defaultAllocator);
+				stagingSize += upload.size;
+			}
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(MeshletCounters),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_counterBuffer, m_counterMemory, m_defaultAllocator);
+			if (!m_useMeshShaders)
+			{
+				VkDeviceSize clusterCount = VkDeviceSize(m_settings.instanceCount) * m_meshletMesh.meshlets.size();
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, clusterCount * sizeof(VkDrawIndirectCommand),
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_drawCommandBuffer, m_drawCommandMemory, m_defaultAllocator);
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, clusterCount * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_visibleClusterBuffer, m_visibleClusterMemory, m_defaultAllocator);
+			}
+
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingMemory;
+			VulkanUtil::createBuffer(m_physicalDevice, m_device, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory, m_defaultAllocator);
+			uint8_t* staging = nullptr;
+			vkd.vkMapMemory(m_device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&staging));
+			VkDeviceSize offset = 0;
+			for (const Upload& upload : uploads)
+			{
+				std::memcpy(staging + offset, upload.pData, upload.size);
+				offset += upload.size;
+			}
+
+			VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+			offset = 0;
+			for (const Upload& upload : uploads)
+			{
+				VkBufferCopy region{ offset, 0, upload.size };
+				vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, *upload.pBuffer, 1, &region);
+				offset += upload.size;
+			}
+			// The scene buffers are never written again, this makes them visible to every later frame
+			VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			if (m_useMeshShaders) shaderStages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_NV | VK_PIPELINE_STAGE_MESH_SHADER_BIT_NV;
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT };
+			vkd.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, shaderStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			endSingleTimeCommands(commandBuffer);
+			destroyBuffer(stagingBuffer, stagingMemory);
+		}
+
+		/*
+		* Color is loaded, the base class cleared it, depth is cleared and discarded.
+		* The render graph transitions both attachments, the render pass keeps their layouts
+		*/
+		void createRenderPass()
+		{
+			VkAttachmentDescription attachments[2]{};
+			attachments[0].format = m_headless ? m_offscreenFormat : m_swapchain.getFormat();
+			attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachments[1].format = DEPTH_FORMAT;
+			attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorReference;
+			subpass.pDepthStencilAttachment = &depthReference;
+
+			VkRenderPassCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			createInfo.attachmentCount = 2;
+			createInfo.pAttachments = attachments;
+			createInfo.subpassCount = 1;
+			createInfo.pSubpasses = &subpass;
+			if (vkd.vkCreateRenderPass(m_device, &createInfo, m_defaultAllocator, &m_renderPass) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render pass!");
+			}
+		}
+
+		/*
+		* Only the pipelines of the chosen path are registered with the hot reloader, layouts come from reflection through
+		* the pipeline layout cache
+		*/
+		void createPipelines()
+		{
+			if (m_useMeshShaders)
+			{
+				m_drawPipeline = m_shaderHotReloader.registerPipeline(
+					{ m_shaderDirectory + "/meshlet.task", m_shaderDirectory + "/meshlet.mesh", m_shaderDirectory + "/meshlet.frag" },
+					[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+					{
+						return buildDrawPipeline(spirvStages, { VK_SHADER_STAGE_TASK_BIT_NV, VK_SHADER_STAGE_MESH_BIT_NV, VK_SHADER_STAGE_FRAGMENT_BIT },
+							pipelineCache);
+					});
+				return;
+			}
+
+			m_cullPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/meshlet_cull.comp" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					std::vector<VkDescriptorSetLayout> setLayouts;
+					m_cullLayout = m_pipelineLayoutCache.getPipelineLayout({ ShaderReflectionUtil::reflect(spirvStages[0]) }, &setLayouts);
+					m_cullSetLayout = setLayouts[0];
+
+					VkShaderModule module = createShaderModule(spirvStages[0]);
+					VkComputePipelineCreateInfo createInfo{};
+					createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+					createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+					createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+					createInfo.stage.module = module;
+					createInfo.stage.pName = "main";
+					createInfo.layout = m_cullLayout;
+					VkPipeline pipeline;
+					VkResult result = vkd.vkCreateComputePipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+					vkd.vkDestroyShaderModule(m_device, module, m_defaultAllocator);
+					if (result != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to create meshlet culling pipeline!");
+					}
+					return pipeline;
+				});
+			m_drawPipeline = m_shaderHotReloader.registerPipeline({ m_shaderDirectory + "/meshlet.vert", m_shaderDirectory + "/meshlet.frag" },
+				[this](const std::vector<std::vector<uint32_t>>& spirvStages, VkPipelineCache pipelineCache)
+				{
+					return buildDrawPipeline(spirvStages, { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT }, pipelineCache);
+				});
+		}
+
+		/*
+		* Task, mesh and fragment stages, or vertex and fragment stages fetching from storage buffers. Neither takes vertex
+		* input, mesh shader pipelines ignore the vertex input and input assembly states
+		*/
+		VkPipeline buildDrawPipeline(const std::vector<std::vector<uint32_t>>& spirvStages, const std::vector<VkShaderStageFlagBits>& stageFlags,
+			VkPipelineCache pipelineCache)
+		{
+			std::vector<ShaderReflection> reflections;
+			for (const std::vector<uint32_t>& spirv : spirvStages) reflections.push_back(ShaderReflectionUtil::reflect(spirv));
+			std::vector<VkDescriptorSetLayout> setLayouts;
+			m_drawLayout = m_pipelineLayoutCache.getPipelineLayout(reflections, &setLayouts);
+			m_drawSetLayout = setLayouts[0];
+
+			std::vector<VkPipelineShaderStageCreateInfo> stages(spirvStages.size());
+			for (size_t stage = 0; stage < stages.size(); stage++)
+			{
+				stages[stage].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				stages[stage].stage = stageFlags[stage];
+				stages[stage].module = createShaderModule(spirvStages[stage]);
+				stages[stage].pName = "main";
+			}
+
+			VkPipelineVertexInputStateCreateInfo vertexInput{};
+			vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+			VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+			VkPipelineViewportStateCreateInfo viewportState{};
+			viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			// The projection flips y, counter clockwise faces stay counter clockwise in framebuffer space
+			VkPipelineRasterizationStateCreateInfo rasterization{};
+			rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+			rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterization.lineWidth = 1.0f;
+
+			VkPipelineMultisampleStateCreateInfo multisample{};
+			multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+			VkPipelineColorBlendAttachmentState blendAttachment{};
+			blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			VkPipelineColorBlendStateCreateInfo colorBlend{};
+			colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			colorBlend.attachmentCount = 1;
+			colorBlend.pAttachments = &blendAttachment;
+
+			VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicState.dynamicStateCount = 2;
+			dynamicState.pDynamicStates = dynamicStates;
+
+			VkGraphicsPipelineCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			createInfo.stageCount = static_cast<uint32_t>(stages.size());
+			createInfo.pStages = stages.data();
+			createInfo.pVertexInputState = m_useMeshShaders ? nullptr : &vertexInput;
+			createInfo.pInputAssemblyState = m_useMeshShaders ? nullptr : &inputAssembly;
+			createInfo.pViewportState = &viewportState;
+			createInfo.pRasterizationState = &rasterization;
+			createInfo.pMultisampleState = &multisample;
+			createInfo.pDepthStencilState = &depthStencil;
+			createInfo.pColorBlendState = &colorBlend;
+			createInfo.pDynamicState = &dynamicState;
+			createInfo.layout = m_drawLayout;
+			createInfo.renderPass = m_renderPass;
+			createInfo.subpass = 0;
+			VkPipeline pipeline;
+			VkResult result = vkd.vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &createInfo, m_defaultAllocator, &pipeline);
+			for (const VkPipelineShaderStageCreateInfo& stage : stages) vkd.vkDestroyShaderModule(m_device, stage.module, m_defaultAllocator);
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create meshlet pipeline!");
+			}
+			return pipeline;
+		}
+
+		/*
+		* Uniform buffers, counter readbacks and descriptor sets per frame in flight
+		*/
+		void createFrameResources()
+		{
+			uint32_t frameCount = m_maxFrameInFlight;
+			VkDescriptorPoolSize poolSizes[] = {
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * frameCount },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 14 * frameCount } };
+			VkDescriptorPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			poolInfo.maxSets = 2 * frameCount;
+			poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+			poolInfo.pPoolSizes = poolSizes;
+			if (vkd.vkCreateDescriptorPool(m_device, &poolInfo, m_defaultAllocator, &m_descriptorPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create descriptor pool!");
+			}
+
+			m_frames.resize(frameCount);
+			for (FrameResources& frame : m_frames)
+			{
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(FrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.uniformBuffer, frame.uniformMemory, m_defaultAllocator);
+				vkd.vkMapMemory(m_device, frame.uniformMemory, 0, VK_WHOLE_SIZE, 0, &frame.uniformData);
+				VulkanUtil::createBuffer(m_physicalDevice, m_device, sizeof(MeshletCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					frame.counterReadbackBuffer, frame.counterReadbackMemory, m_defaultAllocator);
+				vkd.vkMapMemory(m_device, frame.counterReadbackMemory, 0, VK_WHOLE_SIZE, 0, &frame.counterReadbackData);
+
+				// Bindings are shared by all shaders, each set only writes the ones its pipeline's shaders declare
+				VkDescriptorBufferInfo uniformInfo{ frame.uniformBuffer, 0, sizeof(FrameData) };
+				VkDescriptorBufferInfo instanceInfo{ m_instanceBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo meshletInfo{ m_meshletBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo boundsInfo{ m_boundsBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo vertexIndexInfo{ m_vertexIndexBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo triangleIndexInfo{ m_triangleIndexBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo vertexInfo{ m_vertexBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo counterInfo{ m_counterBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo drawCommandInfo{ m_drawCommandBuffer, 0, VK_WHOLE_SIZE };
+				VkDescriptorBufferInfo clusterInfo{ m_visibleClusterBuffer, 0, VK_WHOLE_SIZE };
+
+				frame.drawSet = allocateDescriptorSet(m_drawSetLayout);
+				std::vector<VkWriteDescriptorSet> writes = {
+					bufferWrite(frame.drawSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo),
+					bufferWrite(frame.drawSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instanceInfo),
+					bufferWrite(frame.drawSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshletInfo),
+					bufferWrite(frame.drawSet, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &vertexIndexInfo),
+					bufferWrite(frame.drawSet, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &triangleIndexInfo),
+					bufferWrite(frame.drawSet, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &vertexInfo) };
+				if (m_useMeshShaders)
+				{
+					writes.push_back(bufferWrite(frame.drawSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &boundsInfo));
+					writes.push_back(bufferWrite(frame.drawSet, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &counterInfo));
+				}
+				else
+				{
+					writes.push_back(bufferWrite(frame.drawSet, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &clusterInfo));
+					frame.cullSet = allocateDescriptorSet(m_cullSetLayout);
+					writes.push_back(bufferWrite(frame.cullSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &uniformInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &instanceInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &meshletInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &boundsInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &counterInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &drawCommandInfo));
+					writes.push_back(bufferWrite(frame.cullSet, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &clusterInfo));
+				}
+				vkd.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			}
+		}
+
+		void beginScenePass(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			VkImageView attachments[2] = { target.view, m_targets.depthView };
+			VkRenderPassAttachmentBeginInfo attachmentInfo{};
+			attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+			attachmentInfo.attachmentCount = 2;
+			attachmentInfo.pAttachments = attachments;
+			VkClearValue clearValues[2]{};
+			clearValues[1].depthStencil = { 1.0f, 0 };
+			VkRenderPassBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.pNext = &attachmentInfo;
+			beginInfo.renderPass = m_renderPass;
+			beginInfo.framebuffer = m_targets.framebuffer;
+			beginInfo.renderArea = { { 0, 0 }, target.extent };
+			beginInfo.clearValueCount = 2;
+			beginInfo.pClearValues = clearValues;
+			vkd.vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport{ 0.0f, 0.0f, float(target.extent.width), float(target.extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ { 0, 0 }, target.extent };
+			vkd.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkd.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shaderHotReloader.getPipeline(m_drawPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawLayout, 0, 1, &m_frames[m_currentFrameIndex].drawSet, 0, nullptr);
+		}
+
+		/*
+		* One task workgroup per 32 meshlets of every instance, split into draws of at most maxDrawMeshTasksCount
+		* workgroups, the task shader recovers instance and meshlet from the workgroup id, which includes firstTask
+		*/
+		void recordMeshTasks(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Meshlets");
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Meshlets");
+			beginScenePass(commandBuffer, target);
+			uint32_t groupsPerInstance = (static_cast<uint32_t>(m_meshletMesh.meshlets.size()) + TASK_WORKGROUP_SIZE - 1) / TASK_WORKGROUP_SIZE;
+			uint32_t taskCount = groupsPerInstance * m_settings.instanceCount;
+			for (uint32_t firstTask = 0; firstTask < taskCount; firstTask += m_maxDrawMeshTasksCount)
+			{
+				vkd.vkCmdDrawMeshTasksNV(commandBuffer, std::min(m_maxDrawMeshTasksCount, taskCount - firstTask), firstTask);
+			}
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		void recordCulling(VkCommandBuffer commandBuffer)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Cull Meshlets");
+			vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_shaderHotReloader.getPipeline(m_cullPipeline));
+			vkd.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullLayout, 0, 1, &m_frames[m_currentFrameIndex].cullSet, 0, nullptr);
+			uint32_t meshletCount = static_cast<uint32_t>(m_meshletMesh.meshlets.size());
+			vkd.vkCmdDispatch(commandBuffer, (meshletCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, m_settings.instanceCount, 1);
+		}
+
+		/*
+		* One draw call for every visible cluster of the scene, the culling pass wrote the commands and their count
+		*/
+		void recordIndirectDraws(VkCommandBuffer commandBuffer, const FrameTarget& target)
+		{
+			GpuProfileScope zone(m_gpuProfiler, commandBuffer, "Draw Meshlets");
+			uint32_t statistics = m_pipelineStatistics.beginScope(commandBuffer, "Draw Meshlets");
+			beginScenePass(commandBuffer, target);
+			uint32_t maxDrawCount = m_settings.instanceCount * static_cast<uint32_t>(m_meshletMesh.meshlets.size());
+			vkd.vkCmdDrawIndirectCount(commandBuffer, m_drawCommandBuffer, 0, m_counterBuffer, offsetof(MeshletCounters, visibleMeshletCount),
+				maxDrawCount, sizeof(VkDrawIndirectCommand));
+			vkd.vkCmdEndRenderPass(commandBuffer);
+			m_pipelineStatistics.endScope(commandBuffer, statistics);
+		}
+
+		VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv)
+		{
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
+			VkShaderModule module;
+			if (vkd.vkCreateShaderModule(m_device, &createInfo, m_defaultAllocator, &module) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create shader module!");
+			}
+			return module;
+		}
+
+		VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout)
+		{
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = m_descriptorPool;
+			allocateInfo.descriptorSetCount = 1;
+			allocateInfo.pSetLayouts = &layout;
+			VkDescriptorSet set;
+			if (vkd.vkAllocateDescriptorSets(m_device, &allocateInfo, &set) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate descriptor set!");
+			}
+			return set;
+		}
+
+	private:
+		MeshletSettings					m_settings{};
+		MeshletStatistics				m_statistics{};
+		bool							m_useMeshShaders{ false };
+		uint32_t						m_maxDrawMeshTasksCount{ 1 };
+
+		// One mesh drawn by every instance, kept on the host for the meshlet builder
+		std::vector<Vertex>				m_vertices{};
+		std::vector<uint32_t>			m_indices{};
+		MeshletMesh						m_meshletMesh{};
+		std::vector<Instance>			m_instances{};
+		float							m_gridHalfExtent{ 0.0f };
+
+		VkBuffer						m_vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_meshletBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_meshletMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_boundsBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_boundsMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_vertexIndexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_vertexIndexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_triangleIndexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_triangleIndexMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_instanceBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_instanceMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_counterBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_counterMemory{ VK_NULL_HANDLE };
+		// Vertex path culling outputs
+		VkBuffer						m_drawCommandBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_drawCommandMemory{ VK_NULL_HANDLE };
+		VkBuffer						m_visibleClusterBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory					m_visibleClusterMemory{ VK_NULL_HANDLE };
+
+		SceneTargets					m_targets{ DEPTH_FORMAT, DEPTH_USAGE };
+
+		VkRenderPass					m_renderPass{ VK_NULL_HANDLE };
+
+		// Hot reloader pipeline ids and the layouts their builders took from the pipeline layout cache
+		uint32_t						m_cullPipeline{ 0 };
+		uint32_t						m_drawPipeline{ 0 };
+		VkPipelineLayout				m_cullLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout				m_drawLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_cullSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout			m_drawSetLayout{ VK_NULL_HANDLE };
+
+		VkDescriptorPool				m_descriptorPool{ VK_NULL_HANDLE };
+		std::vector<FrameResources>		m_frames{};
+	};
+
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	using namespace PVulkanExamples;
+
+	MeshletSettings settings{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--instances" && i + 1 < argc) settings.instanceCount = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		else if (argument == "--vertex-path") settings.vertexPath = true;
+		else if (argument == "--no-cone-culling") settings.coneCulling = false;
+		else if (argument == "--no-frustum-culling") settings.frustumCulling = false;
+		else if (argument == "--meshlet-cache" && i + 1 < argc) settings.meshletCachePath = argv[++i];
+	}
+
+	MeshletRenderingExample example(settings);
+	example.parseArguments(argc, argv);
+	example.init();
+	example.run();
+	example.printStatistics();
+	example.cleanup();
+	return 0;
+}
@@ -5,15 +5,18 @@ namespace PVulkanExamples
 {
 	class TriangleExample : public ExampleBase
 	{
-
+	public:
+		TriangleExample() { m_shaderDirectory = getShaderDirectory("triangle"); }
 	};
 
 } // namespace PVulkanExamples
 
-int main()
+int main(int argc, char** argv)
 {
 	PVulkanExamples::TriangleExample example;
+	example.parseArguments(argc, argv);
 	example.init();
+	example.run();
 	example.cleanup();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "test_harness.h"
+#include "vulkan_util.h"
+
+#include <cstring>
+
+/*
+* Physical device pick, queue family selection, memory and descriptor pool limits and leak checks on the mock driver
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		std::string pickedDeviceName(const TestExample& example)
+		{
+			VkPhysicalDeviceProperties properties{};
+			vkd.vkGetPhysicalDeviceProperties(example.m_physicalDevice, &properties);
+			return properties.deviceName;
+		}
+
+		VkResult allocate(const TestExample& example, VkDeviceSize size, uint32_t memoryTypeIndex, VkDeviceMemory& memory)
+		{
+			VkMemoryAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.allocationSize = size;
+			allocateInfo.memoryTypeIndex = memoryTypeIndex;
+			return vkd.vkAllocateMemory(example.m_device, &allocateInfo, example.m_defaultAllocator, &memory);
+		}
+
+		// Keeps a depth target of the frame size like the examples do
+		class DepthTargetExample : public ExampleFixture
+		{
+		public:
+			// Called by the test, cleanup in the fixture's destructor no longer reaches this class' destroyResources
+			void destroyTargets() { destroySceneTargets(m_targets); }
+
+			SceneTargets m_targets{};
+
+		protected:
+			void recordCommandBuffer(VkCommandBuffer, const FrameTarget& target) override { ensureDepthTarget(m_targets, target.extent); }
+		};
+	}
+
+	// Ray tracing is a preferred feature set, the discrete GPU supports it and is picked although it is listed second
+	PVE_TEST_CASE(devicePickPrefersFeatureSets)
+	{
+		ExampleFixture example("createPhysicalDevice", { MockDriver::integratedGpu("Integrated"), MockDriver::discreteGpu("Discrete") });
+		PVE_CHECK(pickedDeviceName(example) == "Discrete");
+		PVE_CHECK(example.isFeatureSetEnabled("RayTracing"));
+	}
+
+	// Devices scoring the same keep the enumeration order
+	PVE_TEST_CASE(devicePickKeepsOrderOnTies)
+	{
+		ExampleFixture example("createPhysicalDevice", { MockDriver::discreteGpu("First"), MockDriver::discreteGpu("Second") });
+		PVE_CHECK(pickedDeviceName(example) == "First");
+	}
+
+	// A device missing a required feature is skipped even when it would score higher
+	PVE_TEST_CASE(devicePickSkipsUnsuitableDevices)
+	{
+		ExampleFixture example("createPhysicalDevice", {
+			MockDriver::discreteGpu("No Anisotropy").disableFeature(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, "samplerAnisotropy"),
+			MockDriver::integratedGpu("Integrated") });
+		PVE_CHECK(pickedDeviceName(example) == "Integrated");
+		PVE_CHECK(!example.isFeatureSetEnabled("RayTracing"));
+	}
+
+	// Required feature sets of the example reject devices without them, no suitable device at all throws
+	PVE_TEST_CASE(devicePickHonorsRequiredFeatureSets)
+	{
+		auto requireIndexing = [](TestExample& example)
+		{
+			example.addDeviceFeatureSet("DescriptorIndexing", FeatureSetPriority::Required);
+			example.addPhysicalDeviceFeatureRequirement(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "runtimeDescriptorArray", "DescriptorIndexing");
+		};
+
+		{
+			ExampleFixture example("createPhysicalDevice", {
+				MockDriver::discreteGpu("No Indexing").disableFeature(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "runtimeDescriptorArray"),
+				MockDriver::integratedGpu("Integrated") }, requireIndexing);
+			PVE_CHECK(pickedDeviceName(example) == "Integrated");
+			PVE_CHECK(example.isFeatureSetEnabled("DescriptorIndexing"));
+		}
+
+		TestExample unsupported;
+		unsupported.m_configure = requireIndexing;
+		unsupported.m_mockDriver.m_physicalDevices = {
+			MockDriver::discreteGpu().disableFeature(VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, "runtimeDescriptorArray") };
+		PVE_CHECK_THROWS(unsupported.initUntil("createPhysicalDevice"));
+		unsupported.cleanup();
+	}
+
+	// The first family with graphics serves graphics and transfer, a family with compute but no graphics gets async compute
+	PVE_TEST_CASE(queueFamilySelection)
+	{
+		{
+			ExampleFixture discrete("createLogicalDevice");
+			PVE_CHECK(discrete.m_queueFamilyIndices.graphicsFamily == 0u);
+			PVE_CHECK(discrete.m_queueFamilyIndices.computeFamily == 1u);
+			PVE_CHECK(discrete.m_queueFamilyIndices.transferFamily == 0u);
+			PVE_CHECK(discrete.m_graphicsQueue != discrete.m_computeQueue);
+		}
+
+		MockPhysicalDeviceDesc singleFamily = MockDriver::discreteGpu();
+		singleFamily.queueFamilies = { { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 1, 64, { 1, 1, 1 } } };
+		{
+			ExampleFixture single("createLogicalDevice", { singleFamily });
+			PVE_CHECK(single.m_queueFamilyIndices.graphicsFamily == 0u);
+			PVE_CHECK(single.m_queueFamilyIndices.computeFamily == 0u);
+			PVE_CHECK(single.m_queueFamilyIndices.transferFamily == 0u);
+		}
+
+		MockPhysicalDeviceDesc computeFirst = MockDriver::discreteGpu();
+		computeFirst.queueFamilies = {
+			{ VK_QUEUE_COMPUTE_BIT, 4, 64, { 1, 1, 1 } },
+			{ VK_QUEUE_TRANSFER_BIT, 1, 64, { 1, 1, 1 } },
+			{ VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 1, 64, { 1, 1, 1 } } };
+		{
+			ExampleFixture split("createLogicalDevice", { computeFirst });
+			PVE_CHECK(split.m_queueFamilyIndices.graphicsFamily == 2u);
+			PVE_CHECK(split.m_queueFamilyIndices.computeFamily == 0u);
+			PVE_CHECK(split.m_queueFamilyIndices.transferFamily == 1u);
+		}
+
+		MockPhysicalDeviceDesc computeOnly = MockDriver::discreteGpu();
+		computeOnly.queueFamilies = { { VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 4, 64, { 1, 1, 1 } } };
+		TestExample noGraphics;
+		noGraphics.m_mockDriver.m_physicalDevices = { computeOnly };
+		PVE_CHECK_THROWS(noGraphics.initUntil("createPhysicalDevice"));
+		noGraphics.cleanup();
+	}
+
+	// Allocations beyond the heap size fail with VK_ERROR_OUT_OF_DEVICE_MEMORY, freeing returns the space
+	PVE_TEST_CASE(memoryHeapExhaustion)
+	{
+		MockPhysicalDeviceDesc desc = MockDriver::discreteGpu();
+		desc.memoryProperties.memoryHeaps[0].size = 64ull << 20;
+		ExampleFixture example("createLogicalDevice", { desc });
+
+		VkDeviceMemory first = VK_NULL_HANDLE;
+		VkDeviceMemory second = VK_NULL_HANDLE;
+		PVE_REQUIRE(allocate(example, 48ull << 20, 0, first) == VK_SUCCESS);
+		PVE_CHECK(MockDriver::getHeapUsage(example.m_device, 0) == 48ull << 20);
+		PVE_CHECK(allocate(example, 32ull << 20, 0, second) == VK_ERROR_OUT_OF_DEVICE_MEMORY);
+		PVE_CHECK(MockDriver::getHeapUsage(example.m_device, 0) == 48ull << 20);
+
+		// The helpers surface the failure as an exception
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory bufferMemory = VK_NULL_HANDLE;
+		PVE_CHECK_THROWS(VulkanUtil::createBuffer(example.m_physicalDevice, example.m_device, 32ull << 20, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory, example.m_defaultAllocator));
+		vkd.vkDestroyBuffer(example.m_device, buffer, example.m_defaultAllocator);
+
+		vkd.vkFreeMemory(example.m_device, first, example.m_defaultAllocator);
+		PVE_CHECK(MockDriver::getHeapUsage(example.m_device, 0) == 0);
+		PVE_CHECK(allocate(example, 32ull << 20, 0, second) == VK_SUCCESS);
+		vkd.vkFreeMemory(example.m_device, second, example.m_defaultAllocator);
+	}
+
+	// The allocation count limit counts live allocations of every memory type
+	PVE_TEST_CASE(maxMemoryAllocationCount)
+	{
+		MockPhysicalDeviceDesc desc = MockDriver::discreteGpu();
+		desc.properties.limits.maxMemoryAllocationCount = 4;
+		ExampleFixture example("createLogicalDevice", { desc });
+
+		std::vector<VkDeviceMemory> memories(4, VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			PVE_REQUIRE(allocate(example, 4096, i, memories[i]) == VK_SUCCESS);
+		}
+		VkDeviceMemory extra = VK_NULL_HANDLE;
+		PVE_CHECK(allocate(example, 4096, 0, extra) == VK_ERROR_TOO_MANY_OBJECTS);
+		vkd.vkFreeMemory(example.m_device, memories[3], example.m_defaultAllocator);
+		PVE_CHECK(allocate(example, 4096, 0, memories[3]) == VK_SUCCESS);
+		for (VkDeviceMemory memory : memories) vkd.vkFreeMemory(example.m_device, memory, example.m_defaultAllocator);
+	}
+
+	// Pools run out of sets and of descriptors of a type separately, a reset gives both back
+	PVE_TEST_CASE(descriptorPoolExhaustion)
+	{
+		ExampleFixture example("createDescriptorPools");
+
+		VkDescriptorSetLayout single = example.m_pipelineLayoutCache.getDescriptorSetLayout({
+			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr } });
+		VkDescriptorSetLayout pair = example.m_pipelineLayoutCache.getDescriptorSetLayout({
+			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr },
+			{ 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr } });
+
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 };
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 2;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		PVE_REQUIRE(vkd.vkCreateDescriptorPool(example.m_device, &poolInfo, example.m_defaultAllocator, &pool) == VK_SUCCESS);
+
+		auto allocateSet = [&](VkDescriptorSetLayout layout)
+		{
+			VkDescriptorSetAllocateInfo allocateInfo{};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocateInfo.descriptorPool = pool;
+			allocateInfo.descriptorSetCount = 1;
+			allocateInfo.pSetLayouts = &layout;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			return vkd.vkAllocateDescriptorSets(example.m_device, &allocateInfo, &set);
+		};
+		PVE_CHECK(allocateSet(pair) == VK_SUCCESS);
+		PVE_CHECK(allocateSet(pair) == VK_ERROR_OUT_OF_POOL_MEMORY);    // Three uniform buffers, four needed
+		PVE_CHECK(allocateSet(single) == VK_SUCCESS);
+		PVE_CHECK(allocateSet(single) == VK_ERROR_OUT_OF_POOL_MEMORY);  // Descriptors left, but no sets
+		PVE_CHECK(example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_DESCRIPTOR_SET) == 2);
+
+		vkd.vkResetDescriptorPool(example.m_device, pool, 0);
+		PVE_CHECK(example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_DESCRIPTOR_SET) == 0);
+		PVE_CHECK(allocateSet(pair) == VK_SUCCESS);
+		vkd.vkDestroyDescriptorPool(example.m_device, pool, example.m_defaultAllocator);
+	}
+
+	// Every object core creates is destroyed by cleanup, also after frames were rendered and when init runs twice
+	PVE_TEST_CASE(noLiveObjectsAfterCleanup)
+	{
+		TestExample example;
+		example.m_mockDriver.m_physicalDevices = { MockDriver::discreteGpu() };
+		example.m_headlessFrameCount = 4;
+		for (uint32_t iteration = 0; iteration < 2; iteration++)
+		{
+			example.init();
+			PVE_CHECK(example.m_mockDriver.getLiveObjectCount() > 0);
+			example.run();
+			example.cleanup();
+			PVE_CHECK(example.m_mockDriver.getLiveObjectCount() == 0);
+			PVE_CHECK(example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_DEVICE_MEMORY) == 0);
+		}
+	}
+
+	// A depth target replaced on resize stays alive until the frame slot it was retired in comes around again
+	PVE_TEST_CASE(resizedDepthTargetIsRetired)
+	{
+		DepthTargetExample example;
+		auto liveImages = [&example]() { return example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_IMAGE); };
+		example.drawFrame();
+		int64_t withDepthTarget = liveImages();
+		PVE_CHECK(example.m_targets.depthImage != VK_NULL_HANDLE);
+
+		example.m_windowWidth = 640;
+		example.drawFrame();
+		PVE_CHECK(example.m_targets.extent.width == 640);
+		for (uint32_t frame = 0; frame < example.m_maxFrameInFlight; frame++)
+		{
+			PVE_CHECK(liveImages() == withDepthTarget + 1);
+			example.drawFrame();
+		}
+		PVE_CHECK(liveImages() == withDepthTarget);
+		example.destroyTargets();
+	}
+} // namespace PVulkanExamples
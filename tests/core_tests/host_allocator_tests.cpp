@@ -0,0 +1,140 @@
+#include "test_harness.h"
+#include "vulkan_host_allocator.h"
+
+/*
+* Host allocation callbacks as the driver sees them: the per frame command arena, size class pools and the budget
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		void* allocate(HostAllocator& allocator, size_t size, VkSystemAllocationScope scope)
+		{
+			VkAllocationCallbacks* callbacks = allocator.getCallbacks();
+			return callbacks->pfnAllocation(callbacks->pUserData, size, 8, scope);
+		}
+
+		void release(HostAllocator& allocator, void* pMemory)
+		{
+			VkAllocationCallbacks* callbacks = allocator.getCallbacks();
+			callbacks->pfnFree(callbacks->pUserData, pMemory);
+		}
+
+		VkBuffer createBuffer(ExampleFixture& example, const VkAllocationCallbacks* pAllocator, VkResult* pResult = nullptr)
+		{
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = 256;
+			bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkResult result = vkd.vkCreateBuffer(example.m_device, &bufferInfo, pAllocator, &buffer);
+			if (pResult) *pResult = result;
+			return buffer;
+		}
+	}
+
+	// Command scope allocations bump through the arena of the current frame slot, which only rewinds once all of them are freed
+	PVE_TEST_CASE(hostAllocatorRewindsCommandArena)
+	{
+		HostAllocator allocator;
+		allocator.init(2, 4096);
+
+		allocator.beginFrame(0);
+		uint8_t* first = static_cast<uint8_t*>(allocate(allocator, 100, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND));
+		uint8_t* second = static_cast<uint8_t*>(allocate(allocator, 100, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND));
+		PVE_REQUIRE(first != nullptr && second != nullptr);
+		PVE_CHECK(second > first);
+		PVE_CHECK(allocator.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND).allocatedBytes == 200);
+
+		// One allocation still alive keeps the slot from rewinding when it comes around again
+		release(allocator, first);
+		allocator.beginFrame(1);
+		void* otherSlot = allocate(allocator, 100, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+		PVE_CHECK(otherSlot != nullptr && (otherSlot < first || otherSlot > second + 100));
+		release(allocator, otherSlot);
+		allocator.beginFrame(0);
+		uint8_t* third = static_cast<uint8_t*>(allocate(allocator, 100, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND));
+		PVE_CHECK(third > second);
+
+		// With nothing alive the slot starts over
+		release(allocator, second);
+		release(allocator, third);
+		allocator.beginFrame(1);
+		allocator.beginFrame(0);
+		void* rewound = allocate(allocator, 100, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+		PVE_CHECK(rewound == first);
+		release(allocator, rewound);
+
+		// More than the arena holds goes to the system heap
+		PVE_CHECK(allocator.getArenaOverflowCount() == 0);
+		void* oversized = allocate(allocator, 8192, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+		PVE_CHECK(oversized != nullptr);
+		PVE_CHECK(allocator.getArenaOverflowCount() == 1);
+		release(allocator, oversized);
+
+		HostAllocationScopeStatistics statistics = allocator.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+		PVE_CHECK(statistics.allocatedBytes == 0);
+		PVE_CHECK(statistics.peakBytes == 8192);
+		PVE_CHECK(statistics.allocationCount == 6);
+		allocator.cleanup();
+	}
+
+	// Objects the mock driver creates with the example's callbacks come from size class blocks that are handed out again once freed
+	PVE_TEST_CASE(hostAllocatorReusesPoolBlocks)
+	{
+		ExampleFixture example("createLogicalDevice");
+		PVE_REQUIRE(example.m_defaultAllocator == example.m_hostAllocator.getCallbacks());
+		HostAllocationScopeStatistics before = example.m_hostAllocator.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+		VkBuffer buffer = createBuffer(example, example.m_defaultAllocator);
+		PVE_REQUIRE(buffer != VK_NULL_HANDLE);
+		HostAllocationScopeStatistics during = example.m_hostAllocator.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+		PVE_CHECK(during.allocatedBytes > before.allocatedBytes);
+		PVE_CHECK(during.allocationCount == before.allocationCount + 1);
+		vkd.vkDestroyBuffer(example.m_device, buffer, example.m_defaultAllocator);
+		PVE_CHECK(example.m_hostAllocator.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT).allocatedBytes == before.allocatedBytes);
+
+		// The mock driver object lives where the allocation callbacks put it, so the freed block shows up as the same handle
+		VkBuffer reused = createBuffer(example, example.m_defaultAllocator);
+		PVE_CHECK(reused == buffer);
+		VkBuffer another = createBuffer(example, example.m_defaultAllocator);
+		PVE_CHECK(another != VK_NULL_HANDLE && another != reused);
+		vkd.vkDestroyBuffer(example.m_device, another, example.m_defaultAllocator);
+		vkd.vkDestroyBuffer(example.m_device, reused, example.m_defaultAllocator);
+	}
+
+	// Past the budget the callbacks return null and the driver fails creation with VK_ERROR_OUT_OF_HOST_MEMORY
+	PVE_TEST_CASE(hostAllocatorRejectsOverBudget)
+	{
+		ExampleFixture example("createLogicalDevice");
+
+		HostAllocator measuring;
+		measuring.init(1);
+		VkBuffer measured = createBuffer(example, measuring.getCallbacks());
+		uint64_t bufferBytes = measuring.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT).allocatedBytes;
+		vkd.vkDestroyBuffer(example.m_device, measured, measuring.getCallbacks());
+		PVE_REQUIRE(bufferBytes > 0);
+
+		HostAllocator limited;
+		limited.init(1, 1 << 20, 2 * bufferBytes);
+		VkBuffer first = createBuffer(example, limited.getCallbacks());
+		VkBuffer second = createBuffer(example, limited.getCallbacks());
+		PVE_CHECK(first != VK_NULL_HANDLE && second != VK_NULL_HANDLE);
+		VkResult result = VK_SUCCESS;
+		PVE_CHECK(createBuffer(example, limited.getCallbacks(), &result) == VK_NULL_HANDLE);
+		PVE_CHECK(result == VK_ERROR_OUT_OF_HOST_MEMORY);
+		PVE_CHECK(limited.getFailedAllocationCount() == 1);
+		PVE_CHECK(limited.getStatistics(VK_SYSTEM_ALLOCATION_SCOPE_OBJECT).allocatedBytes == 2 * bufferBytes);
+
+		// Freeing gives the budget back
+		vkd.vkDestroyBuffer(example.m_device, second, limited.getCallbacks());
+		second = createBuffer(example, limited.getCallbacks(), &result);
+		PVE_CHECK(result == VK_SUCCESS && second != VK_NULL_HANDLE);
+		PVE_CHECK(limited.getFailedAllocationCount() == 1);
+
+		vkd.vkDestroyBuffer(example.m_device, second, limited.getCallbacks());
+		vkd.vkDestroyBuffer(example.m_device, first, limited.getCallbacks());
+		limited.cleanup();
+		measuring.cleanup();
+	}
+} // namespace PVulkanExamples
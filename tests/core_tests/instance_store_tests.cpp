@@ -0,0 +1,65 @@
+#include "test_harness.h"
+#include "vulkan_instance_store.h"
+
+/*
+* Dirty page tracking of the instance store: only the pages of the streams that changed are uploaded, neighbouring
+* pages in one copy region, and a byte budget leaves the rest for the next upload
+*/
+namespace PVulkanExamples
+{
+	PVE_TEST_CASE(instanceStoreUploadsDirtyPages)
+	{
+		ExampleFixture example("initializeCommandBuffers");
+		VkCommandBuffer commandBuffer = example.m_commandBuffers[0];
+
+		RingBuffer stagingRing;
+		stagingRing.init(example.m_physicalDevice, example.m_device, 256 << 10, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 2, example.m_defaultAllocator);
+		InstanceStore store;
+		store.init(example.m_physicalDevice, example.m_device, 8 * InstanceStore::PAGE_SIZE, example.m_defaultAllocator);
+		const VkDeviceSize transformSize = sizeof(InstanceTransform);
+
+		// 1000 instances fill three pages and part of a fourth, every stream goes up in one region
+		for (uint32_t i = 0; i < 1000; i++) store.add(InstanceTransform{}, i % 7, i);
+		stagingRing.beginFrame(0);
+		PVE_CHECK(store.upload(commandBuffer, stagingRing) == 1000 * (transformSize + 8));
+		PVE_CHECK(store.getStatistics().uploadedPages == 12);
+		PVE_CHECK(store.getStatistics().copyRegions == 3);
+		PVE_CHECK(!store.hasDirtyPages());
+		PVE_CHECK(store.upload(commandBuffer, stagingRing) == 0);
+		PVE_CHECK(store.getStatistics().uploads == 1);
+
+		// Moving instances of pages 0, 1 and 3 uploads two transform regions, the last one cut at the instance count,
+		// changing a material uploads its page of the material stream alone
+		store.resetStatistics();
+		InstanceTransform moved{};
+		moved.rows[0][3] = 5.0f;
+		store.setTransform(5, moved);
+		store.setTransform(300, moved);
+		store.setTransform(900, moved);
+		store.setMaterial(700, 42);
+		stagingRing.beginFrame(1);
+		PVE_CHECK(store.upload(commandBuffer, stagingRing) == (512 + 232) * transformSize + InstanceStore::PAGE_SIZE * 4);
+		PVE_CHECK(store.getStatistics().uploadedPages == 4);
+		PVE_CHECK(store.getStatistics().copyRegions == 3);
+		PVE_CHECK(store.getTransform(900).rows[0][3] == 5.0f);
+		PVE_CHECK(store.getMaterial(700) == 42 && store.getFlags(700) == 700);
+
+		// Pages beyond the budget stay dirty for the next upload
+		store.resetStatistics();
+		store.invalidate(InstanceStream::Flags);
+		stagingRing.beginFrame(0);
+		PVE_CHECK(store.upload(commandBuffer, stagingRing, 2 * InstanceStore::PAGE_SIZE * 4) == 2 * InstanceStore::PAGE_SIZE * 4);
+		PVE_CHECK(store.hasDirtyPages());
+		PVE_CHECK(store.upload(commandBuffer, stagingRing) == (256 + 232) * 4);
+		PVE_CHECK(!store.hasDirtyPages());
+		PVE_CHECK(store.getStatistics().uploads == 2);
+		PVE_CHECK(store.getStatistics().uploadedPages == 4);
+
+		// A full store rejects more instances
+		while (store.getCount() < store.getCapacity()) store.add(InstanceTransform{}, 0, 0);
+		PVE_CHECK_THROWS(store.add(InstanceTransform{}, 0, 0));
+
+		store.cleanup();
+		stagingRing.cleanup();
+	}
+} // namespace PVulkanExamples
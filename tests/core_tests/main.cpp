@@ -0,0 +1,68 @@
+#include "test_harness.h"
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+/*
+* Core unit tests on the mock driver, no GPU needed.
+*
+*   core_tests [<test case>...]
+*
+* Without arguments every test case runs. Exits with 1 when a case fails.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		uint32_t s_failureCount{ 0 };
+	}
+
+	std::vector<TestCase>& getTestCases()
+	{
+		static std::vector<TestCase> testCases{};
+		return testCases;
+	}
+
+	void reportFailure(const char* file, int line, const std::string& expression)
+	{
+		std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+		s_failureCount++;
+	}
+
+	int runTests(int argc, char** argv)
+	{
+		uint32_t failedCases = 0;
+		uint32_t runCases = 0;
+		for (const TestCase& testCase : getTestCases())
+		{
+			bool selected = argc <= 1;
+			for (int i = 1; i < argc; i++) selected = selected || testCase.name == std::string(argv[i]);
+			if (!selected) continue;
+
+			uint32_t failuresBefore = s_failureCount;
+			try
+			{
+				testCase.function();
+			}
+			catch (const TestAbort&)
+			{
+			}
+			catch (const std::exception& error)
+			{
+				reportFailure(testCase.name, 0, std::string("unexpected exception: ") + error.what());
+			}
+			bool passed = s_failureCount == failuresBefore;
+			std::cout << (passed ? "[ OK ] " : "[FAIL] ") << testCase.name << std::endl;
+			failedCases += passed ? 0 : 1;
+			runCases++;
+		}
+		std::cout << runCases - failedCases << " / " << runCases << " test cases passed" << std::endl;
+		return failedCases == 0 && runCases > 0 ? 0 : 1;
+	}
+} // namespace PVulkanExamples
+
+int main(int argc, char** argv)
+{
+	return PVulkanExamples::runTests(argc, argv);
+}
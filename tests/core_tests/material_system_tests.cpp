@@ -0,0 +1,88 @@
+#include "test_harness.h"
+#include "vulkan_material_system.h"
+
+/*
+* Material uploads as coalesced deltas and draw sorting by pipeline then material
+*/
+namespace PVulkanExamples
+{
+	PVE_TEST_CASE(materialSystemCoalescesUploads)
+	{
+		ExampleFixture example("initializeCommandBuffers");
+		VkCommandBuffer commandBuffer = example.m_commandBuffers[0];
+
+		RingBuffer stagingRing;
+		stagingRing.init(example.m_physicalDevice, example.m_device, 64 << 10, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 2, example.m_defaultAllocator);
+		MaterialSystem materials;
+		materials.init(example.m_physicalDevice, example.m_device, 16, 4, 2, example.m_defaultAllocator);
+		const VkDeviceSize materialSize = sizeof(MaterialParameters);
+		PVE_CHECK(materialSize == 64);
+
+		// New materials get the lowest free IDs and go up in a single region
+		for (uint32_t i = 0; i < 6; i++) PVE_CHECK(materials.createMaterial({}, 0) == i);
+		stagingRing.beginFrame(0);
+		PVE_CHECK(materials.upload(commandBuffer, stagingRing) == 6 * materialSize);
+		PVE_CHECK(materials.getStatistics().uploadedMaterials == 6);
+		PVE_CHECK(materials.getStatistics().copyRegions == 1);
+		PVE_CHECK(!materials.hasPendingUploads());
+		PVE_CHECK(materials.upload(commandBuffer, stagingRing) == 0);
+		PVE_CHECK(materials.getStatistics().uploads == 1);
+
+		// Updates in any order and repeated updates upload every changed material once, consecutive IDs in one region
+		materials.resetStatistics();
+		MaterialParameters red{};
+		red.baseColor[1] = red.baseColor[2] = 0.0f;
+		materials.updateMaterial(4, red);
+		materials.updateMaterial(1, red);
+		materials.updateMaterial(2, red);
+		materials.updateMaterial(1, red);
+		stagingRing.beginFrame(1);
+		PVE_CHECK(materials.upload(commandBuffer, stagingRing) == 3 * materialSize);
+		PVE_CHECK(materials.getStatistics().uploadedMaterials == 3);
+		PVE_CHECK(materials.getStatistics().copyRegions == 2);
+		PVE_CHECK(materials.getParameters(4).baseColor[1] == 0.0f);
+
+		// Destroyed IDs are reused, the store and the texture array reject more than they hold
+		materials.destroyMaterial(3);
+		PVE_CHECK(materials.createMaterial({}, 0) == 3);
+		while (materials.getMaterialCount() < materials.getMaterialCapacity()) materials.createMaterial({}, 0);
+		PVE_CHECK_THROWS(materials.createMaterial({}, 0));
+		for (uint32_t i = 0; i < materials.getTextureCapacity(); i++) PVE_CHECK(materials.addTexture(VK_NULL_HANDLE, VK_NULL_HANDLE) == i);
+		PVE_CHECK_THROWS(materials.addTexture(VK_NULL_HANDLE, VK_NULL_HANDLE));
+
+		materials.cleanup();
+		stagingRing.cleanup();
+	}
+
+	PVE_TEST_CASE(materialSystemSortsDraws)
+	{
+		ExampleFixture example("createLogicalDevice");
+
+		MaterialSystem materials;
+		materials.init(example.m_physicalDevice, example.m_device, 16, 4, 2, example.m_defaultAllocator);
+		for (uint32_t pipeline : { 2, 1, 2, 1, 0, 2 }) materials.createMaterial({}, pipeline);
+
+		// Draws of a pipeline end up together, those of a material next to each other in submission order
+		std::vector<MaterialDraw> draws{ { 5, 0 }, { 0, 1 }, { 1, 2 }, { 4, 3 }, { 3, 4 }, { 0, 5 }, { 1, 6 } };
+		PVE_CHECK(materials.sortDraws(draws) == 3);
+		std::vector<uint32_t> materialOrder;
+		std::vector<uint32_t> drawOrder;
+		for (const MaterialDraw& draw : draws)
+		{
+			materialOrder.push_back(draw.materialId);
+			drawOrder.push_back(draw.drawIndex);
+		}
+		PVE_CHECK((materialOrder == std::vector<uint32_t>{ 4, 1, 1, 3, 0, 0, 5 }));
+		PVE_CHECK((drawOrder == std::vector<uint32_t>{ 3, 2, 6, 4, 1, 5, 0 }));
+
+		// Moving a material to another pipeline regroups its draws
+		materials.setMaterialPipeline(4, 1);
+		PVE_CHECK(materials.sortDraws(draws) == 2);
+		PVE_CHECK(draws.front().materialId == 1 && draws[3].materialId == 4);
+
+		std::vector<MaterialDraw> none;
+		PVE_CHECK(materials.sortDraws(none) == 0);
+
+		materials.cleanup();
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,155 @@
+#include "test_harness.h"
+#include "vulkan_meshlet.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+/*
+* Meshlet splitting, bounds and the meshlet file cache, all on the CPU
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		// Flat grid of quads in the z = 0 plane facing +z, positions followed by a texture coordinate
+		struct Grid
+		{
+			std::vector<float>      vertices{};
+			std::vector<uint32_t>   indices{};
+			static constexpr size_t STRIDE = 5 * sizeof(float);
+
+			explicit Grid(uint32_t quads)
+			{
+				for (uint32_t y = 0; y <= quads; y++)
+				{
+					for (uint32_t x = 0; x <= quads; x++)
+					{
+						vertices.insert(vertices.end(), { float(x), float(y), 0.0f, float(x) / quads, float(y) / quads });
+					}
+				}
+				for (uint32_t y = 0; y < quads; y++)
+				{
+					for (uint32_t x = 0; x < quads; x++)
+					{
+						uint32_t corner = y * (quads + 1) + x;
+						indices.insert(indices.end(), { corner, corner + 1, corner + quads + 1, corner + 1, corner + quads + 2, corner + quads + 1 });
+					}
+				}
+			}
+
+			size_t getVertexCount() const { return vertices.size() / 5; }
+		};
+
+		// Mesh triangles rotated to start at their smallest index, winding kept
+		std::vector<std::array<uint32_t, 3>> normalizeTriangles(std::vector<std::array<uint32_t, 3>> triangles)
+		{
+			for (auto& triangle : triangles)
+			{
+				std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			}
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		}
+	}
+
+	// Every triangle lands in exactly one meshlet within the limits, bounds enclose the meshlet
+	PVE_TEST_CASE(meshletBuildCoversMesh)
+	{
+		Grid grid(16);
+		MeshletBuildSettings settings{};
+		MeshletMesh mesh = MeshletBuilder::build(grid.vertices.data(), Grid::STRIDE, grid.getVertexCount(), grid.indices.data(), grid.indices.size(), settings);
+		PVE_REQUIRE(!mesh.meshlets.empty());
+		PVE_CHECK(mesh.bounds.size() == mesh.meshlets.size());
+
+		std::vector<std::array<uint32_t, 3>> source;
+		for (size_t i = 0; i < grid.indices.size(); i += 3) source.push_back({ grid.indices[i], grid.indices[i + 1], grid.indices[i + 2] });
+		std::vector<std::array<uint32_t, 3>> built;
+		for (size_t index = 0; index < mesh.meshlets.size(); index++)
+		{
+			const Meshlet& meshlet = mesh.meshlets[index];
+			const MeshletBounds& bounds = mesh.bounds[index];
+			PVE_CHECK(meshlet.vertexCount <= settings.maxVertices && meshlet.triangleCount <= settings.maxTriangles);
+			PVE_CHECK(meshlet.triangleOffset % 4 == 0);
+			for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				std::array<uint32_t, 3> vertices{};
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					uint8_t local = mesh.triangleIndices[meshlet.triangleOffset + triangle * 3 + corner];
+					PVE_REQUIRE(local < meshlet.vertexCount);
+					vertices[corner] = mesh.vertexIndices[meshlet.vertexOffset + local];
+				}
+				built.push_back(vertices);
+			}
+			for (uint32_t vertex = 0; vertex < meshlet.vertexCount; vertex++)
+			{
+				const float* p = &grid.vertices[size_t(mesh.vertexIndices[meshlet.vertexOffset + vertex]) * 5];
+				float distance = std::sqrt((p[0] - bounds.center[0]) * (p[0] - bounds.center[0]) +
+					(p[1] - bounds.center[1]) * (p[1] - bounds.center[1]) + (p[2] - bounds.center[2]) * (p[2] - bounds.center[2]));
+				PVE_CHECK(distance <= bounds.radius + 1e-4f);
+			}
+			// A flat meshlet is back facing from anywhere behind its plane
+			PVE_CHECK(std::fabs(bounds.coneAxis[2] - 1.0f) < 1e-4f && bounds.coneCutoff < 1e-3f);
+		}
+		PVE_CHECK(normalizeTriangles(built) == normalizeTriangles(source));
+
+		// Growing over shared edges keeps meshlets compact, a 6 by 6 quad patch of 49 vertices holds 72 triangles
+		PVE_CHECK(mesh.meshlets.size() <= 10);
+
+		// Tighter limits are honoured as well
+		MeshletBuildSettings small{ 16, 16 };
+		MeshletMesh smallMesh = MeshletBuilder::build(grid.vertices.data(), Grid::STRIDE, grid.getVertexCount(), grid.indices.data(), grid.indices.size(), small);
+		uint32_t triangleCount = 0;
+		for (const Meshlet& meshlet : smallMesh.meshlets)
+		{
+			PVE_CHECK(meshlet.vertexCount <= 16 && meshlet.triangleCount <= 16);
+			triangleCount += meshlet.triangleCount;
+		}
+		PVE_CHECK(triangleCount == grid.indices.size() / 3);
+	}
+
+	// Disconnected parts never share a meshlet, triangles facing opposite ways leave the meshlet without a cone
+	PVE_TEST_CASE(meshletBuildSplitsDisconnectedParts)
+	{
+		const float positions[]{ 0, 0, 0, 1, 0, 0, 0, 1, 0, 10, 0, 0, 11, 0, 0, 10, 1, 0 };
+		const uint32_t separate[]{ 0, 1, 2, 3, 4, 5 };
+		MeshletMesh mesh = MeshletBuilder::build(positions, 3 * sizeof(float), 6, separate, 6);
+		PVE_REQUIRE(mesh.meshlets.size() == 2);
+		PVE_CHECK(mesh.meshlets[0].triangleCount == 1 && mesh.meshlets[1].triangleCount == 1);
+		PVE_CHECK(mesh.meshlets[1].triangleOffset == 4);
+
+		const uint32_t doubleSided[]{ 0, 1, 2, 0, 2, 1 };
+		MeshletMesh twoSided = MeshletBuilder::build(positions, 3 * sizeof(float), 3, doubleSided, 6);
+		PVE_REQUIRE(twoSided.meshlets.size() == 1);
+		const MeshletBounds& bounds = twoSided.bounds[0];
+		PVE_CHECK(bounds.coneAxis[0] == 0.0f && bounds.coneAxis[1] == 0.0f && bounds.coneAxis[2] == 0.0f);
+		PVE_CHECK(bounds.coneCutoff == 1.0f);
+	}
+
+	// Saved meshlets load back only for the source data they were built from
+	PVE_TEST_CASE(meshletFileRoundTrip)
+	{
+		Grid grid(8);
+		uint64_t hash = MeshletBuilder::hashSource(grid.vertices.data(), Grid::STRIDE, grid.getVertexCount(), grid.indices.data(), grid.indices.size());
+		MeshletMesh mesh = MeshletBuilder::build(grid.vertices.data(), Grid::STRIDE, grid.getVertexCount(), grid.indices.data(), grid.indices.size());
+		PVE_CHECK(mesh.sourceHash == hash);
+		PVE_CHECK(hash != MeshletBuilder::hashSource(grid.vertices.data(), Grid::STRIDE, grid.getVertexCount(), grid.indices.data(),
+			grid.indices.size(), { 32, 64 }));
+
+		std::string path = (std::filesystem::temp_directory_path() / "pve_core_tests.meshlets").string();
+		MeshletBuilder::save(path, mesh);
+		MeshletMesh loaded;
+		PVE_CHECK(!MeshletBuilder::load(path, hash + 1, loaded));
+		PVE_REQUIRE(MeshletBuilder::load(path, hash, loaded));
+		PVE_CHECK(loaded.meshlets.size() == mesh.meshlets.size());
+		PVE_CHECK(loaded.vertexIndices == mesh.vertexIndices);
+		PVE_CHECK(loaded.triangleIndices == mesh.triangleIndices);
+		PVE_CHECK(std::memcmp(loaded.bounds.data(), mesh.bounds.data(), mesh.bounds.size() * sizeof(MeshletBounds)) == 0);
+		std::remove(path.c_str());
+		PVE_CHECK(!MeshletBuilder::load(path, hash, loaded));
+	}
+} // namespace PVulkanExamples
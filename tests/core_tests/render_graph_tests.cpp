@@ -0,0 +1,211 @@
+#include "test_harness.h"
+
+/*
+* Render graph culling, barrier planning and async compute queue assignment, declared against the frame targets of a
+* headless example on the mock driver
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		const RenderGraphResourceState COLOR_ATTACHMENT_STATE{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+
+		RenderGraphResource importColorTarget(TestExample& example)
+		{
+			const OffscreenTarget& target = example.m_offscreenTargets[0];
+			return example.m_renderGraph.importImage("Color", target.image, target.view, example.m_offscreenFormat,
+				{ example.m_windowWidth, example.m_windowHeight }, COLOR_ATTACHMENT_STATE, COLOR_ATTACHMENT_STATE);
+		}
+	}
+
+	// Passes whose results reach neither an imported resource nor a pass with side effects are culled and never run
+	PVE_TEST_CASE(renderGraphCullsUnusedPasses)
+	{
+		ExampleFixture example;
+		RenderGraph& graph = example.m_renderGraph;
+		graph.beginFrame(0);
+
+		std::vector<std::string> executed;
+		auto record = [&executed](const char* name)
+		{
+			return [&executed, name](VkCommandBuffer, const RenderGraph&) { executed.push_back(name); };
+		};
+		RenderGraphResource color = importColorTarget(example);
+		RenderGraphResource unused = graph.createImage("Unused", { VK_FORMAT_R16G16B16A16_SFLOAT, { 256, 256 } });
+		RenderGraphResource chain = graph.createBuffer("Chain", { 1 << 16 });
+		RenderGraphResource log = graph.createBuffer("Log", { 1 << 10 });
+
+		uint32_t dead = graph.addPass("Dead", RenderGraphPassType::Raster, record("Dead"))
+			.write(unused, RenderGraphUsage::ColorAttachment).getIndex();
+		uint32_t producer = graph.addPass("Producer", RenderGraphPassType::Compute, record("Producer"))
+			.write(chain, RenderGraphUsage::StorageWrite).getIndex();
+		uint32_t consumer = graph.addPass("Consumer", RenderGraphPassType::Raster, record("Consumer"))
+			.read(chain, RenderGraphUsage::VertexRead)
+			.write(color, RenderGraphUsage::ColorAttachment).getIndex();
+		uint32_t logger = graph.addPass("Logger", RenderGraphPassType::Compute, record("Logger"))
+			.write(log, RenderGraphUsage::StorageWrite)
+			.setSideEffects().getIndex();
+		graph.compile();
+		graph.execute(example.m_commandBuffers[0]);
+
+		PVE_CHECK(graph.isPassCulled(dead));
+		PVE_CHECK(!graph.isPassCulled(producer));
+		PVE_CHECK(!graph.isPassCulled(consumer));
+		PVE_CHECK(!graph.isPassCulled(logger));
+		PVE_CHECK(graph.getStatistics().passCount == 4);
+		PVE_CHECK(graph.getStatistics().culledPassCount == 1);
+		PVE_CHECK((executed == std::vector<std::string>{ "Producer", "Consumer", "Logger" }));
+		PVE_CHECK(graph.getImage(unused) == VK_NULL_HANDLE);
+	}
+
+	/*
+	* Read after write, write after read and write after write each get one barrier, repeated reads and the first write
+	* of an imported resource arriving in the declared state get none
+	*/
+	PVE_TEST_CASE(renderGraphPlansBarriers)
+	{
+		ExampleFixture example;
+		RenderGraph& graph = example.m_renderGraph;
+		graph.beginFrame(0);
+
+		RenderGraphResource color = importColorTarget(example);
+		RenderGraphResource vertices = graph.createBuffer("Vertices", { 1 << 16 });
+		auto nothing = [](VkCommandBuffer, const RenderGraph&) {};
+		graph.addPass("Simulate", RenderGraphPassType::Compute, nothing)
+			.write(vertices, RenderGraphUsage::StorageWrite);                  // First use, no barrier
+		graph.addPass("Draw", RenderGraphPassType::Raster, nothing)
+			.read(vertices, RenderGraphUsage::VertexRead)                      // Read after write
+			.write(color, RenderGraphUsage::ColorAttachment);                  // Arrives in the declared state
+		graph.addPass("Draw Again", RenderGraphPassType::Raster, nothing)
+			.read(vertices, RenderGraphUsage::VertexRead)                      // Already visible
+			.write(color, RenderGraphUsage::ColorAttachment);                  // Write after write
+		graph.addPass("Update", RenderGraphPassType::Compute, nothing)
+			.write(vertices, RenderGraphUsage::StorageWrite)                   // Write after read
+			.setSideEffects();
+		graph.compile();
+
+		const RenderGraphStatistics& statistics = graph.getStatistics();
+		PVE_CHECK(statistics.culledPassCount == 0);
+		PVE_CHECK(statistics.barrierBatchCount == 3);
+		PVE_CHECK(statistics.bufferBarrierCount == 2);
+		PVE_CHECK(statistics.imageBarrierCount == 1);
+
+		// Sampling a transient render target transitions it twice, handing the color target over for transfer adds a final barrier
+		graph.beginFrame(1);
+		color = example.m_renderGraph.importImage("Color", example.m_offscreenTargets[1].image, example.m_offscreenTargets[1].view,
+			example.m_offscreenFormat, { example.m_windowWidth, example.m_windowHeight }, {},
+			{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT });
+		RenderGraphResource scene = graph.createImage("Scene", { VK_FORMAT_R16G16B16A16_SFLOAT, { 800, 600 } });
+		graph.addPass("Scene", RenderGraphPassType::Raster, nothing)
+			.write(scene, RenderGraphUsage::ColorAttachment);
+		graph.addPass("Resolve", RenderGraphPassType::Raster, nothing)
+			.read(scene, RenderGraphUsage::SampledRead)
+			.write(color, RenderGraphUsage::ColorAttachment);
+		graph.compile();
+		PVE_CHECK(statistics.barrierBatchCount == 3);
+		PVE_CHECK(statistics.imageBarrierCount == 4);
+		PVE_CHECK(statistics.bufferBarrierCount == 0);
+	}
+
+	// A transient placed in the memory of earlier ones waits for every stage that used them and makes their writes available
+	PVE_TEST_CASE(renderGraphPlansAliasingBarriers)
+	{
+		ExampleFixture example;
+		RenderGraph& graph = example.m_renderGraph;
+		graph.beginFrame(0);
+
+		RenderGraphResource first = graph.createBuffer("First", { 1 << 16 });
+		RenderGraphResource second = graph.createBuffer("Second", { 1 << 16 });
+		auto nothing = [](VkCommandBuffer, const RenderGraph&) {};
+		graph.addPass("Produce", RenderGraphPassType::Compute, nothing)
+			.write(first, RenderGraphUsage::StorageWrite);
+		graph.addPass("Consume", RenderGraphPassType::Raster, nothing)
+			.read(first, RenderGraphUsage::VertexRead)
+			.setSideEffects();
+		uint32_t reuse = graph.addPass("Reuse", RenderGraphPassType::Compute, nothing)
+			.write(second, RenderGraphUsage::StorageWrite)
+			.setSideEffects().getIndex();
+		graph.compile();
+
+		const RenderGraphStatistics& statistics = graph.getStatistics();
+		PVE_REQUIRE(statistics.transientAllocatedSize < statistics.transientRequestedSize);
+		const std::vector<RenderGraphBarrier>& barriers = graph.getPassBarriers(reuse);
+		PVE_REQUIRE(barriers.size() == 1);
+		const RenderGraphBarrier& barrier = barriers[0];
+		PVE_CHECK(barrier.resource == second);
+		PVE_CHECK(barrier.srcStages == (VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+		PVE_CHECK(barrier.srcAccess == VK_ACCESS_SHADER_WRITE_BIT);
+		PVE_CHECK(barrier.dstStages == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		PVE_CHECK(graph.getFinalBarriers().empty());
+	}
+
+	/*
+	* Async compute passes move to the compute queue only while they touch transients no graphics pass touched before,
+	* the graphics submission then waits for them at the stages of their first graphics consumer
+	*/
+	PVE_TEST_CASE(renderGraphAsyncCompute)
+	{
+		ExampleFixture example;
+		RenderGraph& graph = example.m_renderGraph;
+		PVE_REQUIRE(graph.hasAsyncCompute());
+		graph.beginFrame(0);
+
+		VkCommandBuffer graphicsCommandBuffer = example.m_commandBuffers[0];
+		VkCommandBuffer asyncCommandBuffer = VK_NULL_HANDLE;
+		RenderGraphResource color = importColorTarget(example);
+		RenderGraphResource particles = graph.createBuffer("Particles", { 1 << 16 });
+		RenderGraphResource readback = example.m_renderGraph.importBuffer("Readback", example.m_offscreenTargets[0].readbackBuffer,
+			VK_WHOLE_SIZE, {}, {});
+		uint32_t simulate = graph.addPass("Simulate", RenderGraphPassType::AsyncCompute,
+			[&asyncCommandBuffer](VkCommandBuffer commandBuffer, const RenderGraph&) { asyncCommandBuffer = commandBuffer; })
+			.write(particles, RenderGraphUsage::StorageWrite).getIndex();
+		graph.addPass("Draw", RenderGraphPassType::Raster, [](VkCommandBuffer, const RenderGraph&) {})
+			.read(particles, RenderGraphUsage::VertexRead)
+			.write(color, RenderGraphUsage::ColorAttachment);
+		uint32_t afterGraphics = graph.addPass("Sort", RenderGraphPassType::AsyncCompute, [](VkCommandBuffer, const RenderGraph&) {})
+			.write(particles, RenderGraphUsage::StorageWrite)
+			.setSideEffects().getIndex();
+		uint32_t imported = graph.addPass("Export", RenderGraphPassType::AsyncCompute, [](VkCommandBuffer, const RenderGraph&) {})
+			.write(readback, RenderGraphUsage::StorageWrite).getIndex();
+		graph.compile();
+
+		PVE_CHECK(graph.isPassOnComputeQueue(simulate));
+		PVE_CHECK(!graph.isPassOnComputeQueue(afterGraphics));
+		PVE_CHECK(!graph.isPassOnComputeQueue(imported));
+		PVE_CHECK(graph.getStatistics().asyncComputePassCount == 1);
+
+		graph.execute(graphicsCommandBuffer);
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		VkPipelineStageFlags waitStage = 0;
+		PVE_REQUIRE(graph.getAsyncComputeWait(semaphore, waitStage));
+		PVE_CHECK(semaphore != VK_NULL_HANDLE);
+		PVE_CHECK(waitStage == VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+		PVE_CHECK(asyncCommandBuffer != VK_NULL_HANDLE && asyncCommandBuffer != graphicsCommandBuffer);
+
+		// The next frame in the slot waits for the compute fence and starts without a pending compute submission
+		graph.beginFrame(0);
+		PVE_CHECK(!graph.getAsyncComputeWait(semaphore, waitStage));
+	}
+
+	// A single queue family keeps every pass on the graphics queue
+	PVE_TEST_CASE(renderGraphAsyncComputeOnSingleQueue)
+	{
+		MockPhysicalDeviceDesc singleFamily = MockDriver::discreteGpu();
+		singleFamily.queueFamilies = { { VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, 1, 64, { 1, 1, 1 } } };
+		ExampleFixture single(nullptr, { singleFamily });
+		RenderGraph& singleQueue = single.m_renderGraph;
+		PVE_CHECK(!singleQueue.hasAsyncCompute());
+		singleQueue.beginFrame(0);
+		RenderGraphResource buffer = singleQueue.createBuffer("Particles", { 1 << 16 });
+		uint32_t pass = singleQueue.addPass("Simulate", RenderGraphPassType::AsyncCompute, [](VkCommandBuffer, const RenderGraph&) {})
+			.write(buffer, RenderGraphUsage::StorageWrite)
+			.setSideEffects().getIndex();
+		singleQueue.compile();
+		singleQueue.execute(single.m_commandBuffers[0]);
+		PVE_CHECK(!singleQueue.isPassOnComputeQueue(pass));
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		VkPipelineStageFlags waitStage = 0;
+		PVE_CHECK(!singleQueue.getAsyncComputeWait(semaphore, waitStage));
+	}
+} // namespace PVulkanExamples
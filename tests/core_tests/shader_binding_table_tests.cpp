@@ -0,0 +1,95 @@
+#include "test_harness.h"
+#include "vulkan_shader_binding_table.h"
+
+#include <cstring>
+
+/*
+* Shader binding table layout and partial updates. The mock reports 32 byte handles aligned to 32, regions aligned to 64
+* and fills every byte of a handle with the group index plus one.
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		using Ranges = std::vector<std::pair<VkDeviceSize, VkDeviceSize>>;
+	}
+
+	PVE_TEST_CASE(shaderBindingTableLayout)
+	{
+		ExampleFixture example("initializeCommandBuffers");
+
+		ShaderBindingTable table;
+		table.init(example.m_physicalDevice, example.m_device, example.m_defaultAllocator);
+		const uint8_t color[8]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+		table.addRecord(ShaderRecordKind::RayGen, 0);
+		table.addRecord(ShaderRecordKind::RayGen, 1);
+		table.addRecord(ShaderRecordKind::Miss, 2);
+		table.addRecord(ShaderRecordKind::Miss, 3);
+		table.addRecord(ShaderRecordKind::Hit, 4, color, sizeof(color));
+		table.addRecord(ShaderRecordKind::Hit, 5, nullptr, 0, 10);
+		table.addRecord(ShaderRecordKind::Hit, 6);
+		table.build(VK_NULL_HANDLE);
+
+		// Ray generation records start at the base alignment, hit records hold the handle and up to 10 bytes of data
+		VkStridedDeviceAddressRegionKHR rayGen = table.getRayGenRegion();
+		PVE_CHECK(rayGen.deviceAddress != 0 && rayGen.deviceAddress % 64 == 0);
+		PVE_CHECK(rayGen.stride == 64 && rayGen.size == 64);
+		PVE_CHECK(table.getRayGenRegion(1).deviceAddress == rayGen.deviceAddress + 64);
+		PVE_CHECK(table.getMissRegion().deviceAddress == rayGen.deviceAddress + 128);
+		PVE_CHECK(table.getMissRegion().stride == 32 && table.getMissRegion().size == 64);
+		PVE_CHECK(table.getHitRegion().deviceAddress == rayGen.deviceAddress + 192);
+		PVE_CHECK(table.getHitRegion().stride == 64 && table.getHitRegion().size == 192);
+		PVE_CHECK(table.getCallableRegion().deviceAddress == 0 && table.getCallableRegion().size == 0);
+		PVE_CHECK(table.getSize() == 384);
+
+		const std::vector<uint8_t>& data = table.getTableData();
+		PVE_CHECK(data[0] == 1 && data[64] == 2 && data[160] == 4 && data[192 + 31] == 5);
+		PVE_CHECK(std::memcmp(&data[192 + 32], color, sizeof(color)) == 0);
+		PVE_CHECK(data[256 + 32] == 0);
+
+		// The whole table is written by the first flush
+		PVE_CHECK((table.getDirtyRanges() == Ranges{ { 0, 384 } }));
+		table.flush(example.m_commandBuffers[0]);
+		PVE_CHECK(table.getDirtyRanges().empty());
+
+		table.cleanup();
+	}
+
+	// Changed records are merged with touching ranges of earlier calls, widened to 4 bytes and otherwise kept apart
+	PVE_TEST_CASE(shaderBindingTableDirtyRanges)
+	{
+		ExampleFixture example("initializeCommandBuffers");
+
+		ShaderBindingTable table;
+		table.init(example.m_physicalDevice, example.m_device, example.m_defaultAllocator);
+		table.addRecord(ShaderRecordKind::RayGen, 0);
+		table.addRecord(ShaderRecordKind::Miss, 1);
+		table.addRecord(ShaderRecordKind::Miss, 2);
+		for (uint32_t i = 0; i < 3; i++) table.addRecord(ShaderRecordKind::Hit, 3, nullptr, 0, 10);
+		table.build(VK_NULL_HANDLE);
+		table.flush(example.m_commandBuffers[0]);
+
+		// Regions: ray generation at 0, miss at 64 with a stride of 32, hit at 128 with a stride of 64
+		const uint16_t material = 0x0BAD;
+		table.setRecord(ShaderRecordKind::Hit, 2, 3, &material, sizeof(material));
+		PVE_CHECK((table.getDirtyRanges() == Ranges{ { 256, 44 } }));
+		table.setRecord(ShaderRecordKind::Miss, 0, 2);
+		PVE_CHECK((table.getDirtyRanges() == Ranges{ { 64, 32 }, { 256, 44 } }));
+		table.setRecord(ShaderRecordKind::Miss, 1, 1);
+		table.setRecord(ShaderRecordKind::Hit, 0, 3);
+		PVE_CHECK((table.getDirtyRanges() == Ranges{ { 64, 108 }, { 256, 44 } }));
+		table.setRecord(ShaderRecordKind::Miss, 0, 1);
+		PVE_CHECK((table.getDirtyRanges() == Ranges{ { 64, 108 }, { 256, 44 } }));
+		PVE_CHECK(table.getTableData()[64] == 2 && table.getTableData()[96] == 2);
+		PVE_CHECK(std::memcmp(&table.getTableData()[256 + 32], &material, sizeof(material)) == 0);
+
+		// Data beyond the declared room and groups outside the pipeline are rejected
+		uint8_t tooLarge[12]{};
+		PVE_CHECK_THROWS(table.setRecord(ShaderRecordKind::Hit, 0, 3, tooLarge, sizeof(tooLarge)));
+		PVE_CHECK_THROWS(table.setRecord(ShaderRecordKind::Miss, 0, 4));
+
+		table.flush(example.m_commandBuffers[0]);
+		PVE_CHECK(table.getDirtyRanges().empty());
+		table.cleanup();
+	}
+} // namespace PVulkanExamples
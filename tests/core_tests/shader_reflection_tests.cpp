@@ -0,0 +1,228 @@
+#include "test_harness.h"
+#include "vulkan_shader_reflection.h"
+
+#include <cstring>
+
+/*
+* Shader reflection on hand assembled SPIR-V, stage merging and the pipeline layout cache on the mock driver
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		enum : uint32_t
+		{
+			OpName = 5,
+			OpEntryPoint = 15,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeImage = 25,
+			OpTypeSampledImage = 27,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+
+			DecorationBlock = 2,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+
+			StorageClassUniformConstant = 0,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+
+			ExecutionModelVertex = 0,
+			ExecutionModelFragment = 4,
+		};
+
+		// Just the instructions reflection reads, in no particular order and without function bodies
+		class SpirvBuilder
+		{
+		public:
+			explicit SpirvBuilder(uint32_t executionModel)
+			{
+				m_float = newId();
+				m_vec4 = newId();
+				add(OpEntryPoint, { executionModel, newId() }, "main");
+				add(OpTypeFloat, { m_float, 32 });
+				add(OpTypeVector, { m_vec4, m_float, 4 });
+			}
+
+			uint32_t newId() { return m_nextId++; }
+
+			// Instruction with an optional literal string as its last operand, null terminated and padded to whole words
+			void add(uint32_t opcode, std::vector<uint32_t> operands, const char* string = nullptr)
+			{
+				if (string)
+				{
+					size_t first = operands.size();
+					operands.resize(first + std::strlen(string) / sizeof(uint32_t) + 1, 0);
+					std::memcpy(&operands[first], string, std::strlen(string));
+				}
+				m_words.push_back((static_cast<uint32_t>(operands.size() + 1) << 16) | opcode);
+				m_words.insert(m_words.end(), operands.begin(), operands.end());
+			}
+
+			// Block of the given members, one per offset, vec4 members from offset 0 and float members after that
+			uint32_t block(const std::vector<uint32_t>& offsets, bool vectors)
+			{
+				uint32_t type = newId();
+				std::vector<uint32_t> operands{ type };
+				for (size_t i = 0; i < offsets.size(); i++) operands.push_back(vectors && i == 0 ? m_vec4 : m_float);
+				add(OpTypeStruct, operands);
+				add(OpDecorate, { type, DecorationBlock });
+				for (uint32_t i = 0; i < offsets.size(); i++) add(OpMemberDecorate, { type, i, DecorationOffset, offsets[i] });
+				return type;
+			}
+
+			uint32_t sampledImageArray()
+			{
+				uint32_t image = newId();
+				uint32_t sampledImage = newId();
+				uint32_t array = newId();
+				add(OpTypeImage, { image, m_float, 1, 0, 0, 0, 1, 0 });
+				add(OpTypeSampledImage, { sampledImage, image });
+				add(OpTypeRuntimeArray, { array, sampledImage });
+				return array;
+			}
+
+			void variable(uint32_t type, uint32_t storageClass, const char* name, uint32_t set = UINT32_MAX, uint32_t binding = UINT32_MAX)
+			{
+				uint32_t pointer = newId();
+				uint32_t id = newId();
+				add(OpTypePointer, { pointer, storageClass, type });
+				add(OpVariable, { pointer, id, storageClass });
+				add(OpName, { id }, name);
+				if (set != UINT32_MAX) add(OpDecorate, { id, DecorationDescriptorSet, set });
+				if (binding != UINT32_MAX) add(OpDecorate, { id, DecorationBinding, binding });
+			}
+
+			ShaderReflection reflect()
+			{
+				std::vector<uint32_t> words{ 0x07230203, 0x00010000, 0, m_nextId, 0 };
+				words.insert(words.end(), m_words.begin(), m_words.end());
+				return ShaderReflectionUtil::reflect(words);
+			}
+
+		private:
+			std::vector<uint32_t>   m_words{};
+			uint32_t                m_nextId{ 1 };
+			uint32_t                m_float{ 0 };
+			uint32_t                m_vec4{ 0 };
+		};
+
+		// Uniform block at set 0 binding 0 and push constants at bytes 0 to 20
+		ShaderReflection vertexStage()
+		{
+			SpirvBuilder builder(ExecutionModelVertex);
+			builder.variable(builder.block({ 0 }, true), StorageClassUniform, "ubo", 0, 0);
+			builder.variable(builder.block({ 0, 16 }, true), StorageClassPushConstant, "pc");
+			return builder.reflect();
+		}
+
+		// The same uniform block, or a storage buffer in its place, a texture array at set 2 and push constants at bytes 16 to 20
+		ShaderReflection fragmentStage(bool conflicting = false)
+		{
+			SpirvBuilder builder(ExecutionModelFragment);
+			builder.variable(builder.block({ 0 }, true), conflicting ? StorageClassStorageBuffer : StorageClassUniform, "ubo", 0, 0);
+			builder.variable(builder.sampledImageArray(), StorageClassUniformConstant, "tex", 2, 1);
+			builder.variable(builder.block({ 16 }, false), StorageClassPushConstant, "pc");
+			return builder.reflect();
+		}
+	}
+
+	PVE_TEST_CASE(shaderReflectionReadsStageInterface)
+	{
+		ShaderReflection vertex = vertexStage();
+		PVE_CHECK(vertex.stage == VK_SHADER_STAGE_VERTEX_BIT);
+		PVE_CHECK(vertex.entryPoint == "main");
+		PVE_REQUIRE(vertex.descriptorBindings.size() == 1);
+		PVE_CHECK(vertex.descriptorBindings[0].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+		PVE_CHECK(vertex.descriptorBindings[0].name == "ubo");
+		PVE_REQUIRE(vertex.pushConstantRanges.size() == 1);
+		PVE_CHECK(vertex.pushConstantRanges[0].offset == 0 && vertex.pushConstantRanges[0].size == 20);
+
+		// Push constants start at the first member offset, runtime arrays have no descriptor count
+		ShaderReflection fragment = fragmentStage();
+		PVE_CHECK(fragment.stage == VK_SHADER_STAGE_FRAGMENT_BIT);
+		PVE_REQUIRE(fragment.descriptorBindings.size() == 2);
+		PVE_CHECK(fragment.descriptorBindings[1].set == 2 && fragment.descriptorBindings[1].binding == 1);
+		PVE_CHECK(fragment.descriptorBindings[1].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		PVE_CHECK(fragment.descriptorBindings[1].descriptorCount == 0);
+		PVE_REQUIRE(fragment.pushConstantRanges.size() == 1);
+		PVE_CHECK(fragment.pushConstantRanges[0].offset == 16 && fragment.pushConstantRanges[0].size == 4);
+
+		PVE_CHECK_THROWS(ShaderReflectionUtil::reflect(std::vector<uint32_t>{ 0x07230203, 0x00010000, 0, 1, 0 }));
+		PVE_CHECK_THROWS(ShaderReflectionUtil::reflect(std::vector<uint32_t>{ 0, 0, 0, 0, 0 }));
+	}
+
+	// Bindings used by several stages get their stage flags combined, push constants become one range covering all stages
+	PVE_TEST_CASE(shaderReflectionMergesStages)
+	{
+		PipelineLayoutDescription description = ShaderReflectionUtil::mergeStages({ vertexStage(), fragmentStage() });
+		PVE_REQUIRE(description.sets.size() == 2);
+		const std::vector<VkDescriptorSetLayoutBinding>& shared = description.sets[0];
+		PVE_REQUIRE(shared.size() == 1);
+		PVE_CHECK(shared[0].stageFlags == (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
+		PVE_CHECK(shared[0].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && shared[0].descriptorCount == 1);
+		PVE_REQUIRE(description.sets[2].size() == 1);
+		PVE_CHECK(description.sets[2][0].stageFlags == VK_SHADER_STAGE_FRAGMENT_BIT);
+
+		PVE_REQUIRE(description.pushConstantRanges.size() == 1);
+		const VkPushConstantRange& range = description.pushConstantRanges[0];
+		PVE_CHECK(range.stageFlags == (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
+		PVE_CHECK(range.offset == 0 && range.size == 20);
+
+		// The same binding declared with another type in one stage is an error
+		PVE_CHECK_THROWS(ShaderReflectionUtil::mergeStages({ vertexStage(), fragmentStage(true) }));
+	}
+
+	// Identical interfaces share set and pipeline layouts, holes in the set numbers get the empty set layout
+	PVE_TEST_CASE(pipelineLayoutCacheReusesLayouts)
+	{
+		ExampleFixture example("createLogicalDevice");
+		std::vector<ShaderReflection> stages{ vertexStage(), fragmentStage() };
+
+		PipelineLayoutCache withoutIndexing;
+		withoutIndexing.init(example.m_device, example.m_defaultAllocator);
+		PVE_CHECK_THROWS(withoutIndexing.getPipelineLayout(stages));
+		withoutIndexing.cleanup();
+
+		PipelineLayoutCache cache;
+		cache.init(example.m_device, example.m_defaultAllocator, true);
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		VkPipelineLayout layout = cache.getPipelineLayout(stages, &setLayouts);
+		PVE_CHECK(layout != VK_NULL_HANDLE);
+		PVE_REQUIRE(setLayouts.size() == 3);
+		PVE_CHECK(setLayouts[1] == cache.getDescriptorSetLayout({}));
+		PVE_CHECK(cache.descriptorSetLayoutCount() == 3);
+		PVE_CHECK(cache.pipelineLayoutCount() == 1);
+
+		// Hits create nothing, whichever order the bindings come in
+		PVE_CHECK(cache.getPipelineLayout({ vertexStage(), fragmentStage() }) == layout);
+		PVE_CHECK(cache.getPipelineLayout(setLayouts, { { VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, 20 } }) == layout);
+		VkDescriptorSetLayoutBinding uniforms{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr };
+		VkDescriptorSetLayoutBinding storage{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_ALL, nullptr };
+		PVE_CHECK(cache.getDescriptorSetLayout({ uniforms, storage }) == cache.getDescriptorSetLayout({ storage, uniforms }));
+		PVE_CHECK(cache.descriptorSetLayoutCount() == 4);
+		PVE_CHECK(cache.pipelineLayoutCount() == 1);
+
+		// Other stage flags or push constants are another interface
+		std::vector<VkDescriptorSetLayout> vertexSetLayouts;
+		VkPipelineLayout vertexLayout = cache.getPipelineLayout({ vertexStage() }, &vertexSetLayouts);
+		PVE_CHECK(vertexLayout != layout);
+		PVE_REQUIRE(vertexSetLayouts.size() == 1);
+		PVE_CHECK(vertexSetLayouts[0] != setLayouts[0]);
+		PVE_CHECK(cache.getPipelineLayout(setLayouts, {}) != layout);
+		PVE_CHECK(cache.descriptorSetLayoutCount() == 5);
+		PVE_CHECK(cache.pipelineLayoutCount() == 3);
+		PVE_CHECK(example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_PIPELINE_LAYOUT) == 3);
+		PVE_CHECK(example.m_mockDriver.getLiveObjectCount(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT) == 5);
+
+		cache.cleanup();
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "vulkan_example_base.h"
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+* Minimal test registry of the core tests. PVE_TEST_CASE registers a function run by main in registration order,
+* PVE_CHECK records a failure and carries on, PVE_REQUIRE records it and ends the case. An exception escaping a case
+* fails it as well.
+*/
+namespace PVulkanExamples
+{
+	struct TestCase
+	{
+		const char* name;
+		void        (*function)();
+	};
+
+	// Thrown by PVE_REQUIRE, caught by the runner
+	struct TestAbort {};
+
+	std::vector<TestCase>& getTestCases();
+	void reportFailure(const char* file, int line, const std::string& expression);
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* name, void (*function)()) { getTestCases().push_back({ name, function }); }
+	};
+
+	/*
+	* Headless example on the mock driver without resources of its own. The devices the mock reports are set through
+	* m_mockDriver before init, requirements added by configure on top of the ones every example has.
+	*/
+	class TestExample : public ExampleBase
+	{
+	public:
+		TestExample()
+		{
+			m_useMockDriver = true;
+			m_headless = true;
+			m_requestValidation = false;
+		}
+
+		// Run the init steps up to and including the named one
+		void initUntil(const char* lastStep)
+		{
+			for (const InitStep& step : getInitSteps())
+			{
+				(this->*step.function)();
+				if (std::string(step.name) == lastStep) return;
+			}
+		}
+
+		std::function<void(TestExample&)> m_configure{};
+
+	protected:
+		void configureDeviceRequirements() override
+		{
+			if (m_configure) m_configure(*this);
+		}
+	};
+
+	/*
+	* Test example initialized on the given mock devices for the lifetime of a test case. Construction runs the init
+	* steps up to and including lastStep, all of them without one. Destruction cleans the example up and checks that
+	* no mock objects are left, so everything the test created on the device must be destroyed by then.
+	*/
+	class ExampleFixture : public TestExample
+	{
+	public:
+		explicit ExampleFixture(const char* lastStep = nullptr, std::vector<MockPhysicalDeviceDesc> physicalDevices = { MockDriver::discreteGpu() },
+			std::function<void(TestExample&)> configure = {})
+		{
+			m_mockDriver.m_physicalDevices = std::move(physicalDevices);
+			m_configure = std::move(configure);
+			if (lastStep) initUntil(lastStep);
+			else init();
+		}
+
+		~ExampleFixture()
+		{
+			// A failed PVE_REQUIRE unwinds through here with the test's own objects still alive, only clean up then
+			bool unwinding = std::uncaught_exceptions() > 0;
+			try
+			{
+				cleanup();
+			}
+			catch (const std::exception& error)
+			{
+				reportFailure(__FILE__, __LINE__, std::string("cleanup threw: ") + error.what());
+				return;
+			}
+			if (!unwinding && m_mockDriver.getLiveObjectCount() != 0) reportFailure(__FILE__, __LINE__, "no live objects after cleanup");
+		}
+
+		ExampleFixture(const ExampleFixture&) = delete;
+		ExampleFixture& operator=(const ExampleFixture&) = delete;
+	};
+} // namespace PVulkanExamples
+
+#define PVE_TEST_CASE(name) \
+	static void name(); \
+	static PVulkanExamples::TestRegistrar name##Registrar(#name, &name); \
+	static void name()
+
+#define PVE_CHECK(expression) \
+	do { if (!(expression)) PVulkanExamples::reportFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define PVE_REQUIRE(expression) \
+	do { if (!(expression)) { PVulkanExamples::reportFailure(__FILE__, __LINE__, #expression); throw PVulkanExamples::TestAbort{}; } } while (0)
+
+#define PVE_CHECK_THROWS(expression) \
+	do { bool thrown = false; try { expression; } catch (const std::exception&) { thrown = true; } \
+		if (!thrown) PVulkanExamples::reportFailure(__FILE__, __LINE__, "throws " #expression); } while (0)
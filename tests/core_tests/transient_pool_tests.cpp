@@ -0,0 +1,86 @@
+#include "test_harness.h"
+#include "vulkan_transient_pool.h"
+
+/*
+* Placement of transient resources: disjoint lifetimes share memory, overlapping ones and concurrent resources do not,
+* single pass attachments go to lazily allocated memory where the device has it
+*/
+namespace PVulkanExamples
+{
+	// The mock aligns buffers to 256 bytes and reports a buffer image granularity of 1024
+	PVE_TEST_CASE(transientPoolAliasesDisjointLifetimes)
+	{
+		ExampleFixture example("createLogicalDevice");
+
+		TransientResourcePool pool;
+		pool.init(example.m_physicalDevice, example.m_device, example.m_defaultAllocator);
+		uint32_t early = pool.addBuffer("Early", 64 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, 1);
+		uint32_t late = pool.addBuffer("Late", 64 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 2, 3);
+		uint32_t spanning = pool.addBuffer("Spanning", 32 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 1, 2);
+		uint32_t odd = pool.addBuffer("Odd", 1000, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 3, 3);
+		pool.allocate();
+
+		// Late reuses the memory of Early, Spanning overlaps both and goes behind them, Odd reuses the memory of Spanning
+		const TransientPoolStatistics& statistics = pool.getStatistics();
+		PVE_CHECK(statistics.requestedSize == (160 << 10) + 1024);
+		PVE_CHECK(statistics.allocatedSize == 96 << 10);
+		PVE_CHECK(statistics.memoryCount == 1);
+		PVE_CHECK(statistics.lazilyAllocatedSize == 0);
+		PVE_CHECK(pool.getAliasPredecessors(early).empty());
+		PVE_CHECK((pool.getAliasPredecessors(late) == std::vector<uint32_t>{ early }));
+		PVE_CHECK(pool.getAliasPredecessors(spanning).empty());
+		PVE_CHECK((pool.getAliasPredecessors(odd) == std::vector<uint32_t>{ spanning }));
+		PVE_CHECK(MockDriver::getHeapUsage(example.m_device, 0) == 96 << 10);
+		PVE_CHECK_THROWS(pool.allocate());
+
+		// A reset destroys everything, the pool is declared again for the next frame
+		pool.reset();
+		PVE_CHECK(pool.getResourceCount() == 0);
+		PVE_CHECK(MockDriver::getHeapUsage(example.m_device, 0) == 0);
+		pool.cleanup();
+
+		// Resources shared between queues do not alias and get memory of their own
+		TransientResourcePool shared;
+		shared.init(example.m_physicalDevice, example.m_device, example.m_defaultAllocator,
+			{ example.m_queueFamilyIndices.graphicsFamily.value(), example.m_queueFamilyIndices.computeFamily.value() });
+		shared.addBuffer("Exclusive", 64 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, 0);
+		uint32_t concurrent = shared.addBuffer("Concurrent", 64 << 10, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 1, 1, true);
+		shared.allocate();
+		PVE_CHECK(shared.getStatistics().memoryCount == 2);
+		PVE_CHECK(shared.getStatistics().allocatedSize == 128 << 10);
+		PVE_CHECK(shared.getAliasPredecessors(concurrent).empty());
+		shared.cleanup();
+	}
+
+	// Attachments never used outside one pass are lazily allocated where the device has such memory and fall back to device local memory
+	PVE_TEST_CASE(transientPoolLazilyAllocatesAttachments)
+	{
+		for (bool lazyMemory : { true, false })
+		{
+			MockPhysicalDeviceDesc desc = MockDriver::discreteGpu();
+			if (lazyMemory)
+			{
+				desc.memoryProperties.memoryTypes[desc.memoryProperties.memoryTypeCount++] = {
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, 0 };
+			}
+			ExampleFixture example("createLogicalDevice", { desc });
+
+			TransientResourcePool pool;
+			pool.init(example.m_physicalDevice, example.m_device, example.m_defaultAllocator);
+			uint32_t depth = pool.addImage("Depth", VK_FORMAT_D32_SFLOAT, { 256, 256 }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, 0);
+			uint32_t sampled = pool.addImage("Sampled", VK_FORMAT_R8G8B8A8_UNORM, { 256, 256 },
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, 0);
+			uint32_t resolved = pool.addImage("Resolved", VK_FORMAT_R8G8B8A8_UNORM, { 256, 256 }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0, 1);
+			pool.allocate();
+
+			PVE_CHECK(pool.isLazilyAllocated(depth) == lazyMemory);
+			PVE_CHECK(!pool.isLazilyAllocated(sampled));
+			PVE_CHECK(!pool.isLazilyAllocated(resolved));
+			PVE_CHECK(pool.getStatistics().lazilyAllocatedSize == (lazyMemory ? 256 << 10 : 0));
+			PVE_CHECK(pool.getStatistics().memoryCount == (lazyMemory ? 2u : 1u));
+			PVE_CHECK(pool.getImageView(depth) != VK_NULL_HANDLE);
+			PVE_CHECK(TransientResourcePool::getImageAspect(VK_FORMAT_D32_SFLOAT) == VK_IMAGE_ASPECT_DEPTH_BIT);
+			pool.cleanup();
+		}
+	}
+} // namespace PVulkanExamples
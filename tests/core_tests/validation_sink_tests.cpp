@@ -0,0 +1,99 @@
+#include "test_harness.h"
+#include "vulkan_validation_sink.h"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+/*
+* Validation messages going through the sink's queue, with std::cerr captured while the sink runs
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		class CapturedErrorStream
+		{
+		public:
+			CapturedErrorStream() : m_previous(std::cerr.rdbuf(m_stream.rdbuf())) {}
+			~CapturedErrorStream() { release(); }
+
+			// Give std::cerr back, so failed checks are reported, and return what was written in the meantime.
+			// Only call once the sink has stopped, its thread writes to the stream before that.
+			std::string release()
+			{
+				if (m_previous != nullptr) std::cerr.rdbuf(m_previous);
+				m_previous = nullptr;
+				return m_stream.str();
+			}
+
+		private:
+			std::ostringstream  m_stream{};
+			std::streambuf*     m_previous{ nullptr };
+		};
+
+		void sendMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity, int32_t messageId, const std::string& text, ValidationMessageSink& sink)
+		{
+			VkDebugUtilsMessengerCallbackDataEXT data{};
+			data.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+			data.messageIdNumber = messageId;
+			data.pMessage = text.c_str();
+			ValidationMessageSink::debugCallback(severity, VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT, &data, &sink);
+		}
+	}
+
+	// Errors wait in the queue with everything else and come out in submission order when the sink stops
+	PVE_TEST_CASE(validationSinkQueuesErrors)
+	{
+		CapturedErrorStream captured;
+		ValidationMessageSink sink;
+		sink.m_summaryPeriod = std::chrono::hours(1);
+		sink.start();
+		sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, 1, "first warning", sink);
+		sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, 2, "first error", sink);
+		sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, 3, "second warning", sink);
+		sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, 4, "below threshold", sink);
+		sink.stop();
+		// Messages sent after stop are ignored
+		sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, 2, "late error", sink);
+
+		std::string text = captured.release();
+		size_t firstWarning = text.find("[warning] first warning");
+		size_t error = text.find("[error] first error");
+		size_t secondWarning = text.find("[warning] second warning");
+		PVE_REQUIRE(firstWarning != std::string::npos && error != std::string::npos && secondWarning != std::string::npos);
+		PVE_CHECK(firstWarning < error && error < secondWarning);
+		PVE_CHECK(text.find("first error", secondWarning) == std::string::npos);
+		PVE_CHECK(text.find("below threshold") == std::string::npos);
+		PVE_CHECK(text.find("late error") == std::string::npos);
+	}
+
+	// Once every slot of the id table is taken, new ids share one counter with the same occurrence limit
+	PVE_TEST_CASE(validationSinkLimitsUntrackedIds)
+	{
+		const int32_t tableCapacity = 1024;
+		CapturedErrorStream captured;
+		ValidationMessageSink sink;
+		sink.m_firstOccurrences = 1;
+		sink.m_summaryPeriod = std::chrono::hours(1);
+		sink.start();
+		for (int32_t id = 0; id < tableCapacity; id++)
+		{
+			sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, id, "tracked " + std::to_string(id), sink);
+			// Let the background thread keep up, the queue holds fewer messages than the table
+			if (id % 32 == 31) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		for (int32_t id = tableCapacity; id < tableCapacity + 5; id++)
+		{
+			sendMessage(VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, id, "untracked " + std::to_string(id - tableCapacity), sink);
+		}
+		sink.stop();
+
+		std::string text = captured.release();
+		PVE_CHECK(text.find("messages dropped") == std::string::npos);
+		PVE_CHECK(text.find("tracked 1023\n") != std::string::npos);
+		PVE_CHECK(text.find("untracked 0\n") != std::string::npos);
+		PVE_CHECK(text.find("untracked 1\n") == std::string::npos);
+		PVE_CHECK(text.find("messages with untracked ids repeated 4 more times (5 total)") != std::string::npos);
+	}
+} // namespace PVulkanExamples
@@ -0,0 +1,50 @@
+#include "test_harness.h"
+#include "vulkan_vertex_blending.h"
+
+/*
+* Vertex blending workgroup tables and dispatch size on a mock device with a small maxComputeWorkGroupCount
+*/
+namespace PVulkanExamples
+{
+	namespace
+	{
+		// Three workgroups per mesh, the last one blending a single vertex
+		uint32_t addMeshes(VertexBlending& blending, uint32_t meshCount)
+		{
+			BlendGeometryDesc geometry{};
+			geometry.vertices.resize(2 * VertexBlending::WORKGROUP_SIZE + 1);
+			uint32_t geometryIndex = blending.addGeometry(geometry);
+			for (uint32_t mesh = 0; mesh < meshCount; mesh++) blending.addMesh(geometryIndex);
+			return blending.getWorkgroupCount();
+		}
+	}
+
+	// Workgroups beyond maxComputeWorkGroupCount[0] go to further rows, beyond the whole grid creation fails
+	PVE_TEST_CASE(vertexBlendingRespectsWorkgroupCountLimit)
+	{
+		MockPhysicalDeviceDesc desc = MockDriver::discreteGpu();
+		desc.properties.limits.maxComputeWorkGroupCount[0] = 4;
+		desc.properties.limits.maxComputeWorkGroupCount[1] = 4;
+		ExampleFixture example("createLogicalDevice", { desc });
+
+		VertexBlending single;
+		single.init(example.m_physicalDevice, example.m_device, 8, example.m_defaultAllocator);
+		PVE_CHECK(addMeshes(single, 1) == 3);
+		single.createBuffers(false);
+		PVE_CHECK(single.getDispatchSize().width == 3 && single.getDispatchSize().height == 1);
+		single.cleanup();
+
+		VertexBlending rows;
+		rows.init(example.m_physicalDevice, example.m_device, 8, example.m_defaultAllocator);
+		PVE_CHECK(addMeshes(rows, 3) == 9);
+		rows.createBuffers(false);
+		PVE_CHECK(rows.getDispatchSize().width == 4 && rows.getDispatchSize().height == 3);
+		rows.cleanup();
+
+		VertexBlending tooMany;
+		tooMany.init(example.m_physicalDevice, example.m_device, 8, example.m_defaultAllocator);
+		PVE_CHECK(addMeshes(tooMany, 6) == 18);
+		PVE_CHECK_THROWS(tooMany.createBuffers(false));
+		tooMany.cleanup();
+	}
+} // namespace PVulkanExamples